@@ -0,0 +1,150 @@
+# Decoder of the sample history download (HISTORY DATA notifications, see
+# include/history.h and include/codec.h)
+#
+# Usage: tclsh ShowHistory.tcl ?-rollup|-log? capture.txt
+#   capture.txt: one HISTORY DATA notification per line, in hex as logged by
+#   the BLE tool (spaces, dashes and a 0x prefix are ignored)
+#   -rollup: the capture is the download of a rollup tier (include/rollup.h)
+#   -log: the capture is the download of the flash log (include/flashlog.h),
+#   the times are in s since the reset that preceded each block
+# Output: one line per sample: block sequence number, sensor index, time in s
+# since the reset of the device (see the HISTORY CTRL status for the current
+# time) and value in degC. With -rollup one line per rollup: block sequence
+# number, sensor index, start of the bucket in s since reset, bucket period in
+# s, mean, min and max in degC
+
+set Stream ""
+set Expected ""
+set Rollup 0
+set Log 0
+
+# Value of a field of the bit string (LSB first, as given by binary scan b*)
+proc HistoryField {Bits Pos Width} {
+	set Value 0
+	for {set i [expr {$Width - 1}]} {$i >= 0} {incr i -1} {
+		set Value [expr {($Value << 1) | [string index $Bits [expr {$Pos + $i}]]}]
+	}
+	return $Value
+}
+
+proc HistorySample {Seq Sensor Time Value} {
+	puts [format "%u,%u,%u,%.2f" $Seq $Sensor $Time [expr {$Value / 100.0}]]
+}
+
+# Decodes the complete blocks at the start of Data, returns the rest
+proc HistoryBlocks {Data} {
+	while {[string length $Data] >= 14} {
+		binary scan $Data iuiuscucucucu Seq Time Value Sensor Count VWidth TWidth
+		if {$Count < 1 || $VWidth > 17 || $TWidth > 16} {
+			puts stderr "invalid block header, stream dropped"
+			return ""
+		}
+		set Size [expr {14 + (($Count - 1) * ($VWidth + $TWidth) + 7) / 8}]
+		if {[string length $Data] < $Size} {
+			break
+		}
+		binary scan [string range $Data 14 [expr {$Size - 1}]] b* Bits
+		set Pos 0
+		HistorySample $Seq $Sensor $Time $Value
+		for {set i 1} {$i < $Count} {incr i} {
+			incr Time [HistoryField $Bits $Pos $TWidth]
+			incr Pos $TWidth
+			set Z [HistoryField $Bits $Pos $VWidth]
+			incr Pos $VWidth
+			# Zigzag: 0, 1, 2, 3 -> 0, -1, 1, -2
+			incr Value [expr {$Z & 1 ? -(($Z + 1) >> 1) : $Z >> 1}]
+			HistorySample $Seq $Sensor $Time $Value
+		}
+		set Data [string range $Data $Size end]
+	}
+	return $Data
+}
+
+proc HistoryRollup {Seq Sensor Time Period Mean Min Max} {
+	puts [format "%u,%u,%u,%u,%.2f,%.2f,%.2f" $Seq $Sensor $Time $Period \
+		[expr {$Mean / 100.0}] [expr {$Min / 100.0}] [expr {$Max / 100.0}]]
+}
+
+# Decodes the complete rollup blocks at the start of Data, returns the rest
+proc HistoryRollupBlocks {Data} {
+	while {[string length $Data] >= 17} {
+		binary scan $Data iuiussucucucucucu Seq Time Mean Period Sensor Count SWidth MWidth DWidth
+		if {$Count < 1 || $SWidth > 16 || $MWidth > 17 || $DWidth > 16} {
+			puts stderr "invalid rollup block header, stream dropped"
+			return ""
+		}
+		set Size [expr {17 + (($Count - 1) * ($SWidth + $MWidth) + $Count * 2 * $DWidth + 7) / 8}]
+		if {[string length $Data] < $Size} {
+			break
+		}
+		binary scan [string range $Data 17 [expr {$Size - 1}]] b* Bits
+		set Pos 0
+		for {set i 0} {$i < $Count} {incr i} {
+			if {$i > 0} {
+				incr Time [expr {$Period * ([HistoryField $Bits $Pos $SWidth] + 1)}]
+				incr Pos $SWidth
+				set Z [HistoryField $Bits $Pos $MWidth]
+				incr Pos $MWidth
+				incr Mean [expr {$Z & 1 ? -(($Z + 1) >> 1) : $Z >> 1}]
+			}
+			set Min [expr {$Mean - [HistoryField $Bits $Pos $DWidth]}]
+			incr Pos $DWidth
+			set Max [expr {$Mean + [HistoryField $Bits $Pos $DWidth]}]
+			incr Pos $DWidth
+			HistoryRollup $Seq $Sensor $Time $Period $Mean $Min $Max
+		}
+		set Data [string range $Data $Size end]
+	}
+	return $Data
+}
+
+# One notification: stream offset (uint32) then the next bytes of the blocks,
+# or record sequence number (uint32) then the next bytes of the record
+proc HistoryPacket {Packet} {
+	global Stream Expected Rollup Log
+	if {[binary scan $Packet iu Offset] != 1} {
+		return
+	}
+	set Data [string range $Packet 4 end]
+	if {$Log} {
+		# A record continues in the notifications with the same sequence
+		# number
+		if {$Stream ne "" && $Offset != $Expected} {
+			puts stderr "record $Expected incomplete, dropped"
+			set Stream ""
+		}
+		set Expected $Offset
+	} elseif {$Expected ne "" && $Offset != $Expected} {
+		# Blocks overwritten before they were sent, a new block starts here
+		puts stderr "gap at offset $Expected, partial block dropped"
+		set Stream ""
+	}
+	append Stream $Data
+	if {!$Log} {
+		set Expected [expr {$Offset + [string length $Data]}]
+	}
+	if {$Rollup} {
+		set Stream [HistoryRollupBlocks $Stream]
+	} else {
+		set Stream [HistoryBlocks $Stream]
+	}
+}
+
+if {$argc == 2 && [lindex $argv 0] eq "-rollup"} {
+	set Rollup 1
+	set argv [lrange $argv 1 end]
+} elseif {$argc == 2 && [lindex $argv 0] eq "-log"} {
+	set Log 1
+	set argv [lrange $argv 1 end]
+} elseif {$argc != 1} {
+	puts stderr "usage: tclsh ShowHistory.tcl ?-rollup|-log? capture.txt"
+	exit 1
+}
+set f [open [lindex $argv 0]]
+while {[gets $f line] >= 0} {
+	regsub -all -nocase {0x|[^0-9a-f]} $line "" Hex
+	if {$Hex ne ""} {
+		HistoryPacket [binary format H* $Hex]
+	}
+}
+close $f
@@ -56,8 +56,9 @@ pack [label .l -font "Helvetica 60 bold"]
 proc GetData {chan} {
 	if {[gets $chan line]>=0} {
 		#puts $line
-		if {[regexp {^(.*)C\s+(.*)%} $line {} Temp Hum]} {
-			.l config -text "${Temp}C\n${Hum}%"
+		# First sensor of the "<temp>C  <temp>C ..." line
+		if {[regexp {^\s*(\S+)C} $line {} Temp]} {
+			.l config -text "${Temp}C"
 		}
 	}
 }
@@ -18,9 +18,6 @@
 
 /* Application Environment Structure */
 struct app_env_tag app_env;
-struct NCT375_Reg_tag nct375;
-extern void TIMER0_IRQHandler(void);
-extern void TIMER1_IRQHandler(void);
 
 /* ----------------------------------------------------------------------------
  * Function      : void LCD_ShowAll()
@@ -32,22 +29,94 @@ extern void TIMER1_IRQHandler(void);
  * ------------------------------------------------------------------------- */
 
 /* ----------------------------------------------------------------------------
- * Function      : void UART_WriteEnvData()
+ * Function      : void UART_WriteEnvData(const int16_t *value)
  * ----------------------------------------------------------------------------
- * Description   : Write the environment data to the UART
- * Inputs        : None
+ * Description   : Write the environment data to the UART, one value per
+ *                 sensor registered with the sampler, with the unit of its
+ *                 quantity
+ * Inputs        : - value      - Published values, in the order the sensors
+ *                                are registered
  * Outputs       : void
  * Assumptions   : None
  * ------------------------------------------------------------------------- */
-void UART_WriteEnvData(void)
+void UART_WriteEnvData(const int16_t *value)
 {
-	UART_WriteInt32(app_env.temperature, 2);
-	UART_WriteString("C  ");
-//	UART_WriteInt32(app_env.humidity, 2);
-	UART_WriteString("%\n\r");
+	/* Decimals and unit of each sensor_quantity_t */
+	static const int8_t dec_pos[] = { 2, 2, 1 };
+	static const char * const unit[] = { "C  ", "%RH  ", "hPa  " };
+	uint8_t quantity;
+	uint8_t i;
+
+	for (i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		quantity = sampler_env.sensor[i].driver->quantity;
+		if (value[i] == SENSOR_VALUE_INVALID)
+		{
+			UART_WriteString("--");
+		}
+		else
+		{
+			UART_WriteInt32(value[i], dec_pos[quantity]);
+		}
+		UART_WriteString(unit[quantity]);
+	}
+	UART_WriteString("\n\r");
 }
 
 
+/* ----------------------------------------------------------------------------
+ * Function      : void UART_WriteI2CStats()
+ * ----------------------------------------------------------------------------
+ * Description   : Write the I2C transaction statistics to the UART. Durations
+ *                 are in SYSCLK cycles, the histogram lists the log2 buckets
+ *                 starting at 2^I2C_STATS_HIST_MIN_LOG2 cycles.
+ * Inputs        : None
+ * Outputs       : void
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void UART_WriteI2CStats(void)
+{
+	const struct i2c_stats_tag *stats = I2C_Stats_Get();
+	uint8_t i;
+
+	UART_WriteString("I2C xfer ");
+	UART_WriteInt32(stats->transactions, 0);
+	UART_WriteString(" fail ");
+	UART_WriteInt32(stats->failures, 0);
+	UART_WriteString(" tx ");
+	UART_WriteInt32(stats->bytes_tx, 0);
+	UART_WriteString(" rx ");
+	UART_WriteInt32(stats->bytes_rx, 0);
+	UART_WriteString("\n\r");
+	UART_Flush();
+
+	UART_WriteString("nack ");
+	UART_WriteInt32(stats->nacks, 0);
+	UART_WriteString(" berr ");
+	UART_WriteInt32(stats->bus_errors, 0);
+	UART_WriteString(" tmo ");
+	UART_WriteInt32(stats->timeouts, 0);
+	UART_WriteString(" retry ");
+	UART_WriteInt32(stats->retries, 0);
+	UART_WriteString(" full ");
+	UART_WriteInt32(stats->queue_full, 0);
+	UART_WriteString("\n\r");
+	UART_Flush();
+
+	UART_WriteString("max ");
+	UART_WriteInt32(stats->duration_max, 0);
+	UART_WriteString(" isr max ");
+	UART_WriteInt32(stats->isr_max, 0);
+	UART_WriteString("\n\rhist");
+	for (i = 0; i < I2C_STATS_HIST_BUCKETS; i++)
+	{
+		UART_Flush();
+		UART_WriteString(" ");
+		UART_WriteInt32(stats->duration_hist[i], 0);
+	}
+	UART_WriteString("\n\r");
+}
+
 /* ----------------------------------------------------------------------------
  * Function      : int APP_Timer(ke_msg_idd_t const msg_id,
  *                               void const *param,
@@ -69,10 +138,26 @@ int APP_Timer(ke_msg_id_t const msg_id,
               ke_task_id_t const src_id)
 {
     int16_t rssi_avg;
+    uint8_t uart_cmd;
 
     /* Restart timer */
     ke_timer_set(APP_TIMER, TASK_APP, TIMER_1S_SETTING);
 
+    /* Time of the sample history (extends the time base tick), copy of the
+     * closed history blocks to the flash log and the archive */
+    History_Tick();
+    FlashLog_Process();
+    Archive_Process();
+
+    /* Dump the I2C statistics on request ('s' received on the UART) */
+    while (UART_Read(&uart_cmd, 1))
+    {
+        if (uart_cmd == UART_CMD_I2C_STATS)
+        {
+            UART_WriteI2CStats();
+        }
+    }
+
     /* Turn on LED of EVB if the link is established and
      * blinking when it is advertising */
     switch(ble_env.state)
@@ -102,22 +187,36 @@ int APP_Timer(ke_msg_id_t const msg_id,
 
     /* Update some service characteristics */
 
-    /* Update the timeout */
-   	if ( ble_env.state==APPM_CONNECTED && (app_env.timeout_cccd & ATT_CCC_START_NTF) )
+    /* Update the timeout, notified as its policy allows (see notify.h) */
+   	if (Notify_Check(NOTIFY_TIMEOUT, &app_env.timeout, 1,
+   	                 ble_env.state==APPM_CONNECTED && (app_env.timeout_cccd & ATT_CCC_START_NTF)))
    	{
    		REAK_SendNotification(&app_env.timeout);
    	}
 
-   	/* Update the RSSI and notify an eventual change if notification is enabled
+   	/* Update the RSSI and notify it as its policy allows
    	 * RSSI[dBm] = 0.317 * RF_REG32->RSSI_AVG - 107.9 */
     rssi_avg = (RF_REG32->RSSI_AVG_RSSI_AVG_BYTE * 81 - 27622)>>8;
-    if ( ble_env.state==APPM_CONNECTED && rssi_avg != app_env.rssi_avg )
+    if ( ble_env.state==APPM_CONNECTED )
     {
         app_env.rssi_avg = rssi_avg;
-        if ( app_env.rssi_avg_cccd & ATT_CCC_START_NTF )
-        {
-            REAK_SendNotification(&app_env.rssi_avg);
-        }
+    }
+    if (Notify_Check(NOTIFY_RSSI_AVG, &rssi_avg, 1,
+                     ble_env.state==APPM_CONNECTED && (app_env.rssi_avg_cccd & ATT_CCC_START_NTF)))
+    {
+        REAK_SendNotification(&app_env.rssi_avg);
+    }
+
+    /* Temperature changes held back by the minimum interval, heartbeat */
+    if (Notify_Poll(NOTIFY_TEMPERATURE, &app_env.temperature, 1,
+                    ble_env.state==APPM_CONNECTED && (app_env.temperature_cccd_value & ATT_CCC_START_NTF)))
+    {
+        REAK_SendNotification(&app_env.temperature);
+    }
+    if (Notify_Poll(NOTIFY_TEMPERATURE_ALL, app_env.temperature_all, NCT375_MAX_DEVICES,
+                    ble_env.state==APPM_CONNECTED && (app_env.temperature_all_cccd & ATT_CCC_START_NTF)))
+    {
+        REAK_SendNotification(&app_env.temperature_all);
     }
 
     app_env.update_ble_data = true;
@@ -135,6 +234,13 @@ int APP_Timer(ke_msg_id_t const msg_id,
  * ------------------------------------------------------------------------- */
 void App_Env_Initialize(void)
 {
+    uint32_t limits;
+    uint32_t rate;
+    uint32_t interval;
+    struct filter_param_tag filter_param;
+    struct notify_policy_tag *policy;
+    uint8_t channel;
+
     /* Reset the application manager environment */
     memset(&app_env, 0, sizeof(app_env));
 	app_env.pa_power = (RF_REG19->PA_PWR_BYTE & RF_REG19_PA_PWR_PA_PWR_BYTE_Mask);
@@ -146,39 +252,86 @@ void App_Env_Initialize(void)
      * quicker the transferred data */
     I2C_Master_Init(0x80U);
     NVIC_SetPriority(I2C_IRQn,2);
+    NVIC_SetPriority(I2C_TIMEOUT_IRQn,2);
+    NVIC_SetPriority(SAMPLER_TIMER_IRQn,2);
+    NVIC_SetPriority(NCT375_ALERT_IRQn,2);
+#ifdef I2C_DMA_CHANNEL
+    NVIC_SetPriority(I2C_DMA_IRQn,2);
+#endif
+    NVIC_SetPriority(SPIFLASH_DMA_IRQn,2);
+    NVIC_SetPriority(SPIFLASH_TIMER_IRQn,2);
+    TimeBase_Init();
+    Sampler_Init();
+    NCT375_Sensors_Add();
+    History_Init();
+    Rollup_Init();
+    Stats_Init();
+    Notify_Init();
+
+    /* Configure the DIOs of the SPI flash, the chip select as a GPIO, and
+     * find the end of the archive */
+    Sys_SPI_DIOConfig(0, SPI0_SELECT_MASTER, DIO_LPF_DISABLE | DIO_WEAK_PULL_UP,
+                      SPI_SCLK_DIO_NUM, SPI_CS_DIO_NUM, SPI_MISO_DIO_NUM, SPI_MOSI_DIO_NUM);
+    Sys_DIO_Config(SPI_CS_DIO_NUM, DIO_MODE_GPIO_OUT_1);
+    Archive_Init();
+
+    /* Restore the sensor power mode, alert limits, filter parameters,
+     * adaptive rate and notification policies selected before the last
+     * reset */
+    Settings_Init();
+    FlashLog_Init();
+    Sampler_Mode_Set(Settings_Read(SETTINGS_KEY_SENSOR_MODE, SAMPLER_MODE_DEFAULT));
+    app_env.power_mode = sampler_env.mode;
+    limits = Settings_Read(SETTINGS_KEY_ALERT_LIMITS,
+                           ALERT_LIMITS_PACK(NCT375_THYST_DEFAULT, NCT375_TOS_DEFAULT));
+    NCT375_Limits_Set(ALERT_LIMITS_THYST(limits), ALERT_LIMITS_TOS(limits));
+    app_env.alert_limits[0] = nct375_env.thyst;
+    app_env.alert_limits[1] = nct375_env.tos;
+    Filter_Param_Unpack(Settings_Read(SETTINGS_KEY_FILTER_PARAM,
+                                      FILTER_PARAM_PACK(sampler_env.filter_param)),
+                        &filter_param);
+    Sampler_Filter_Set(&filter_param);
+    app_env.filter_param = sampler_env.filter_param;
+    rate = Settings_Read(SETTINGS_KEY_ADAPTIVE_RATE,
+                         ADAPTIVE_RATE_PACK(SAMPLER_RATE_MAX_PERIOD_DEFAULT, SAMPLER_RATE_THRESHOLD_DEFAULT));
+    Sampler_Rate_Set(ADAPTIVE_RATE_PERIOD(rate), ADAPTIVE_RATE_THRESHOLD(rate));
+    app_env.adaptive_rate[0] = sampler_env.max_period;
+    app_env.adaptive_rate[1] = sampler_env.rate_threshold;
+    app_env.sample_period = Sampler_Period_Ms();
+    for (channel = 0; channel < NOTIFY_CHANNEL_MAX; channel++)
+    {
+        policy = &notify_env.channel[channel].policy;
+        interval = Settings_Read(SETTINGS_KEY_NOTIFY_INTERVAL + channel,
+                                 NOTIFY_INTERVAL_PACK(policy->min_interval, policy->max_interval));
+        Notify_Policy_Set(channel,
+                          Settings_Read(SETTINGS_KEY_NOTIFY_DEADBAND + channel, policy->deadband),
+                          NOTIFY_INTERVAL_MIN(interval), NOTIFY_INTERVAL_MAX(interval));
+    }
+    Notify_Policy_Value(app_env.notify_policy);
 
     /* Configure the DIOs for I2C */
-    Sys_I2C_DIOConfig(DIO_6X_DRIVE | DIO_LPF_ENABLE | DIO_STRONG_PULL_UP,
+    Sys_I2C_DIOConfig(I2C_DIO_CFG,
     		          I2C_SCL_DIO_NUM,
     		          I2C_SDA_DIO_NUM);
+    I2C_Recovery_Config(I2C_DIO_CFG,
+                        I2C_SCL_DIO_NUM,
+                        I2C_SDA_DIO_NUM);
 
-    /* Configure the DIO used as ground and power pins for the SI7042 */
+    /* Configure the DIO used as ground and power pins for the sensors. The
+     * sampler cuts the power between samples in gated mode. */
     Sys_DIO_Config(I2C_GND_DIO_NUM, DIO_MODE_GPIO_OUT_0);
     Sys_DIO_Config(I2C_PWR_DIO_NUM, DIO_MODE_GPIO_OUT_1);
 
+    /* Configure the DIO used by the NCT375 ALERT output and its interrupt */
+    Sys_DIO_Config(NCT375_ALERT_DIO_NUM, NCT375_ALERT_DIO_CFG);
+    Sys_DIO_IntConfig(NCT375_ALERT_DIO_INT,
+                      NCT375_ALERT_EVENT | DIO_SRC(NCT375_ALERT_DIO_NUM) | DIO_DEBOUNCE_DISABLE,
+                      DIO_DEBOUNCE_SLOWCLK_DIV1024, 0);
+
     /* Configure the UART and the DIO used by it */
     Sys_UART_DIOConfig(DIO_2X_DRIVE | DIO_WEAK_PULL_UP | DIO_LPF_ENABLE,
                        UART_TX_DIO_NUM, UART_RX_DIO_NUM);
     UART_Initialize( UART_CFG_SYS_CLK, UART_BAUD_RATE );
-
-    /* Timer 0 start taking sample value */
-    Sys_Timer_Set_Control(0,  TIMER_MULTI_COUNT_1 |
-                              TIMER_FREE_RUN      |
-                              TIMER_SLOWCLK_DIV2  |
-                              TIMER_PRESCALE_32   | 14000);
-    //Sys_Timers_Stop(SELECT_TIMER0);
-#ifndef FULL_POWER_MODE
-    NVIC_EnableIRQ(TIMER0_IRQn);
-#endif
-
-    /* Timer 1 read sample value */
-    Sys_Timer_Set_Control(1,  TIMER_MULTI_COUNT_1 |
-                              TIMER_SHOT_MODE     |
-                              TIMER_SLOWCLK_DIV2  |
-                              TIMER_PRESCALE_32   | 10000);
-#ifndef FULL_POWER_MODE
-    NVIC_EnableIRQ(TIMER1_IRQn);
-#endif
 }
 
 /* ----------------------------------------------------------------------------
@@ -198,28 +351,18 @@ int main()
      * - Run the kernel scheduler
      * - Perform some application stuff
      * - Refresh the watchdog and wait for an interrupt before continuing */
-    Sys_Timers_Start(SELECT_TIMER0);
-#ifndef FULL_POWER_MODE
-#ifdef ONE_SHOT_MODE
-    NCT375_ONEShot_ModeOn();
-#else
-    NCT375_PowerDown();
-#endif
-    //NCT375_ONEShot_ModeOff();
-    NCT375_I2C_Delay();
-#endif
+    Sampler_Start();
     while (1)
     {
         Kernel_Schedule();
 
-#ifdef FULL_POWER_MODE
-        /* Update temperature in a regular interval from temperatire sensor */
-        if (app_env.update_ble_data)
-        {
-        	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, app_env.i2c_rx_buffer, 2, NCT375_Received_Temperature);
-        	app_env.update_ble_data = false;
-        }
-#endif
+        /* Send the archive notifications read by the SPI flash interrupts
+         * and start the next flash operation */
+        Archive_Resume();
+
+        /* Notify the values published by the sampler interrupts */
+        Sampler_Resume();
+
         /* Refresh the watchdog timer */
         Sys_Watchdog_Refresh();
 
@@ -227,69 +370,3 @@ int main()
         SYS_WAIT_FOR_EVENT;
     }
 }
-
-void TIMER0_IRQHandler(void)
-{
-	//NCT375_I2C_Delay();
-	//NCT375_THYST_Write((short int) 27); // Test
-	//NCT375_I2C_Delay();
-	//NCT375_TOS_Write((short int) -30);	// Test
-	//NCT375_I2C_Delay();
-#ifndef FULL_POWER_MODE
-#ifndef ONE_SHOT_MODE
-	NCT375_ConfReg_Read();
-	NCT375_I2C_Delay();
-#endif
-	if(ble_env.state==APPM_CONNECTED)
-	{
-#ifdef ONE_SHOT_MODE
-		NCT375_ONEShot_StartSample();
-#else
-		if(nct375.Config & 0x01)
-		{
-			NCT375_PowerUp();
-			NCT375_I2C_Delay();
-			// Update state
-			NCT375_ConfReg_Read();
-			NCT375_I2C_Delay();
-		}
-#endif
-		Sys_Timers_Start(SELECT_TIMER1);
-	}
-	//Sys_Timers_Start(SELECT_TIMER1);	// Test
-#ifndef ONE_SHOT_MODE
-	else
-	{
-		if(!(nct375.Config & 0x01))
-		{
-			NCT375_PowerDown();
-			NCT375_I2C_Delay();
-			// Update state
-			NCT375_ConfReg_Read();
-			NCT375_I2C_Delay();
-		}
-
-	}
-#endif
-#endif
-}
-
-// Temperature value register reading
-void TIMER1_IRQHandler(void)
-{
-#ifndef FULL_POWER_MODE
-	app_env.i2c_tx_buffer[0]=0x00;	// Address pointer register
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, NULL, 0, NULL);
-	NCT375_I2C_Delay();
-	I2C_WriteRead(0x48, NCT375_CMD_GET_TEMPERATURE, 0, app_env.i2c_rx_buffer, 2, NCT375_Received_Temperature);
-	/*
-	nct375.Thyst=NCT375_THYST_Read();	// Test
-	if(nct375.Thyst == (short int) 27) 	{	}	// Test
-	*/
-	/*
-	nct375.TOs=NCT375_TOS_Read();	// Test
-	if(nct375.Thyst == (short int) -30) {	}	// Test
-	*/
-#endif
-}
-
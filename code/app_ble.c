@@ -64,6 +64,94 @@ const struct reak_att_desc reak_att[] =
                        sizeof(app_env.pa_power), &app_env.pa_power, DataAccess_PaPower),
     REAK_CHAR_CCC(&app_env.pa_power_cccd, REAK_GenericDataAccess),
     REAK_CHAR_USER_DESC(sizeof(CHAR_PA_PWR_NAME)-1, CHAR_PA_PWR_NAME, REAK_GenericDataAccess),
+
+    /**** Service 2 - Sensors ****/
+    REAK_SERVICE_UUID_128(SVC_SENSOR_UUID),
+
+    /*  Temperatures of all sensors */
+    REAK_CHAR_UUID_128(CHAR_TEMP_ALL_UUID,
+                       PERM(RD,ENABLE) | PERM(NTF,ENABLE),
+                       sizeof(app_env.temperature_all), app_env.temperature_all, REAK_GenericDataAccess),
+    REAK_CHAR_CCC(&app_env.temperature_all_cccd, REAK_GenericDataAccess),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_TEMP_ALL_NAME)-1, CHAR_TEMP_ALL_NAME, REAK_GenericDataAccess),
+
+    /*  Sensor power mode */
+    REAK_CHAR_UUID_128(CHAR_POWER_MODE_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE) | PERM(WRITE_COMMAND,ENABLE),
+                       sizeof(app_env.power_mode), &app_env.power_mode, DataAccess_PowerMode),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_POWER_MODE_NAME)-1, CHAR_POWER_MODE_NAME, REAK_GenericDataAccess),
+
+    /*  Alert limits THYST and TOS */
+    REAK_CHAR_UUID_128(CHAR_ALERT_LIMITS_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE) | PERM(WRITE_COMMAND,ENABLE),
+                       sizeof(app_env.alert_limits), app_env.alert_limits, DataAccess_AlertLimits),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_ALERT_LIMITS_NAME)-1, CHAR_ALERT_LIMITS_NAME, REAK_GenericDataAccess),
+
+    /*  Filter parameters */
+    REAK_CHAR_UUID_128(CHAR_FILTER_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE) | PERM(WRITE_COMMAND,ENABLE),
+                       sizeof(app_env.filter_param), &app_env.filter_param, DataAccess_Filter),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_FILTER_NAME)-1, CHAR_FILTER_NAME, REAK_GenericDataAccess),
+
+    /*  Adaptive rate: maximum sample period and rate threshold */
+    REAK_CHAR_UUID_128(CHAR_ADAPTIVE_RATE_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE) | PERM(WRITE_COMMAND,ENABLE),
+                       sizeof(app_env.adaptive_rate), app_env.adaptive_rate, DataAccess_AdaptiveRate),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_ADAPTIVE_RATE_NAME)-1, CHAR_ADAPTIVE_RATE_NAME, REAK_GenericDataAccess),
+
+    /*  Current sample period */
+    REAK_CHAR_UUID_128(CHAR_SAMPLE_PERIOD_UUID,
+                       PERM(RD,ENABLE) | PERM(NTF,ENABLE),
+                       sizeof(app_env.sample_period), &app_env.sample_period, REAK_GenericDataAccess),
+    REAK_CHAR_CCC(&app_env.sample_period_cccd, REAK_GenericDataAccess),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_SAMPLE_PERIOD_NAME)-1, CHAR_SAMPLE_PERIOD_NAME, REAK_GenericDataAccess),
+
+    /*  Sample history control point */
+    REAK_CHAR_UUID_128(CHAR_HISTORY_CTRL_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE) | PERM(NTF,ENABLE),
+                       sizeof(app_env.history_ctrl), app_env.history_ctrl, DataAccess_HistoryCtrl),
+    REAK_CHAR_CCC(&app_env.history_ctrl_cccd, REAK_GenericDataAccess),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_HISTORY_CTRL_NAME)-1, CHAR_HISTORY_CTRL_NAME, REAK_GenericDataAccess),
+
+    /*  Sample history download packets */
+    REAK_CHAR_UUID_128(CHAR_HISTORY_DATA_UUID,
+                       PERM(NTF,ENABLE),
+                       sizeof(app_env.history_data), app_env.history_data, REAK_GenericDataAccess),
+    REAK_CHAR_CCC(&app_env.history_data_cccd, REAK_GenericDataAccess),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_HISTORY_DATA_NAME)-1, CHAR_HISTORY_DATA_NAME, REAK_GenericDataAccess),
+
+    /*  Record access control point */
+    REAK_CHAR_UUID_128(CHAR_RACP_UUID,
+                       PERM(WRITE_REQ,ENABLE) | PERM(NTF,ENABLE),
+                       sizeof(app_env.racp), app_env.racp, DataAccess_RACP),
+    REAK_CHAR_CCC(&app_env.racp_cccd, REAK_GenericDataAccess),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_RACP_NAME)-1, CHAR_RACP_NAME, REAK_GenericDataAccess),
+
+    /*  Time base: seconds since reset, tick, wall time and drift */
+    REAK_CHAR_UUID_128(CHAR_TIME_BASE_UUID,
+                       PERM(RD,ENABLE),
+                       sizeof(app_env.time_base), app_env.time_base, DataAccess_TimeBase),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_TIME_BASE_NAME)-1, CHAR_TIME_BASE_NAME, REAK_GenericDataAccess),
+
+    /*  Running statistics of the sensors */
+    REAK_CHAR_UUID_128(CHAR_STATS_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE),
+                       sizeof(app_env.stats), app_env.stats, DataAccess_Stats),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_STATS_NAME)-1, CHAR_STATS_NAME, REAK_GenericDataAccess),
+
+    /*  Notification policy: deadband, minimum and maximum interval */
+    REAK_CHAR_UUID_128(CHAR_NOTIFY_POLICY_UUID,
+                       PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE),
+                       sizeof(app_env.notify_policy), app_env.notify_policy, DataAccess_NotifyPolicy),
+    REAK_CHAR_USER_DESC(sizeof(CHAR_NOTIFY_POLICY_NAME)-1, CHAR_NOTIFY_POLICY_NAME, REAK_GenericDataAccess),
+
+    /**** Service 3 - Current time ****/
+    REAK_SERVICE_UUID_16(SVC_CTS_UUID),
+
+    /* Current time, written by the central to sync the wall clock */
+    REAK_CHAR_UUID_16(CHAR_CURRENT_TIME_UUID,
+                      PERM(RD,ENABLE) | PERM(WRITE_REQ,ENABLE),
+                      sizeof(app_env.current_time), app_env.current_time, DataAccess_CurrentTime),
 };
 
 uint8_t reak_att_desc_max_idx(void)
@@ -95,3 +183,339 @@ void DataAccess_PaPower(void *gattm_data, void *app_data, uint16_t length, uint8
         					    (app_env.pa_power & RF_REG19_PA_PWR_PA_PWR_BYTE_Mask);
     }
 }
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_PowerMode(void *gattm_data, void *app_data,
+ *                                           uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the sensor power mode between the
+ *                 application and the GATTM. A valid mode written by the GATTM
+ *                 is applied to the sampler and stored in the settings flash,
+ *                 so it survives a reset. An invalid mode is discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_PowerMode(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        if (Sampler_Mode_Set(app_env.power_mode))
+        {
+            Settings_Write(SETTINGS_KEY_SENSOR_MODE, app_env.power_mode);
+        }
+        app_env.power_mode = sampler_env.mode;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_AlertLimits(void *gattm_data, void *app_data,
+ *                                             uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the alert limits (THYST then TOS, in
+ *                 0.01 degC) between the application and the GATTM. Valid
+ *                 limits written by the GATTM are programmed into the sensors
+ *                 (in alert mode) and stored in the settings flash. Invalid
+ *                 limits are discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_AlertLimits(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        if (NCT375_Limits_Set(app_env.alert_limits[0], app_env.alert_limits[1]))
+        {
+            Settings_Write(SETTINGS_KEY_ALERT_LIMITS,
+                           ALERT_LIMITS_PACK(app_env.alert_limits[0], app_env.alert_limits[1]));
+        }
+        app_env.alert_limits[0] = nct375_env.thyst;
+        app_env.alert_limits[1] = nct375_env.tos;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_Filter(void *gattm_data, void *app_data,
+ *                                        uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the filter parameters (burst length,
+ *                 filter type, coefficient, decimation) between the
+ *                 application and the GATTM. Valid parameters written by the
+ *                 GATTM are applied from the next burst and stored in the
+ *                 settings flash. Invalid parameters are discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_Filter(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        if (Sampler_Filter_Set(&app_env.filter_param))
+        {
+            Settings_Write(SETTINGS_KEY_FILTER_PARAM, FILTER_PARAM_PACK(app_env.filter_param));
+        }
+        app_env.filter_param = sampler_env.filter_param;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_AdaptiveRate(void *gattm_data,
+ *                                              void *app_data,
+ *                                              uint16_t length,
+ *                                              uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the adaptive rate settings (maximum
+ *                 sample period in s, 0 for a fixed period, then rate
+ *                 threshold in 0.01 degC/min) between the application and the
+ *                 GATTM. Valid settings written by the GATTM are applied to
+ *                 the sampler and stored in the settings flash. Invalid
+ *                 settings are discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_AdaptiveRate(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        if (Sampler_Rate_Set(app_env.adaptive_rate[0], app_env.adaptive_rate[1]))
+        {
+            Settings_Write(SETTINGS_KEY_ADAPTIVE_RATE,
+                           ADAPTIVE_RATE_PACK(app_env.adaptive_rate[0], app_env.adaptive_rate[1]));
+        }
+        app_env.adaptive_rate[0] = sampler_env.max_period;
+        app_env.adaptive_rate[1] = sampler_env.rate_threshold;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_HistoryCtrl(void *gattm_data,
+ *                                             void *app_data,
+ *                                             uint16_t length,
+ *                                             uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the sample history control point
+ *                 between the application and the GATTM. A command written
+ *                 by the GATTM (see history.h) is executed, a read returns
+ *                 the current history status.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_HistoryCtrl(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    if (access == reak_cb_read)
+    {
+        History_Status(app_env.history_ctrl);
+    }
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        History_Command(app_env.history_ctrl, length);
+        History_Status(app_env.history_ctrl);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_RACP(void *gattm_data, void *app_data,
+ *                                      uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the record access control point
+ *                 between the application and the GATTM. A command written
+ *                 by the GATTM (see racp.h) is executed, its response is
+ *                 notified.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_RACP(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        RACP_Command(app_env.racp, length);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_TimeBase(void *gattm_data, void *app_data,
+ *                                          uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the time base status (see
+ *                 timebase.h) from the application to the GATTM, updated at
+ *                 each read
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_TimeBase(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    if (access == reak_cb_read)
+    {
+        TimeBase_Status(app_env.time_base);
+    }
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_CurrentTime(void *gattm_data,
+ *                                             void *app_data,
+ *                                             uint16_t length,
+ *                                             uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the current time (Current Time
+ *                 Service format) between the application and the GATTM. A
+ *                 read returns the wall time, a valid time written by the
+ *                 GATTM syncs the wall clock. Invalid times are discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_CurrentTime(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    if (access == reak_cb_read)
+    {
+        TimeBase_Current_Time(app_env.current_time);
+    }
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        TimeBase_Sync(app_env.current_time, length);
+        TimeBase_Current_Time(app_env.current_time);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_Stats(void *gattm_data, void *app_data,
+ *                                       uint16_t length, uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the running statistics (see stats.h)
+ *                 between the application and the GATTM. A read returns the
+ *                 current statistics, a sensor mask written by the GATTM
+ *                 resets the statistics of these sensors.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_Stats(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    if (access == reak_cb_read)
+    {
+        Stats_Value(app_env.stats);
+    }
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read && length > 0)
+    {
+        Stats_Reset(app_env.stats[0]);
+        Stats_Value(app_env.stats);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void DataAccess_NotifyPolicy(void *gattm_data,
+ *                                              void *app_data,
+ *                                              uint16_t length,
+ *                                              uint8_t access)
+ * ----------------------------------------------------------------------------
+ * Description   : Function to transfer the notification policy (see
+ *                 notify.h) between the application and the GATTM. A read
+ *                 returns the policy of every channel. A valid channel entry
+ *                 written by the GATTM is applied and stored in the settings
+ *                 flash. Invalid entries are discarded.
+ * Inputs        : - gattm_data : Pointer to the GATTM data structure
+ *                 - app_data   : Pointer to the application data structure
+ *                 - length     : Data length (in bytes)
+ *                 - access     : Data access (reak_cb_read or reak_cb_write)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void DataAccess_NotifyPolicy(void *gattm_data, void *app_data, uint16_t length, uint8_t access)
+{
+    uint16_t deadband;
+    uint16_t min_interval;
+    uint16_t max_interval;
+    uint8_t channel;
+
+    if (access == reak_cb_read)
+    {
+        Notify_Policy_Value(app_env.notify_policy);
+    }
+    REAK_GenericDataAccess(gattm_data, app_data, length, access);
+    if (access != reak_cb_read)
+    {
+        channel = app_env.notify_policy[0];
+        memcpy(&deadband, &app_env.notify_policy[1], sizeof(deadband));
+        memcpy(&min_interval, &app_env.notify_policy[3], sizeof(min_interval));
+        memcpy(&max_interval, &app_env.notify_policy[5], sizeof(max_interval));
+        if (length == NOTIFY_WRITE_SIZE &&
+            Notify_Policy_Set(channel, deadband, min_interval, max_interval))
+        {
+            Settings_Write(SETTINGS_KEY_NOTIFY_DEADBAND + channel, deadband);
+            Settings_Write(SETTINGS_KEY_NOTIFY_INTERVAL + channel,
+                           NOTIFY_INTERVAL_PACK(min_interval, max_interval));
+        }
+        Notify_Policy_Value(app_env.notify_policy);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : int GATTC_CmpEvt(ke_msg_id_t const msg_id,
+ *                                  struct gattc_cmp_evt const *param,
+ *                                  ke_task_id_t const dest_id,
+ *                                  ke_task_id_t const src_id)
+ * ----------------------------------------------------------------------------
+ * Description   : Handle the completion of a GATT controller operation. A
+ *                 completed sample history notification releases the next
+ *                 packet of the download.
+ * Inputs        : - msg_id     - Kernel message ID number
+ *                 - param      - Message parameters in format of
+ *                                struct gattc_cmp_evt
+ *                 - dest_id    - Destination task ID number
+ *                 - src_id     - Source task ID number
+ * Outputs       : return value - Indicate if the message was consumed;
+ *                                compare with KE_MSG_CONSUMED
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+int GATTC_CmpEvt(ke_msg_id_t const msg_id, struct gattc_cmp_evt const *param,
+                 ke_task_id_t const dest_id, ke_task_id_t const src_id)
+{
+    if (param->operation == GATTC_NOTIFY && param->seq_num == HISTORY_NTF_SEQ_NUM)
+    {
+        History_Sent(param->status);
+    }
+
+    return (KE_MSG_CONSUMED);
+}
@@ -0,0 +1,680 @@
+/* ----------------------------------------------------------------------------
+ * archive.c
+ * - Sample archive in the external SPI NOR flash. See archive.h for the page
+ *   format.
+ * - The history blocks are copied from the kernel context, the flash
+ *   operations are completed from the SPI flash interrupts; the archive state
+ *   is changed with the interrupts masked. One flash operation runs at a
+ *   time: the programming of a full page goes first, the download reads use
+ *   the flash in between.
+ * - The interrupts only chain the programming steps of a page. Everything
+ *   that uses the kernel (notification allocation, send and free) runs from
+ *   Archive_Resume in the main loop, which the interrupts flag when the flash
+ *   is free again or a download read has completed.
+ * - Known limitations:
+ *   > Stream offsets are 32 bits; the page of an offset isn't found anymore
+ *     once they wrap (after 4 GB).
+ *   > A read waits for the end of a sector erase (up to 240 ms).
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct archive_env_tag archive_env;
+
+/* Local functions */
+static void Archive_Next(void);
+static void Archive_Written(void *context, bool result);
+static void Archive_Header_Done(void *context, bool result);
+static void Archive_Read_Done(void *context, bool result);
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t Archive_Addr(uint32_t offset)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the flash address of the page of a stream offset
+ * Inputs        : - offset     - Stream offset
+ * Outputs       : return value - Page address
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t Archive_Addr(uint32_t offset)
+{
+    return ((offset / ARCHIVE_PAYLOAD_SIZE) % ARCHIVE_PAGES) * SPIFLASH_PAGE_SIZE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Archive_Header_Valid(const uint8_t *header,
+ *                                                  uint32_t addr)
+ * ----------------------------------------------------------------------------
+ * Description   : Check a page header read from the flash
+ * Inputs        : - header     - Page header (ARCHIVE_HEADER_SIZE bytes)
+ *                 - addr       - Address the header has been read from
+ * Outputs       : return value - true if the page is complete and belongs
+ *                                to this address
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static bool Archive_Header_Valid(const uint8_t *header, uint32_t addr)
+{
+    uint32_t offset;
+    uint16_t crc;
+
+    memcpy(&offset, &header[0], sizeof(offset));
+    memcpy(&crc, &header[6], sizeof(crc));
+    return header[5] == ARCHIVE_PAGE_MAGIC && crc == FlashLog_CRC(0xFFFF, header, 6) &&
+           offset % ARCHIVE_PAYLOAD_SIZE == 0 && Archive_Addr(offset) == addr;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Archive_Page_Read(uint32_t page,
+ *                                               uint32_t *offset)
+ * ----------------------------------------------------------------------------
+ * Description   : Read the header of a flash page (start-up scan)
+ * Inputs        : - page       - Flash page index
+ *                 - offset     - Stream offset of the page
+ * Outputs       : return value - false if the page is erased or incomplete
+ * Assumptions   : No flash operation in progress
+ * ------------------------------------------------------------------------- */
+static bool Archive_Page_Read(uint32_t page, uint32_t *offset)
+{
+    uint8_t header[ARCHIVE_HEADER_SIZE];
+
+    SPIFlash_Read_Wait(page * SPIFLASH_PAGE_SIZE, header, ARCHIVE_HEADER_SIZE);
+    memcpy(offset, &header[0], sizeof(uint32_t));
+    return Archive_Header_Valid(header, page * SPIFLASH_PAGE_SIZE);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Archive_Page_Blank(uint32_t page)
+ * ----------------------------------------------------------------------------
+ * Description   : Check that a flash page is erased (start-up scan)
+ * Inputs        : - page       - Flash page index
+ * Outputs       : return value - false if a byte of the page is programmed
+ * Assumptions   : No flash operation in progress
+ * ------------------------------------------------------------------------- */
+static bool Archive_Page_Blank(uint32_t page)
+{
+    uint8_t data[ARCHIVE_HEADER_SIZE];
+    uint16_t pos;
+    uint8_t i;
+
+    for (pos = 0; pos < SPIFLASH_PAGE_SIZE; pos += sizeof(data))
+    {
+        SPIFlash_Read_Wait(page * SPIFLASH_PAGE_SIZE + pos, data, sizeof(data));
+        for (i = 0; i < sizeof(data); i++)
+        {
+            if (data[i] != 0xFF)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Open(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start an empty page in the fill buffer
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static void Archive_Open(void)
+{
+    uint8_t *page = archive_env.buffer[archive_env.fill];
+
+    memset(page, 0xFF, SPIFLASH_PAGE_SIZE);
+    memcpy(&page[0], &archive_env.offset, sizeof(uint32_t));
+    archive_env.used = 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Close(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Hand the fill buffer to the programming once it is full
+ *                 and the other buffer is free, and start the next page in
+ *                 the other buffer
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static void Archive_Close(void)
+{
+    uint8_t *page = archive_env.buffer[archive_env.fill];
+    uint16_t crc;
+
+    if (archive_env.used < ARCHIVE_PAYLOAD_SIZE || archive_env.programming)
+    {
+        return;
+    }
+
+    page[5] = ARCHIVE_PAGE_MAGIC;
+    crc = FlashLog_CRC(0xFFFF, page, 6);
+    memcpy(&page[6], &crc, sizeof(crc));
+    archive_env.programming = true;
+    archive_env.step = ARCHIVE_STEP_ERASE;
+
+    archive_env.fill ^= 1;
+    archive_env.offset += ARCHIVE_PAYLOAD_SIZE;
+    Archive_Open();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Append(const uint8_t *data,
+ *                                            uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Append a block to the stream, it continues in the next
+ *                 page if it doesn't fit
+ * Inputs        : - data       - Encoded block
+ *                 - length     - Block size
+ * Outputs       : None
+ * Assumptions   : Called with the interrupts masked, the block fits in the
+ *                 free bytes of the two buffers
+ * ------------------------------------------------------------------------- */
+static void Archive_Append(const uint8_t *data, uint16_t length)
+{
+    uint8_t *page;
+    uint16_t n;
+
+    Archive_Close();
+    page = archive_env.buffer[archive_env.fill];
+    if (page[4] == ARCHIVE_NO_BLOCK)
+    {
+        page[4] = (uint8_t)archive_env.used;
+    }
+
+    while (length > 0)
+    {
+        Archive_Close();
+        page = archive_env.buffer[archive_env.fill];
+        n = MIN(length, ARCHIVE_PAYLOAD_SIZE - archive_env.used);
+        memcpy(&page[ARCHIVE_HEADER_SIZE + archive_env.used], data, n);
+        archive_env.used += n;
+        data += n;
+        length -= n;
+    }
+    Archive_Close();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Archive_Write(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the next step of the programming of the full page:
+ *                 erase the sector if the page is the first one programmed
+ *                 in it, program the payload, then the header
+ * Inputs        : None
+ * Outputs       : return value - true if a flash operation has been started
+ * Assumptions   : Called with the interrupts masked, a page is being
+ *                 programmed
+ * ------------------------------------------------------------------------- */
+static bool Archive_Write(void)
+{
+    uint8_t *page = archive_env.buffer[archive_env.fill ^ 1];
+    uint32_t offset;
+    uint32_t addr;
+
+    memcpy(&offset, &page[0], sizeof(offset));
+    addr = Archive_Addr(offset);
+
+    if (archive_env.step == ARCHIVE_STEP_ERASE)
+    {
+        if (addr / SPIFLASH_SECTOR_SIZE != archive_env.erased)
+        {
+            return SPIFlash_Erase(addr, Archive_Written, NULL);
+        }
+        archive_env.step = ARCHIVE_STEP_PAYLOAD;
+    }
+    if (archive_env.step == ARCHIVE_STEP_PAYLOAD)
+    {
+        return SPIFlash_Program(addr + ARCHIVE_HEADER_SIZE, &page[ARCHIVE_HEADER_SIZE],
+                                ARCHIVE_PAYLOAD_SIZE, Archive_Written, NULL);
+    }
+    return SPIFlash_Program(addr, page, ARCHIVE_HEADER_SIZE, Archive_Written, NULL);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Download_Next(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the read of the next download notification, as long
+ *                 as notification credits are left. The payload is read into
+ *                 the notification message, the header of a page is checked
+ *                 first. The download ends at the end of the archive.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called from the kernel context with the interrupts masked,
+ *                 the flash is idle
+ * ------------------------------------------------------------------------- */
+static void Archive_Download_Next(void)
+{
+    uint16_t max = MIN(HISTORY_PACKET_SIZE, ble_env.mtu - 3) - HISTORY_PACKET_HEADER_SIZE;
+    struct gattc_send_evt_cmd *cmd;
+    uint32_t tail = Archive_Tail();
+    uint32_t page;
+    uint16_t n;
+
+    while (archive_env.download && !archive_env.reading && archive_env.credits > 0)
+    {
+        if ((int32_t)(archive_env.next - tail) < 0)
+        {
+            archive_env.next = tail;
+            archive_env.jump = true;
+        }
+        if ((int32_t)(archive_env.next - archive_env.head) >= 0)
+        {
+            archive_env.download = false;
+            History_Notify_Status();
+            return;
+        }
+
+        page = archive_env.next - archive_env.next % ARCHIVE_PAYLOAD_SIZE;
+        if (archive_env.checked != page)
+        {
+            archive_env.reading = SPIFlash_Read(Archive_Addr(page), archive_env.header,
+                                                ARCHIVE_HEADER_SIZE, Archive_Header_Done, NULL);
+            return;
+        }
+
+        /* After a gap the stream restarts with a block */
+        if (archive_env.jump)
+        {
+            if (archive_env.header[4] == ARCHIVE_NO_BLOCK)
+            {
+                archive_env.next = page + ARCHIVE_PAYLOAD_SIZE;
+                continue;
+            }
+            archive_env.next = page + archive_env.header[4];
+            archive_env.jump = false;
+        }
+
+        n = (uint16_t)MIN(max, page + ARCHIVE_PAYLOAD_SIZE - archive_env.next);
+        cmd = REAK_NotificationAlloc(app_env.history_data, HISTORY_PACKET_HEADER_SIZE + n,
+                                     HISTORY_NTF_SEQ_NUM);
+        if (cmd == NULL)
+        {
+            Archive_Abort();
+            return;
+        }
+        memcpy(cmd->value, &archive_env.next, sizeof(uint32_t));
+        archive_env.reading = SPIFlash_Read(Archive_Addr(page) + ARCHIVE_HEADER_SIZE +
+                                            (archive_env.next - page),
+                                            &cmd->value[HISTORY_PACKET_HEADER_SIZE], n,
+                                            Archive_Read_Done, cmd);
+        if (!archive_env.reading)
+        {
+            ke_msg_free(ke_param2msg(cmd));
+            return;
+        }
+        archive_env.next += n;
+        archive_env.credits--;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Next(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the next flash operation if the flash is idle: the
+ *                 programming of the full page, else a download read
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called from the kernel context
+ * ------------------------------------------------------------------------- */
+static void Archive_Next(void)
+{
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    if (spiflash_env.present && SPIFlash_Idle() &&
+        !(archive_env.programming && Archive_Write()))
+    {
+        Archive_Download_Next();
+    }
+    __set_PRIMASK(primask);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Written(void *context, bool result)
+ * ----------------------------------------------------------------------------
+ * Description   : A step of the programming of a full page is completed,
+ *                 start the next one. The page is dropped if a step failed.
+ *                 Once the flash is free the main loop is asked to go on.
+ * Inputs        : - context    - Unused
+ *                 - result     - Operation result
+ * Outputs       : None
+ * Assumptions   : Called from the SPI flash interrupts
+ * ------------------------------------------------------------------------- */
+static void Archive_Written(void *context, bool result)
+{
+    uint8_t *page = archive_env.buffer[archive_env.fill ^ 1];
+    uint32_t offset;
+
+    memcpy(&offset, &page[0], sizeof(offset));
+    if (result && archive_env.step == ARCHIVE_STEP_ERASE)
+    {
+        archive_env.erased = Archive_Addr(offset) / SPIFLASH_SECTOR_SIZE;
+        archive_env.step = ARCHIVE_STEP_PAYLOAD;
+    }
+    else if (result && archive_env.step == ARCHIVE_STEP_PAYLOAD)
+    {
+        archive_env.step = ARCHIVE_STEP_HEADER;
+    }
+    else
+    {
+        if (!result)
+        {
+            archive_env.errors++;
+        }
+        archive_env.head = offset + ARCHIVE_PAYLOAD_SIZE;
+        archive_env.programming = false;
+        Archive_Close();
+    }
+    if (!(archive_env.programming && Archive_Write()))
+    {
+        archive_env.resume = true;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Header_Done(void *context,
+ *                                                 bool result)
+ * ----------------------------------------------------------------------------
+ * Description   : The header of the next page of the download has been read.
+ *                 The page is skipped if it is incomplete or belongs to an
+ *                 older round of the flash.
+ * Inputs        : - context    - Unused
+ *                 - result     - Read result
+ * Outputs       : None
+ * Assumptions   : Called from the SPI flash interrupts
+ * ------------------------------------------------------------------------- */
+static void Archive_Header_Done(void *context, bool result)
+{
+    uint32_t page = archive_env.next - archive_env.next % ARCHIVE_PAYLOAD_SIZE;
+    uint32_t offset;
+
+    memcpy(&offset, &archive_env.header[0], sizeof(offset));
+    archive_env.reading = false;
+    if (result && Archive_Header_Valid(archive_env.header, Archive_Addr(page)) && offset == page)
+    {
+        archive_env.checked = page;
+    }
+    else
+    {
+        archive_env.checked = ARCHIVE_NO_PAGE;
+        archive_env.next = page + ARCHIVE_PAYLOAD_SIZE;
+        archive_env.jump = true;
+    }
+    archive_env.resume = true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Archive_Read_Done(void *context, bool result)
+ * ----------------------------------------------------------------------------
+ * Description   : The payload of a download notification has been read. The
+ *                 message is handed to Archive_Resume, reading stays set
+ *                 until it has been sent or freed.
+ * Inputs        : - context    - Notification message
+ *                 - result     - Read result
+ * Outputs       : None
+ * Assumptions   : Called from the SPI flash interrupts
+ * ------------------------------------------------------------------------- */
+static void Archive_Read_Done(void *context, bool result)
+{
+    archive_env.message = context;
+    archive_env.read_result = result;
+    archive_env.read_done = true;
+    archive_env.resume = true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Initialize the SPI flash and find the end of the archive.
+ *                 The newest sector is the one whose first page is the
+ *                 newest (its first page can be a gap, the second one is
+ *                 checked too), then its pages are scanned. The pages after
+ *                 the newest one aren't all erased: the page cut by a reset
+ *                 can follow the page skipped by the reset before, so the
+ *                 stream goes on after the last page written to.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : The SPI0 DIOs are configured
+ * ------------------------------------------------------------------------- */
+void Archive_Init(void)
+{
+    uint32_t newest = 0;
+    uint32_t sector = ARCHIVE_NO_SECTOR;
+    uint32_t written;
+    uint32_t offset;
+    uint32_t page;
+    uint32_t i;
+
+    memset(&archive_env, 0, sizeof(archive_env));
+    archive_env.erased = ARCHIVE_NO_SECTOR;
+    archive_env.checked = ARCHIVE_NO_PAGE;
+
+    SPIFlash_Init();
+    if (!spiflash_env.present)
+    {
+        return;
+    }
+
+    for (page = 0; page < ARCHIVE_PAGES; page += ARCHIVE_SECTOR_PAGES)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            if (Archive_Page_Read(page + i, &offset) &&
+                (sector == ARCHIVE_NO_SECTOR || (int32_t)(offset - newest) > 0))
+            {
+                newest = offset;
+                sector = page / ARCHIVE_SECTOR_PAGES;
+            }
+        }
+    }
+
+    if (sector != ARCHIVE_NO_SECTOR)
+    {
+        for (i = 2; i < ARCHIVE_SECTOR_PAGES; i++)
+        {
+            if (Archive_Page_Read(sector * ARCHIVE_SECTOR_PAGES + i, &offset) &&
+                (int32_t)(offset - newest) > 0)
+            {
+                newest = offset;
+            }
+        }
+
+        /* A torn page can't be programmed again before the sector is
+         * erased */
+        written = newest;
+        page = Archive_Addr(newest) / SPIFLASH_PAGE_SIZE;
+        for (i = page + 1; i < (sector + 1) * ARCHIVE_SECTOR_PAGES; i++)
+        {
+            if (!Archive_Page_Blank(i))
+            {
+                written = newest + (i - page) * ARCHIVE_PAYLOAD_SIZE;
+            }
+        }
+        archive_env.erased = sector;
+        archive_env.head = written + 2 * ARCHIVE_PAYLOAD_SIZE;
+    }
+    archive_env.offset = archive_env.head;
+    Archive_Open();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Process(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the history blocks closed since the last call to the
+ *                 archive, as long as they fit in the page buffers, and start
+ *                 the programming of a full page
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called periodically from the kernel context
+ * ------------------------------------------------------------------------- */
+void Archive_Process(void)
+{
+    uint8_t block[CODEC_BLOCK_SIZE_MAX];
+    uint16_t length;
+    uint16_t room;
+    uint32_t pos;
+    uint32_t primask;
+
+    if (!spiflash_env.present)
+    {
+        return;
+    }
+
+    pos = archive_env.history_pos;
+    while (History_Block_Read(&pos, block, &length))
+    {
+        primask = __get_PRIMASK();
+        __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+        room = ARCHIVE_PAYLOAD_SIZE - archive_env.used;
+        if (!archive_env.programming)
+        {
+            room += ARCHIVE_PAYLOAD_SIZE;
+        }
+        if (length <= room)
+        {
+            Archive_Append(block, length);
+            archive_env.history_pos = pos;
+        }
+        __set_PRIMASK(primask);
+
+        if (length > room)
+        {
+            break;
+        }
+    }
+    Archive_Next();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Resume(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Go on after the SPI flash interrupts: send the notification
+ *                 whose payload has been read (freed if the read failed or
+ *                 the download has been stopped), then start the next flash
+ *                 operation
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called from the main loop (kernel context)
+ * ------------------------------------------------------------------------- */
+void Archive_Resume(void)
+{
+    struct gattc_send_evt_cmd *cmd = NULL;
+    bool send = false;
+    uint32_t primask;
+
+    if (!archive_env.resume)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    archive_env.resume = false;
+    if (archive_env.read_done)
+    {
+        cmd = archive_env.message;
+        send = archive_env.read_result && archive_env.download;
+        archive_env.read_done = false;
+        archive_env.reading = false;
+    }
+    __set_PRIMASK(primask);
+
+    if (send)
+    {
+        ke_msg_send(cmd);
+    }
+    else if (cmd != NULL)
+    {
+        ke_msg_free(ke_param2msg(cmd));
+    }
+    Archive_Next();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t Archive_Tail(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the stream offset of the oldest page that can be kept:
+ *                 the first page after the sector of the end of the archive,
+ *                 one round of the flash earlier
+ * Inputs        : None
+ * Outputs       : return value - Stream offset
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t Archive_Tail(void)
+{
+    uint32_t end = (archive_env.head / ARCHIVE_PAYLOAD_SIZE / ARCHIVE_SECTOR_PAGES + 1) *
+                   ARCHIVE_SECTOR_PAGES;
+
+    return (end > ARCHIVE_PAGES) ? (end - ARCHIVE_PAGES) * ARCHIVE_PAYLOAD_SIZE : 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Download(uint32_t first)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the download of the archive. Only the programmed
+ *                 pages are sent.
+ * Inputs        : - first      - Stream offset of the first block to send (the
+ *                                end of the last complete block received), 0
+ *                                for the oldest block kept
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Archive_Download(uint32_t first)
+{
+    uint32_t primask;
+
+    if (!spiflash_env.present)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    archive_env.next = first;
+    archive_env.jump = (first == 0);
+    archive_env.checked = ARCHIVE_NO_PAGE;
+    archive_env.credits = HISTORY_NTF_CREDITS;
+    archive_env.download = true;
+    __set_PRIMASK(primask);
+    Archive_Next();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Abort(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Stop the download in progress, a read in progress is
+ *                 dropped
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Archive_Abort(void)
+{
+    archive_env.download = false;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Archive_Sent(uint8_t status)
+ * ----------------------------------------------------------------------------
+ * Description   : A download notification has been completed by the stack,
+ *                 read the next one. The download is stopped if the
+ *                 notification failed.
+ * Inputs        : - status     - Completion status
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Archive_Sent(uint8_t status)
+{
+    if (archive_env.credits < HISTORY_NTF_CREDITS)
+    {
+        archive_env.credits++;
+    }
+    if (status != GAP_ERR_NO_ERROR)
+    {
+        Archive_Abort();
+        return;
+    }
+    Archive_Next();
+}
@@ -281,8 +281,7 @@ int GATTC_WriteReqInd(ke_msg_id_t const msg_id,
 }
 
 /* ----------------------------------------------------------------------------
- * Function      : void REAK_SendNotification(uint8_t conidx,
- *                               uint8_t attidx, uint8_t *value, uint8_t length)
+ * Function      : void REAK_SendNotification(void *data)
  * ----------------------------------------------------------------------------
  * Description   : Send a notification to the client device
  * Inputs        : - data  - Pointer to the data structure in the application
@@ -290,13 +289,65 @@ int GATTC_WriteReqInd(ke_msg_id_t const msg_id,
  * Assumptions   : None
  * ------------------------------------------------------------------------- */
 void REAK_SendNotification(void *data)
+{
+    REAK_SendNotificationLength(data, 0xFFFF, 0);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void REAK_SendNotificationLength(void *data,
+ *                               uint16_t length, uint16_t seq_num)
+ * ----------------------------------------------------------------------------
+ * Description   : Send a notification of the first bytes of a characteristic
+ *                 value to the client device
+ * Inputs        : - data    - Pointer to the data structure in the application
+ *                 - length  - Notified length (in bytes), limited to the
+ *                             characteristic length
+ *                 - seq_num - Sequence number returned in the GATTC_CMP_EVT
+ *                             of the notification
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void REAK_SendNotificationLength(void *data, uint16_t length, uint16_t seq_num)
+{
+    struct gattc_send_evt_cmd *cmd;
+
+    cmd = REAK_NotificationAlloc(data, length, seq_num);
+    if (cmd == NULL)
+    {
+        return;
+    }
+    memcpy(cmd->value, data, cmd->length);
+
+    /* Send the message */
+    ke_msg_send(cmd);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : struct gattc_send_evt_cmd *REAK_NotificationAlloc(
+ *                               void *data, uint16_t length,
+ *                               uint16_t seq_num)
+ * ----------------------------------------------------------------------------
+ * Description   : Prepare a notification message of a characteristic. The
+ *                 caller fills cmd->value (cmd->length bytes) and sends the
+ *                 message with ke_msg_send, or releases it with ke_msg_free.
+ * Inputs        : - data    - Pointer to the data structure in the application
+ *                 - length  - Notified length (in bytes), limited to the
+ *                             characteristic length
+ *                 - seq_num - Sequence number returned in the GATTC_CMP_EVT
+ *                             of the notification
+ * Outputs       : return value - Notification message, NULL if no connection
+ *                                is established or the data pointer doesn't
+ *                                match with a registered data structure
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+struct gattc_send_evt_cmd *REAK_NotificationAlloc(void *data, uint16_t length, uint16_t seq_num)
 {
     int attidx;
 
     /* Ignore the notification request if no connection is established */
     if (ble_env.state != APPM_CONNECTED)
     {
-    	return;
+    	return NULL;
     }
 
     /* Search the relevant attribute index. Ignore the notification request if
@@ -309,7 +360,7 @@ void REAK_SendNotification(void *data)
     }
     if(attidx==reak_env.nb_att)
     {
-        return;
+        return NULL;
     }
 
 //    /* Ignore the notification request of notification is not enabled */
@@ -318,7 +369,8 @@ void REAK_SendNotification(void *data)
     uint8_t conidx = ble_env.conidx;
     struct gattc_send_evt_cmd *cmd;
     uint16_t handle = (attidx + reak_env.start_hdl);
-    uint16_t length = reak_att[attidx].length;
+
+    length = MIN(length, reak_att[attidx].length);
 
     /* Prepare a notification message for the specified attribute */
     cmd = KE_MSG_ALLOC_DYN(GATTC_SEND_EVT_CMD,
@@ -328,9 +380,6 @@ void REAK_SendNotification(void *data)
     cmd->handle = handle;
     cmd->length = length;
     cmd->operation = GATTC_NOTIFY;
-    cmd->seq_num = 0;
-    memcpy(cmd->value, data, length);
-
-    /* Send the message */
-    ke_msg_send(cmd);
+    cmd->seq_num = seq_num;
+    return cmd;
 }
@@ -548,6 +548,7 @@ int GAPC_ConnectionReqInd(ke_msg_id_t const msg_id,
                           ke_task_id_t const src_id)
 {
     struct gapc_connection_cfm *cfm;
+    struct gattc_exc_mtu_cmd *mtu_cmd;
 
     ble_env.conidx = KE_IDX_GET(src_id);
 
@@ -571,6 +572,16 @@ int GAPC_ConnectionReqInd(ke_msg_id_t const msg_id,
         /* Send the message */
         ke_msg_send(cfm);
 
+        /* Start with the default MTU and request the largest one, so bulk
+         * data can be sent in long notifications */
+        ble_env.mtu = ATT_DEFAULT_MTU;
+        mtu_cmd = KE_MSG_ALLOC(GATTC_EXC_MTU_CMD,
+                               KE_BUILD_ID(TASK_GATTC, ble_env.conidx), TASK_APP,
+                               gattc_exc_mtu_cmd);
+        mtu_cmd->operation = GATTC_MTU_EXCH;
+        mtu_cmd->seq_num = 0;
+        ke_msg_send(mtu_cmd);
+
         BLE_SetServiceState(true);
 
     }
@@ -694,6 +705,34 @@ int GAPC_ParamUpdateReqInd(ke_msg_id_t const msg_id,
     return(KE_MSG_CONSUMED);
 }
 
+/* ----------------------------------------------------------------------------
+ * Function      : int GATTC_MtuChangedInd(ke_msg_id_t const msg_id,
+ *                                         struct gattc_mtu_changed_ind
+ *                                         const *param,
+ *                                         ke_task_id_t const dest_id,
+ *                                         ke_task_id_t const src_id)
+ * ----------------------------------------------------------------------------
+ * Description   : Handle the MTU changed indication of the GATT controller,
+ *                 sent once an MTU exchange has been completed
+ * Inputs        : - msg_id     - Kernel message ID number
+ *                 - param      - Message parameters in format of
+ *                                struct gattc_mtu_changed_ind
+ *                 - dest_id    - Destination task ID number
+ *                 - src_id     - Source task ID number
+ * Outputs       : return value - Indicate if the message was consumed;
+ *                                compare with KE_MSG_CONSUMED
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+int GATTC_MtuChangedInd(ke_msg_id_t const msg_id,
+                        struct gattc_mtu_changed_ind const *param,
+                        ke_task_id_t const dest_id,
+                        ke_task_id_t const src_id)
+{
+    ble_env.mtu = param->mtu;
+
+    return(KE_MSG_CONSUMED);
+}
+
 /* ----------------------------------------------------------------------------
  * Function      : void BLE_SetServiceState(bool enable)
  * ----------------------------------------------------------------------------
@@ -721,6 +760,7 @@ void BLE_SetServiceState(bool enable)
     {
 //        bass_support_env.enable = false;
         reak_env.state = REAK_INIT;
+        History_Abort();
     }
 
 }
@@ -0,0 +1,398 @@
+/* ----------------------------------------------------------------------------
+ * codec.c
+ * - Block encoders of sample series and of rollups, see codec.h for the
+ *   formats.
+ * - Known limitations:
+ *   > Bits are packed one at a time; a block of CODEC_BLOCK_SAMPLES samples
+ *     takes about a thousand loop iterations to encode.
+ * ------------------------------------------------------------------------- */
+
+#include "codec.h"
+#include <string.h>
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t Codec_ZigZag(int32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Map a signed difference to an unsigned value, small
+ *                 magnitudes to small values (0, -1, 1, -2 -> 0, 1, 2, 3)
+ * Inputs        : - value      - Signed difference
+ * Outputs       : return value - Zigzag encoded value
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t Codec_ZigZag(int32_t value)
+{
+    return (value >= 0 ? (uint32_t)value << 1 : ((uint32_t)(-value) << 1) - 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static int32_t Codec_UnZigZag(uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Inverse of Codec_ZigZag
+ * Inputs        : - value      - Zigzag encoded value
+ * Outputs       : return value - Signed difference
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static int32_t Codec_UnZigZag(uint32_t value)
+{
+    return ((value & 1) ? -(int32_t)((value + 1) >> 1) : (int32_t)(value >> 1));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint8_t Codec_Width(uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Number of bits needed to hold a value
+ * Inputs        : - value      - Unsigned value
+ * Outputs       : return value - Bit width, 0 for 0
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint8_t Codec_Width(uint32_t value)
+{
+    uint8_t width = 0;
+
+    while (value)
+    {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Codec_Put(uint8_t *data, uint32_t *bit,
+ *                                       uint32_t value, uint8_t width)
+ * ----------------------------------------------------------------------------
+ * Description   : Append a field to a bit stream, LSB first
+ * Inputs        : - data       - Bit stream, cleared beforehand
+ *                 - bit        - Position of the next bit, updated
+ *                 - value      - Field value
+ *                 - width      - Field width (in bits)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void Codec_Put(uint8_t *data, uint32_t *bit, uint32_t value, uint8_t width)
+{
+    while (width--)
+    {
+        if (value & 1)
+        {
+            data[*bit >> 3] |= (uint8_t)(1 << (*bit & 7));
+        }
+        value >>= 1;
+        (*bit)++;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t Codec_Get(const uint8_t *data,
+ *                                           uint32_t *bit, uint8_t width)
+ * ----------------------------------------------------------------------------
+ * Description   : Extract a field of a bit stream, LSB first
+ * Inputs        : - data       - Bit stream
+ *                 - bit        - Position of the field, updated
+ *                 - width      - Field width (in bits)
+ * Outputs       : return value - Field value
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t Codec_Get(const uint8_t *data, uint32_t *bit, uint8_t width)
+{
+    uint32_t value = 0;
+    uint8_t i;
+
+    for (i = 0; i < width; i++)
+    {
+        if (data[*bit >> 3] & (1 << (*bit & 7)))
+        {
+            value |= (uint32_t)1 << i;
+        }
+        (*bit)++;
+    }
+    return value;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint16_t Codec_Encode(const struct codec_block_tag *block,
+ *                                       uint8_t *data)
+ * ----------------------------------------------------------------------------
+ * Description   : Encode a block
+ * Inputs        : - block      - Samples, offsets in increasing order
+ *                 - data       - Encoded block (CODEC_BLOCK_SIZE_MAX bytes)
+ * Outputs       : return value - Encoded block size (in bytes)
+ * Assumptions   : block->count is 1 to CODEC_BLOCK_SAMPLES
+ * ------------------------------------------------------------------------- */
+uint16_t Codec_Encode(const struct codec_block_tag *block, uint8_t *data)
+{
+    uint32_t time_max = 0;
+    uint32_t value_max = 0;
+    uint8_t time_width;
+    uint8_t value_width;
+    uint32_t bit = 0;
+    uint16_t size;
+    uint8_t i;
+
+    /* Smallest widths that fit all the differences of the block */
+    for (i = 1; i < block->count; i++)
+    {
+        time_max |= (uint32_t)(block->offset[i] - block->offset[i - 1]);
+        value_max |= Codec_ZigZag((int32_t)block->value[i] - block->value[i - 1]);
+    }
+    time_width = Codec_Width(time_max);
+    value_width = Codec_Width(value_max);
+
+    memcpy(&data[0], &block->seq, sizeof(block->seq));
+    memcpy(&data[4], &block->time, sizeof(block->time));
+    memcpy(&data[8], &block->value[0], sizeof(block->value[0]));
+    data[10] = block->sensor;
+    data[11] = block->count;
+    data[12] = value_width;
+    data[13] = time_width;
+
+    size = Codec_Size(data);
+    memset(&data[CODEC_HEADER_SIZE], 0, size - CODEC_HEADER_SIZE);
+    for (i = 1; i < block->count; i++)
+    {
+        Codec_Put(&data[CODEC_HEADER_SIZE], &bit,
+                  block->offset[i] - block->offset[i - 1], time_width);
+        Codec_Put(&data[CODEC_HEADER_SIZE], &bit,
+                  Codec_ZigZag((int32_t)block->value[i] - block->value[i - 1]), value_width);
+    }
+    return size;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint16_t Codec_Size(const uint8_t *header)
+ * ----------------------------------------------------------------------------
+ * Description   : Size of an encoded block
+ * Inputs        : - header     - Encoded block header (CODEC_HEADER_SIZE
+ *                                bytes)
+ * Outputs       : return value - Encoded block size (in bytes)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint16_t Codec_Size(const uint8_t *header)
+{
+    uint8_t count = header[11];
+    uint32_t bits = (count > 1 ? (uint32_t)(count - 1) * (header[12] + header[13]) : 0);
+
+    return (uint16_t)(CODEC_HEADER_SIZE + (bits + 7) / 8);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Codec_Decode(const uint8_t *data, uint16_t length,
+ *                                   struct codec_block_tag *block)
+ * ----------------------------------------------------------------------------
+ * Description   : Decode a block
+ * Inputs        : - data       - Encoded block
+ *                 - length     - Bytes available at data
+ *                 - block      - Decoded block
+ * Outputs       : return value - false if the block is invalid or truncated
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool Codec_Decode(const uint8_t *data, uint16_t length, struct codec_block_tag *block)
+{
+    uint32_t bit = 0;
+    int32_t value;
+    uint8_t i;
+
+    if (length < CODEC_HEADER_SIZE || data[11] < 1 || data[11] > CODEC_BLOCK_SAMPLES ||
+        data[12] > CODEC_VALUE_WIDTH_MAX || data[13] > CODEC_TIME_WIDTH_MAX ||
+        length < Codec_Size(data))
+    {
+        return false;
+    }
+
+    memcpy(&block->seq, &data[0], sizeof(block->seq));
+    memcpy(&block->time, &data[4], sizeof(block->time));
+    memcpy(&block->value[0], &data[8], sizeof(block->value[0]));
+    block->sensor = data[10];
+    block->count = data[11];
+    block->offset[0] = 0;
+
+    for (i = 1; i < block->count; i++)
+    {
+        block->offset[i] = block->offset[i - 1] +
+                           Codec_Get(&data[CODEC_HEADER_SIZE], &bit, data[13]);
+        value = block->value[i - 1] +
+                Codec_UnZigZag(Codec_Get(&data[CODEC_HEADER_SIZE], &bit, data[12]));
+        block->value[i] = (int16_t)value;
+    }
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint16_t Codec_Rollup_Encode(
+ *                     const struct codec_rollup_tag *block, uint8_t *data)
+ * ----------------------------------------------------------------------------
+ * Description   : Encode a rollup block
+ * Inputs        : - block      - Rollups, offsets in increasing order, min
+ *                                <= mean <= max
+ *                 - data       - Encoded block (CODEC_ROLLUP_SIZE_MAX bytes)
+ * Outputs       : return value - Encoded block size (in bytes)
+ * Assumptions   : block->count is 1 to CODEC_ROLLUP_RECORDS
+ * ------------------------------------------------------------------------- */
+uint16_t Codec_Rollup_Encode(const struct codec_rollup_tag *block, uint8_t *data)
+{
+    uint32_t step_max = 0;
+    uint32_t mean_max = 0;
+    uint32_t spread_max = 0;
+    uint8_t step_width;
+    uint8_t mean_width;
+    uint8_t spread_width;
+    uint32_t bit = 0;
+    uint16_t size;
+    uint8_t i;
+
+    /* Smallest widths that fit all the fields of the block */
+    for (i = 0; i < block->count; i++)
+    {
+        if (i > 0)
+        {
+            step_max |= (uint32_t)(block->offset[i] - block->offset[i - 1] - 1);
+            mean_max |= Codec_ZigZag((int32_t)block->mean[i] - block->mean[i - 1]);
+        }
+        spread_max |= (uint32_t)((int32_t)block->mean[i] - block->min[i]);
+        spread_max |= (uint32_t)((int32_t)block->max[i] - block->mean[i]);
+    }
+    step_width = Codec_Width(step_max);
+    mean_width = Codec_Width(mean_max);
+    spread_width = Codec_Width(spread_max);
+
+    memcpy(&data[0], &block->seq, sizeof(block->seq));
+    memcpy(&data[4], &block->time, sizeof(block->time));
+    memcpy(&data[8], &block->mean[0], sizeof(block->mean[0]));
+    memcpy(&data[10], &block->period, sizeof(block->period));
+    data[12] = block->sensor;
+    data[13] = block->count;
+    data[14] = step_width;
+    data[15] = mean_width;
+    data[16] = spread_width;
+
+    size = Codec_Rollup_Size(data);
+    memset(&data[CODEC_ROLLUP_HEADER_SIZE], 0, size - CODEC_ROLLUP_HEADER_SIZE);
+    for (i = 0; i < block->count; i++)
+    {
+        if (i > 0)
+        {
+            Codec_Put(&data[CODEC_ROLLUP_HEADER_SIZE], &bit,
+                      block->offset[i] - block->offset[i - 1] - 1, step_width);
+            Codec_Put(&data[CODEC_ROLLUP_HEADER_SIZE], &bit,
+                      Codec_ZigZag((int32_t)block->mean[i] - block->mean[i - 1]), mean_width);
+        }
+        Codec_Put(&data[CODEC_ROLLUP_HEADER_SIZE], &bit,
+                  (uint32_t)((int32_t)block->mean[i] - block->min[i]), spread_width);
+        Codec_Put(&data[CODEC_ROLLUP_HEADER_SIZE], &bit,
+                  (uint32_t)((int32_t)block->max[i] - block->mean[i]), spread_width);
+    }
+    return size;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint16_t Codec_Rollup_Size(const uint8_t *header)
+ * ----------------------------------------------------------------------------
+ * Description   : Size of an encoded rollup block
+ * Inputs        : - header     - Encoded block header
+ *                                (CODEC_ROLLUP_HEADER_SIZE bytes)
+ * Outputs       : return value - Encoded block size (in bytes)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint16_t Codec_Rollup_Size(const uint8_t *header)
+{
+    uint8_t count = header[13];
+    uint32_t bits = (uint32_t)count * 2 * header[16];
+
+    if (count > 1)
+    {
+        bits += (uint32_t)(count - 1) * (header[14] + header[15]);
+    }
+    return (uint16_t)(CODEC_ROLLUP_HEADER_SIZE + (bits + 7) / 8);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Codec_Rollup_Decode(const uint8_t *data,
+ *                                          uint16_t length,
+ *                                          struct codec_rollup_tag *block)
+ * ----------------------------------------------------------------------------
+ * Description   : Decode a rollup block
+ * Inputs        : - data       - Encoded block
+ *                 - length     - Bytes available at data
+ *                 - block      - Decoded block
+ * Outputs       : return value - false if the block is invalid or truncated
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool Codec_Rollup_Decode(const uint8_t *data, uint16_t length, struct codec_rollup_tag *block)
+{
+    const uint8_t *fields = &data[CODEC_ROLLUP_HEADER_SIZE];
+    uint32_t bit = 0;
+    int32_t mean;
+    uint8_t i;
+
+    if (length < CODEC_ROLLUP_HEADER_SIZE || data[13] < 1 || data[13] > CODEC_ROLLUP_RECORDS ||
+        data[14] > CODEC_STEP_WIDTH_MAX || data[15] > CODEC_VALUE_WIDTH_MAX ||
+        data[16] > CODEC_SPREAD_WIDTH_MAX || length < Codec_Rollup_Size(data))
+    {
+        return false;
+    }
+
+    memcpy(&block->seq, &data[0], sizeof(block->seq));
+    memcpy(&block->time, &data[4], sizeof(block->time));
+    memcpy(&block->mean[0], &data[8], sizeof(block->mean[0]));
+    memcpy(&block->period, &data[10], sizeof(block->period));
+    block->sensor = data[12];
+    block->count = data[13];
+    block->offset[0] = 0;
+
+    for (i = 0; i < block->count; i++)
+    {
+        if (i > 0)
+        {
+            block->offset[i] = block->offset[i - 1] + 1 + Codec_Get(fields, &bit, data[14]);
+            mean = block->mean[i - 1] + Codec_UnZigZag(Codec_Get(fields, &bit, data[15]));
+            block->mean[i] = (int16_t)mean;
+        }
+        block->min[i] = (int16_t)(block->mean[i] - (int32_t)Codec_Get(fields, &bit, data[16]));
+        block->max[i] = (int16_t)(block->mean[i] + (int32_t)Codec_Get(fields, &bit, data[16]));
+    }
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t Codec_Time(const uint8_t *data, uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Time of the last sample of an encoded block
+ * Inputs        : - data       - Encoded block
+ *                 - length     - Bytes available at data
+ * Outputs       : return value - Time of the last sample (s), 0 if the
+ *                                block is invalid
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t Codec_Time(const uint8_t *data, uint16_t length)
+{
+    struct codec_block_tag block;
+
+    if (!Codec_Decode(data, length, &block))
+    {
+        return 0;
+    }
+    return block.time + block.offset[block.count - 1];
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t Codec_Rollup_Time(const uint8_t *data,
+ *                                            uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Time of the last second of the last bucket of an encoded
+ *                 rollup block
+ * Inputs        : - data       - Encoded rollup block
+ *                 - length     - Bytes available at data
+ * Outputs       : return value - End of the last bucket (s), 0 if the block
+ *                                is invalid
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t Codec_Rollup_Time(const uint8_t *data, uint16_t length)
+{
+    struct codec_rollup_tag block;
+
+    if (!Codec_Rollup_Decode(data, length, &block))
+    {
+        return 0;
+    }
+    return block.time + (block.offset[block.count - 1] + 1) * (uint32_t)block.period - 1;
+}
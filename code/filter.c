@@ -0,0 +1,185 @@
+/* ----------------------------------------------------------------------------
+ * filter.c
+ * - Fixed-point filter stage of the temperature pipeline, see filter.h.
+ * - Known limitations:
+ *   > The IIR state and the boxcar sum are kept per channel; a parameter change
+ *     should be followed by Filter_Reset of each channel.
+ * ------------------------------------------------------------------------- */
+
+#include "filter.h"
+#include <string.h>
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Filter_Param_Check(const struct filter_param_tag *param)
+ * ----------------------------------------------------------------------------
+ * Description   : Check the filter parameters
+ * Inputs        : - param      - Filter parameters
+ * Outputs       : return value - true if the parameters are valid
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool Filter_Param_Check(const struct filter_param_tag *param)
+{
+    if (param->burst < 1 || param->burst > FILTER_BURST_MAX || param->decimation < 1)
+    {
+        return false;
+    }
+
+    switch (param->type)
+    {
+        case FILTER_TYPE_NONE:
+            return true;
+        case FILTER_TYPE_IIR:
+            return (param->coef >= 1 && param->coef <= FILTER_IIR_SHIFT_MAX);
+        case FILTER_TYPE_BOXCAR:
+            return (param->coef >= 1 && param->coef <= FILTER_BOXCAR_MAX);
+        default:
+            return false;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Filter_Param_Unpack(uint32_t value,
+ *                                          struct filter_param_tag *param)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the filter parameters from a settings word (see
+ *                 FILTER_PARAM_PACK)
+ * Inputs        : - value      - Packed parameters
+ *                 - param      - Filter parameters
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Filter_Param_Unpack(uint32_t value, struct filter_param_tag *param)
+{
+    param->burst = value & 0xFF;
+    param->type = (value >> 8) & 0xFF;
+    param->coef = (value >> 16) & 0xFF;
+    param->decimation = (value >> 24) & 0xFF;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Filter_Reset(struct filter_tag *filter)
+ * ----------------------------------------------------------------------------
+ * Description   : Clear the burst and the filter history of a channel
+ * Inputs        : - filter     - Channel filter state
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Filter_Reset(struct filter_tag *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Filter_Add(struct filter_tag *filter, int16_t sample)
+ * ----------------------------------------------------------------------------
+ * Description   : Add a conversion to the current burst. Invalid samples and
+ *                 samples beyond FILTER_BURST_MAX are ignored.
+ * Inputs        : - filter     - Channel filter state
+ *                 - sample     - Temperature (0.01 degC)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Filter_Add(struct filter_tag *filter, int16_t sample)
+{
+    if (sample != FILTER_SAMPLE_INVALID && filter->burst_count < FILTER_BURST_MAX)
+    {
+        filter->burst[filter->burst_count++] = sample;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static int16_t Filter_Median(struct filter_tag *filter)
+ * ----------------------------------------------------------------------------
+ * Description   : Median of the burst (mean of the two middle samples for an
+ *                 even count). The burst is sorted in place.
+ * Inputs        : - filter     - Channel filter state
+ * Outputs       : return value - Median (0.01 degC)
+ * Assumptions   : The burst holds at least one sample
+ * ------------------------------------------------------------------------- */
+static int16_t Filter_Median(struct filter_tag *filter)
+{
+    int16_t *x = filter->burst;
+    uint8_t n = filter->burst_count;
+    uint8_t i, j;
+    int16_t v;
+
+    /* Insertion sort, the burst is short */
+    for (i = 1; i < n; i++)
+    {
+        v = x[i];
+        for (j = i; j > 0 && x[j - 1] > v; j--)
+        {
+            x[j] = x[j - 1];
+        }
+        x[j] = v;
+    }
+
+    if (n & 1)
+    {
+        return x[n / 2];
+    }
+    return (int16_t)(((int32_t)x[n / 2 - 1] + x[n / 2]) / 2);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : int16_t Filter_Run(struct filter_tag *filter,
+ *                                    const struct filter_param_tag *param)
+ * ----------------------------------------------------------------------------
+ * Description   : End the current burst: its median is fed to the selected
+ *                 filter and the burst is cleared
+ * Inputs        : - filter     - Channel filter state
+ *                 - param      - Filter parameters
+ * Outputs       : return value - Filter output (0.01 degC), or
+ *                                FILTER_SAMPLE_INVALID if the burst had no
+ *                                valid sample (the history is kept)
+ * Assumptions   : The parameters have been checked by Filter_Param_Check
+ * ------------------------------------------------------------------------- */
+int16_t Filter_Run(struct filter_tag *filter, const struct filter_param_tag *param)
+{
+    int16_t x;
+    int32_t y;
+
+    if (filter->burst_count == 0)
+    {
+        return FILTER_SAMPLE_INVALID;
+    }
+    x = Filter_Median(filter);
+    filter->burst_count = 0;
+
+    switch (param->type)
+    {
+        case FILTER_TYPE_IIR:
+            if (!filter->primed)
+            {
+                filter->iir = (int32_t)x << FILTER_IIR_FRAC;
+                filter->primed = true;
+            }
+            filter->iir += (((int32_t)x << FILTER_IIR_FRAC) - filter->iir) >> param->coef;
+
+            /* Rounded to the nearest 0.01 degC */
+            y = (filter->iir + (1 << (FILTER_IIR_FRAC - 1))) >> FILTER_IIR_FRAC;
+            return (int16_t)y;
+
+        case FILTER_TYPE_BOXCAR:
+            /* Drop the oldest samples if the length has been reduced */
+            while (filter->boxcar_count >= param->coef)
+            {
+                filter->boxcar_sum -= filter->boxcar[(uint8_t)(filter->boxcar_pos + FILTER_BOXCAR_MAX -
+                                                               filter->boxcar_count) % FILTER_BOXCAR_MAX];
+                filter->boxcar_count--;
+            }
+            filter->boxcar[filter->boxcar_pos] = x;
+            filter->boxcar_pos = (filter->boxcar_pos + 1) % FILTER_BOXCAR_MAX;
+            filter->boxcar_sum += x;
+            filter->boxcar_count++;
+            filter->primed = true;
+
+            /* Mean of the samples received so far until the window is full */
+            y = filter->boxcar_sum;
+            y += (y < 0 ? -(filter->boxcar_count / 2) : filter->boxcar_count / 2);
+            return (int16_t)(y / filter->boxcar_count);
+
+        default:
+            return x;
+    }
+}
@@ -0,0 +1,341 @@
+/* ----------------------------------------------------------------------------
+ * flashlog.c
+ * - Persistent sample log in the main flash. See flashlog.h for the page and
+ *   record format.
+ * - Known limitations:
+ *   > The flash is written by the CPU; committing a page blocks the caller
+ *     for the sector erase and the programming of the page (as for the
+ *     settings), so it is only done from the kernel context, once per page.
+ *   > Sequence numbers are 32 bits and compared modulo 2^32.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct flashlog_env_tag flashlog_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint16_t FlashLog_CRC(uint16_t crc, const uint8_t *data,
+ *                                       uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Update a CRC-16/CCITT (polynomial 0x1021), also used by
+ *                 the archive
+ * Inputs        : - crc        - Current CRC (0xFFFF at the start)
+ *                 - data       - Data
+ *                 - length     - Number of bytes
+ * Outputs       : return value - Updated CRC
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint16_t FlashLog_CRC(uint16_t crc, const uint8_t *data, uint16_t length)
+{
+    uint8_t bit;
+
+    while (length--)
+    {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t FlashLog_Page_Addr(uint8_t page)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the address of a log page
+ * Inputs        : - page       - Page (sector) index
+ * Outputs       : return value - Page address
+ * Assumptions   : page < FLASHLOG_SECTORS
+ * ------------------------------------------------------------------------- */
+static uint32_t FlashLog_Page_Addr(uint8_t page)
+{
+    return FLASHLOG_FLASH_ADDR + (uint32_t)page * FLASHLOG_PAGE_SIZE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool FlashLog_Header_Valid(const uint32_t *header)
+ * ----------------------------------------------------------------------------
+ * Description   : Check a page header
+ * Inputs        : - header     - Page header (4 words)
+ * Outputs       : return value - true if the page is complete
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static bool FlashLog_Header_Valid(const uint32_t *header)
+{
+    return (header[3] & 0xFFFF) == FLASHLOG_PAGE_MAGIC &&
+           (header[3] >> 16) == FlashLog_CRC(0xFFFF, (const uint8_t *)header, 14) &&
+           (header[2] >> 16) <= FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static const uint32_t *FlashLog_Header(uint8_t page)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the header of a programmed page
+ * Inputs        : - page       - Page (sector) index
+ * Outputs       : return value - Page header, NULL if the page is erased or
+ *                                incomplete
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static const uint32_t *FlashLog_Header(uint8_t page)
+{
+    const uint32_t *header = (const uint32_t *)(FlashLog_Page_Addr(page) +
+                                                FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE);
+
+    return FlashLog_Header_Valid(header) ? header : NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool FlashLog_Find(const uint8_t *page,
+ *                                           uint16_t used, uint32_t *seq,
+ *                                           uint8_t *data, uint16_t size,
+ *                                           uint16_t *length)
+ * ----------------------------------------------------------------------------
+ * Description   : Look for the first record of a page whose sequence number
+ *                 is at least *seq. Records with a bad CRC or longer than
+ *                 the payload buffer are skipped.
+ * Inputs        : - page       - Page records (flash or page buffer)
+ *                 - used       - Bytes used by the records
+ *                 - seq        - Sequence number looked for, set to the
+ *                                sequence number of the record found
+ *                 - data       - Payload buffer
+ *                 - size       - Payload buffer size
+ *                 - length     - Payload length of the record found
+ * Outputs       : return value - true if a record has been found
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static bool FlashLog_Find(const uint8_t *page, uint16_t used, uint32_t *seq,
+                          uint8_t *data, uint16_t size, uint16_t *length)
+{
+    uint16_t pos = 0;
+    uint32_t record[2];
+    uint16_t n;
+
+    while (pos + FLASHLOG_RECORD_HEADER_SIZE <= used)
+    {
+        memcpy(record, &page[pos], sizeof(record));
+        n = record[1] & 0xFFFF;
+        if (n > used - pos - FLASHLOG_RECORD_HEADER_SIZE)
+        {
+            return false;
+        }
+        if ((int32_t)(record[0] - *seq) >= 0 && n <= size &&
+            (record[1] >> 16) == FlashLog_CRC(FlashLog_CRC(0xFFFF, &page[pos], 6),
+                                              &page[pos + FLASHLOG_RECORD_HEADER_SIZE], n))
+        {
+            *seq = record[0];
+            memcpy(data, &page[pos + FLASHLOG_RECORD_HEADER_SIZE], n);
+            *length = n;
+            return true;
+        }
+        pos += FLASHLOG_RECORD_HEADER_SIZE + FLASHLOG_ALIGN(n);
+    }
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void FlashLog_Open(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start an empty page buffer
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void FlashLog_Open(void)
+{
+    flashlog_env.first = flashlog_env.seq;
+    flashlog_env.count = 0;
+    flashlog_env.used = 0;
+    memset(flashlog_env.buffer, 0xFF, sizeof(flashlog_env.buffer));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void FlashLog_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Find the newest complete page from the page headers and
+ *                 continue the log in the next sector
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Settings_Init has been called (flash unlocked for writing)
+ * ------------------------------------------------------------------------- */
+void FlashLog_Init(void)
+{
+    const uint32_t *header;
+    const uint32_t *newest = NULL;
+    uint8_t page;
+
+    memset(&flashlog_env, 0, sizeof(flashlog_env));
+
+    for (page = 0; page < FLASHLOG_SECTORS; page++)
+    {
+        header = FlashLog_Header(page);
+        if (header != NULL && (newest == NULL || (int32_t)(header[0] - newest[0]) > 0))
+        {
+            newest = header;
+            flashlog_env.page = page;
+        }
+    }
+
+    if (newest != NULL)
+    {
+        flashlog_env.page = (flashlog_env.page + 1) % FLASHLOG_SECTORS;
+        flashlog_env.page_seq = newest[0] + 1;
+        flashlog_env.seq = newest[1] + (newest[2] & 0xFFFF);
+    }
+    FlashLog_Open();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool FlashLog_Append(const uint8_t *data, uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Append a record to the page buffer. The page is committed
+ *                 first if the record doesn't fit.
+ * Inputs        : - data       - Payload
+ *                 - length     - Payload length (up to FLASHLOG_PAYLOAD_MAX)
+ * Outputs       : return value - true if the record has been appended
+ * Assumptions   : FlashLog_Init has been called
+ * ------------------------------------------------------------------------- */
+bool FlashLog_Append(const uint8_t *data, uint16_t length)
+{
+    uint8_t *record;
+    uint32_t word;
+    uint16_t crc;
+
+    if (length > FLASHLOG_PAYLOAD_MAX)
+    {
+        return false;
+    }
+    if (flashlog_env.used + FLASHLOG_RECORD_HEADER_SIZE + FLASHLOG_ALIGN(length) >
+        FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE)
+    {
+        FlashLog_Commit();
+    }
+
+    record = (uint8_t *)flashlog_env.buffer + flashlog_env.used;
+    memcpy(&record[0], &flashlog_env.seq, sizeof(uint32_t));
+    memcpy(&record[4], &length, sizeof(uint16_t));
+    memcpy(&record[FLASHLOG_RECORD_HEADER_SIZE], data, length);
+    crc = FlashLog_CRC(FlashLog_CRC(0xFFFF, record, 6), data, length);
+    word = length | ((uint32_t)crc << 16);
+    memcpy(&record[4], &word, sizeof(word));
+
+    flashlog_env.seq++;
+    flashlog_env.count++;
+    flashlog_env.used += FLASHLOG_RECORD_HEADER_SIZE + FLASHLOG_ALIGN(length);
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool FlashLog_Commit(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Program the page buffer into the next sector (erased
+ *                 first) and start a new page. The header is programmed
+ *                 last. The page buffer is dropped if programming fails.
+ * Inputs        : None
+ * Outputs       : return value - true if the page has been programmed (or
+ *                                the page buffer is empty)
+ * Assumptions   : FlashLog_Init has been called
+ * ------------------------------------------------------------------------- */
+bool FlashLog_Commit(void)
+{
+    uint32_t addr = FlashLog_Page_Addr(flashlog_env.page);
+    uint32_t header[FLASHLOG_HEADER_SIZE / 4];
+    bool result;
+    uint16_t i;
+
+    if (flashlog_env.count == 0)
+    {
+        return true;
+    }
+
+    header[0] = flashlog_env.page_seq;
+    header[1] = flashlog_env.first;
+    header[2] = flashlog_env.count | ((uint32_t)flashlog_env.used << 16);
+    header[3] = FLASHLOG_PAGE_MAGIC;
+    header[3] |= (uint32_t)FlashLog_CRC(0xFFFF, (const uint8_t *)header, 14) << 16;
+
+    result = (Flash_EraseSector(addr) == FLASH_ERR_NONE);
+    for (i = 0; result && i < flashlog_env.used / 4; i += 2)
+    {
+        result = (Flash_WriteWordPair(addr + i * 4, flashlog_env.buffer[i],
+                                      flashlog_env.buffer[i + 1]) == FLASH_ERR_NONE);
+    }
+    addr += FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE;
+    for (i = 0; result && i < FLASHLOG_HEADER_SIZE / 4; i += 2)
+    {
+        result = (Flash_WriteWordPair(addr + i * 4, header[i], header[i + 1]) == FLASH_ERR_NONE);
+    }
+
+    if (!result)
+    {
+        flashlog_env.errors++;
+    }
+    flashlog_env.page = (flashlog_env.page + 1) % FLASHLOG_SECTORS;
+    flashlog_env.page_seq++;
+    FlashLog_Open();
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool FlashLog_Read(uint32_t *seq, uint8_t *data,
+ *                                    uint16_t size, uint16_t *length)
+ * ----------------------------------------------------------------------------
+ * Description   : Read the first record whose sequence number is at least
+ *                 *seq, from the programmed pages or the page buffer.
+ *                 Records longer than the payload buffer are skipped.
+ * Inputs        : - seq        - Sequence number looked for, set to the
+ *                                sequence number of the record read
+ *                 - data       - Payload buffer
+ *                 - size       - Payload buffer size (CODEC_BLOCK_SIZE_MAX
+ *                                for the history blocks)
+ *                 - length     - Payload length of the record read
+ * Outputs       : return value - false if there is no such record
+ * Assumptions   : FlashLog_Init has been called
+ * ------------------------------------------------------------------------- */
+bool FlashLog_Read(uint32_t *seq, uint8_t *data, uint16_t size, uint16_t *length)
+{
+    const uint32_t *header;
+    uint8_t page;
+    uint8_t i;
+
+    /* Pages from the oldest one: the write page is the oldest one, until it
+     * is erased */
+    for (i = 0; i < FLASHLOG_SECTORS; i++)
+    {
+        page = (flashlog_env.page + i) % FLASHLOG_SECTORS;
+        header = FlashLog_Header(page);
+        if (header == NULL || (int32_t)(header[1] + (header[2] & 0xFFFF) - *seq) <= 0 ||
+            (int32_t)(header[1] - flashlog_env.first) >= 0)
+        {
+            continue;
+        }
+        if (FlashLog_Find((const uint8_t *)FlashLog_Page_Addr(page), header[2] >> 16,
+                          seq, data, size, length))
+        {
+            return true;
+        }
+    }
+    return FlashLog_Find((const uint8_t *)flashlog_env.buffer, flashlog_env.used,
+                         seq, data, size, length);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void FlashLog_Process(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the history blocks closed since the last call to the
+ *                 log
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called periodically from the kernel context
+ * ------------------------------------------------------------------------- */
+void FlashLog_Process(void)
+{
+    uint8_t block[CODEC_BLOCK_SIZE_MAX];
+    uint16_t length;
+
+    while (History_Block_Read(&flashlog_env.history_pos, block, &length))
+    {
+        FlashLog_Append(block, length);
+    }
+}
@@ -0,0 +1,848 @@
+/* ----------------------------------------------------------------------------
+ * history.c
+ * - Sample history, RAM ring buffer of timestamped samples and its download
+ *   over BLE, also of the rollup tiers and of the flash log. See history.h
+ *   for the control point and the packet format.
+ * - History_Add is called by the sampler from the interrupt handlers, the
+ *   download runs from the BLE message handlers; the records of a packet are
+ *   copied with the interrupts masked.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct history_env_tag history_env;
+
+_Static_assert(sizeof(struct history_env_tag) + sizeof(struct rollup_env_tag) +
+               sizeof(struct flashlog_env_tag) + sizeof(struct archive_env_tag) <= HISTORY_RAM_BUDGET,
+               "HISTORY_RAM_BUDGET: the sample storage doesn't fit");
+_Static_assert(ROLLUP_QUARTER_BUFFER_SIZE / CODEC_ROLLUP_HEADER_SIZE < HISTORY_INDEX_SIZE * HISTORY_INDEX_STRIDE &&
+               HISTORY_BUFFER_SIZE / CODEC_HEADER_SIZE < HISTORY_INDEX_SIZE * HISTORY_INDEX_STRIDE,
+               "HISTORY_INDEX_SIZE: the index doesn't cover the rings");
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void History_Read(
+ *                     const struct history_ring_tag *ring, uint32_t pos,
+ *                     uint8_t *data, uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy bytes of the block stream out of a ring
+ * Inputs        : - ring       - Ring buffer
+ *                 - pos        - Stream offset
+ *                 - data       - Destination
+ *                 - length     - Number of bytes
+ * Outputs       : None
+ * Assumptions   : The bytes are kept in the ring
+ * ------------------------------------------------------------------------- */
+static void History_Read(const struct history_ring_tag *ring, uint32_t pos,
+                         uint8_t *data, uint16_t length)
+{
+    while (length--)
+    {
+        *data++ = ring->buffer[pos++ & (ring->size - 1)];
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint16_t History_Block_Size(
+ *                     const struct history_ring_tag *ring, uint32_t pos)
+ * ----------------------------------------------------------------------------
+ * Description   : Size of the block at a stream offset
+ * Inputs        : - ring       - Ring buffer
+ *                 - pos        - Stream offset of a block kept in the ring
+ * Outputs       : return value - Block size (in bytes)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint16_t History_Block_Size(const struct history_ring_tag *ring, uint32_t pos)
+{
+    uint8_t header[CODEC_ROLLUP_HEADER_SIZE];
+
+    History_Read(ring, pos, header, ring->header_size);
+    return ring->block_size(header);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void History_Close(uint8_t sensor)
+ * ----------------------------------------------------------------------------
+ * Description   : Encode the open block of a sensor and append it to the
+ *                 buffer, the oldest blocks are dropped to make room
+ * Inputs        : - sensor     - Sensor index
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers or with the
+ *                 interrupts masked
+ * ------------------------------------------------------------------------- */
+static void History_Close(uint8_t sensor)
+{
+    struct codec_block_tag *block = &history_env.block[sensor];
+    uint32_t time;
+    uint16_t size;
+
+    if (block->count == 0)
+    {
+        return;
+    }
+
+    block->seq = history_env.ring.seq;
+    size = Codec_Encode(block, history_env.encoded);
+    time = block->time + block->offset[block->count - 1];
+    block->count = 0;
+    History_Ring_Write(&history_env.ring, history_env.encoded, size, time);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Flush(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Close the open block of every sensor, so a download
+ *                 includes the latest samples
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Flush(void)
+{
+    uint32_t primask;
+    uint8_t sensor;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    for (sensor = 0; sensor < SENSOR_MAX; sensor++)
+    {
+        History_Close(sensor);
+    }
+    __set_PRIMASK(primask);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static struct history_index_tag *History_Index(
+ *                     struct history_ring_tag *ring, uint32_t seq)
+ * ----------------------------------------------------------------------------
+ * Description   : Index entry of a block
+ * Inputs        : - ring       - Ring buffer
+ *                 - seq        - Block sequence number, a multiple of
+ *                                HISTORY_INDEX_STRIDE
+ * Outputs       : return value - Index entry, valid if the block is kept
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static struct history_index_tag *History_Index(struct history_ring_tag *ring, uint32_t seq)
+{
+    return &ring->index[(seq / HISTORY_INDEX_STRIDE) % HISTORY_INDEX_SIZE];
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t History_Seek(
+ *                     struct history_ring_tag *ring, uint32_t seq)
+ * ----------------------------------------------------------------------------
+ * Description   : Find the stream offset of a block, from the closest index
+ *                 entry before it
+ * Inputs        : - ring       - Ring buffer
+ *                 - seq        - Block sequence number
+ * Outputs       : return value - Stream offset of the block, of the oldest
+ *                                block kept if it has been overwritten, head
+ *                                if it doesn't exist yet
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static uint32_t History_Seek(struct history_ring_tag *ring, uint32_t seq)
+{
+    uint32_t pos = ring->tail;
+    uint32_t n = ring->first;
+    uint32_t entry = seq - seq % HISTORY_INDEX_STRIDE;
+
+    if ((int32_t)(entry - n) > 0 && (int32_t)(ring->seq - entry) > 0)
+    {
+        pos = History_Index(ring, entry)->pos;
+        n = entry;
+    }
+    while ((int32_t)(seq - n) > 0 && pos != ring->head)
+    {
+        pos += History_Block_Size(ring, pos);
+        n++;
+    }
+    return pos;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t History_Ring_Find(
+ *                     struct history_ring_tag *ring, uint32_t time)
+ * ----------------------------------------------------------------------------
+ * Description   : Find the first block whose record time is at or after a
+ *                 time: binary search of the last index entry before the
+ *                 time, then scan of the blocks following it (up to
+ *                 HISTORY_INDEX_STRIDE). The blocks are copied with the
+ *                 interrupts masked and decoded with the interrupts enabled.
+ * Inputs        : - ring       - Ring buffer
+ *                 - time       - Time (s)
+ * Outputs       : return value - Sequence number of the block, of the next
+ *                                block if every block kept is older
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t History_Ring_Find(struct history_ring_tag *ring, uint32_t time)
+{
+    uint8_t data[MAX(CODEC_BLOCK_SIZE_MAX, CODEC_ROLLUP_SIZE_MAX)];
+    struct history_index_tag *entry;
+    uint32_t primask;
+    uint32_t lower;
+    uint32_t count;
+    uint32_t low;
+    uint32_t high;
+    uint32_t middle;
+    uint32_t record = 0;
+    uint32_t pos;
+    uint32_t n;
+    uint16_t length;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    if (ring->time < time || ring->first == ring->seq)
+    {
+        n = ring->seq;
+        __set_PRIMASK(primask);
+        return n;
+    }
+
+    /* Index entries of the blocks kept: lower, lower + stride, ... */
+    lower = ring->first + (HISTORY_INDEX_STRIDE - 1);
+    lower -= lower % HISTORY_INDEX_STRIDE;
+    count = 0;
+    if ((int32_t)(ring->seq - lower) > 0)
+    {
+        count = (ring->seq - lower + HISTORY_INDEX_STRIDE - 1) / HISTORY_INDEX_STRIDE;
+    }
+
+    /* Number of entries before the time */
+    low = 0;
+    high = count;
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (History_Index(ring, lower + middle * HISTORY_INDEX_STRIDE)->time < time)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    pos = ring->tail;
+    n = ring->first;
+    if (low > 0)
+    {
+        n = lower + (low - 1) * HISTORY_INDEX_STRIDE;
+        entry = History_Index(ring, n);
+        record = entry->time;
+        pos = entry->pos + History_Block_Size(ring, entry->pos);
+        n++;
+    }
+    __set_PRIMASK(primask);
+
+    /* The record time of the scanned blocks reaches the time at the latest
+     * at the next index entry */
+    while (1)
+    {
+        __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+        if ((int32_t)(n - ring->first) < 0)
+        {
+            pos = ring->tail;
+            n = ring->first;
+        }
+        if (n == ring->seq)
+        {
+            __set_PRIMASK(primask);
+            return n;
+        }
+        length = History_Block_Size(ring, pos);
+        History_Read(ring, pos, data, length);
+        __set_PRIMASK(primask);
+
+        record = MAX(record, ring->block_time(data, length));
+        if (record >= time)
+        {
+            return n;
+        }
+        pos += length;
+        n++;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Notify_Status(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Update the control point value and notify it if the
+ *                 notification is enabled
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Notify_Status(void)
+{
+    History_Status(app_env.history_ctrl);
+    if (app_env.history_ctrl_cccd & ATT_CCC_START_NTF)
+    {
+        REAK_SendNotification(app_env.history_ctrl);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint16_t History_Pack(uint8_t *packet,
+ *                                              uint16_t max)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the next bytes of the download into a packet. If
+ *                 blocks not sent yet have been overwritten, the download
+ *                 continues with the oldest block kept; a bounded download
+ *                 stops at its end.
+ * Inputs        : - packet     - Packet buffer
+ *                 - max        - Maximum number of bytes after the header
+ * Outputs       : return value - Number of bytes copied
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static uint16_t History_Pack(uint8_t *packet, uint16_t max)
+{
+    const struct history_ring_tag *ring = history_env.source;
+    uint32_t end = history_env.bounded ? history_env.end : ring->head;
+    uint16_t n;
+
+    if ((int32_t)(history_env.next - ring->tail) < 0)
+    {
+        history_env.next = ring->tail;
+    }
+    if ((int32_t)(end - history_env.next) <= 0)
+    {
+        return 0;
+    }
+    n = (uint16_t)MIN(max, end - history_env.next);
+
+    memcpy(packet, &history_env.next, sizeof(uint32_t));
+    History_Read(ring, history_env.next, packet + HISTORY_PACKET_HEADER_SIZE, n);
+    history_env.next += n;
+    return n;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint16_t History_Log_Pack(uint8_t *packet,
+ *                                                  uint16_t max)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the next bytes of the flash log download into a
+ *                 packet: the rest of the record being sent, or the start of
+ *                 the next record kept
+ * Inputs        : - packet     - Packet buffer
+ *                 - max        - Maximum number of bytes after the header
+ * Outputs       : return value - Number of bytes copied
+ * Assumptions   : Called from the kernel context, as FlashLog_Process
+ * ------------------------------------------------------------------------- */
+static uint16_t History_Log_Pack(uint8_t *packet, uint16_t max)
+{
+    uint16_t n;
+
+    if (history_env.log_pos == history_env.log_length)
+    {
+        if (!FlashLog_Read(&history_env.log_seq, history_env.log_record,
+                           sizeof(history_env.log_record), &history_env.log_length))
+        {
+            return 0;
+        }
+        history_env.log_pos = 0;
+    }
+    n = MIN(max, history_env.log_length - history_env.log_pos);
+
+    memcpy(packet, &history_env.log_seq, sizeof(uint32_t));
+    memcpy(packet + HISTORY_PACKET_HEADER_SIZE, &history_env.log_record[history_env.log_pos], n);
+    history_env.log_pos += n;
+    if (history_env.log_pos == history_env.log_length)
+    {
+        history_env.log_seq++;
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void History_Send(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Hand the next packets of the download to the stack, as long
+ *                 as notification credits are left. The download ends when
+ *                 the newest record (or the end of a report) has been sent.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void History_Send(void)
+{
+    uint16_t max = MIN(HISTORY_PACKET_SIZE, ble_env.mtu - 3) - HISTORY_PACKET_HEADER_SIZE;
+    uint32_t primask;
+    uint16_t n;
+
+    while (history_env.download && history_env.credits > 0)
+    {
+        if (ble_env.state != APPM_CONNECTED)
+        {
+            History_Abort();
+            return;
+        }
+
+        if (history_env.log)
+        {
+            n = History_Log_Pack(app_env.history_data, max);
+        }
+        else
+        {
+            primask = __get_PRIMASK();
+            __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+            n = History_Pack(app_env.history_data, max);
+            __set_PRIMASK(primask);
+        }
+
+        if (n == 0)
+        {
+            history_env.download = false;
+            History_Notify_Status();
+            if (history_env.report)
+            {
+                history_env.report = false;
+                RACP_Report_Done();
+            }
+            return;
+        }
+
+        history_env.credits--;
+        REAK_SendNotificationLength(app_env.history_data, HISTORY_PACKET_HEADER_SIZE + n,
+                                    HISTORY_NTF_SEQ_NUM);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void History_Download(
+ *                     struct history_ring_tag *ring, uint32_t first)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the download of a ring from a block, or of the
+ *                 flash log from a record
+ * Inputs        : - ring       - Ring buffer, of the samples or of a tier,
+ *                                NULL for the flash log
+ *                 - first      - Sequence number of the first block or
+ *                                record, the oldest one kept if it is older
+ * Outputs       : None
+ * Assumptions   : No download in progress
+ * ------------------------------------------------------------------------- */
+static void History_Download(struct history_ring_tag *ring, uint32_t first)
+{
+    uint32_t primask;
+
+    history_env.log = (ring == NULL);
+    if (history_env.log)
+    {
+        history_env.log_seq = first;
+        history_env.log_length = 0;
+        history_env.log_pos = 0;
+    }
+    else
+    {
+        primask = __get_PRIMASK();
+        __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+        history_env.source = ring;
+        history_env.next = History_Seek(ring, first);
+        history_env.bounded = false;
+        __set_PRIMASK(primask);
+    }
+    history_env.credits = HISTORY_NTF_CREDITS;
+    history_env.download = true;
+    History_Notify_Status();
+    History_Send();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Clear the history
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Init(void)
+{
+    memset(&history_env, 0, sizeof(history_env));
+    History_Ring_Init(&history_env.ring, history_env.buffer, HISTORY_BUFFER_SIZE,
+                      CODEC_HEADER_SIZE, Codec_Size, Codec_Time);
+    history_env.source = &history_env.ring;
+    History_Status(app_env.history_ctrl);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Tick(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Update the history time from the time base
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Called every second
+ * ------------------------------------------------------------------------- */
+void History_Tick(void)
+{
+    history_env.time = TimeBase_Seconds();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Add(uint8_t sensor, int16_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Record a sample in the open block of its sensor. The block
+ *                 is encoded once it is full, or before a sample whose time
+ *                 offset doesn't fit.
+ * Inputs        : - sensor     - Sensor index (sampler registration order)
+ *                 - value      - Sample value
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers only
+ * ------------------------------------------------------------------------- */
+void History_Add(uint8_t sensor, int16_t value)
+{
+    struct codec_block_tag *block;
+    uint32_t time = history_env.time;
+
+    if (sensor >= SENSOR_MAX)
+    {
+        return;
+    }
+    block = &history_env.block[sensor];
+
+    if (block->count > 0 && time - block->time > CODEC_OFFSET_MAX)
+    {
+        History_Close(sensor);
+    }
+    if (block->count == 0)
+    {
+        block->time = time;
+        block->sensor = sensor;
+    }
+    block->offset[block->count] = (uint16_t)(time - block->time);
+    block->value[block->count++] = value;
+
+    if (block->count == CODEC_BLOCK_SAMPLES)
+    {
+        History_Close(sensor);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Command(const uint8_t *command,
+ *                                      uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Execute a command written to the control point. A download
+ *                 replaces the one in progress. Unknown commands are ignored.
+ * Inputs        : - command    - Opcode and parameters
+ *                 - length     - Command length (in bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Command(const uint8_t *command, uint16_t length)
+{
+    uint32_t first = 0;
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    switch (command[0])
+    {
+        case HISTORY_OP_DOWNLOAD:
+            if (length >= 1 + sizeof(first))
+            {
+                memcpy(&first, &command[1], sizeof(first));
+            }
+            History_Abort();
+            History_Flush();
+            History_Download(&history_env.ring, first);
+            break;
+
+        case HISTORY_OP_ABORT:
+            History_Abort();
+            History_Notify_Status();
+            break;
+
+        case HISTORY_OP_ARCHIVE:
+            if (length >= 1 + sizeof(first))
+            {
+                memcpy(&first, &command[1], sizeof(first));
+            }
+            History_Abort();
+            Archive_Download(first);
+            History_Notify_Status();
+            break;
+
+        case HISTORY_OP_ROLLUP:
+            if (length < 2 || command[1] >= ROLLUP_TIERS)
+            {
+                break;
+            }
+            if (length >= 2 + sizeof(first))
+            {
+                memcpy(&first, &command[2], sizeof(first));
+            }
+            History_Abort();
+            Rollup_Flush();
+            History_Download(&rollup_env.tier[command[1]].ring, first);
+            break;
+
+        case HISTORY_OP_LOG:
+            if (length >= 1 + sizeof(first))
+            {
+                memcpy(&first, &command[1], sizeof(first));
+            }
+            History_Abort();
+            History_Download(NULL, first);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Status(uint8_t *status)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the control point status
+ * Inputs        : - status     - Status buffer (HISTORY_CTRL_SIZE bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Status(uint8_t *status)
+{
+    uint32_t first = history_env.ring.first;
+    uint32_t seq = history_env.ring.seq;
+    uint32_t time = history_env.time;
+    uint32_t tail = Archive_Tail();
+    uint32_t head = archive_env.head;
+
+    status[0] = HISTORY_OP_STATUS;
+    status[1] = history_env.download || archive_env.download;
+    memcpy(&status[2], &first, sizeof(first));
+    memcpy(&status[6], &seq, sizeof(seq));
+    memcpy(&status[10], &time, sizeof(time));
+    memcpy(&status[14], &tail, sizeof(tail));
+    memcpy(&status[18], &head, sizeof(head));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Abort(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Stop the download in progress, of the history or the
+ *                 archive, or the report in progress (command or link lost)
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Abort(void)
+{
+    history_env.download = false;
+    history_env.report = false;
+    Archive_Abort();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Sent(uint8_t status)
+ * ----------------------------------------------------------------------------
+ * Description   : A history notification has been completed by the stack,
+ *                 send the next packet (or let the archive read it). The
+ *                 download is stopped if the notification failed.
+ * Inputs        : - status     - Completion status
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void History_Sent(uint8_t status)
+{
+    if (archive_env.download)
+    {
+        Archive_Sent(status);
+        return;
+    }
+    if (history_env.credits < HISTORY_NTF_CREDITS)
+    {
+        history_env.credits++;
+    }
+    if (status != GAP_ERR_NO_ERROR)
+    {
+        History_Abort();
+        return;
+    }
+    History_Send();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool History_Block_Read(uint32_t *pos, uint8_t *data,
+ *                                         uint16_t *length)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the encoded block at a stream offset and advance the
+ *                 offset to the next block. If the block has been
+ *                 overwritten, the oldest block kept is copied.
+ * Inputs        : - pos        - Stream offset of a block (0 after reset)
+ *                 - data       - Block buffer (CODEC_BLOCK_SIZE_MAX bytes)
+ *                 - length     - Block size
+ * Outputs       : return value - false if no block has been closed since
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool History_Block_Read(uint32_t *pos, uint8_t *data, uint16_t *length)
+{
+    uint32_t primask;
+    bool result = false;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    if ((int32_t)(*pos - history_env.ring.tail) < 0)
+    {
+        *pos = history_env.ring.tail;
+    }
+    if (*pos != history_env.ring.head)
+    {
+        *length = History_Block_Size(&history_env.ring, *pos);
+        History_Read(&history_env.ring, *pos, data, *length);
+        *pos += *length;
+        result = true;
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Ring_Init(struct history_ring_tag *ring,
+ *                     uint8_t *buffer, uint32_t size, uint8_t header_size,
+ *                     uint16_t (*block_size)(const uint8_t *header),
+ *                     uint32_t (*block_time)(const uint8_t *data,
+ *                                            uint16_t length))
+ * ----------------------------------------------------------------------------
+ * Description   : Set up an empty ring of encoded blocks
+ * Inputs        : - ring       - Ring buffer
+ *                 - buffer     - Storage of the ring
+ *                 - size       - Storage size (power of 2)
+ *                 - header_size - Bytes needed by block_size (up to
+ *                                 CODEC_ROLLUP_HEADER_SIZE)
+ *                 - block_size - Size of an encoded block from its header
+ *                 - block_time - Time of the newest data of an encoded
+ *                                block
+ * Outputs       : None
+ * Assumptions   : The ring holds less than HISTORY_INDEX_SIZE *
+ *                 HISTORY_INDEX_STRIDE blocks
+ * ------------------------------------------------------------------------- */
+void History_Ring_Init(struct history_ring_tag *ring, uint8_t *buffer, uint32_t size,
+                       uint8_t header_size, uint16_t (*block_size)(const uint8_t *header),
+                       uint32_t (*block_time)(const uint8_t *data, uint16_t length))
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->buffer = buffer;
+    ring->size = size;
+    ring->header_size = header_size;
+    ring->block_size = block_size;
+    ring->block_time = block_time;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Ring_Write(struct history_ring_tag *ring,
+ *                                         const uint8_t *data,
+ *                                         uint16_t length, uint32_t time)
+ * ----------------------------------------------------------------------------
+ * Description   : Append an encoded block to a ring, the oldest blocks are
+ *                 dropped to make room. Every HISTORY_INDEX_STRIDE-th block
+ *                 is indexed.
+ * Inputs        : - ring       - Ring buffer
+ *                 - data       - Encoded block, sequence number ring->seq
+ *                 - length     - Block size (up to the ring size)
+ *                 - time       - Time of the newest data of the block
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers or with the
+ *                 interrupts masked
+ * ------------------------------------------------------------------------- */
+void History_Ring_Write(struct history_ring_tag *ring, const uint8_t *data, uint16_t length,
+                        uint32_t time)
+{
+    struct history_index_tag *entry;
+    uint16_t i;
+
+    ring->time = MAX(ring->time, time);
+    if (ring->seq % HISTORY_INDEX_STRIDE == 0)
+    {
+        entry = History_Index(ring, ring->seq);
+        entry->pos = ring->head;
+        entry->time = ring->time;
+    }
+
+    while (ring->head + length - ring->tail > ring->size)
+    {
+        ring->tail += History_Block_Size(ring, ring->tail);
+        ring->first++;
+    }
+    for (i = 0; i < length; i++)
+    {
+        ring->buffer[ring->head++ & (ring->size - 1)] = data[i];
+    }
+    ring->seq++;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t History_Find(uint32_t time)
+ * ----------------------------------------------------------------------------
+ * Description   : Find the first history block whose record time is at or
+ *                 after a time
+ * Inputs        : - time       - Time (s since reset)
+ * Outputs       : return value - Sequence number of the block, of the next
+ *                                block if every block kept is older
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t History_Find(uint32_t time)
+{
+    return History_Ring_Find(&history_env.ring, time);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void History_Report(uint32_t first, uint32_t last)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the download of a range of history blocks for the
+ *                 record access control point, which is answered once the
+ *                 last block has been sent (RACP_Report_Done)
+ * Inputs        : - first      - Sequence number of the first block
+ *                 - last       - Sequence number of the block following the
+ *                                last one
+ * Outputs       : None
+ * Assumptions   : No download in progress
+ * ------------------------------------------------------------------------- */
+void History_Report(uint32_t first, uint32_t last)
+{
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    history_env.source = &history_env.ring;
+    history_env.next = History_Seek(&history_env.ring, first);
+    history_env.end = History_Seek(&history_env.ring, last);
+    history_env.bounded = true;
+    __set_PRIMASK(primask);
+    history_env.log = false;
+    history_env.credits = HISTORY_NTF_CREDITS;
+    history_env.report = true;
+    history_env.download = true;
+    History_Notify_Status();
+    History_Send();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool History_Delete(uint32_t last)
+ * ----------------------------------------------------------------------------
+ * Description   : Drop the oldest history blocks, up to a block. The blocks
+ *                 not copied yet to the flash log or the archive are kept.
+ * Inputs        : - last       - Sequence number of the block following the
+ *                                last one to drop
+ * Outputs       : return value - false if blocks had to be kept
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool History_Delete(uint32_t last)
+{
+    struct history_ring_tag *ring = &history_env.ring;
+    uint32_t primask;
+    bool result;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    while ((int32_t)(last - ring->first) > 0 && ring->tail != ring->head &&
+           (int32_t)(flashlog_env.history_pos - ring->tail) > 0 &&
+           (!spiflash_env.present || (int32_t)(archive_env.history_pos - ring->tail) > 0))
+    {
+        ring->tail += History_Block_Size(ring, ring->tail);
+        ring->first++;
+    }
+    result = (int32_t)(last - ring->first) <= 0 || ring->tail == ring->head;
+    __set_PRIMASK(primask);
+    return result;
+}
@@ -13,11 +13,20 @@
  * i2c.c
  * - RSL10 I2C communication library. Only master mode/auto acknowlege mode is
  *   currently supported.
+ * - Transactions are queued: each call posts a descriptor into a ring and the
+ *   interrupt handler starts the next one as soon as the current one is
+ *   completed. No wait is required between two transactions.
  * - The DIOs used by the I2C interface are not configured by this library; they
  *   have to be configured on the application level.
- * - Known limitations:
- *   > DMA transfers are not supported.
- *   > I2C bus errors are not treated.
+ * - Transaction payloads of at least I2C_DMA_MIN_LENGTH bytes are moved by a
+ *   DMA channel if I2C_DMA_CHANNEL is defined; shorter payloads use the
+ *   per-byte interrupt path.
+ * - Every transaction has a deadline. NACKs, bus errors and timeouts abort the
+ *   transaction, a stuck bus is recovered by clocking out SCL, and the
+ *   transaction is retried with a bounded backoff before its callback is
+ *   called with the error code.
+ * - Transaction statistics (counters and duration histogram) are always kept
+ *   and can be read with I2C_Stats_Get.
  * ----------------------------------------------------------------------------
  * $Revision: $
  * $Date: $
@@ -29,6 +38,15 @@
 
 struct i2c_env_tag    i2c_env;
 
+/* Local functions */
+static void I2C_StartNext(void);
+static void I2C_StartWritePhase(void);
+static void I2C_StartReadPhase(void);
+static void I2C_Complete(i2c_error_code_t status);
+static void I2C_Fail(i2c_error_code_t status);
+static void I2C_BusRecovery(void);
+static void I2C_Timer_Start(uint8_t state, uint32_t ticks);
+static void I2C_IRQHandle(void);
 
 /* Initialization and configuration */
 
@@ -49,9 +67,14 @@ void I2C_Master_Init(uint8_t speed)
     memset(&i2c_env, 0, sizeof(i2c_env));
 
     /* Configure the I2C interface */
-    Sys_I2C_Config(((uint32_t)(speed << I2C_CTRL0_SPEED_Pos)) |
-                   I2C_CONTROLLER_CM3 | I2C_STOP_INT_ENABLE |
-                   I2C_AUTO_ACK_DISABLE  | I2C_SAMPLE_CLK_ENABLE | I2C_SLAVE_DISABLE );
+    i2c_env.config = ((uint32_t)(speed << I2C_CTRL0_SPEED_Pos)) |
+                     I2C_STOP_INT_ENABLE | I2C_SAMPLE_CLK_ENABLE |
+                     I2C_SLAVE_DISABLE;
+    Sys_I2C_Config(i2c_env.config | I2C_CONTROLLER_CM3 | I2C_AUTO_ACK_DISABLE);
+
+    /* Start the cycle counter used to time transactions and interrupts */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
     /* Configure I2C debug DIO */
     #ifdef I2C_DBG_DIO_NUM
@@ -61,70 +84,157 @@ void I2C_Master_Init(uint8_t speed)
 
     /* Enable interrupts */
     NVIC_EnableIRQ(I2C_IRQn);
-
+    NVIC_EnableIRQ(I2C_TIMEOUT_IRQn);
+    #ifdef I2C_DMA_CHANNEL
+        Sys_DMA_ChannelDisable(I2C_DMA_CHANNEL);
+        NVIC_EnableIRQ(I2C_DMA_IRQn);
+    #endif
  }
 
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_Recovery_Config(uint32_t config, uint32_t scl,
+ *                                          uint32_t sda)
+ * ----------------------------------------------------------------------------
+ * Description   : Provides the I2C DIO configuration of the application. It is
+ *                 used to temporarily take over SCL and SDA as GPIOs to clock
+ *                 out a slave holding SDA low, and to restore the I2C DIOs.
+ * Inputs        : - config - DIO configuration passed to Sys_I2C_DIOConfig
+ *                 - scl    - DIO number used for SCL
+ *                 - sda    - DIO number used for SDA
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void I2C_Recovery_Config(uint32_t config, uint32_t scl, uint32_t sda)
+{
+    i2c_env.dio_config = config;
+    i2c_env.scl_dio = scl;
+    i2c_env.sda_dio = sda;
+}
+
 /**** Write/read functions ****/
 
 /* ----------------------------------------------------------------------------
- * Function      : void I2C_WriteRead(uint8_t address, 
-                                      uint8_t *txdata, uint16_t txlength,
-                                      uint8_t *rxdata, uint16_t rxlength, 
-                                      void *callback)
+ * Function      : bool I2C_Transfer(uint8_t address,
+                                     uint8_t *txdata, uint16_t txlength,
+                                     uint8_t *rxdata, uint16_t rxlength,
+                                     i2c_callback_t callback, void *context)
  * ----------------------------------------------------------------------------
- * Description   : Initiates a write, read or combined write-read transaction, 
-                   of one or multiple bytes. Optionally a callback function 
-                   can be provided that will be called once the tranasction is 
-                   completed. If both, write and read parameters are provided 
-                   (e.g txdata/txlength, rxdata/rxlength), the write sequence
-                   is first performed followed by the read sequence. This 
-                   allows running a sequence of 1) sending device address, 
-                   2) sending memory address, 3) receiving memory data.
+ * Description   : Queues a write, read or combined write-read transaction.
+                   The transaction is started immediately if the interface is
+                   idle, otherwise by the interrupt handler once all previously
+                   queued transactions are completed. TX data up to
+                   I2C_TX_INLINE_SIZE bytes is copied, so the caller can reuse
+                   its buffer on return.
  * Inputs        : - address  - 7-bit slave address
                    - txdata   - Pointer to the TX data. Ignored if txlength=0
-                   - txlength - Number of bytes to transfer. To be set to 0 for
-                                read transactions.
+                   - txlength - Number of bytes to transfer
                    - rxdata   - Pointer to the RX data. Ignored if rxlength=0
-                   - rxlength - Number of bytes to receive. To be set to 0 for
-                                write transactions.
-                   - callback - Pointer to function that will be called if the
-                                transaction is completed. To be set to NULL if 
-                                no callback function is used.
- * Outputs       : None
+                   - rxlength - Number of bytes to receive
+                   - callback - Function called with the context once the
+                                transaction is completed, or NULL
+                   - context  - Pointer passed unchanged to the callback
+ * Outputs       : return value - false if the queue is full and the
+                                  transaction has been dropped
  * Assumptions   : The I2C interface has previously been configured with 
-                   I2C_Master_Init.
+                   I2C_Master_Init. May be called from thread or interrupt
+                   context.
  * ------------------------------------------------------------------------- */
-void I2C_WriteRead(uint8_t address, uint8_t *txdata, uint16_t txlength,
-              uint8_t *rxdata, uint16_t rxlength, void *callback)
+bool I2C_Transfer(uint8_t address, uint8_t *txdata, uint16_t txlength,
+                  uint8_t *rxdata, uint16_t rxlength,
+                  i2c_callback_t callback, void *context)
 {
-    /* Copy the transaction parameters to the I2C environment structure */
-    i2c_env.address = address;
-    i2c_env.tx_buffer = txdata;
-    i2c_env.tx_buffer_length = txlength;
-    i2c_env.rx_buffer = rxdata;
-    i2c_env.rx_buffer_length = rxlength;
-    i2c_env.callbackfunction = callback;
-
-     /* Start the transaction by reseting the interface */
-    Sys_I2C_Reset();
+    struct i2c_xfer_tag *xfer;
+    uint32_t primask;
 
-    /* Start either a TX or RX transaction with the device selected with the 
-       provided address. */
-    if (txlength > 0)
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+
+    if ((uint8_t)(i2c_env.queue_tail - i2c_env.queue_head) >= I2C_QUEUE_SIZE)
     {
-        Sys_I2C_StartWrite(address);
+        i2c_env.stats.queue_full++;
+        __set_PRIMASK(primask);
+        return false;
     }
-    else if (rxlength > 0)
+
+    /* Fill the next free descriptor */
+    xfer = &i2c_env.queue[i2c_env.queue_tail & (I2C_QUEUE_SIZE - 1)];
+    xfer->address = address;
+    xfer->tx_buffer = txdata;
+    if (txlength > 0 && txlength <= I2C_TX_INLINE_SIZE)
     {
-        i2c_env.tx_buffer_length--;
-        Sys_I2C_StartRead(address);
+        memcpy(xfer->tx_inline, txdata, txlength);
+        xfer->tx_buffer = xfer->tx_inline;
     }
+    xfer->tx_buffer_length = txlength;
+    xfer->rx_buffer = rxdata;
+    xfer->rx_buffer_length = rxlength;
+    xfer->callbackfunction = callback;
+    xfer->context = context;
+    xfer->retries = 0;
+    i2c_env.queue_tail++;
+
+    /* Start the transaction directly if the interface is idle */
+    if (!i2c_env.busy)
+    {
+        I2C_StartNext();
+    }
+
+    __set_PRIMASK(primask);
+    return true;
 }
 
 /* ----------------------------------------------------------------------------
- * Function      : void I2C_Write(uint8_t address, 
+ * Function      : bool I2C_Idle(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Indicates if the I2C interface has no active or queued
+                   transaction
+ * Inputs        : None
+ * Outputs       : return value - true if idle
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool I2C_Idle(void)
+{
+    return (!i2c_env.busy && i2c_env.queue_head == i2c_env.queue_tail);
+}
+
+/**** Statistics ****/
+
+/* ----------------------------------------------------------------------------
+ * Function      : const struct i2c_stats_tag *I2C_Stats_Get(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Returns the transaction statistics
+ * Inputs        : None
+ * Outputs       : return value - Pointer to the statistics (read only)
+ * Assumptions   : The counters are updated from interrupt context; a
+                   consistent snapshot requires masking the I2C interrupts.
+ * ------------------------------------------------------------------------- */
+const struct i2c_stats_tag *I2C_Stats_Get(void)
+{
+    return &i2c_env.stats;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_Stats_Reset(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Clears the transaction statistics
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void I2C_Stats_Reset(void)
+{
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    memset(&i2c_env.stats, 0, sizeof(i2c_env.stats));
+    __set_PRIMASK(primask);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool I2C_Write(uint8_t address, 
                                   uint8_t *txdata, uint16_t txlength,
-                                  void *callback)
+                                  i2c_callback_t callback, void *context)
  * ----------------------------------------------------------------------------
  * Description   : Initiates a write transaction of one or multiple 
                    bytes. Optionally a callback function can be provided that
@@ -135,20 +245,21 @@ void I2C_WriteRead(uint8_t address, uint8_t *txdata, uint16_t txlength,
                    - callback - Pointer to function that will be called if the
                                 transaction is completed. To be set to NULL if 
                                 no callback function is used.
- * Outputs       : None
+                   - context  - Passed to the callback
+ * Outputs       : return value - false if the queue is full
  * Assumptions   : The I2C interface has previously been configured with 
                    I2C_Master_Init.
  * ------------------------------------------------------------------------- */
-void I2C_Write(uint8_t address, uint8_t *txdata, uint16_t txlength,
-               void *callback)
+bool I2C_Write(uint8_t address, uint8_t *txdata, uint16_t txlength,
+               i2c_callback_t callback, void *context)
 {
-    I2C_WriteRead(address, txdata, txlength, NULL, 0, callback);
+    return I2C_Transfer(address, txdata, txlength, NULL, 0, callback, context);
 }
 
 /* ----------------------------------------------------------------------------
- * Function      : void I2C_Read(uint8_t address, 
+ * Function      : bool I2C_Read(uint8_t address, 
                                  uint8_t *rxdata, uint16_t rxlength, 
-                                 void *callback)
+                                 i2c_callback_t callback, void *context)
  * ----------------------------------------------------------------------------
  * Description   : Initiates a read transaction of one or multiple 
                    bytes. Optionally a callback function can be provided that
@@ -160,33 +271,407 @@ void I2C_Write(uint8_t address, uint8_t *txdata, uint16_t txlength,
                    - callback - Pointer to function that will be called if the
                                 transaction is completed. To be set to NULL if 
                                 no callback function is used.
- * Outputs       : None
+                   - context  - Passed to the callback
+ * Outputs       : return value - false if the queue is full
  * Assumptions   : The I2C interface has previously been configured with 
                    I2C_Master_Init.
  * ------------------------------------------------------------------------- */
-void I2C_Read(uint8_t address, uint8_t *rxdata, uint16_t rxlength,
-              void *callback)
+bool I2C_Read(uint8_t address, uint8_t *rxdata, uint16_t rxlength,
+              i2c_callback_t callback, void *context)
 {
-    I2C_WriteRead(address, NULL, 0, rxdata, rxlength, callback);
+    return I2C_Transfer(address, NULL, 0, rxdata, rxlength, callback, context);
 }
 
 
 /**** Support functions (internally used by the library) ****/
 
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_StartNext(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Copies the transaction at the head of the queue into the
+                   active transaction and starts it. Does nothing if the queue
+                   is empty.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : The interface is idle. Called with the I2C interrupt
+                   masked or from the I2C interrupt.
+ * ------------------------------------------------------------------------- */
+static void I2C_StartNext(void)
+{
+    struct i2c_xfer_tag *xfer;
+
+    if (i2c_env.queue_head == i2c_env.queue_tail)
+    {
+        return;
+    }
+
+    /* Copy the transaction parameters to the I2C environment structure */
+    xfer = &i2c_env.queue[i2c_env.queue_head & (I2C_QUEUE_SIZE - 1)];
+    i2c_env.address = xfer->address;
+    i2c_env.tx_buffer = xfer->tx_buffer;
+    i2c_env.tx_buffer_length = xfer->tx_buffer_length;
+    i2c_env.rx_buffer = xfer->rx_buffer;
+    i2c_env.rx_buffer_length = xfer->rx_buffer_length;
+    i2c_env.callbackfunction = xfer->callbackfunction;
+    i2c_env.context = xfer->context;
+    i2c_env.busy = true;
+    if (xfer->retries == 0)
+    {
+        i2c_env.start_time = DWT->CYCCNT;
+    }
+
+    /* Start the transaction by reseting the interface and arm its deadline */
+    Sys_I2C_Reset();
+    I2C_Timer_Start(I2C_TIMER_DEADLINE, I2C_TIMEOUT_TICKS);
+
+    /* Start either a TX or RX transaction with the device selected with the 
+       provided address. */
+    if (i2c_env.tx_buffer_length > 0)
+    {
+        I2C_StartWritePhase();
+    }
+    else if (i2c_env.rx_buffer_length > 0)
+    {
+        i2c_env.tx_buffer_length--;
+        I2C_StartReadPhase();
+    }
+    else
+    {
+        /* Empty transaction, nothing to put on the bus */
+        I2C_Complete(I2C_ERRNO_NONE);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_StartWritePhase(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Starts the write phase of the active transaction. If DMA is
+                   enabled and the payload is long enough, the DMA channel
+                   feeds the I2C data register, otherwise the I2C interrupt
+                   transfers each byte.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : tx_buffer_length > 0
+ * ------------------------------------------------------------------------- */
+static void I2C_StartWritePhase(void)
+{
+    #ifdef I2C_DMA_CHANNEL
+    if (i2c_env.tx_buffer_length >= I2C_DMA_MIN_LENGTH)
+    {
+        i2c_env.dma_active = true;
+        Sys_DMA_ClearChannelStatus(I2C_DMA_CHANNEL);
+        Sys_DMA_ChannelConfig(I2C_DMA_CHANNEL,
+                              DMA_ENABLE | DMA_ADDR_LIN | DMA_TRANSFER_M_TO_P |
+                              DMA_PRIORITY_0 | DMA_DISABLE_INT_DISABLE |
+                              DMA_ERROR_INT_DISABLE | DMA_COMPLETE_INT_ENABLE |
+                              DMA_COUNTER_INT_DISABLE | DMA_START_INT_DISABLE |
+                              DMA_LITTLE_ENDIAN | DMA_SRC_ADDR_INC |
+                              DMA_DEST_ADDR_STATIC | DMA_DEST_I2C |
+                              WORD_SIZE_8BITS_TO_8BITS,
+                              i2c_env.tx_buffer_length, 0,
+                              (uint32_t)i2c_env.tx_buffer,
+                              (uint32_t)&I2C->DATA);
+        Sys_I2C_Config(i2c_env.config | I2C_CONTROLLER_DMA | I2C_AUTO_ACK_DISABLE);
+    }
+    #endif
+
+    Sys_I2C_StartWrite(i2c_env.address);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_StartReadPhase(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Starts the read phase of the active transaction. If DMA is
+                   enabled and the payload is long enough, the DMA channel
+                   receives all bytes but the last one with automatic ACK. The
+                   last byte is received by the I2C interrupt to send the NACK
+                   and STOP.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : rx_buffer_length > 0
+ * ------------------------------------------------------------------------- */
+static void I2C_StartReadPhase(void)
+{
+    #ifdef I2C_DMA_CHANNEL
+    if (i2c_env.rx_buffer_length >= I2C_DMA_MIN_LENGTH)
+    {
+        i2c_env.dma_active = true;
+        Sys_DMA_ClearChannelStatus(I2C_DMA_CHANNEL);
+        Sys_DMA_ChannelConfig(I2C_DMA_CHANNEL,
+                              DMA_ENABLE | DMA_ADDR_LIN | DMA_TRANSFER_P_TO_M |
+                              DMA_PRIORITY_0 | DMA_DISABLE_INT_DISABLE |
+                              DMA_ERROR_INT_DISABLE | DMA_COMPLETE_INT_ENABLE |
+                              DMA_COUNTER_INT_DISABLE | DMA_START_INT_DISABLE |
+                              DMA_LITTLE_ENDIAN | DMA_SRC_ADDR_STATIC |
+                              DMA_DEST_ADDR_INC | DMA_SRC_I2C |
+                              WORD_SIZE_8BITS_TO_8BITS,
+                              i2c_env.rx_buffer_length - 1, 0,
+                              (uint32_t)&I2C->DATA,
+                              (uint32_t)i2c_env.rx_buffer);
+        Sys_I2C_Config(i2c_env.config | I2C_CONTROLLER_DMA | I2C_AUTO_ACK_ENABLE);
+    }
+    #endif
+
+    Sys_I2C_StartRead(i2c_env.address);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_Complete(i2c_error_code_t status)
+ * ----------------------------------------------------------------------------
+ * Description   : Releases the active transaction, calls its callback function
+                   if defined and starts the next queued transaction
+ * Inputs        : - status - Transaction result passed to the callback
+ * Outputs       : None
+ * Assumptions   : Called from the I2C interrupt or with the I2C interrupt
+                   masked
+ * ------------------------------------------------------------------------- */
+static void I2C_Complete(i2c_error_code_t status)
+{
+    i2c_callback_t callback = i2c_env.callbackfunction;
+    void *context = i2c_env.context;
+    struct i2c_xfer_tag *xfer;
+    uint32_t duration;
+    int32_t bucket;
+
+    /* Disarm the deadline */
+    Sys_Timers_Stop(I2C_TIMEOUT_SELECT);
+    i2c_env.timer_state = I2C_TIMER_IDLE;
+
+    /* Update the statistics */
+    xfer = &i2c_env.queue[i2c_env.queue_head & (I2C_QUEUE_SIZE - 1)];
+    duration = DWT->CYCCNT - i2c_env.start_time;
+    bucket = (duration ? 31 - (int32_t)__CLZ(duration) : 0) - I2C_STATS_HIST_MIN_LOG2;
+    bucket = (bucket < 0 ? 0 : (bucket >= I2C_STATS_HIST_BUCKETS ? I2C_STATS_HIST_BUCKETS - 1 : bucket));
+    i2c_env.stats.duration_hist[bucket]++;
+    if (duration > i2c_env.stats.duration_max)
+    {
+        i2c_env.stats.duration_max = duration;
+    }
+    i2c_env.stats.transactions++;
+    if (status == I2C_ERRNO_NONE)
+    {
+        i2c_env.stats.bytes_tx += xfer->tx_buffer_length;
+        i2c_env.stats.bytes_rx += xfer->rx_buffer_length;
+    }
+    else
+    {
+        i2c_env.stats.failures++;
+    }
+
+    /* Release the descriptor before the callback, so it can queue again */
+    i2c_env.queue_head++;
+    i2c_env.busy = false;
+
+    if (callback != NULL)
+    {
+        callback(context, status);
+    }
+
+    /* The callback may already have started a new transaction */
+    if (!i2c_env.busy)
+    {
+        I2C_StartNext();
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_Fail(i2c_error_code_t status)
+ * ----------------------------------------------------------------------------
+ * Description   : Aborts the active transaction. The bus is recovered if the
+                   failure may have left a slave driving SDA. The transaction
+                   is restarted after a backoff as long as retries are left,
+                   otherwise it is completed with the error code.
+ * Inputs        : - status - Reason of the failure
+ * Outputs       : None
+ * Assumptions   : A transaction is active
+ * ------------------------------------------------------------------------- */
+static void I2C_Fail(i2c_error_code_t status)
+{
+    struct i2c_xfer_tag *xfer;
+
+    switch (status)
+    {
+        case I2C_ERRNO_NACK:
+            i2c_env.stats.nacks++;
+            break;
+        case I2C_ERRNO_BUS_ERROR:
+            i2c_env.stats.bus_errors++;
+            break;
+        default:
+            i2c_env.stats.timeouts++;
+    }
+
+    /* Abort an ongoing DMA phase and give the interface back to the CPU */
+    #ifdef I2C_DMA_CHANNEL
+    if (i2c_env.dma_active)
+    {
+        Sys_DMA_ChannelDisable(I2C_DMA_CHANNEL);
+        Sys_DMA_ClearChannelStatus(I2C_DMA_CHANNEL);
+        i2c_env.dma_active = false;
+    }
+    #endif
+    Sys_I2C_Config(i2c_env.config | I2C_CONTROLLER_CM3 | I2C_AUTO_ACK_DISABLE);
+
+    /* A NACK leaves the bus released, only a STOP is needed */
+    if (status == I2C_ERRNO_NACK)
+    {
+        Sys_I2C_NackAndStop();
+    }
+    else
+    {
+        I2C_BusRecovery();
+    }
+    Sys_I2C_Reset();
+
+    xfer = &i2c_env.queue[i2c_env.queue_head & (I2C_QUEUE_SIZE - 1)];
+    if (xfer->retries < I2C_RETRY_MAX)
+    {
+        I2C_Timer_Start(I2C_TIMER_BACKOFF,
+                        (uint32_t)I2C_RETRY_BACKOFF_TICKS << xfer->retries);
+        xfer->retries++;
+        i2c_env.stats.retries++;
+    }
+    else
+    {
+        I2C_Complete(status);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_BusRecovery(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Releases a slave that holds SDA low: SCL is clocked up to 9
+                   times as GPIO until SDA is high, then a STOP condition is
+                   generated and the I2C DIO configuration is restored.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : The DIOs have been provided with I2C_Recovery_Config. Does
+                   nothing otherwise.
+ * ------------------------------------------------------------------------- */
+static void I2C_BusRecovery(void)
+{
+    uint8_t i;
+
+    if (i2c_env.scl_dio == i2c_env.sda_dio)
+    {
+        return;
+    }
+
+    /* Take over SCL as output (high) and release SDA */
+    Sys_DIO_Config(i2c_env.scl_dio, DIO_MODE_GPIO_OUT_1 | DIO_STRONG_PULL_UP);
+    Sys_DIO_Config(i2c_env.sda_dio, DIO_MODE_INPUT | DIO_STRONG_PULL_UP);
+
+    /* Clock out the byte the slave is still sending */
+    for (i = 0; i < 9 && !(DIO->DATA & (1U << i2c_env.sda_dio)); i++)
+    {
+        Sys_GPIO_Set_Low(i2c_env.scl_dio);
+        Sys_Delay_ProgramROM(I2C_RECOVERY_HALF_CLK_CYCLES);
+        Sys_GPIO_Set_High(i2c_env.scl_dio);
+        Sys_Delay_ProgramROM(I2C_RECOVERY_HALF_CLK_CYCLES);
+    }
+
+    /* STOP condition: SDA rising while SCL is high */
+    Sys_GPIO_Set_Low(i2c_env.scl_dio);
+    Sys_DIO_Config(i2c_env.sda_dio, DIO_MODE_GPIO_OUT_0);
+    Sys_Delay_ProgramROM(I2C_RECOVERY_HALF_CLK_CYCLES);
+    Sys_GPIO_Set_High(i2c_env.scl_dio);
+    Sys_Delay_ProgramROM(I2C_RECOVERY_HALF_CLK_CYCLES);
+    Sys_GPIO_Set_High(i2c_env.sda_dio);
+    Sys_Delay_ProgramROM(I2C_RECOVERY_HALF_CLK_CYCLES);
+
+    /* Give the DIOs back to the I2C interface */
+    Sys_I2C_DIOConfig(i2c_env.dio_config, i2c_env.scl_dio, i2c_env.sda_dio);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_Timer_Start(uint8_t state, uint32_t ticks)
+ * ----------------------------------------------------------------------------
+ * Description   : (Re)starts the deadline/backoff timer
+ * Inputs        : - state - I2C_TIMER_DEADLINE or I2C_TIMER_BACKOFF
+ *                 - ticks - Timer period (SLOWCLK/64 ticks)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void I2C_Timer_Start(uint8_t state, uint32_t ticks)
+{
+    Sys_Timers_Stop(I2C_TIMEOUT_SELECT);
+    i2c_env.timer_state = state;
+    Sys_Timer_Set_Control(I2C_TIMEOUT_TIMER, TIMER_SHOT_MODE |
+                                             TIMER_SLOWCLK_DIV2 |
+                                             TIMER_PRESCALE_32 | ticks);
+    Sys_Timers_Start(I2C_TIMEOUT_SELECT);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_TIMEOUT_IRQHandler(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Timer interrupt service function. On a deadline expiry the
+                   active transaction is failed with I2C_ERRNO_TIMEOUT. At the
+                   end of a retry backoff the transaction is restarted.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Runs at the same priority as I2C_IRQHandler
+ * ------------------------------------------------------------------------- */
+void I2C_TIMEOUT_IRQHandler(void)
+{
+    uint8_t state = i2c_env.timer_state;
+
+    i2c_env.timer_state = I2C_TIMER_IDLE;
+    if (!i2c_env.busy)
+    {
+        return;
+    }
+
+    if (state == I2C_TIMER_BACKOFF)
+    {
+        I2C_StartNext();
+    }
+    else if (state == I2C_TIMER_DEADLINE)
+    {
+        I2C_Fail(I2C_ERRNO_TIMEOUT);
+    }
+}
+
 /* ----------------------------------------------------------------------------
  * Function      : void I2C_IRQHandler(void)
  * ----------------------------------------------------------------------------
+ * Description   : I2C interrupt service function. Keeps track of the longest
+                   time spent in the interrupt (including the completion
+                   callbacks).
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void I2C_IRQHandler(void)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t duration;
+
+    I2C_IRQHandle();
+
+    duration = DWT->CYCCNT - start;
+    if (duration > i2c_env.stats.isr_max)
+    {
+        i2c_env.stats.isr_max = duration;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_IRQHandle(void)
+ * ----------------------------------------------------------------------------
  * Description   : I2C interrupt service function to handle all read and write 
                    operations. It is called for each received or transmitted 
                    byte. It transfers the bytes from the TX buffer to the I2C 
-                   interface, and from this latest one to the RX buffer.
+                   interface, and from this latest one to the RX buffer. Once
+                   the STOP condition of a transaction is seen, the next queued
+                   transaction is started.
  * Inputs        : None
  * Outputs       : None
  * Assumptions   : The I2C interface has previously been configured with 
                    I2C_Master_Init and a transaction has been initiated with
                    one of the read or write functions.
  * ------------------------------------------------------------------------- */
-void I2C_IRQHandler(void)
+static void I2C_IRQHandle(void)
 {
     /* Toggle the debug IO in debug mode */
     #ifdef I2C_DBG_DIO_NUM
@@ -196,6 +681,35 @@ void I2C_IRQHandler(void)
      /* Read the current I2C interface status */
     i2c_env.last_status = Sys_I2C_Get_Status();
 
+    /* No transaction on the bus: idle, or waiting for a retry */
+    if (!i2c_env.busy || i2c_env.timer_state != I2C_TIMER_DEADLINE)
+    {
+        return;
+    }
+
+    /* Abort the transaction on a bus error or if the slave doesn't
+       acknowledge its address or a written byte, also while the DMA channel
+       moves the payload */
+    if ((i2c_env.last_status & (1<<I2C_STATUS_BUS_ERROR_Pos)) == I2C_BUS_ERROR)
+    {
+        I2C_Fail(I2C_ERRNO_BUS_ERROR);
+        return;
+    }
+    if ((i2c_env.last_status & (1<<I2C_STATUS_ACK_STATUS_Pos)) == I2C_HAS_NACK &&
+        ((i2c_env.last_status & (1<<I2C_STATUS_READ_WRITE_Pos)) == I2C_IS_WRITE ||
+         ((i2c_env.last_status & (1<<I2C_STATUS_BUFFER_FULL_Pos)) != I2C_BUFFER_FULL &&
+          i2c_env.rx_buffer_length > 0)))
+    {
+        I2C_Fail(I2C_ERRNO_NACK);
+        return;
+    }
+
+    /* The payload of the current phase is moved by the DMA channel */
+    if (i2c_env.dma_active)
+    {
+        return;
+    }
+
     /* Handle write/TX transfers (priority over read transaction) */
     if ((i2c_env.last_status & (1<<I2C_STATUS_READ_WRITE_Pos)) == I2C_IS_WRITE)
     {
@@ -204,7 +718,10 @@ void I2C_IRQHandler(void)
         {
             i2c_env.tx_buffer_length--;
             I2C->DATA = *i2c_env.tx_buffer++;
-            if (i2c_env.tx_buffer_length == 0)
+
+            /* Terminate with a STOP only if no read follows, otherwise the
+               read is started with a repeated START */
+            if (i2c_env.tx_buffer_length == 0 && i2c_env.rx_buffer_length <= 0)
             {
                 I2C_CTRL1->LAST_DATA_ALIAS = I2C_LAST_DATA_BITBAND;
             }
@@ -217,11 +734,11 @@ void I2C_IRQHandler(void)
             i2c_env.tx_buffer_length--;
             if (i2c_env.rx_buffer_length > 0)
             {
-                Sys_I2C_StartRead(i2c_env.address);
+                I2C_StartReadPhase();
             }
-            else if (i2c_env.callbackfunction != NULL)
+            else
             {
-                ((void(*)())i2c_env.callbackfunction)();
+                I2C_Complete(I2C_ERRNO_NONE);
             }
         }
     }
@@ -230,11 +747,19 @@ void I2C_IRQHandler(void)
        been completed */
     else if ((i2c_env.last_status & (1<<I2C_STATUS_READ_WRITE_Pos)) == I2C_IS_READ)
     {
+        /* The last byte has already been received: this is the STOP
+           interrupt that terminates the transaction */
+        if (i2c_env.rx_buffer_length == 0)
+        {
+            i2c_env.rx_buffer_length--;
+            I2C_Complete(I2C_ERRNO_NONE);
+        }
+
         /* Initiate a new read/RX transfer without preceeding write/TX transfer. 
            This is indicated by the I2C_BUFFER_FULL flag that is not set. Send 
            an ACK to start the read operation. Indicate the last byte to 
            receive if only a single by has to be read. */
-        if ((i2c_env.last_status & (1<<I2C_STATUS_BUFFER_FULL_Pos)) != I2C_BUFFER_FULL)
+        else if ((i2c_env.last_status & (1<<I2C_STATUS_BUFFER_FULL_Pos)) != I2C_BUFFER_FULL)
         {
             Sys_I2C_ACK();
             if (i2c_env.rx_buffer_length == 1)
@@ -258,16 +783,60 @@ void I2C_IRQHandler(void)
             }
         }
           
-        /* If the last byte has been received, read it from the buffer, and 
-           call the callback function if such one is defined */
+        /* If the last byte has been received, read it from the buffer. The
+           transaction is completed on the following STOP interrupt. */
         else if (i2c_env.rx_buffer_length == 1)
         {
             i2c_env.rx_buffer_length--;
             *i2c_env.rx_buffer++ = I2C->DATA;
-            if (i2c_env.callbackfunction != NULL)
-            {
-                ((void(*)())i2c_env.callbackfunction)();
-            }
         }
     }
 }
+
+#ifdef I2C_DMA_CHANNEL
+/* ----------------------------------------------------------------------------
+ * Function      : void I2C_DMA_IRQHandler(void)
+ * ----------------------------------------------------------------------------
+ * Description   : DMA interrupt service function, called once the DMA channel
+                   has moved the payload of a write or read phase. Hands the
+                   interface back to the CPU: a write is terminated by STOP or
+                   continued by the read phase, a read is terminated by the
+                   last byte received in I2C_IRQHandler.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : The phase has been started by I2C_StartWritePhase or
+                   I2C_StartReadPhase with DMA enabled.
+ * ------------------------------------------------------------------------- */
+void I2C_DMA_IRQHandler(void)
+{
+    Sys_DMA_ClearChannelStatus(I2C_DMA_CHANNEL);
+    Sys_DMA_ChannelDisable(I2C_DMA_CHANNEL);
+
+    /* The phase has already been aborted by I2C_Fail */
+    if (!i2c_env.dma_active)
+    {
+        return;
+    }
+    Sys_I2C_Config(i2c_env.config | I2C_CONTROLLER_CM3 | I2C_AUTO_ACK_DISABLE);
+    i2c_env.dma_active = false;
+
+    /* Write phase: all bytes have been passed to the interface */
+    if (i2c_env.tx_buffer_length > 0)
+    {
+        i2c_env.tx_buffer += i2c_env.tx_buffer_length;
+        i2c_env.tx_buffer_length = 0;
+        if (i2c_env.rx_buffer_length <= 0)
+        {
+            I2C_CTRL1->LAST_DATA_ALIAS = I2C_LAST_DATA_BITBAND;
+        }
+    }
+
+    /* Read phase: all bytes but the last one have been received */
+    else
+    {
+        i2c_env.rx_buffer += i2c_env.rx_buffer_length - 1;
+        i2c_env.rx_buffer_length = 1;
+        I2C_CTRL1->LAST_DATA_ALIAS = I2C_LAST_DATA_BITBAND;
+    }
+}
+#endif
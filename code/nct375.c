@@ -7,206 +7,657 @@
 
 #include "app.h"
 
-void NCT375_Received_Temperature(void)
+/* Sensors on the bus */
+struct NCT375_Env_tag nct375_env;
+
+/* Asynchronous operations: every register access belongs to an operation taken
+ * from nct375_env.op. The operation counts its I2C transactions (plus one while
+ * it is being posted) and calls its callback once, when the last one is
+ * completed. No caller waits, results are stored in the shadow registers. */
+static struct NCT375_Op_tag *NCT375_Op_Alloc(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NULL;
+	uint8_t i;
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	for(i = 0; i < NCT375_OP_POOL_SIZE; i++)
+	{
+		if(nct375_env.op[i].dev == NULL)
+		{
+			op = &nct375_env.op[i];
+			op->dev = dev;
+			break;
+		}
+	}
+	__set_PRIMASK(primask);
+
+	if(op != NULL)
+	{
+		op->callback = callback;
+		op->sensor_callback = NULL;
+		op->context = context;
+		op->status = I2C_ERRNO_NONE;
+		op->pending = 1;
+		op->trigger = false;
+	}
+	return op;
+}
+
+static void NCT375_Op_Pending(struct NCT375_Op_tag *op)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	op->pending++;
+	__set_PRIMASK(primask);
+}
+
+/* Releases a transaction of the operation, the first error is reported */
+static void NCT375_Op_Done(struct NCT375_Op_tag *op, i2c_error_code_t status)
 {
-	/* Temperature(C) = (TempCode*100)/16 */
+	struct NCT375_Reg_tag *dev;
+	nct375_callback_t callback;
+	sensor_callback_t sensor_callback;
+	void *context;
+	uint8_t pending;
+	uint32_t primask = __get_PRIMASK();
 
-	//int32_t temp = (app_env.i2c_rx_buffer[0]<<4) + (app_env.i2c_rx_buffer[0]>>4);
-	int32_t temp = app_env.i2c_rx_buffer[0];
-	bool SGN = temp > 127;
-	temp = (temp<<4);
-	temp += (app_env.i2c_rx_buffer[1]>>4);
-	/**/
-	if(SGN)	// temperatures less than zero
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	if(op->status == I2C_ERRNO_NONE)
 	{
-		temp -=4096;
+		op->status = status;
 	}
-	/* numbers behind the decimal point */
-	temp *= 100;
-	/* To obtain real temperatur in (C) value should be converted to float
-	 * and devided by 16 then result is valid
-	 */
-	temp /= 16;
+	pending = --op->pending;
+	__set_PRIMASK(primask);
 
-		app_env.temperature = temp;
-		if (app_env.temperature_cccd_value & ATT_CCC_START_NTF)
+	if(pending == 0)
+	{
+		dev = op->dev;
+		callback = op->callback;
+		sensor_callback = op->sensor_callback;
+		context = op->context;
+		status = op->status;
+		op->dev = NULL;		// free the operation before the callback reuses it
+		if(callback != NULL)
 		{
-			REAK_SendNotification(&app_env.temperature);
+			callback(context, dev, status);
 		}
+		else if(sensor_callback != NULL)
+		{
+			sensor_callback(context, dev, status);
+		}
+	}
+}
 
-	UART_WriteEnvData();
+/* Called first by every transaction callback: the transaction isn't in flight
+ * any more. A failed transaction leaves the address pointer and the registers
+ * in an unknown state. */
+static bool NCT375_I2C_Failed(struct NCT375_Reg_tag *dev, i2c_error_code_t status)
+{
+	dev->InFlight--;
+	if(status != I2C_ERRNO_NONE)
+	{
+		dev->Addr = NCT375_REG_UNKNOWN;
+		// A write may or may not have been applied
+		NCT375_Shadow_Invalidate(dev);
+		return true;
+	}
+	return false;
 }
 
-void NCT375_ONEShot_ModeOn(void)
+/* Accounts a transaction queued for the device and tells whether it has to
+ * write the address pointer. dev->Addr is the pointer value once the queued
+ * transactions are completed; the pointer write is only skipped while none
+ * is in flight, as a failing one leaves the pointer unknown. */
+static bool NCT375_Addr_Set(struct NCT375_Reg_tag *dev, uint8_t reg)
 {
-	app_env.i2c_tx_buffer[0]=0x01;	// Configuration register
-    app_env.i2c_tx_buffer[1]=0x20;	// OneShot mode DO5 = 1
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 2, NULL, 0, NULL);
+	bool write;
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	write = (dev->InFlight != 0 || dev->Addr != reg);
+	dev->Addr = reg;
+	dev->InFlight++;
+	__set_PRIMASK(primask);
+	return write;
 }
 
-void NCT375_ONEShot_ModeOff(void)
+/* A transaction that couldn't be queued */
+static void NCT375_Addr_Unqueued(struct NCT375_Reg_tag *dev)
 {
-	app_env.i2c_tx_buffer[0]=0x01;	// Configuration register
-    app_env.i2c_tx_buffer[1]=0x00;	// OneShot mode DO5 = 0
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 2, NULL, 0, NULL);
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	dev->InFlight--;
+	dev->Addr = NCT375_REG_UNKNOWN;
+	__set_PRIMASK(primask);
 }
 
-void NCT375_ONEShot_StartSample(void)
+/* The NCT375 keeps its address pointer register between two transactions. Its
+ * value is tracked in dev->Addr, so a register that is already addressed is
+ * read with a single read frame, otherwise with a repeated-start write-read.
+ * The register content is received in dev->Rx, the callback gets the
+ * operation as context. A read that can't be queued fails the operation. */
+static void NCT375_Reg_Read(struct NCT375_Op_tag *op, uint8_t reg, uint16_t length, i2c_callback_t callback)
 {
-	app_env.i2c_tx_buffer[0]=0x04;	// Address pointer register
-	app_env.i2c_tx_buffer[1]=0x01;	// irrelevant data
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 2, NULL, 0, NULL);
+	struct NCT375_Reg_tag *dev = op->dev;
+	bool queued;
+
+	NCT375_Op_Pending(op);
+	if(NCT375_Addr_Set(dev, reg))
+	{
+		queued = I2C_Transfer(dev->I2CAddr, &reg, 1, dev->Rx, length, callback, op);
+	}
+	else
+	{
+		queued = I2C_Transfer(dev->I2CAddr, NULL, 0, dev->Rx, length, callback, op);
+	}
+	if(!queued)
+	{
+		NCT375_Addr_Unqueued(dev);
+		NCT375_Op_Done(op, I2C_ERRNO_BUS_ERROR);
+	}
 }
 
-void NCT375_ONEShotReg_Read(void)
+static void NCT375_Reg_Written(void *context, i2c_error_code_t status)
 {
-	void NCT375_ONEShotReg(void)
+	struct NCT375_Op_tag *op = context;
+
+	NCT375_I2C_Failed(op->dev, status);
+	NCT375_Op_Done(op, status);
+}
+
+/* Address pointer and the largest register are copied by the I2C driver */
+_Static_assert(1 + NCT375_REG_SIZE_MAX <= I2C_TX_INLINE_SIZE, "NCT375 register write buffer");
+
+/* A register write leaves the address pointer on the written register.
+ * Returns false (and fails the operation) if the write couldn't be queued. */
+static bool NCT375_Reg_Write(struct NCT375_Op_tag *op, uint8_t reg, uint8_t *data, uint16_t length)
+{
+	struct NCT375_Reg_tag *dev = op->dev;
+	uint8_t buffer[1 + NCT375_REG_SIZE_MAX];
+
+	buffer[0]=reg;	// Address pointer register
+	memcpy(&buffer[1], data, length);
+	NCT375_Op_Pending(op);
+	NCT375_Addr_Set(dev, reg);
+	if(!I2C_Transfer(dev->I2CAddr, buffer, length+1, NULL, 0, NCT375_Reg_Written, op))
 	{
-		nct375.OneShot = app_env.i2c_rx_buffer[0];
+		NCT375_Addr_Unqueued(dev);
+		NCT375_Op_Done(op, I2C_ERRNO_BUS_ERROR);
+		return false;
 	}
-	// ONEShot register address writing
-	app_env.i2c_tx_buffer[0]=0x04;
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, app_env.i2c_rx_buffer, 0, NULL);
-	// ONEShot register content reading
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 0, app_env.i2c_rx_buffer, 1, NCT375_ONEShotReg);
+	return true;
 }
 
-void NCT375_PowerDown(void)
+/* Temperature register to 0.01 degC */
+static int16_t NCT375_Temp_Decode(uint8_t *buffer)
 {
-	app_env.i2c_tx_buffer[0]=0x01;	// Configuration register
-    app_env.i2c_tx_buffer[1]=0x01;	// Power Down DO0 = 1
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 2, NULL, 0, NULL);
+	return NCT375_TEMP12_TO_TEMP(NCT375_TEMP12_DECODE(NCT375_REG16(buffer)));
 }
 
-void NCT375_PowerUp(void)
+void NCT375_Init(struct NCT375_Reg_tag *dev, uint8_t i2c_addr)
 {
-	app_env.i2c_tx_buffer[0]=0x01;	// Configuration register
-    app_env.i2c_tx_buffer[1]=0x00;	// Power Up DO0 = 0
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 2, NULL, 0, NULL);
+	memset(dev, 0, sizeof(*dev));
+	dev->I2CAddr = i2c_addr;
+	dev->Temp = NCT375_TEMP_INVALID;
+	// Pointer register state is unknown until the first access
+	dev->Addr = NCT375_REG_UNKNOWN;
 }
 
-void NCT375_ConfReg_Read(void)
+/* Write-through shadow of the Config, THYST, TOS and OneShot registers. A
+ * write updates the shadow as soon as it is queued, so the shadow holds the
+ * value the device will have. The hardware is read only while a shadow is
+ * invalid: after a reset, a failed transaction or NCT375_Shadow_Invalidate. */
+void NCT375_Shadow_Invalidate(struct NCT375_Reg_tag *dev)
 {
-	void NCT375_ConfReg(void)
+	dev->Valid = 0;
+}
+
+static bool NCT375_Shadow_Valid(struct NCT375_Reg_tag *dev, uint8_t reg)
+{
+	return (dev->Valid & NCT375_REG_BIT(reg)) != 0;
+}
+
+/* THYST and TOS limit registers, same encoding as the temperature register */
+static void NCT375_Limit_Encode(short int limit, uint8_t *data)
+{
+	uint16_t reg = NCT375_TEMP12_ENCODE(limit);
+
+	data[0] = reg >> 8;
+	data[1] = reg & 0xFF;
+}
+
+static short int NCT375_Limit_Decode(uint8_t *data)
+{
+	return NCT375_TEMP12_DECODE(NCT375_REG16(data));
+}
+
+/* Read callbacks, one per register: the shadow is only loaded if it is still
+ * invalid, a write queued after the read already holds the newer value */
+static void NCT375_TempReg(void *context, i2c_error_code_t status)
+{
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	// No stale temperature if the sensor didn't answer
+	dev->Temp = NCT375_I2C_Failed(dev, status) ? NCT375_TEMP_INVALID : NCT375_Temp_Decode(dev->Rx);
+	NCT375_Op_Done(op, status);
+}
+
+static void NCT375_ConfReg(void *context, i2c_error_code_t status)
+{
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(!NCT375_I2C_Failed(dev, status) && !NCT375_Shadow_Valid(dev, NCT375_REG_CONFIG))
 	{
-		nct375.Config = app_env.i2c_rx_buffer[0];
+		dev->Config = dev->Rx[0];
+		dev->Valid |= NCT375_REG_BIT(NCT375_REG_CONFIG);
 	}
-	// Configuration register address writing
-	app_env.i2c_tx_buffer[0]=0x01;
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, app_env.i2c_rx_buffer, 0, NULL);
-	// Configuration register content reading
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 0, app_env.i2c_rx_buffer, 1, NCT375_ConfReg);
+	NCT375_Op_Done(op, status);
 }
 
-void NCT375_I2C_Delay(void)
+static void NCT375_THYSTReg(void *context, i2c_error_code_t status)
 {
-	// important wait between two i2c data frames
-	uint32_t tmp=3000;
-	while(tmp){tmp--;}
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(!NCT375_I2C_Failed(dev, status) && !NCT375_Shadow_Valid(dev, NCT375_REG_THYST))
+	{
+		dev->Thyst = NCT375_Limit_Decode(dev->Rx);
+		dev->Valid |= NCT375_REG_BIT(NCT375_REG_THYST);
+	}
+	NCT375_Op_Done(op, status);
 }
 
-/* temperature hysteresis and  over set register are used in comparasion and interrupt modes
- * (bit D1 configuration register) but chip has to be working in power NORMAL-MODE
- */
-// temperature hysteresis register
-void NCT375_THYST_Write(short int temp_hyst)
+static void NCT375_TOSReg(void *context, i2c_error_code_t status)
+{
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(!NCT375_I2C_Failed(dev, status) && !NCT375_Shadow_Valid(dev, NCT375_REG_TOS))
+	{
+		dev->TOs = NCT375_Limit_Decode(dev->Rx);
+		dev->Valid |= NCT375_REG_BIT(NCT375_REG_TOS);
+	}
+	NCT375_Op_Done(op, status);
+}
+
+static void NCT375_ONEShotReg(void *context, i2c_error_code_t status)
+{
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(!NCT375_I2C_Failed(dev, status) && !NCT375_Shadow_Valid(dev, NCT375_REG_ONESHOT))
+	{
+		dev->OneShot = dev->Rx[0];
+		dev->Valid |= NCT375_REG_BIT(NCT375_REG_ONESHOT);
+	}
+	NCT375_Op_Done(op, status);
+}
+
+/* Posts the reads of a batch of registers (NCT375_REG_BIT mask) to the
+ * operation. The temperature is invalid until it has been read. */
+static void NCT375_Read_Post(struct NCT375_Op_tag *op, uint8_t regs)
+{
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(regs & NCT375_REG_BIT(NCT375_REG_TEMP))
+	{
+		dev->Temp = NCT375_TEMP_INVALID;
+		NCT375_Reg_Read(op, NCT375_REG_TEMP, NCT375_REG_TEMP_SIZE, NCT375_TempReg);
+	}
+	if((regs & NCT375_REG_BIT(NCT375_REG_CONFIG)) && !NCT375_Shadow_Valid(dev, NCT375_REG_CONFIG))
+	{
+		NCT375_Reg_Read(op, NCT375_REG_CONFIG, NCT375_REG_CONFIG_SIZE, NCT375_ConfReg);
+	}
+	if((regs & NCT375_REG_BIT(NCT375_REG_THYST)) && !NCT375_Shadow_Valid(dev, NCT375_REG_THYST))
+	{
+		NCT375_Reg_Read(op, NCT375_REG_THYST, NCT375_REG_THYST_SIZE, NCT375_THYSTReg);
+	}
+	if((regs & NCT375_REG_BIT(NCT375_REG_TOS)) && !NCT375_Shadow_Valid(dev, NCT375_REG_TOS))
+	{
+		NCT375_Reg_Read(op, NCT375_REG_TOS, NCT375_REG_TOS_SIZE, NCT375_TOSReg);
+	}
+	if((regs & NCT375_REG_BIT(NCT375_REG_ONESHOT)) && !NCT375_Shadow_Valid(dev, NCT375_REG_ONESHOT))
+	{
+		NCT375_Reg_Read(op, NCT375_REG_ONESHOT, NCT375_REG_ONESHOT_SIZE, NCT375_ONEShotReg);
+	}
+}
+
+/* Reads a batch of registers (NCT375_REG_BIT mask) into the shadow registers
+ * and dev->Temp. Registers with a valid shadow are served without bus traffic,
+ * the temperature is always read. The callback is called once all reads are
+ * completed (directly if nothing has to be read). Returns false if no
+ * operation is available, the callback isn't called then. */
+bool NCT375_Read_Async(struct NCT375_Reg_tag *dev, uint8_t regs, nct375_callback_t callback, void *context)
 {
-	union
+	struct NCT375_Op_tag *op = NCT375_Op_Alloc(dev, callback, context);
+
+	if(op == NULL)
 	{
-		short int hyst;
-		uint8_t buffer[2];
-	} to_buff;
-	to_buff.hyst=temp_hyst;
+		return false;
+	}
+	NCT375_Read_Post(op, regs);
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+static void NCT375_Config_Write(struct NCT375_Op_tag *op, uint8_t config)
+{
+	if(NCT375_Reg_Write(op, NCT375_REG_CONFIG, &config, NCT375_REG_CONFIG_SIZE))
+	{
+		op->dev->Config = config;
+		op->dev->Valid |= NCT375_REG_BIT(NCT375_REG_CONFIG);
+	}
+}
+
+/* One-shot register write, always written: the write is the trigger */
+static void NCT375_ONEShot_Write(struct NCT375_Op_tag *op)
+{
+	uint8_t data = 0x01;	// irrelevant data
+
+	if(NCT375_Reg_Write(op, NCT375_REG_ONESHOT, &data, NCT375_REG_ONESHOT_SIZE))
+	{
+		op->dev->OneShot = data;
+		op->dev->Valid |= NCT375_REG_BIT(NCT375_REG_ONESHOT);
+	}
+}
 
-	// only upper 12 bit is valid limit value
-	to_buff.hyst= (to_buff.hyst<<4);
+/* Applies the clear and set masks of the operation to the valid Config shadow,
+ * then triggers a one-shot conversion if the operation asks for it */
+static void NCT375_Config_Apply(struct NCT375_Op_tag *op)
+{
+	uint8_t config = (op->dev->Config & ~op->clear) | op->set;
 
-	app_env.i2c_tx_buffer[0]=0x02;	// Address pointer register
-	app_env.i2c_tx_buffer[1]=to_buff.buffer[1];
-	app_env.i2c_tx_buffer[2]=to_buff.buffer[0];
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 3, NULL, 0, NULL);
+	if(config != op->dev->Config)
+	{
+		NCT375_Config_Write(op, config);
+	}
+	if(op->trigger)
+	{
+		NCT375_ONEShot_Write(op);
+	}
 }
 
-short int NCT375_THYST_Read(void)
+/* Config register refreshed for a read-modify-write */
+static void NCT375_Config_Refreshed(void *context, i2c_error_code_t status)
 {
-	union
+	struct NCT375_Op_tag *op = context;
+	struct NCT375_Reg_tag *dev = op->dev;
+
+	if(!NCT375_I2C_Failed(dev, status))
 	{
-		short int hyst;
-		uint8_t buffer[2];
-	} from_buff;
+		if(!NCT375_Shadow_Valid(dev, NCT375_REG_CONFIG))
+		{
+			dev->Config = dev->Rx[0];
+			dev->Valid |= NCT375_REG_BIT(NCT375_REG_CONFIG);
+		}
+		NCT375_Config_Apply(op);
+	}
+	NCT375_Op_Done(op, status);
+}
 
-	short int temp_hyst=0;
+/* Posts the Config read-modify-write of an operation, an invalid shadow is
+ * refreshed first */
+static void NCT375_Config_Post(struct NCT375_Op_tag *op, uint8_t clear, uint8_t set)
+{
+	op->clear = clear;
+	op->set = set;
 
-	void NCT375_THYSTReg(void)
+	if(!NCT375_Shadow_Valid(op->dev, NCT375_REG_CONFIG))
+	{
+		NCT375_Reg_Read(op, NCT375_REG_CONFIG, NCT375_REG_CONFIG_SIZE, NCT375_Config_Refreshed);
+	}
+	else
 	{
+		NCT375_Config_Apply(op);
+	}
+}
 
-		from_buff.buffer[0] = app_env.i2c_rx_buffer[1];
-		from_buff.buffer[1] = app_env.i2c_rx_buffer[0];
-		// only upper 12 bit is valid limit value
-		from_buff.hyst = from_buff.hyst>>4;
-		/* negative value correction for 16 bits */
-		if(app_env.i2c_rx_buffer[1] & 0x80)
+/* Posts the THYST and TOS writes of an operation, a limit the shadow already
+ * holds isn't written */
+static void NCT375_Limits_Post(struct NCT375_Op_tag *op, short int thyst, short int tos)
+{
+	struct NCT375_Reg_tag *dev = op->dev;
+	uint8_t data[NCT375_REG_SIZE_MAX];
+
+	if(!NCT375_Shadow_Valid(dev, NCT375_REG_THYST) || dev->Thyst != thyst)
+	{
+		NCT375_Limit_Encode(thyst, data);
+		if(NCT375_Reg_Write(op, NCT375_REG_THYST, data, NCT375_REG_THYST_SIZE))
 		{
-			from_buff.buffer[1]=from_buff.buffer[1]|0xF0;
+			dev->Thyst = thyst;
+			dev->Valid |= NCT375_REG_BIT(NCT375_REG_THYST);
 		}
-		/**/
-		temp_hyst=from_buff.hyst;
 	}
+	if(!NCT375_Shadow_Valid(dev, NCT375_REG_TOS) || dev->TOs != tos)
+	{
+		NCT375_Limit_Encode(tos, data);
+		if(NCT375_Reg_Write(op, NCT375_REG_TOS, data, NCT375_REG_TOS_SIZE))
+		{
+			dev->TOs = tos;
+			dev->Valid |= NCT375_REG_BIT(NCT375_REG_TOS);
+		}
+	}
+}
+
+/* Read-modify-write of the Config register against the shadow: the bits of
+ * clear are reset, the bits of set are set, nothing is written if the register
+ * already has the value. An invalid shadow is refreshed first. Completion as
+ * NCT375_Read_Async. */
+bool NCT375_Config_Async(struct NCT375_Reg_tag *dev, uint8_t clear, uint8_t set, nct375_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NCT375_Op_Alloc(dev, callback, context);
 
-	app_env.i2c_tx_buffer[0]=0x02;	// Address pointer register
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, NULL, 0, NULL);
-	NCT375_I2C_Delay();
-	// THYST register content reading
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 0, app_env.i2c_rx_buffer, 2, NCT375_THYSTReg);
-	return temp_hyst;
+	if(op == NULL)
+	{
+		return false;
+	}
+	NCT375_Config_Post(op, clear, set);
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
 }
 
-// temperature over set alert value register
-void NCT375_TOS_Write(short int temp_tos)
+/* Writes the THYST and TOS limits (1/16 degC), a limit the shadow already
+ * holds isn't written. Completion as NCT375_Read_Async. */
+bool NCT375_Limits_Async(struct NCT375_Reg_tag *dev, short int thyst, short int tos, nct375_callback_t callback, void *context)
 {
-	union
+	struct NCT375_Op_tag *op = NCT375_Op_Alloc(dev, callback, context);
+
+	if(op == NULL)
 	{
-		short int tos;
-		uint8_t buffer[2];
-	} to_buff;
-	to_buff.tos= temp_tos;
-	// only upper 12 bit is valid limit value
-	to_buff.tos= (to_buff.tos<<4);
+		return false;
+	}
+	NCT375_Limits_Post(op, thyst, tos);
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+/* Starts a one-shot conversion. Completion as NCT375_Read_Async. */
+bool NCT375_ONEShot_StartSample(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NCT375_Op_Alloc(dev, callback, context);
 
-	app_env.i2c_tx_buffer[0]=0x03;	// Address pointer register
-	app_env.i2c_tx_buffer[1]=to_buff.buffer[1];
-	app_env.i2c_tx_buffer[2]=to_buff.buffer[0];
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 3, NULL, 0, NULL);
+	if(op == NULL)
+	{
+		return false;
+	}
+	NCT375_ONEShot_Write(op);
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+bool NCT375_ONEShot_ModeOn(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
+{
+	// OneShot mode DO5 = 1
+	return NCT375_Config_Async(dev, 0, NCT375_CONFIG_ONESHOT, callback, context);
 }
 
-short int NCT375_TOS_Read(void)
+bool NCT375_ONEShot_ModeOff(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
 {
-	union
+	// OneShot mode DO5 = 0
+	return NCT375_Config_Async(dev, NCT375_CONFIG_ONESHOT, 0, callback, context);
+}
+
+bool NCT375_PowerDown(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
+{
+	// Power Down DO0 = 1
+	return NCT375_Config_Async(dev, 0, NCT375_CONFIG_SHUTDOWN, callback, context);
+}
+
+bool NCT375_PowerUp(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context)
+{
+	// Power Up DO0 = 0
+	return NCT375_Config_Async(dev, NCT375_CONFIG_SHUTDOWN, 0, callback, context);
+}
+
+/* temperature hysteresis and  over set register are used in comparasion and interrupt modes
+ * (bit D1 configuration register) but chip has to be working in power NORMAL-MODE.
+ * The limits are read with NCT375_Read_Async (dev->Thyst and dev->TOs).
+ */
+
+/* Sensor driver (see sensor.h), scheduled by the sampler. Power states: a
+ * continuous start clears the mode bits (normal mode), a single conversion is
+ * a one-shot trigger in one-shot mode. Power down selects shutdown, unless the
+ * device is idle in one-shot mode already; with alert the THYST and TOS limits
+ * are programmed and the device keeps converting with the ALERT output on. */
+static void NCT375_Drv_Init(void *dev, uint8_t i2c_addr)
+{
+	NCT375_Init(dev, i2c_addr);
+}
+
+/* Operation completed with the sensor callback */
+static struct NCT375_Op_tag *NCT375_Drv_Op_Alloc(void *dev, sensor_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NCT375_Op_Alloc(dev, NULL, context);
+
+	if(op != NULL)
+	{
+		op->sensor_callback = callback;
+	}
+	return op;
+}
+
+static bool NCT375_Drv_Start(void *dev, bool continuous, sensor_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NCT375_Drv_Op_Alloc(dev, callback, context);
+
+	if(op == NULL)
+	{
+		return false;
+	}
+	if(continuous)
+	{
+		NCT375_Config_Post(op, NCT375_CONFIG_MODE_MASK, 0);	// Power Up DO0 = 0
+	}
+	else
 	{
-		short int tos;
-		uint8_t buffer[2];
-	} from_buff;
+		// Trigger posted once the one-shot mode is set
+		op->trigger = true;
+		NCT375_Config_Post(op, NCT375_CONFIG_MODE_MASK, NCT375_CONFIG_ONESHOT);
+	}
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+static uint32_t NCT375_Drv_Conversion_Time(void *dev)
+{
+	return NCT375_CONVERSION_TICKS;
+}
+
+static bool NCT375_Drv_Read(void *dev, sensor_callback_t callback, void *context)
+{
+	struct NCT375_Op_tag *op = NCT375_Drv_Op_Alloc(dev, callback, context);
+
+	if(op == NULL)
+	{
+		return false;
+	}
+	NCT375_Read_Post(op, NCT375_REG_BIT(NCT375_REG_TEMP));
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+/* Temperature of the last read, invalid if it failed */
+static int16_t NCT375_Drv_Decode(void *dev)
+{
+	return ((struct NCT375_Reg_tag *)dev)->Temp;
+}
 
-	short int temp_tos=0;
+static bool NCT375_Drv_PowerDown(void *dev, bool alert, sensor_callback_t callback, void *context)
+{
+	struct NCT375_Reg_tag *nct = dev;
+	struct NCT375_Op_tag *op = NCT375_Drv_Op_Alloc(nct, callback, context);
 
-	void NCT375_TOSReg(void)
+	if(op == NULL)
+	{
+		return false;
+	}
+	if(alert)
+	{
+		NCT375_Limits_Post(op, NCT375_TEMP_TO_LIMIT(nct375_env.thyst), NCT375_TEMP_TO_LIMIT(nct375_env.tos));
+		NCT375_Config_Post(op, NCT375_CONFIG_MODE_MASK, NCT375_CONFIG_ALERT);
+	}
+	else if(!NCT375_Shadow_Valid(nct, NCT375_REG_CONFIG) ||
+	        (nct->Config & NCT375_CONFIG_MODE_MASK) != NCT375_CONFIG_ONESHOT)
 	{
+		NCT375_Config_Post(op, NCT375_CONFIG_MODE_MASK, NCT375_CONFIG_SHUTDOWN);	// Power Down DO0 = 1
+	}
+	NCT375_Op_Done(op, I2C_ERRNO_NONE);
+	return true;
+}
+
+const struct sensor_driver_tag nct375_driver =
+{
+	.quantity = SENSOR_QUANTITY_TEMPERATURE,
+	.init = NCT375_Drv_Init,
+	.start_conversion = NCT375_Drv_Start,
+	.conversion_time = NCT375_Drv_Conversion_Time,
+	.read = NCT375_Drv_Read,
+	.decode = NCT375_Drv_Decode,
+	.power_down = NCT375_Drv_PowerDown,
+};
+
+/* Registers the sensors of NCT375_I2C_ADDR_LIST with the sampler */
+void NCT375_Sensors_Add(void)
+{
+	const uint8_t i2c_addr[] = NCT375_I2C_ADDR_LIST;
+	uint8_t i;
 
-		from_buff.buffer[0] = app_env.i2c_rx_buffer[1];
-		from_buff.buffer[1] = app_env.i2c_rx_buffer[0];
-		// only upper 12 bit is valid limit value
-		from_buff.tos = from_buff.tos>>4;
-		/* negative value correction for 16 bits */
-		if(app_env.i2c_rx_buffer[1] & 0x80)
+	memset(&nct375_env, 0, sizeof(nct375_env));
+	nct375_env.thyst = NCT375_THYST_DEFAULT;
+	nct375_env.tos = NCT375_TOS_DEFAULT;
+	for(i = 0; i < sizeof(i2c_addr) && nct375_env.nb_dev < NCT375_MAX_DEVICES; i++)
+	{
+		if(Sampler_Sensor_Add(&nct375_driver, &nct375_env.dev[nct375_env.nb_dev], i2c_addr[i]))
 		{
-			from_buff.buffer[1]=from_buff.buffer[1]|0xF0;
+			nct375_env.nb_dev++;
 		}
-		temp_tos=from_buff.tos;
-	}
-	app_env.i2c_tx_buffer[0]=0x03;	// Address pointer register
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 1, NULL, 0, NULL);
-	NCT375_I2C_Delay();
-	// TOS register content reading
-	I2C_WriteRead(0x48, app_env.i2c_tx_buffer, 0, app_env.i2c_rx_buffer, 2, NCT375_TOSReg);
-	return temp_tos;
+	}
+}
+
+/* Sets the THYST and TOS limits (0.01 degC) used in alert mode. Returns false
+ * if the limits are out of the sensor range or THYST isn't below TOS. */
+bool NCT375_Limits_Set(int16_t thyst, int16_t tos)
+{
+	if(thyst < NCT375_LIMIT_MIN || tos > NCT375_LIMIT_MAX || thyst >= tos)
+	{
+		return false;
+	}
+	nct375_env.thyst = thyst;
+	nct375_env.tos = tos;
+	if(sampler_env.mode == SAMPLER_MODE_ALERT)
+	{
+		Sampler_Reconfigure();
+	}
+	return true;
+}
+
+/* ALERT pin event: a sensor crossed the THYST/TOS band */
+void NCT375_ALERT_IRQHandler(void)
+{
+	Sampler_Alert();
 }
@@ -0,0 +1,238 @@
+/* ----------------------------------------------------------------------------
+ * notify.c
+ * - Notification policy of the measured values, see notify.h.
+ * - Notify_Check is called by the sampler from the main loop and by the
+ *   application timer, Notify_Poll by the application timer; the channel
+ *   state is only accessed with the interrupts masked.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Longest time between two checks of a channel for its elapsed time to stay
+ * exact (half of the tick range, above the largest maximum interval) */
+#define NOTIFY_ELAPSED_MAX              0x80000000U
+
+_Static_assert(NOTIFY_VALUES_MAX >= NCT375_MAX_DEVICES, "NOTIFY_VALUES_MAX: TEMPERATURE ALL doesn't fit");
+
+/* Global variable definition */
+struct notify_env_tag notify_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Notify_Changed(
+ *                               const struct notify_channel_tag *channel,
+ *                               const int16_t *value, uint8_t count)
+ * ----------------------------------------------------------------------------
+ * Description   : Check a value against the deadband
+ * Inputs        : - channel    - Channel state
+ *                 - value      - Value (count entries)
+ *                 - count      - Number of entries
+ * Outputs       : return value - true if an entry differs from the last
+ *                                notified one by at least the deadband
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static bool Notify_Changed(const struct notify_channel_tag *channel,
+                           const int16_t *value, uint8_t count)
+{
+    int32_t delta;
+    uint8_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        delta = (int32_t)value[i] - channel->value[i];
+        if ((delta < 0 ? -delta : delta) >= channel->policy.deadband)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Notify_Decide(uint8_t channel,
+ *                                           const int16_t *value,
+ *                                           uint8_t count, bool enabled,
+ *                                           bool sample)
+ * ----------------------------------------------------------------------------
+ * Description   : Apply the policy of a channel to its current value, and
+ *                 record the value as notified if it is to be notified
+ * Inputs        : - channel    - Channel (notify_channel_t)
+ *                 - value      - Current value (count entries)
+ *                 - count      - Number of entries
+ *                 - enabled    - Notifications enabled by the client
+ *                 - sample     - true for a new value, false for a poll
+ * Outputs       : return value - true if the value is to be notified
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static bool Notify_Decide(uint8_t channel, const int16_t *value, uint8_t count,
+                          bool enabled, bool sample)
+{
+    struct notify_channel_tag *state;
+    uint32_t primask;
+    uint32_t now;
+    uint32_t elapsed;
+    bool changed;
+    bool notify;
+
+    if (channel >= NOTIFY_CHANNEL_MAX)
+    {
+        return false;
+    }
+    state = &notify_env.channel[channel];
+    count = MIN(count, NOTIFY_VALUES_MAX);
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    now = TimeBase_Ticks();
+    if (!enabled)
+    {
+        /* The next value after the client enables them is notified */
+        state->sent = false;
+        state->pending = false;
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    elapsed = now - state->time;
+    if (state->sent && elapsed > NOTIFY_ELAPSED_MAX)
+    {
+        state->time = now - NOTIFY_ELAPSED_MAX;
+        elapsed = NOTIFY_ELAPSED_MAX;
+    }
+
+    changed = sample ? Notify_Changed(state, value, count) : state->pending;
+    notify = !state->sent ||
+             (changed && elapsed >= (uint32_t)state->policy.min_interval * TIMEBASE_TICK_HZ) ||
+             (state->policy.max_interval != 0 &&
+              elapsed >= (uint32_t)state->policy.max_interval * TIMEBASE_TICK_HZ);
+
+    if (notify)
+    {
+        memcpy(state->value, value, count * sizeof(value[0]));
+        state->time = now;
+        state->sent = true;
+        state->pending = false;
+    }
+    else
+    {
+        state->pending = changed;
+    }
+    __set_PRIMASK(primask);
+
+    return notify;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Notify_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Set the default policy of every channel
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Notify_Init(void)
+{
+    uint8_t channel;
+
+    memset(&notify_env, 0, sizeof(notify_env));
+    for (channel = 0; channel < NOTIFY_CHANNEL_MAX; channel++)
+    {
+        notify_env.channel[channel].policy.deadband = 1;
+        notify_env.channel[channel].policy.min_interval = NOTIFY_MIN_INTERVAL_DEFAULT;
+        notify_env.channel[channel].policy.max_interval = NOTIFY_MAX_INTERVAL_DEFAULT;
+    }
+    notify_env.channel[NOTIFY_TEMPERATURE].policy.deadband = NOTIF_THRES_TEMPERATURE;
+    notify_env.channel[NOTIFY_TEMPERATURE_ALL].policy.deadband = NOTIF_THRES_TEMPERATURE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Notify_Policy_Set(uint8_t channel, uint16_t deadband,
+ *                                        uint16_t min_interval,
+ *                                        uint16_t max_interval)
+ * ----------------------------------------------------------------------------
+ * Description   : Change the policy of a channel
+ * Inputs        : - channel      - Channel (notify_channel_t)
+ *                 - deadband     - Deadband, in the unit of the value
+ *                 - min_interval - Minimum interval (s)
+ *                 - max_interval - Maximum interval (s), 0 for none
+ * Outputs       : return value   - true if the policy is valid and applied
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool Notify_Policy_Set(uint8_t channel, uint16_t deadband,
+                       uint16_t min_interval, uint16_t max_interval)
+{
+    struct notify_policy_tag *policy;
+    uint32_t primask;
+
+    if (channel >= NOTIFY_CHANNEL_MAX || (max_interval != 0 && min_interval > max_interval))
+    {
+        return false;
+    }
+
+    policy = &notify_env.channel[channel].policy;
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    policy->deadband = deadband;
+    policy->min_interval = min_interval;
+    policy->max_interval = max_interval;
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Notify_Policy_Value(uint8_t *value)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the NOTIFY POLICY characteristic value
+ * Inputs        : - value      - Value buffer (NOTIFY_POLICY_SIZE bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Notify_Policy_Value(uint8_t *value)
+{
+    const struct notify_policy_tag *policy;
+    uint8_t channel;
+
+    for (channel = 0; channel < NOTIFY_CHANNEL_MAX; channel++, value += NOTIFY_ENTRY_SIZE)
+    {
+        policy = &notify_env.channel[channel].policy;
+        memcpy(&value[0], &policy->deadband, sizeof(policy->deadband));
+        memcpy(&value[2], &policy->min_interval, sizeof(policy->min_interval));
+        memcpy(&value[4], &policy->max_interval, sizeof(policy->max_interval));
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Notify_Check(uint8_t channel, const int16_t *value,
+ *                                   uint8_t count, bool enabled)
+ * ----------------------------------------------------------------------------
+ * Description   : Apply the policy of a channel to a new value
+ * Inputs        : - channel    - Channel (notify_channel_t)
+ *                 - value      - New value (count entries)
+ *                 - count      - Number of entries
+ *                 - enabled    - Notifications enabled by the client
+ * Outputs       : return value - true if the value is to be notified
+ * Assumptions   : The caller notifies the value if true is returned
+ * ------------------------------------------------------------------------- */
+bool Notify_Check(uint8_t channel, const int16_t *value, uint8_t count, bool enabled)
+{
+    return Notify_Decide(channel, value, count, enabled, true);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Notify_Poll(uint8_t channel, const int16_t *value,
+ *                                  uint8_t count, bool enabled)
+ * ----------------------------------------------------------------------------
+ * Description   : Check if the last value of a channel is due: a change held
+ *                 back by the minimum interval, or the heartbeat
+ * Inputs        : - channel    - Channel (notify_channel_t)
+ *                 - value      - Last value (count entries)
+ *                 - count      - Number of entries
+ *                 - enabled    - Notifications enabled by the client
+ * Outputs       : return value - true if the value is to be notified
+ * Assumptions   : The caller notifies the value if true is returned; called
+ *                 at least once a second while enabled
+ * ------------------------------------------------------------------------- */
+bool Notify_Poll(uint8_t channel, const int16_t *value, uint8_t count, bool enabled)
+{
+    return Notify_Decide(channel, value, count, enabled, false);
+}
@@ -0,0 +1,277 @@
+/* ----------------------------------------------------------------------------
+ * racp.c
+ * - Record access control point over the sample history, see racp.h.
+ * - The commands run from the BLE message handlers; the records selected
+ *   are a range of block sequence numbers, found through the history index.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void RACP_Respond(uint8_t opcode, uint8_t response)
+ * ----------------------------------------------------------------------------
+ * Description   : Notify the response to a command, if the notification is
+ *                 enabled
+ * Inputs        : - opcode     - Request opcode
+ *                 - response   - Response code (racp_response_t)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void RACP_Respond(uint8_t opcode, uint8_t response)
+{
+    app_env.racp[0] = RACP_OP_RESPONSE;
+    app_env.racp[1] = RACP_OPERATOR_NULL;
+    app_env.racp[2] = opcode;
+    app_env.racp[3] = response;
+    if (app_env.racp_cccd & ATT_CCC_START_NTF)
+    {
+        REAK_SendNotificationLength(app_env.racp, 4, 0);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void RACP_Respond_Count(uint32_t count)
+ * ----------------------------------------------------------------------------
+ * Description   : Notify the number of records selected, if the
+ *                 notification is enabled
+ * Inputs        : - count      - Number of records
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void RACP_Respond_Count(uint32_t count)
+{
+    uint16_t value = (uint16_t)MIN(count, UINT16_MAX);
+
+    app_env.racp[0] = RACP_OP_COUNT_RESPONSE;
+    app_env.racp[1] = RACP_OPERATOR_NULL;
+    memcpy(&app_env.racp[2], &value, sizeof(value));
+    if (app_env.racp_cccd & ATT_CCC_START_NTF)
+    {
+        REAK_SendNotificationLength(app_env.racp, 4, 0);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t RACP_Bound(uint8_t filter, uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : First record at or after a filter value
+ * Inputs        : - filter     - Filter type (racp_filter_t)
+ *                 - value      - Sequence number or time (s)
+ * Outputs       : return value - Sequence number of the record
+ * Assumptions   : The filter type is valid
+ * ------------------------------------------------------------------------- */
+static uint32_t RACP_Bound(uint8_t filter, uint32_t value)
+{
+    return (filter == RACP_FILTER_TIME) ? History_Find(value) : value;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint8_t RACP_Select(const uint8_t *command,
+ *                                            uint16_t length,
+ *                                            uint32_t *first,
+ *                                            uint32_t *last)
+ * ----------------------------------------------------------------------------
+ * Description   : Resolve the operator and operand of a command to the
+ *                 records kept that it selects
+ * Inputs        : - command    - Opcode, operator and operand
+ *                 - length     - Command length (in bytes)
+ *                 - first      - Sequence number of the first record
+ *                 - last       - Sequence number of the record following
+ *                                the last one (first if none is selected)
+ * Outputs       : return value - RACP_SUCCESS or the error response code
+ * Assumptions   : length >= 2
+ * ------------------------------------------------------------------------- */
+static uint8_t RACP_Select(const uint8_t *command, uint16_t length,
+                           uint32_t *first, uint32_t *last)
+{
+    uint32_t oldest;
+    uint32_t next;
+    uint32_t low;
+    uint32_t high;
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    oldest = history_env.ring.first;
+    next = history_env.ring.seq;
+    __set_PRIMASK(primask);
+
+    switch (command[1])
+    {
+        case RACP_OPERATOR_ALL:
+            *first = oldest;
+            *last = next;
+            break;
+
+        case RACP_OPERATOR_FIRST:
+            *first = oldest;
+            *last = (oldest != next) ? oldest + 1 : oldest;
+            break;
+
+        case RACP_OPERATOR_LAST:
+            *first = (oldest != next) ? next - 1 : next;
+            *last = next;
+            break;
+
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+        case RACP_OPERATOR_RANGE:
+            if (length < ((command[1] == RACP_OPERATOR_RANGE) ? 11 : 7))
+            {
+                return RACP_INVALID_OPERAND;
+            }
+            if (command[2] != RACP_FILTER_SEQ && command[2] != RACP_FILTER_TIME)
+            {
+                return RACP_OPERAND_NOT_SUPPORTED;
+            }
+            memcpy(&low, &command[3], sizeof(low));
+            high = low;
+            if (command[1] == RACP_OPERATOR_RANGE)
+            {
+                memcpy(&high, &command[7], sizeof(high));
+                if (low > high)
+                {
+                    return RACP_INVALID_OPERAND;
+                }
+            }
+
+            /* Records in [low, high], high included */
+            *first = (command[1] == RACP_OPERATOR_LESS_OR_EQUAL) ? oldest :
+                     RACP_Bound(command[2], low);
+            *last = (command[1] == RACP_OPERATOR_GREATER_OR_EQUAL || high == UINT32_MAX) ? next :
+                    RACP_Bound(command[2], high + 1);
+            break;
+
+        default:
+            return (command[1] == RACP_OPERATOR_NULL) ? RACP_INVALID_OPERATOR :
+                   RACP_OPERATOR_NOT_SUPPORTED;
+    }
+
+    /* Keep the records that are kept */
+    if ((int32_t)(*first - oldest) < 0)
+    {
+        *first = oldest;
+    }
+    if ((int32_t)(*last - next) > 0)
+    {
+        *last = next;
+    }
+    if ((int32_t)(*last - *first) < 0)
+    {
+        *last = *first;
+    }
+    return RACP_SUCCESS;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void RACP_Command(const uint8_t *command,
+ *                                   uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Execute a command written to the record access control
+ *                 point. The open history blocks are closed first, so the
+ *                 latest samples are included. A command other than abort
+ *                 while a report is in progress is not completed.
+ * Inputs        : - command    - Opcode, operator and operand
+ *                 - length     - Command length (in bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void RACP_Command(const uint8_t *command, uint16_t length)
+{
+    uint8_t opcode;
+    uint8_t response;
+    uint32_t first;
+    uint32_t last;
+
+    if (length < 2)
+    {
+        if (length == 1)
+        {
+            RACP_Respond(command[0], RACP_INVALID_OPERATOR);
+        }
+        return;
+    }
+    opcode = command[0];
+
+    if (opcode == RACP_OP_ABORT)
+    {
+        if (command[1] != RACP_OPERATOR_NULL)
+        {
+            RACP_Respond(opcode, RACP_INVALID_OPERATOR);
+            return;
+        }
+        if (history_env.report)
+        {
+            History_Abort();
+            History_Notify_Status();
+        }
+        RACP_Respond(opcode, RACP_SUCCESS);
+        return;
+    }
+
+    if (opcode != RACP_OP_REPORT && opcode != RACP_OP_DELETE && opcode != RACP_OP_REPORT_COUNT)
+    {
+        RACP_Respond(opcode, RACP_OPCODE_NOT_SUPPORTED);
+        return;
+    }
+    if (history_env.report)
+    {
+        RACP_Respond(opcode, RACP_PROCEDURE_NOT_COMPLETED);
+        return;
+    }
+
+    History_Flush();
+    response = RACP_Select(command, length, &first, &last);
+    if (response != RACP_SUCCESS)
+    {
+        RACP_Respond(opcode, response);
+        return;
+    }
+
+    switch (opcode)
+    {
+        case RACP_OP_REPORT_COUNT:
+            RACP_Respond_Count(last - first);
+            break;
+
+        case RACP_OP_REPORT:
+            if (last == first)
+            {
+                RACP_Respond(opcode, RACP_NO_RECORDS_FOUND);
+                break;
+            }
+            History_Abort();
+            History_Report(first, last);
+            break;
+
+        default:
+            if (last == first)
+            {
+                RACP_Respond(opcode, RACP_NO_RECORDS_FOUND);
+            }
+            else if (first != history_env.ring.first)
+            {
+                RACP_Respond(opcode, RACP_OPERATOR_NOT_SUPPORTED);
+            }
+            else
+            {
+                RACP_Respond(opcode, History_Delete(last) ? RACP_SUCCESS :
+                             RACP_PROCEDURE_NOT_COMPLETED);
+            }
+            break;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void RACP_Report_Done(void)
+ * ----------------------------------------------------------------------------
+ * Description   : The last record of the report in progress has been handed
+ *                 to the stack, notify the response
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void RACP_Report_Done(void)
+{
+    RACP_Respond(RACP_OP_REPORT, RACP_SUCCESS);
+}
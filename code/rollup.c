@@ -0,0 +1,201 @@
+/* ----------------------------------------------------------------------------
+ * rollup.c
+ * - Rollup tiers of the sample history, see rollup.h.
+ * - Rollup_Add is called by the sampler from the interrupt handlers, next to
+ *   History_Add; Rollup_Flush runs from the BLE message handlers with the
+ *   interrupts masked.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct rollup_env_tag rollup_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Rollup_Close_Block(struct rollup_tier_tag *tier,
+ *                                               uint8_t sensor)
+ * ----------------------------------------------------------------------------
+ * Description   : Encode the open rollup block of a sensor and append it to
+ *                 the ring of the tier
+ * Inputs        : - tier       - Rollup tier
+ *                 - sensor     - Sensor index
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers or with the
+ *                 interrupts masked
+ * ------------------------------------------------------------------------- */
+static void Rollup_Close_Block(struct rollup_tier_tag *tier, uint8_t sensor)
+{
+    struct codec_rollup_tag *block = &tier->block[sensor];
+    uint32_t time;
+    uint16_t size;
+
+    if (block->count == 0)
+    {
+        return;
+    }
+
+    block->seq = tier->ring.seq;
+    size = Codec_Rollup_Encode(block, rollup_env.encoded);
+    time = block->time + (block->offset[block->count - 1] + 1) * (uint32_t)tier->period - 1;
+    block->count = 0;
+    History_Ring_Write(&tier->ring, rollup_env.encoded, size, time);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void Rollup_Close_Bucket(
+ *                     struct rollup_tier_tag *tier, uint8_t sensor)
+ * ----------------------------------------------------------------------------
+ * Description   : Add the rollup of the bucket in progress of a sensor to its
+ *                 open rollup block. The block is encoded once it is full,
+ *                 or before a rollup whose bucket offset doesn't fit.
+ * Inputs        : - tier       - Rollup tier
+ *                 - sensor     - Sensor index
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers or with the
+ *                 interrupts masked
+ * ------------------------------------------------------------------------- */
+static void Rollup_Close_Bucket(struct rollup_tier_tag *tier, uint8_t sensor)
+{
+    struct rollup_bucket_tag *bucket = &tier->bucket[sensor];
+    struct codec_rollup_tag *block = &tier->block[sensor];
+    uint32_t first = block->time / tier->period;
+    int32_t half = bucket->count / 2;
+
+    if (bucket->count == 0)
+    {
+        return;
+    }
+
+    if (block->count > 0 && bucket->index - first > CODEC_OFFSET_MAX)
+    {
+        Rollup_Close_Block(tier, sensor);
+    }
+    if (block->count == 0)
+    {
+        block->time = bucket->index * tier->period;
+        block->period = tier->period;
+        block->sensor = sensor;
+        first = bucket->index;
+    }
+
+    /* Mean rounded to the nearest value */
+    block->offset[block->count] = (uint16_t)(bucket->index - first);
+    block->mean[block->count] = (int16_t)((bucket->sum + (bucket->sum < 0 ? -half : half)) /
+                                          bucket->count);
+    block->min[block->count] = bucket->min;
+    block->max[block->count++] = bucket->max;
+    bucket->count = 0;
+
+    if (block->count == CODEC_ROLLUP_RECORDS)
+    {
+        Rollup_Close_Block(tier, sensor);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Rollup_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Clear the rollup tiers
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Rollup_Init(void)
+{
+    memset(&rollup_env, 0, sizeof(rollup_env));
+
+    rollup_env.tier[ROLLUP_TIER_MINUTE].period = ROLLUP_MINUTE_PERIOD;
+    History_Ring_Init(&rollup_env.tier[ROLLUP_TIER_MINUTE].ring, rollup_env.minute_buffer,
+                      ROLLUP_MINUTE_BUFFER_SIZE, CODEC_ROLLUP_HEADER_SIZE, Codec_Rollup_Size,
+                      Codec_Rollup_Time);
+    rollup_env.tier[ROLLUP_TIER_QUARTER].period = ROLLUP_QUARTER_PERIOD;
+    History_Ring_Init(&rollup_env.tier[ROLLUP_TIER_QUARTER].ring, rollup_env.quarter_buffer,
+                      ROLLUP_QUARTER_BUFFER_SIZE, CODEC_ROLLUP_HEADER_SIZE, Codec_Rollup_Size,
+                      Codec_Rollup_Time);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Rollup_Add(uint8_t sensor, int16_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Add a sample to the bucket in progress of its sensor in
+ *                 every tier, closing the bucket first if the sample belongs
+ *                 to a later one
+ * Inputs        : - sensor     - Sensor index (sampler registration order)
+ *                 - value      - Sample value
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers only
+ * ------------------------------------------------------------------------- */
+void Rollup_Add(uint8_t sensor, int16_t value)
+{
+    struct rollup_tier_tag *tier;
+    struct rollup_bucket_tag *bucket;
+    uint32_t index;
+    uint8_t i;
+
+    if (sensor >= SENSOR_MAX)
+    {
+        return;
+    }
+
+    for (i = 0; i < ROLLUP_TIERS; i++)
+    {
+        tier = &rollup_env.tier[i];
+        bucket = &tier->bucket[sensor];
+        index = history_env.time / tier->period;
+
+        if (bucket->count > 0 && bucket->index != index)
+        {
+            Rollup_Close_Bucket(tier, sensor);
+        }
+        if (bucket->count == 0)
+        {
+            bucket->index = index;
+            bucket->sum = 0;
+            bucket->min = value;
+            bucket->max = value;
+        }
+        bucket->sum += value;
+        bucket->count++;
+        bucket->min = MIN(bucket->min, value);
+        bucket->max = MAX(bucket->max, value);
+
+        /* Keep the sum in range, the rollup of a full bucket is closed early */
+        if (bucket->count == UINT16_MAX)
+        {
+            Rollup_Close_Bucket(tier, sensor);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Rollup_Flush(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Close the buckets whose period is over and the open rollup
+ *                 blocks, so a download includes the latest rollups
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Rollup_Flush(void)
+{
+    struct rollup_tier_tag *tier;
+    uint32_t primask;
+    uint8_t sensor;
+    uint8_t i;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    for (i = 0; i < ROLLUP_TIERS; i++)
+    {
+        tier = &rollup_env.tier[i];
+        for (sensor = 0; sensor < SENSOR_MAX; sensor++)
+        {
+            if (tier->bucket[sensor].index != history_env.time / tier->period)
+            {
+                Rollup_Close_Bucket(tier, sensor);
+            }
+            Rollup_Close_Block(tier, sensor);
+        }
+    }
+    __set_PRIMASK(primask);
+}
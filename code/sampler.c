@@ -0,0 +1,718 @@
+/* ----------------------------------------------------------------------------
+ * sampler.c
+ * - Sampling engine, see sampler.h.
+ * - Batched round-robin sampling: commands are posted for all sensors back to
+ *   back, so the sensors convert in parallel and are read in one burst.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Sensors sampled together */
+struct sampler_env_tag sampler_env;
+
+void Sampler_Init(void)
+{
+	const struct filter_param_tag filter_param = FILTER_PARAM_DEFAULT;
+	uint8_t i;
+
+	memset(&sampler_env, 0, sizeof(sampler_env));
+	sampler_env.mode = SAMPLER_MODE_DEFAULT;
+	sampler_env.filter_param = filter_param;
+	sampler_env.max_period = SAMPLER_RATE_MAX_PERIOD_DEFAULT;
+	sampler_env.rate_threshold = SAMPLER_RATE_THRESHOLD_DEFAULT;
+	sampler_env.period = SAMPLER_PERIOD_TICKS;
+	// Supply switched on by the application DIO configuration
+	sampler_env.supplied = true;
+	for(i = 0; i < SENSOR_MAX; i++)
+	{
+		Filter_Reset(&sampler_env.filter[i]);
+		sampler_env.value[i] = SENSOR_VALUE_INVALID;
+	}
+}
+
+/* Registers a sensor instance and initializes it. Returns false if
+ * SENSOR_MAX sensors are registered already. */
+bool Sampler_Sensor_Add(const struct sensor_driver_tag *driver, void *dev, uint8_t i2c_addr)
+{
+	struct sensor_tag *sensor;
+
+	if(sampler_env.nb_sensor >= SENSOR_MAX)
+	{
+		return false;
+	}
+	sensor = &sampler_env.sensor[sampler_env.nb_sensor++];
+	sensor->driver = driver;
+	sensor->dev = dev;
+	sensor->i2c_addr = i2c_addr;
+	driver->init(dev, i2c_addr);
+	return true;
+}
+
+/* Sampler state machine. The phases are chained by the completion of the
+ * operations of a batch and by the sampler timer, the CPU doesn't wait in
+ * between:
+ *   IDLE       -> sample period elapsed (or ALERT line event in alert mode),
+ *                 trigger the conversion
+ *   SETTLING   -> gated mode, supply restored, timer running for the settling
+ *                 time
+ *   POWERUP    -> conversions started on all sensors
+ *   CONVERTING -> timer running for the longest conversion time
+ *   READING    -> reads posted to all sensors, back to CONVERTING (or
+ *                 POWERUP) until the burst of the filter stage is done
+ *   POWERDOWN  -> all sensors put in their idle state
+ */
+
+/* Sensors sampled periodically, outside of a BLE connection too */
+static bool Sampler_Active(void)
+{
+	switch(sampler_env.mode)
+	{
+		case SAMPLER_MODE_FULL_POWER:
+		case SAMPLER_MODE_ONE_SHOT:
+		case SAMPLER_MODE_GATED:
+			return true;
+		case SAMPLER_MODE_ALERT:
+			return false;
+		default:
+			return (ble_env.state == APPM_CONNECTED);
+	}
+}
+
+/* Sensors kept in continuous conversion between two samples */
+static bool Sampler_KeepPowered(void)
+{
+	switch(sampler_env.mode)
+	{
+		case SAMPLER_MODE_FULL_POWER:
+		case SAMPLER_MODE_ALERT:
+			return true;
+		case SAMPLER_MODE_NORMAL:
+			return (ble_env.state == APPM_CONNECTED);
+		default:
+			return false;
+	}
+}
+
+/* Gated mode: the sensors are supplied from I2C_PWR_DIO_NUM. With the supply
+ * cut the bus and ALERT pull-ups are released too, no current flows into the
+ * unpowered sensors. The device state is lost, the instances are initialized
+ * again and reload it with the first command after power-up. */
+static void Sampler_Supply_Off(void)
+{
+	struct sensor_tag *sensor;
+	uint8_t i;
+
+	Sys_DIO_Config(I2C_SCL_DIO_NUM, DIO_MODE_DISABLE | DIO_NO_PULL);
+	Sys_DIO_Config(I2C_SDA_DIO_NUM, DIO_MODE_DISABLE | DIO_NO_PULL);
+	Sys_DIO_Config(NCT375_ALERT_DIO_NUM, DIO_MODE_DISABLE | DIO_NO_PULL);
+	Sys_DIO_Config(I2C_PWR_DIO_NUM, DIO_MODE_GPIO_OUT_0);
+	sampler_env.supplied = false;
+
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		sensor->driver->init(sensor->dev, sensor->i2c_addr);
+	}
+}
+
+static void Sampler_Supply_On(void)
+{
+	Sys_DIO_Config(I2C_PWR_DIO_NUM, DIO_MODE_GPIO_OUT_1);
+	Sys_I2C_DIOConfig(I2C_DIO_CFG, I2C_SCL_DIO_NUM, I2C_SDA_DIO_NUM);
+	Sys_DIO_Config(NCT375_ALERT_DIO_NUM, NCT375_ALERT_DIO_CFG);
+	sampler_env.supplied = true;
+}
+
+static void Sampler_Timer_Start(uint32_t ticks)
+{
+	// The rest of a wait beyond the timer range is restarted by the interrupt
+	sampler_env.delay = ticks - MIN(ticks, SAMPLER_TIMER_MAX_TICKS);
+	ticks = MIN(ticks, SAMPLER_TIMER_MAX_TICKS);
+	Sys_Timer_Set_Control(SAMPLER_TIMER, TIMER_MULTI_COUNT_1 |
+	                                     TIMER_SHOT_MODE     |
+	                                     TIMER_SLOWCLK_DIV2  |
+	                                     TIMER_PRESCALE_32   | ticks);
+	Sys_Timers_Start(SAMPLER_TIMER_SELECT);
+}
+
+/* Counts an operation of the current batch. The batch is opened with one
+ * extra count released by Sampler_Done once everything is posted, so
+ * operations completing meanwhile can't end it early. */
+static void Sampler_Pending(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	sampler_env.pending++;
+	__set_PRIMASK(primask);
+}
+
+static void Sampler_Step(void);
+
+/* Releases an operation of the current batch */
+static void Sampler_Done(void)
+{
+	uint8_t pending;
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	pending = --sampler_env.pending;
+	__set_PRIMASK(primask);
+
+	if(pending == 0)
+	{
+		Sampler_Step();
+	}
+}
+
+/* Completion of an operation of the current batch, the context is the
+ * sensor */
+static void Sampler_Completed(void *context, void *dev, i2c_error_code_t status)
+{
+	((struct sensor_tag *)context)->status = status;
+	Sampler_Done();
+}
+
+/* Releases the count taken before posting an operation that couldn't be
+ * posted (its callback isn't called), the operation failed */
+static void Sampler_Posted(struct sensor_tag *sensor, bool posted)
+{
+	if(!posted)
+	{
+		sensor->status = I2C_ERRNO_BUS_ERROR;
+		Sampler_Done();
+	}
+}
+
+/* Batch commands: the driver operation is posted to all sensors and the state
+ * machine steps once the last one is completed */
+
+/* Starts a conversion on all sensors */
+static void Sampler_Trigger(bool continuous)
+{
+	struct sensor_tag *sensor;
+	uint8_t i;
+
+	Sampler_Pending();
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		Sampler_Pending();
+		Sampler_Posted(sensor, sensor->driver->start_conversion(sensor->dev, continuous, Sampler_Completed, sensor));
+	}
+	Sampler_Done();
+}
+
+/* Reads all sensors */
+static void Sampler_Read(void)
+{
+	struct sensor_tag *sensor;
+	uint8_t i;
+
+	Sampler_Pending();
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		Sampler_Pending();
+		Sampler_Posted(sensor, sensor->driver->read(sensor->dev, Sampler_Completed, sensor));
+	}
+	Sampler_Done();
+}
+
+/* Puts all sensors in their idle state */
+static void Sampler_Idle(bool alert)
+{
+	struct sensor_tag *sensor;
+	uint8_t i;
+
+	Sampler_Pending();
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		Sampler_Pending();
+		Sampler_Posted(sensor, sensor->driver->power_down(sensor->dev, alert, Sampler_Completed, sensor));
+	}
+	Sampler_Done();
+}
+
+/* Waits for the slowest sensor of the wake window */
+static void Sampler_Convert_Wait(void)
+{
+	struct sensor_tag *sensor;
+	uint32_t ticks = 1;
+	uint8_t i;
+
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		ticks = MAX(ticks, sensor->driver->conversion_time(sensor->dev));
+	}
+	sampler_env.state = SAMPLER_CONVERTING;
+	Sampler_Timer_Start(ticks);
+}
+
+/* Starts the next conversion of a burst: sensors in continuous conversion
+ * only need the conversion time, the others a new start */
+static void Sampler_Convert(void)
+{
+	if(sampler_env.powered || sampler_env.mode == SAMPLER_MODE_GATED)
+	{
+		Sampler_Convert_Wait();
+	}
+	else
+	{
+		sampler_env.state = SAMPLER_POWERUP;
+		Sampler_Trigger(false);
+	}
+}
+
+/* Adds the values just read to the burst of each sensor, a failed read adds
+ * a missing sample */
+static void Sampler_Collect(void)
+{
+	struct sensor_tag *sensor;
+	uint8_t i;
+
+	if(sampler_env.burst == 0 && sampler_env.refilter)
+	{
+		// Filter parameters changed, restart from an empty history
+		sampler_env.refilter = false;
+		sampler_env.decimation = 0;
+		for(i = 0; i < SENSOR_MAX; i++)
+		{
+			Filter_Reset(&sampler_env.filter[i]);
+		}
+	}
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		sensor = &sampler_env.sensor[i];
+		Filter_Add(&sampler_env.filter[i], sensor->status == I2C_ERRNO_NONE ?
+		                                   sensor->driver->decode(sensor->dev) : FILTER_SAMPLE_INVALID);
+	}
+}
+
+/* Current sample period in ms, exposed over BLE */
+uint32_t Sampler_Period_Ms(void)
+{
+	return (uint32_t)(((uint64_t)sampler_env.period * 1000) / SAMPLER_TICKS_PER_S);
+}
+
+/* Change of a filtered value over one sample period, in 0.01 unit/min */
+static uint16_t Sampler_Rate(int16_t value, int16_t last)
+{
+	uint32_t delta;
+	uint64_t rate;
+
+	if(value == SENSOR_VALUE_INVALID || last == SENSOR_VALUE_INVALID)
+	{
+		return 0;
+	}
+	delta = (value > last ? value - last : last - value);
+	rate = ((uint64_t)delta * 60 * SAMPLER_TICKS_PER_S) / sampler_env.period;
+	return (uint16_t)MIN(rate, 0xFFFF);
+}
+
+/* Adaptive sample period controller, run once per burst with the fastest
+ * change of all sensors. A new period is notified over BLE by
+ * Sampler_Resume. */
+static void Sampler_Adapt(uint16_t rate)
+{
+	uint32_t period = sampler_env.period;
+	uint32_t max_period = (uint32_t)sampler_env.max_period * SAMPLER_TICKS_PER_S;
+
+	sampler_env.rate = rate;
+	if(sampler_env.max_period == 0 || rate > sampler_env.rate_threshold)
+	{
+		period = SAMPLER_PERIOD_TICKS;
+	}
+	else if(rate <= sampler_env.rate_threshold / 2)
+	{
+		// Stable, stretch the interval
+		period = MIN(2 * period, MAX(max_period, SAMPLER_PERIOD_TICKS));
+	}
+
+	if(period != sampler_env.period)
+	{
+		sampler_env.period = period;
+		sampler_env.period_changed = true;
+	}
+}
+
+/* Ends the burst: median and filter of each sensor. Returns true if the
+ * output is due for publication, only every n-th output is published (each
+ * one in alert mode, where a reading means a crossing of the band). */
+static bool Sampler_Filter(void)
+{
+	int16_t value;
+	uint16_t rate = 0;
+	uint8_t i;
+
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		value = Filter_Run(&sampler_env.filter[i], &sampler_env.filter_param);
+		rate = MAX(rate, Sampler_Rate(value, sampler_env.value[i]));
+		// No sample read in the burst, the last value isn't current any more
+		sampler_env.value[i] = (value != FILTER_SAMPLE_INVALID ? value : SENSOR_VALUE_INVALID);
+	}
+	if(sampler_env.mode != SAMPLER_MODE_ALERT)
+	{
+		Sampler_Adapt(rate);
+	}
+
+	if(sampler_env.mode == SAMPLER_MODE_ALERT || ++sampler_env.decimation >= sampler_env.filter_param.decimation)
+	{
+		sampler_env.decimation = 0;
+		return true;
+	}
+	return false;
+}
+
+/* Records the filtered values in the sample history, its rollups and the
+ * running statistics. The values are sent over BLE and UART by
+ * Sampler_Resume from the main loop. */
+static void Sampler_Publish(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < sampler_env.nb_sensor; i++)
+	{
+		if(sampler_env.value[i] != SENSOR_VALUE_INVALID)
+		{
+			History_Add(i, sampler_env.value[i]);
+			Rollup_Add(i, sampler_env.value[i]);
+			Stats_Add(i, sampler_env.value[i]);
+		}
+	}
+	sampler_env.publish = true;
+}
+
+/* Waits for the next sample: sample period, or in alert mode the ALERT line.
+ * A pending alert or configuration change is handled right away. While the
+ * sensors aren't sampled the state is polled at the fast period. */
+static void Sampler_Wait(void)
+{
+	if(sampler_env.alert || sampler_env.reconfigure)
+	{
+		Sampler_Timer_Start(1);
+	}
+	else if(sampler_env.mode != SAMPLER_MODE_ALERT)
+	{
+		Sampler_Timer_Start(Sampler_Active() ? sampler_env.period : SAMPLER_PERIOD_TICKS);
+	}
+}
+
+/* Puts the sensors in the idle state of the current mode. In alert mode the
+ * sensors keep converting and monitor their thresholds, in gated mode the
+ * supply is cut instead. */
+static void Sampler_PowerDown(void)
+{
+	sampler_env.state = SAMPLER_POWERDOWN;
+	sampler_env.powered = (sampler_env.mode == SAMPLER_MODE_ALERT);
+	// In alert mode the current values are published once configured
+	sampler_env.alert = (sampler_env.mode == SAMPLER_MODE_ALERT);
+
+	Sampler_Pending();
+	if(sampler_env.mode == SAMPLER_MODE_GATED)
+	{
+		Sampler_Supply_Off();
+	}
+	else
+	{
+		Sampler_Idle(sampler_env.mode == SAMPLER_MODE_ALERT);
+	}
+	Sampler_Done();
+}
+
+/* Restores the sensor supply, the sampler steps once it is settled */
+static void Sampler_PowerOn(void)
+{
+	sampler_env.state = SAMPLER_SETTLING;
+	Sampler_Supply_On();
+	Sampler_Timer_Start(SAMPLER_SUPPLY_SETTLE_TICKS);
+}
+
+/* Triggers the state machine from the application, if it is waiting */
+static void Sampler_Kick(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	if(sampler_env.state == SAMPLER_IDLE)
+	{
+		Sampler_Timer_Start(1);
+	}
+	__set_PRIMASK(primask);
+}
+
+static void Sampler_Step(void)
+{
+	switch(sampler_env.state)
+	{
+		case SAMPLER_IDLE:
+			// Sample period elapsed
+			if(sampler_env.reconfigure)
+			{
+				if(!sampler_env.supplied && sampler_env.mode != SAMPLER_MODE_GATED)
+				{
+					// Leaving gated mode, reconfigure once supplied
+					Sampler_PowerOn();
+					break;
+				}
+				// Power mode or thresholds changed, start from the idle state
+				sampler_env.reconfigure = false;
+				Sampler_PowerDown();
+			}
+			else if(sampler_env.mode == SAMPLER_MODE_ALERT)
+			{
+				// Band crossed, the sensors are converting
+				sampler_env.alert = false;
+				sampler_env.state = SAMPLER_READING;
+				Sampler_Read();
+			}
+			else if(!Sampler_Active())
+			{
+				if(sampler_env.powered && !Sampler_KeepPowered())
+				{
+					Sampler_PowerDown();
+				}
+				else
+				{
+					Sampler_Wait();
+				}
+			}
+			else if(sampler_env.powered)
+			{
+				// Continuous conversion, the last conversion is up to date
+				sampler_env.state = SAMPLER_READING;
+				Sampler_Read();
+			}
+			else if(!sampler_env.supplied)
+			{
+				Sampler_PowerOn();
+			}
+			else
+			{
+				sampler_env.state = SAMPLER_POWERUP;
+				sampler_env.powered = Sampler_KeepPowered();
+				Sampler_Trigger(sampler_env.powered);
+			}
+			break;
+
+		case SAMPLER_SETTLING:
+			// Supply settled
+			if(sampler_env.reconfigure)
+			{
+				sampler_env.reconfigure = false;
+				Sampler_PowerDown();
+				break;
+			}
+			sampler_env.state = SAMPLER_POWERUP;
+			Sampler_Trigger(true);
+			break;
+
+		case SAMPLER_POWERUP:
+			// Conversion started on all sensors
+			Sampler_Convert_Wait();
+			break;
+
+		case SAMPLER_CONVERTING:
+			// Conversion time elapsed
+			sampler_env.state = SAMPLER_READING;
+			Sampler_Read();
+			break;
+
+		case SAMPLER_READING:
+			// All sensors read
+			Sampler_Collect();
+			if(++sampler_env.burst < sampler_env.filter_param.burst)
+			{
+				Sampler_Convert();
+				break;
+			}
+			sampler_env.burst = 0;
+			if(Sampler_Filter())
+			{
+				Sampler_Publish();
+			}
+			if((sampler_env.powered && !Sampler_KeepPowered()) || sampler_env.mode == SAMPLER_MODE_GATED)
+			{
+				Sampler_PowerDown();
+				break;
+			}
+			sampler_env.state = SAMPLER_IDLE;
+			Sampler_Wait();
+			break;
+
+		case SAMPLER_POWERDOWN:
+		default:
+			// All sensors idle
+			sampler_env.state = SAMPLER_IDLE;
+			Sampler_Wait();
+			break;
+	}
+}
+
+/* Puts the sensors in the idle state of the selected power mode and starts
+ * sampling */
+void Sampler_Start(void)
+{
+	sampler_env.reconfigure = false;
+	NVIC_EnableIRQ(SAMPLER_TIMER_IRQn);
+	NVIC_EnableIRQ(NCT375_ALERT_IRQn);
+	Sampler_PowerDown();
+}
+
+/* Selects the power mode (sampler_mode_t). Once sampling is started, a new
+ * mode is applied at the next sample period. Returns false for an unknown
+ * mode. */
+bool Sampler_Mode_Set(uint8_t mode)
+{
+	if(mode >= SAMPLER_MODE_MAX)
+	{
+		return false;
+	}
+	if(mode != sampler_env.mode)
+	{
+		sampler_env.mode = mode;
+		Sampler_Reconfigure();
+	}
+	return true;
+}
+
+/* Applies a changed sensor configuration (e.g. thresholds) by putting the
+ * sensors in their idle state again */
+void Sampler_Reconfigure(void)
+{
+	sampler_env.reconfigure = true;
+	Sampler_Kick();
+}
+
+/* ALERT line event, a sensor crossed its threshold band: read in alert mode */
+void Sampler_Alert(void)
+{
+	if(sampler_env.mode != SAMPLER_MODE_ALERT)
+	{
+		return;
+	}
+	sampler_env.alert = true;
+	if(sampler_env.state == SAMPLER_IDLE)
+	{
+		Sampler_Step();
+	}
+}
+
+/* Sets the filter stage parameters, applied from the next burst. Returns false
+ * if the parameters are invalid (see Filter_Param_Check). */
+bool Sampler_Filter_Set(const struct filter_param_tag *param)
+{
+	uint32_t primask;
+
+	if(!Filter_Param_Check(param))
+	{
+		return false;
+	}
+	primask = __get_PRIMASK();
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	sampler_env.filter_param = *param;
+	sampler_env.refilter = true;
+	__set_PRIMASK(primask);
+	return true;
+}
+
+/* Sets the adaptive sample period: maximum period (s, 0 for a fixed period)
+ * and rate threshold (0.01 unit/min). The period restarts from the fast rate.
+ * Returns false for a zero threshold. */
+bool Sampler_Rate_Set(uint16_t max_period, uint16_t threshold)
+{
+	uint32_t primask;
+
+	if(threshold == 0)
+	{
+		return false;
+	}
+	primask = __get_PRIMASK();
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	sampler_env.max_period = max_period;
+	sampler_env.rate_threshold = threshold;
+	sampler_env.period = SAMPLER_PERIOD_TICKS;
+	__set_PRIMASK(primask);
+	app_env.sample_period = Sampler_Period_Ms();
+	Sampler_Kick();
+	return true;
+}
+
+/* Exposes the values published by the interrupts over BLE (notified as their
+ * policy allows, see notify.h) and UART, in the order the temperature sensors
+ * are registered. The first one is reported by the standard temperature
+ * characteristic. A new sample period is notified too. Called from the main
+ * loop, the kernel messages aren't sent from the interrupts. */
+void Sampler_Resume(void)
+{
+	int16_t value[SENSOR_MAX];
+	uint32_t primask;
+	bool publish;
+	bool period_changed;
+	uint8_t i;
+	uint8_t n = 0;
+
+	primask = __get_PRIMASK();
+	__set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+	publish = sampler_env.publish;
+	period_changed = sampler_env.period_changed;
+	sampler_env.publish = false;
+	sampler_env.period_changed = false;
+	memcpy(value, sampler_env.value, sizeof(value));
+	__set_PRIMASK(primask);
+
+	if(period_changed)
+	{
+		app_env.sample_period = Sampler_Period_Ms();
+		if (app_env.sample_period_cccd & ATT_CCC_START_NTF)
+		{
+			REAK_SendNotification(&app_env.sample_period);
+		}
+	}
+	if(!publish)
+	{
+		return;
+	}
+
+	for(i = 0; i < sampler_env.nb_sensor && n < NCT375_MAX_DEVICES; i++)
+	{
+		if(sampler_env.sensor[i].driver->quantity == SENSOR_QUANTITY_TEMPERATURE)
+		{
+			app_env.temperature_all[n++] = value[i];
+		}
+	}
+	while(n < NCT375_MAX_DEVICES)
+	{
+		app_env.temperature_all[n++] = SENSOR_VALUE_INVALID;
+	}
+
+	app_env.temperature = app_env.temperature_all[0];
+	if (Notify_Check(NOTIFY_TEMPERATURE, &app_env.temperature, 1,
+	                 ble_env.state == APPM_CONNECTED && (app_env.temperature_cccd_value & ATT_CCC_START_NTF)))
+	{
+		REAK_SendNotification(&app_env.temperature);
+	}
+	if (Notify_Check(NOTIFY_TEMPERATURE_ALL, app_env.temperature_all, NCT375_MAX_DEVICES,
+	                 ble_env.state == APPM_CONNECTED && (app_env.temperature_all_cccd & ATT_CCC_START_NTF)))
+	{
+		REAK_SendNotification(&app_env.temperature_all);
+	}
+
+	UART_WriteEnvData(value);
+}
+
+void SAMPLER_TIMER_IRQHandler(void)
+{
+	if(sampler_env.delay > 0)
+	{
+		Sampler_Timer_Start(sampler_env.delay);
+		return;
+	}
+	if(sampler_env.state == SAMPLER_IDLE || sampler_env.state == SAMPLER_SETTLING ||
+	   sampler_env.state == SAMPLER_CONVERTING)
+	{
+		Sampler_Step();
+	}
+}
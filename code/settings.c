@@ -0,0 +1,212 @@
+/* ----------------------------------------------------------------------------
+ * settings.c
+ * - Persistent application settings, kept in one of two sectors of the main
+ *   flash.
+ * - See settings.h for the record format and the copy between the sectors.
+ * - Known limitations:
+ *   > The flash is written by the CPU; an erase blocks the caller for the
+ *     sector erase time, so settings should not be changed at a high rate.
+ * ------------------------------------------------------------------------- */
+
+#include "settings.h"
+
+/* Global variable definition */
+struct settings_env_tag settings_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t Settings_Check(uint8_t key, uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Compute the first word of a record
+ * Inputs        : - key        - Setting key
+ *                 - value      - Setting value
+ * Outputs       : return value - Record word 0 (tag, key and check)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t Settings_Check(uint8_t key, uint32_t value)
+{
+    uint16_t check = (uint16_t)(value ^ (value >> 16) ^ (key * 0x0101U) ^ 0xA5A5U);
+
+    return ((uint32_t)SETTINGS_RECORD_TAG << 24) | ((uint32_t)key << 16) | check;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Settings_Append(uint8_t key, uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Program a record at the next free location
+ * Inputs        : - key        - Setting key
+ *                 - value      - Setting value
+ * Outputs       : return value - true if the record has been programmed
+ * Assumptions   : A free record is available
+ * ------------------------------------------------------------------------- */
+static bool Settings_Append(uint8_t key, uint32_t value)
+{
+    FlashStatus status;
+
+    status = Flash_WriteWordPair(settings_env.next, Settings_Check(key, value), value);
+    settings_env.next += SETTINGS_RECORD_SIZE;
+
+    return (status == FLASH_ERR_NONE);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool Settings_Compact(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Copy the current value of each key to the other settings
+ *                 sector (erased first), then program its header with the
+ *                 next generation number. The sector in use is left as it
+ *                 is until the copy is complete.
+ * Inputs        : None
+ * Outputs       : return value - true if the copy is in use
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static bool Settings_Compact(void)
+{
+    uint32_t sector = SETTINGS_FLASH_ADDR;
+    uint32_t generation = settings_env.generation + 1;
+    uint8_t key;
+    bool result;
+
+    if (settings_env.sector == SETTINGS_FLASH_ADDR)
+    {
+        sector += SETTINGS_SECTOR_SIZE;
+    }
+
+    result = (Flash_EraseSector(sector) == FLASH_ERR_NONE);
+    settings_env.next = sector + SETTINGS_RECORD_SIZE;
+    for (key = 0; result && key < SETTINGS_KEY_MAX; key++)
+    {
+        if (settings_env.valid[key])
+        {
+            result = Settings_Append(key, settings_env.value[key]);
+        }
+    }
+
+    /* The header last: the copy is found at start-up once it is complete */
+    result = result && (Flash_WriteWordPair(sector, Settings_Check(SETTINGS_HEADER_KEY, generation),
+                                            generation) == FLASH_ERR_NONE);
+    if (!result)
+    {
+        /* Still in the full sector, the copy is tried again by the next
+         * write */
+        settings_env.next = settings_env.sector + SETTINGS_SECTOR_SIZE;
+        return false;
+    }
+    settings_env.sector = sector;
+    settings_env.generation = generation;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Settings_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Unlock the main flash for writing, find the settings
+ *                 sector with the newest header and load the last valid
+ *                 record of each key
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Settings_Init(void)
+{
+    const uint32_t *record;
+    uint32_t sector;
+    uint8_t key;
+
+    memset(&settings_env, 0, sizeof(settings_env));
+
+    FLASH->MAIN_CTRL = MAIN_LOW_W_ENABLE | MAIN_MIDDLE_W_ENABLE | MAIN_HIGH_W_ENABLE;
+    FLASH->MAIN_WRITE_UNLOCK = FLASH_MAIN_KEY;
+
+    /* A sector whose copy or erase was interrupted has no header, or an
+     * older one */
+    for (sector = SETTINGS_FLASH_ADDR; sector < SETTINGS_FLASH_ADDR + SETTINGS_FLASH_SIZE;
+         sector += SETTINGS_SECTOR_SIZE)
+    {
+        record = (const uint32_t *)sector;
+        if (record[0] == Settings_Check(SETTINGS_HEADER_KEY, record[1]) &&
+            (settings_env.sector == 0 || (int32_t)(record[1] - settings_env.generation) > 0))
+        {
+            settings_env.sector = sector;
+            settings_env.generation = record[1];
+        }
+    }
+    if (settings_env.sector == 0)
+    {
+        /* Nothing stored yet: the first write sets up a sector */
+        return;
+    }
+
+    /* Records are appended, so the first erased word pair ends the list.
+     * Records with a bad check (e.g. write interrupted by a reset) are
+     * skipped. */
+    for (settings_env.next = settings_env.sector + SETTINGS_RECORD_SIZE;
+         settings_env.next < settings_env.sector + SETTINGS_SECTOR_SIZE;
+         settings_env.next += SETTINGS_RECORD_SIZE)
+    {
+        record = (const uint32_t *)settings_env.next;
+        if (record[0] == 0xFFFFFFFF && record[1] == 0xFFFFFFFF)
+        {
+            break;
+        }
+
+        key = (record[0] >> 16) & 0xFF;
+        if (key < SETTINGS_KEY_MAX && record[0] == Settings_Check(key, record[1]))
+        {
+            settings_env.value[key] = record[1];
+            settings_env.valid[key] = true;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t Settings_Read(settings_key_t key,
+ *                                        uint32_t default_value)
+ * ----------------------------------------------------------------------------
+ * Description   : Get the stored value of a setting
+ * Inputs        : - key           - Setting key
+ *                 - default_value - Value returned if the setting has never
+ *                                   been stored
+ * Outputs       : return value    - Setting value
+ * Assumptions   : Settings_Init has been called
+ * ------------------------------------------------------------------------- */
+uint32_t Settings_Read(settings_key_t key, uint32_t default_value)
+{
+    if (key >= SETTINGS_KEY_MAX || !settings_env.valid[key])
+    {
+        return default_value;
+    }
+    return settings_env.value[key];
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool Settings_Write(settings_key_t key, uint32_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Store the value of a setting. Nothing is programmed if the
+ *                 value is already stored.
+ * Inputs        : - key        - Setting key
+ *                 - value      - Setting value
+ * Outputs       : return value - true if the value is stored in the flash
+ * Assumptions   : Settings_Init has been called
+ * ------------------------------------------------------------------------- */
+bool Settings_Write(settings_key_t key, uint32_t value)
+{
+    if (key >= SETTINGS_KEY_MAX)
+    {
+        return false;
+    }
+    if (settings_env.valid[key] && settings_env.value[key] == value)
+    {
+        return true;
+    }
+
+    settings_env.value[key] = value;
+    settings_env.valid[key] = true;
+
+    /* Sector full (or none yet): keep only the current values, in the
+     * other sector */
+    if (settings_env.sector == 0 || settings_env.next >= settings_env.sector + SETTINGS_SECTOR_SIZE)
+    {
+        return Settings_Compact();
+    }
+    return Settings_Append(key, value);
+}
@@ -0,0 +1,436 @@
+/* ----------------------------------------------------------------------------
+ * spiflash.c
+ * - Driver of the external SPI NOR flash. See spiflash.h.
+ * - The start functions and the completion run with the interrupts masked or
+ *   from the DMA and timer interrupts, which have to use the same priority.
+ * - Known limitations:
+ *   > A program must not cross a page boundary (the flash wraps to the start
+ *     of the page).
+ *   > The flash isn't put in deep power-down between operations.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct spiflash_env_tag spiflash_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint8_t SPIFlash_Transfer(uint8_t data)
+ * ----------------------------------------------------------------------------
+ * Description   : Send and receive one byte with the CPU
+ * Inputs        : - data       - Byte sent
+ * Outputs       : return value - Byte received
+ * Assumptions   : SPI0 is controlled by the CPU in manual mode
+ * ------------------------------------------------------------------------- */
+static uint8_t SPIFlash_Transfer(uint8_t data)
+{
+    SPI0->TX_DATA = data;
+    Sys_SPI_TransferConfig(0, SPI0_START | SPI0_CS_1 | SPI0_READ_WRITE_DATA | SPI0_WORD_SIZE_8);
+    while (SPI0_CTRL1->START_BUSY_ALIAS == SPI0_BUSY_BITBAND);
+    return (uint8_t)SPI0->RX_DATA;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_Command(uint8_t command, uint32_t addr,
+ *                                              bool with_addr)
+ * ----------------------------------------------------------------------------
+ * Description   : Select the flash and send a command, with its address if
+ *                 needed. The flash stays selected.
+ * Inputs        : - command    - Command
+ *                 - addr       - Address (24 bits)
+ *                 - with_addr  - true to send the address
+ * Outputs       : None
+ * Assumptions   : SPI0 is controlled by the CPU in manual mode
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_Command(uint8_t command, uint32_t addr, bool with_addr)
+{
+    Sys_GPIO_Set_Low(SPI_CS_DIO_NUM);
+    SPIFlash_Transfer(command);
+    if (with_addr)
+    {
+        SPIFlash_Transfer((uint8_t)(addr >> 16));
+        SPIFlash_Transfer((uint8_t)(addr >> 8));
+        SPIFlash_Transfer((uint8_t)addr);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_Deselect(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Wait for the end of the current byte, give SPI0 back to
+ *                 the CPU in manual mode and deselect the flash
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_Deselect(void)
+{
+    while (SPI0_CTRL1->START_BUSY_ALIAS == SPI0_BUSY_BITBAND);
+    Sys_SPI_Config(0, SPI0_SELECT_MASTER | SPI0_ENABLE | SPI0_CLK_POLARITY_NORMAL |
+                      SPI0_CONTROLLER_CM3 | SPI0_MODE_SELECT_MANUAL | SPIFLASH_SPI_PRESCALE);
+    Sys_GPIO_Set_High(SPI_CS_DIO_NUM);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_Write_Enable(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Send the write enable command, needed before each program
+ *                 or erase
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : SPI0 is controlled by the CPU in manual mode
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_Write_Enable(void)
+{
+    SPIFlash_Command(SPIFLASH_CMD_WRITE_ENABLE, 0, false);
+    SPIFlash_Deselect();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static bool SPIFlash_Start(uint8_t op,
+ *                                            spiflash_callback_t callback,
+ *                                            void *context)
+ * ----------------------------------------------------------------------------
+ * Description   : Reserve the flash for an operation
+ * Inputs        : - op         - Operation (spiflash_op_t)
+ *                 - callback   - Completion callback
+ *                 - context    - Callback context
+ * Outputs       : return value - false if the flash is absent or busy
+ * Assumptions   : Called with the interrupts masked
+ * ------------------------------------------------------------------------- */
+static bool SPIFlash_Start(uint8_t op, spiflash_callback_t callback, void *context)
+{
+    if (!spiflash_env.present || spiflash_env.op != SPIFLASH_OP_IDLE)
+    {
+        return false;
+    }
+    spiflash_env.op = op;
+    spiflash_env.callback = callback;
+    spiflash_env.context = context;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_Complete(bool result)
+ * ----------------------------------------------------------------------------
+ * Description   : Release the flash and call the callback of the operation
+ * Inputs        : - result     - Operation result
+ * Outputs       : None
+ * Assumptions   : Called from the DMA or timer interrupt
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_Complete(bool result)
+{
+    spiflash_callback_t callback = spiflash_env.callback;
+
+    if (!result)
+    {
+        spiflash_env.errors++;
+    }
+    spiflash_env.op = SPIFLASH_OP_IDLE;
+    if (callback != NULL)
+    {
+        callback(spiflash_env.context, result);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_Poll_Start(uint16_t poll,
+ *                                                 uint16_t timeout)
+ * ----------------------------------------------------------------------------
+ * Description   : Start polling the status register of a program or erase
+ * Inputs        : - poll       - Poll period (timer ticks)
+ *                 - timeout    - Deadline (timer ticks)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_Poll_Start(uint16_t poll, uint16_t timeout)
+{
+    spiflash_env.poll_ticks = poll;
+    spiflash_env.ticks_left = timeout;
+    Sys_Timers_Stop(SPIFLASH_TIMER_SELECT);
+    Sys_Timer_Set_Control(SPIFLASH_TIMER, TIMER_SHOT_MODE | TIMER_SLOWCLK_DIV2 |
+                                          TIMER_PRESCALE_32 | poll);
+    Sys_Timers_Start(SPIFLASH_TIMER_SELECT);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void SPIFlash_DMA_Start(bool write, uint8_t *data,
+ *                                                uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Hand SPI0 to the DMA channel to move the data of a read or
+ *                 program, SPIFLASH_DMA_IRQHandler is called at the end
+ * Inputs        : - write      - true to send the data, false to receive it
+ *                 - data       - Data buffer
+ *                 - length     - Number of bytes (> 0)
+ * Outputs       : None
+ * Assumptions   : The command has been sent, the flash is selected
+ * ------------------------------------------------------------------------- */
+static void SPIFlash_DMA_Start(bool write, uint8_t *data, uint16_t length)
+{
+    Sys_DMA_ClearChannelStatus(SPIFLASH_DMA_CHANNEL);
+    if (write)
+    {
+        Sys_DMA_ChannelConfig(SPIFLASH_DMA_CHANNEL,
+                              DMA_ENABLE | DMA_ADDR_LIN | DMA_TRANSFER_M_TO_P |
+                              DMA_PRIORITY_0 | DMA_DISABLE_INT_DISABLE |
+                              DMA_ERROR_INT_DISABLE | DMA_COMPLETE_INT_ENABLE |
+                              DMA_COUNTER_INT_DISABLE | DMA_START_INT_DISABLE |
+                              DMA_LITTLE_ENDIAN | DMA_SRC_ADDR_INC |
+                              DMA_DEST_ADDR_STATIC | DMA_DEST_SPI0 |
+                              WORD_SIZE_8BITS_TO_8BITS,
+                              length, 0, (uint32_t)data, (uint32_t)&SPI0->TX_DATA);
+        Sys_SPI_Config(0, SPI0_SELECT_MASTER | SPI0_ENABLE | SPI0_CLK_POLARITY_NORMAL |
+                          SPI0_CONTROLLER_DMA | SPI0_MODE_SELECT_AUTO | SPIFLASH_SPI_PRESCALE);
+        Sys_SPI_TransferConfig(0, SPI0_IDLE | SPI0_CS_1 | SPI0_WRITE_DATA | SPI0_WORD_SIZE_8);
+    }
+    else
+    {
+        Sys_DMA_ChannelConfig(SPIFLASH_DMA_CHANNEL,
+                              DMA_ENABLE | DMA_ADDR_LIN | DMA_TRANSFER_P_TO_M |
+                              DMA_PRIORITY_0 | DMA_DISABLE_INT_DISABLE |
+                              DMA_ERROR_INT_DISABLE | DMA_COMPLETE_INT_ENABLE |
+                              DMA_COUNTER_INT_DISABLE | DMA_START_INT_DISABLE |
+                              DMA_LITTLE_ENDIAN | DMA_SRC_ADDR_STATIC |
+                              DMA_DEST_ADDR_INC | DMA_SRC_SPI0 |
+                              WORD_SIZE_8BITS_TO_8BITS,
+                              length, 0, (uint32_t)&SPI0->RX_DATA, (uint32_t)data);
+        Sys_SPI_Config(0, SPI0_SELECT_MASTER | SPI0_ENABLE | SPI0_CLK_POLARITY_NORMAL |
+                          SPI0_CONTROLLER_DMA | SPI0_MODE_SELECT_AUTO | SPIFLASH_SPI_PRESCALE);
+        Sys_SPI_TransferConfig(0, SPI0_START | SPI0_CS_1 | SPI0_READ_DATA | SPI0_WORD_SIZE_8);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void SPIFlash_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Configure SPI0 as master, wake the flash up from deep
+ *                 power-down and read its JEDEC ID
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : The SPI0 DIOs are configured on the application level, the
+ *                 chip select DIO as a GPIO output
+ * ------------------------------------------------------------------------- */
+void SPIFlash_Init(void)
+{
+    uint8_t i;
+
+    memset(&spiflash_env, 0, sizeof(spiflash_env));
+
+    Sys_DMA_ChannelDisable(SPIFLASH_DMA_CHANNEL);
+    Sys_Timers_Stop(SPIFLASH_TIMER_SELECT);
+    Sys_GPIO_Set_High(SPI_CS_DIO_NUM);
+    SPIFlash_Deselect();
+
+    /* Release from deep power-down (tRES1 up to 35 us) */
+    SPIFlash_Command(SPIFLASH_CMD_RELEASE_PD, 0, false);
+    SPIFlash_Deselect();
+    Sys_Delay_ProgramROM(SystemCoreClock / 25000);
+
+    SPIFlash_Command(SPIFLASH_CMD_READ_ID, 0, false);
+    for (i = 0; i < 3; i++)
+    {
+        spiflash_env.id = (spiflash_env.id << 8) | SPIFlash_Transfer(0xFF);
+    }
+    SPIFlash_Deselect();
+    spiflash_env.present = (spiflash_env.id != 0 && spiflash_env.id != 0xFFFFFF);
+
+    NVIC_EnableIRQ(SPIFLASH_DMA_IRQn);
+    NVIC_EnableIRQ(SPIFLASH_TIMER_IRQn);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool SPIFlash_Idle(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Indicate if no operation is in progress
+ * Inputs        : None
+ * Outputs       : return value - true if idle
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool SPIFlash_Idle(void)
+{
+    return (spiflash_env.op == SPIFLASH_OP_IDLE);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void SPIFlash_Read_Wait(uint32_t addr, uint8_t *data,
+ *                                         uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Read with the CPU, waiting for the end of the read
+ * Inputs        : - addr       - Flash address
+ *                 - data       - Destination
+ *                 - length     - Number of bytes
+ * Outputs       : None
+ * Assumptions   : No operation in progress (start-up)
+ * ------------------------------------------------------------------------- */
+void SPIFlash_Read_Wait(uint32_t addr, uint8_t *data, uint16_t length)
+{
+    SPIFlash_Command(SPIFLASH_CMD_READ, addr, true);
+    while (length--)
+    {
+        *data++ = SPIFlash_Transfer(0xFF);
+    }
+    SPIFlash_Deselect();
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool SPIFlash_Read(uint32_t addr, uint8_t *data,
+ *                                    uint16_t length,
+ *                                    spiflash_callback_t callback,
+ *                                    void *context)
+ * ----------------------------------------------------------------------------
+ * Description   : Start a read, the data is moved by the DMA channel
+ * Inputs        : - addr       - Flash address
+ *                 - data       - Destination, valid until the callback
+ *                 - length     - Number of bytes (> 0)
+ *                 - callback   - Completion callback
+ *                 - context    - Callback context
+ * Outputs       : return value - false if the read couldn't be started
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool SPIFlash_Read(uint32_t addr, uint8_t *data, uint16_t length,
+                   spiflash_callback_t callback, void *context)
+{
+    uint32_t primask;
+    bool result;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    result = SPIFlash_Start(SPIFLASH_OP_READ, callback, context);
+    if (result)
+    {
+        SPIFlash_Command(SPIFLASH_CMD_READ, addr, true);
+        SPIFlash_DMA_Start(false, data, length);
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool SPIFlash_Program(uint32_t addr, const uint8_t *data,
+ *                                       uint16_t length,
+ *                                       spiflash_callback_t callback,
+ *                                       void *context)
+ * ----------------------------------------------------------------------------
+ * Description   : Start programming bytes of a page, the data is moved by the
+ *                 DMA channel, then the end of the write is polled
+ * Inputs        : - addr       - Flash address
+ *                 - data       - Data, valid until the callback
+ *                 - length     - Number of bytes (> 0)
+ *                 - callback   - Completion callback
+ *                 - context    - Callback context
+ * Outputs       : return value - false if the program couldn't be started
+ * Assumptions   : The bytes are erased and within one page
+ * ------------------------------------------------------------------------- */
+bool SPIFlash_Program(uint32_t addr, const uint8_t *data, uint16_t length,
+                      spiflash_callback_t callback, void *context)
+{
+    uint32_t primask;
+    bool result;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    result = SPIFlash_Start(SPIFLASH_OP_PROGRAM, callback, context);
+    if (result)
+    {
+        SPIFlash_Write_Enable();
+        SPIFlash_Command(SPIFLASH_CMD_PROGRAM, addr, true);
+        SPIFlash_DMA_Start(true, (uint8_t *)data, length);
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool SPIFlash_Erase(uint32_t addr,
+ *                                     spiflash_callback_t callback,
+ *                                     void *context)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the erase of a sector, then poll the end of the erase
+ * Inputs        : - addr       - Address in the sector
+ *                 - callback   - Completion callback
+ *                 - context    - Callback context
+ * Outputs       : return value - false if the erase couldn't be started
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool SPIFlash_Erase(uint32_t addr, spiflash_callback_t callback, void *context)
+{
+    uint32_t primask;
+    bool result;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    result = SPIFlash_Start(SPIFLASH_OP_ERASE, callback, context);
+    if (result)
+    {
+        SPIFlash_Write_Enable();
+        SPIFlash_Command(SPIFLASH_CMD_ERASE_SECTOR, addr, true);
+        SPIFlash_Deselect();
+        SPIFlash_Poll_Start(SPIFLASH_ERASE_POLL_TICKS, SPIFLASH_ERASE_TIMEOUT_TICKS);
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void SPIFLASH_DMA_IRQHandler(void)
+ * ----------------------------------------------------------------------------
+ * Description   : DMA interrupt service function, called once the data of a
+ *                 read or program has been moved. Deselects the flash; a
+ *                 read is completed, the end of a program is polled.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void SPIFLASH_DMA_IRQHandler(void)
+{
+    Sys_DMA_ClearChannelStatus(SPIFLASH_DMA_CHANNEL);
+    Sys_DMA_ChannelDisable(SPIFLASH_DMA_CHANNEL);
+    SPIFlash_Deselect();
+
+    if (spiflash_env.op == SPIFLASH_OP_READ)
+    {
+        SPIFlash_Complete(true);
+    }
+    else if (spiflash_env.op == SPIFLASH_OP_PROGRAM)
+    {
+        SPIFlash_Poll_Start(SPIFLASH_PROGRAM_POLL_TICKS, SPIFLASH_PROGRAM_TIMEOUT_TICKS);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void SPIFLASH_TIMER_IRQHandler(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Timer interrupt service function. Reads the status
+ *                 register: the program or erase is completed once the flash
+ *                 isn't busy anymore, failed once its deadline has passed.
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : Runs at the same priority as SPIFLASH_DMA_IRQHandler
+ * ------------------------------------------------------------------------- */
+void SPIFLASH_TIMER_IRQHandler(void)
+{
+    uint8_t status;
+
+    if (spiflash_env.op != SPIFLASH_OP_PROGRAM && spiflash_env.op != SPIFLASH_OP_ERASE)
+    {
+        return;
+    }
+
+    SPIFlash_Command(SPIFLASH_CMD_READ_STATUS, 0, false);
+    status = SPIFlash_Transfer(0xFF);
+    SPIFlash_Deselect();
+
+    if (!(status & SPIFLASH_STATUS_WIP))
+    {
+        SPIFlash_Complete(true);
+    }
+    else if (spiflash_env.ticks_left <= spiflash_env.poll_ticks)
+    {
+        SPIFlash_Complete(false);
+    }
+    else
+    {
+        SPIFlash_Poll_Start(spiflash_env.poll_ticks,
+                            spiflash_env.ticks_left - spiflash_env.poll_ticks);
+    }
+}
@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------------
+ * stats.c
+ * - Running statistics of the sensors, see stats.h.
+ * - Stats_Add is called by the sampler from the interrupt handlers, next to
+ *   History_Add; the characteristic is read and reset from the BLE message
+ *   handlers with the interrupts masked.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct stats_env_tag stats_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Stats_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Clear the statistics of all sensors
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Stats_Init(void)
+{
+    memset(&stats_env, 0, sizeof(stats_env));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Stats_Add(uint8_t sensor, int16_t value)
+ * ----------------------------------------------------------------------------
+ * Description   : Add a sample to the statistics of its sensor
+ * Inputs        : - sensor     - Sensor index (sampler registration order)
+ *                 - value      - Sample value
+ * Outputs       : None
+ * Assumptions   : Called from the sampler interrupt handlers only
+ * ------------------------------------------------------------------------- */
+void Stats_Add(uint8_t sensor, int16_t value)
+{
+    struct stats_sensor_tag *stats;
+    int64_t x = (int64_t)value * ((int64_t)1 << STATS_MEAN_SHIFT);
+    int64_t delta;
+    int64_t term;
+
+    if (sensor >= SENSOR_MAX)
+    {
+        return;
+    }
+    stats = &stats_env.sensor[sensor];
+    if (stats->count == UINT32_MAX)
+    {
+        return;
+    }
+
+    if (stats->count == 0)
+    {
+        stats->min = value;
+        stats->max = value;
+    }
+    stats->count++;
+    stats->min = MIN(stats->min, value);
+    stats->max = MAX(stats->max, value);
+
+    /* Both differences in 1/2^8 of the unit for the product, so it stays
+     * below 2^50 */
+    delta = x - stats->mean;
+    stats->mean += delta / (int64_t)stats->count;
+    term = (delta / (1 << 24)) * ((x - stats->mean) / (1 << 24));
+    stats->m2 = (term > INT64_MAX - stats->m2) ? INT64_MAX : stats->m2 + term;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Stats_Reset(uint8_t mask)
+ * ----------------------------------------------------------------------------
+ * Description   : Clear the statistics of some sensors
+ * Inputs        : - mask       - Sensors to clear (bit i for sensor i)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Stats_Reset(uint8_t mask)
+{
+    uint32_t primask;
+    uint8_t sensor;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    for (sensor = 0; sensor < SENSOR_MAX; sensor++)
+    {
+        if (mask & (1 << sensor))
+        {
+            memset(&stats_env.sensor[sensor], 0, sizeof(stats_env.sensor[sensor]));
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void Stats_Value(uint8_t *value)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the STATISTICS characteristic value
+ * Inputs        : - value      - Value buffer (STATS_SIZE bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void Stats_Value(uint8_t *value)
+{
+    struct stats_sensor_tag stats;
+    uint32_t primask;
+    uint32_t variance;
+    int64_t m2;
+    int32_t mean;
+    uint8_t sensor;
+
+    for (sensor = 0; sensor < SENSOR_MAX; sensor++, value += STATS_ENTRY_SIZE)
+    {
+        primask = __get_PRIMASK();
+        __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+        stats = stats_env.sensor[sensor];
+        __set_PRIMASK(primask);
+
+        /* Rounded to 1/256 of the unit, sample variance (n - 1) */
+        mean = (int32_t)((stats.mean + ((int64_t)1 << (STATS_MEAN_SHIFT - 9))) >>
+                         (STATS_MEAN_SHIFT - 8));
+        variance = 0;
+        if (stats.count > 1 && stats.m2 > 0)
+        {
+            m2 = (stats.m2 / (stats.count - 1)) >> STATS_M2_SHIFT;
+            variance = (uint32_t)MIN(m2, UINT32_MAX);
+        }
+
+        memcpy(&value[0], &stats.count, sizeof(stats.count));
+        memcpy(&value[4], &stats.min, sizeof(stats.min));
+        memcpy(&value[6], &stats.max, sizeof(stats.max));
+        memcpy(&value[8], &mean, sizeof(mean));
+        memcpy(&value[12], &variance, sizeof(variance));
+    }
+}
@@ -0,0 +1,313 @@
+/* ----------------------------------------------------------------------------
+ * timebase.c
+ * - Device time base and wall clock, see timebase.h.
+ * - The tick is read from the interrupt handlers (history timestamps) and
+ *   the BLE message handlers, always with the interrupts masked; the sync
+ *   runs from the BLE message handlers.
+ * ------------------------------------------------------------------------- */
+
+#include "app.h"
+
+/* Global variable definition */
+struct timebase_env_tag timebase_env;
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint64_t TimeBase_Now(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Extend the RTC tick to the ticks since reset
+ * Inputs        : None
+ * Outputs       : return value - Ticks since reset
+ * Assumptions   : Called with the interrupts masked, at least once per RTC
+ *                 period
+ * ------------------------------------------------------------------------- */
+static uint64_t TimeBase_Now(void)
+{
+    uint32_t tick = ~Sys_RTC_Value();
+
+    timebase_env.ticks += (uint32_t)(tick - timebase_env.last);
+    timebase_env.last = tick;
+    return timebase_env.ticks;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint64_t TimeBase_Project(uint64_t ticks,
+ *                                                  uint64_t base,
+ *                                                  uint64_t base_wall)
+ * ----------------------------------------------------------------------------
+ * Description   : Wall time of a tick, from a sync and the rate error
+ * Inputs        : - ticks      - Ticks since reset, at or after base
+ *                 - base       - Ticks since reset at the sync
+ *                 - base_wall  - Wall time at the sync (ticks since 1970)
+ * Outputs       : return value - Wall time (ticks since 1970)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint64_t TimeBase_Project(uint64_t ticks, uint64_t base, uint64_t base_wall)
+{
+    int64_t elapsed = (int64_t)(ticks - base);
+    int64_t correction;
+
+    /* elapsed * drift / 2^32, in two parts to stay in range */
+    correction = (((elapsed >> 16) * timebase_env.drift) >> 16) +
+                 (((elapsed & 0xFFFF) * timebase_env.drift) >> 32);
+    return base_wall + elapsed + correction;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static uint32_t TimeBase_Days(uint16_t year, uint8_t month,
+ *                                              uint8_t day)
+ * ----------------------------------------------------------------------------
+ * Description   : Days since 1970-01-01 of a date of the Gregorian calendar
+ * Inputs        : - year       - Year, from TIMEBASE_YEAR_MIN
+ *                 - month      - Month (1 to 12)
+ *                 - day        - Day of the month (1 to 31)
+ * Outputs       : return value - Days since 1970-01-01
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static uint32_t TimeBase_Days(uint16_t year, uint8_t month, uint8_t day)
+{
+    /* Years starting in March, so the leap day is the last one */
+    uint32_t y = year - (month <= 2);
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : static void TimeBase_Date(uint32_t days, uint8_t *time)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the date fields of the Current Time characteristic
+ * Inputs        : - days       - Days since 1970-01-01
+ *                 - time       - Current Time value (year, month, day)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+static void TimeBase_Date(uint32_t days, uint8_t *time)
+{
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint8_t month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    uint16_t year = (uint16_t)(yoe + era * 400 + (month <= 2));
+
+    memcpy(&time[0], &year, sizeof(year));
+    time[2] = month;
+    time[3] = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void TimeBase_Init(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Start the RTC, the tick counts from 0 and the wall time is
+ *                 unknown
+ * Inputs        : None
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void TimeBase_Init(void)
+{
+    memset(&timebase_env, 0, sizeof(timebase_env));
+    Sys_RTC_Config(TIMEBASE_RTC_START, TIMEBASE_RTC_CFG);
+    timebase_env.last = ~TIMEBASE_RTC_START;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t TimeBase_Ticks(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Monotonic 32-bit tick
+ * Inputs        : None
+ * Outputs       : return value - Ticks since reset modulo 2^32
+ *                                (TIMEBASE_TICK_HZ)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t TimeBase_Ticks(void)
+{
+    uint32_t primask;
+    uint32_t ticks;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    ticks = (uint32_t)TimeBase_Now();
+    __set_PRIMASK(primask);
+    return ticks;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : uint32_t TimeBase_Seconds(void)
+ * ----------------------------------------------------------------------------
+ * Description   : Seconds since reset
+ * Inputs        : None
+ * Outputs       : return value - Seconds since reset
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+uint32_t TimeBase_Seconds(void)
+{
+    uint32_t primask;
+    uint32_t seconds;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    seconds = (uint32_t)(TimeBase_Now() >> TIMEBASE_TICK_SHIFT);
+    __set_PRIMASK(primask);
+    return seconds;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : bool TimeBase_Sync(const uint8_t *time, uint16_t length)
+ * ----------------------------------------------------------------------------
+ * Description   : Anchor the wall clock to a Current Time value written by
+ *                 the central, and update the rate error if the drift
+ *                 reference is old enough
+ * Inputs        : - time       - Current Time value (at least the date and
+ *                                time)
+ *                 - length     - Value length (in bytes)
+ * Outputs       : return value - false if the value is invalid (discarded)
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+bool TimeBase_Sync(const uint8_t *time, uint16_t length)
+{
+    uint16_t year;
+    uint8_t fraction = 0;
+    uint8_t reason = 0;
+    uint64_t wall;
+    uint64_t now;
+    uint64_t interval;
+    int64_t error;
+    int64_t drift;
+    uint32_t primask;
+
+    if (length < TIMEBASE_CTS_DATE_SIZE)
+    {
+        return false;
+    }
+    memcpy(&year, &time[0], sizeof(year));
+    if (year < TIMEBASE_YEAR_MIN || year > TIMEBASE_YEAR_MAX ||
+        time[2] < 1 || time[2] > 12 || time[3] < 1 || time[3] > 31 ||
+        time[4] > 23 || time[5] > 59 || time[6] > 59)
+    {
+        return false;
+    }
+    if (length >= TIMEBASE_CTS_SIZE)
+    {
+        fraction = time[8];
+        reason = time[9];
+    }
+    wall = (((uint64_t)TimeBase_Days(year, time[2], time[3]) * 86400 +
+             time[4] * 3600UL + time[5] * 60UL + time[6]) << TIMEBASE_TICK_SHIFT) +
+           ((uint64_t)fraction << (TIMEBASE_TICK_SHIFT - 8));
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    now = TimeBase_Now();
+    interval = now - timebase_env.reference;
+    if (timebase_env.synced &&
+        !(reason & (TIMEBASE_ADJUST_MANUAL | TIMEBASE_ADJUST_TIME_ZONE | TIMEBASE_ADJUST_DST)))
+    {
+        error = (int64_t)(wall - TimeBase_Project(now, timebase_env.reference,
+                                                  timebase_env.reference_wall));
+        if (error > (int64_t)(interval / 16 + TIMEBASE_JUMP_MIN) ||
+            -error > (int64_t)(interval / 16 + TIMEBASE_JUMP_MIN))
+        {
+            /* Time jump: new drift reference */
+            timebase_env.reference = now;
+            timebase_env.reference_wall = wall;
+        }
+        else if (interval >= TIMEBASE_DRIFT_INTERVAL)
+        {
+            drift = timebase_env.drift + error * 65536 / (int64_t)(interval >> 16);
+            timebase_env.drift = (int32_t)MAX(-TIMEBASE_DRIFT_MAX, MIN(TIMEBASE_DRIFT_MAX, drift));
+            timebase_env.reference = now;
+            timebase_env.reference_wall = wall;
+        }
+    }
+    else
+    {
+        timebase_env.reference = now;
+        timebase_env.reference_wall = wall;
+    }
+    timebase_env.anchor = now;
+    timebase_env.anchor_wall = wall;
+    timebase_env.synced = true;
+    timebase_env.syncs++;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void TimeBase_Current_Time(uint8_t *time)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the Current Time value with the wall time
+ * Inputs        : - time       - Current Time value (TIMEBASE_CTS_SIZE
+ *                                bytes), all zero if the time is unknown
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void TimeBase_Current_Time(uint8_t *time)
+{
+    uint64_t wall;
+    uint32_t seconds;
+    uint32_t days;
+    uint32_t primask;
+
+    memset(time, 0, TIMEBASE_CTS_SIZE);
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    wall = TimeBase_Project(TimeBase_Now(), timebase_env.anchor, timebase_env.anchor_wall);
+    __set_PRIMASK(primask);
+    if (!timebase_env.synced)
+    {
+        return;
+    }
+
+    seconds = (uint32_t)(wall >> TIMEBASE_TICK_SHIFT);
+    days = seconds / 86400;
+    seconds %= 86400;
+    TimeBase_Date(days, time);
+    time[4] = (uint8_t)(seconds / 3600);
+    time[5] = (uint8_t)(seconds / 60 % 60);
+    time[6] = (uint8_t)(seconds % 60);
+    time[7] = (uint8_t)((days + 3) % 7 + 1);
+    time[8] = (uint8_t)(wall >> (TIMEBASE_TICK_SHIFT - 8));
+}
+
+/* ----------------------------------------------------------------------------
+ * Function      : void TimeBase_Status(uint8_t *status)
+ * ----------------------------------------------------------------------------
+ * Description   : Fill the TIME BASE characteristic value
+ * Inputs        : - status     - Status buffer (TIMEBASE_STATUS_SIZE bytes)
+ * Outputs       : None
+ * Assumptions   : None
+ * ------------------------------------------------------------------------- */
+void TimeBase_Status(uint8_t *status)
+{
+    uint64_t now;
+    uint32_t seconds;
+    uint32_t ticks;
+    uint32_t wall = 0;
+    int32_t drift;
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __set_PRIMASK(PRIMASK_DISABLE_INTERRUPTS);
+    now = TimeBase_Now();
+    if (timebase_env.synced)
+    {
+        wall = (uint32_t)(TimeBase_Project(now, timebase_env.anchor, timebase_env.anchor_wall) >>
+                          TIMEBASE_TICK_SHIFT);
+    }
+    __set_PRIMASK(primask);
+
+    seconds = (uint32_t)(now >> TIMEBASE_TICK_SHIFT);
+    ticks = (uint32_t)now;
+    drift = (int32_t)(((int64_t)timebase_env.drift * 1000000000) >> 32);
+    memcpy(&status[0], &seconds, sizeof(seconds));
+    memcpy(&status[4], &ticks, sizeof(ticks));
+    memcpy(&status[8], &wall, sizeof(wall));
+    memcpy(&status[12], &drift, sizeof(drift));
+    memcpy(&status[16], &timebase_env.syncs, sizeof(timebase_env.syncs));
+}
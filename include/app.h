@@ -54,7 +54,20 @@ extern "C"
 #include "ble_reak.h"
 #include "ble_std.h"
 #include "app_ble.h"
+#include "sensor.h"
+#include "filter.h"
 #include "nct375.h"
+#include "sampler.h"
+#include "notify.h"
+#include "settings.h"
+#include "timebase.h"
+#include "history.h"
+#include "rollup.h"
+#include "racp.h"
+#include "stats.h"
+#include "flashlog.h"
+#include "spiflash.h"
+#include "archive.h"
 
 /* ----------------------------------------------------------------------------
  * Defines
@@ -67,11 +80,17 @@ extern "C"
 /* DIO number that is connected to LED of EVB */
 #define LED_DIO_NUM                     6
 
-/* DIO used for the I2C interface to interface the SI7042 sensor */
+/* DIO used for the I2C interface to interface the sensors */
 #define I2C_SDA_DIO_NUM                 12 /* 0 */
 #define I2C_SCL_DIO_NUM                 11 /* 1 */
 #define I2C_GND_DIO_NUM                 10 /* 2 */
 #define I2C_PWR_DIO_NUM                 8  /* 4 */
+#define NCT375_ALERT_DIO_NUM            5
+
+/* Pad configuration of the I2C bus and of the ALERT input while the sensors
+ * are supplied */
+#define I2C_DIO_CFG                     (DIO_6X_DRIVE | DIO_LPF_ENABLE | DIO_STRONG_PULL_UP)
+#define NCT375_ALERT_DIO_CFG            (DIO_MODE_INPUT | DIO_WEAK_PULL_UP | DIO_LPF_DISABLE)
 
 #define UART_CFG_SYS_CLK                SystemCoreClock
 #define UART_BAUD_RATE                  115200
@@ -83,14 +102,24 @@ extern "C"
 #define SPI_CS_DIO_NUM                  4
 #define SPI_MISO_DIO_NUM                7
 
+/* UART command characters */
+#define UART_CMD_I2C_STATS              's'
 
-/* NCT375 I2C commands */
-#define NCT375_CMD_GET_TEMPERATURE					(uint8_t[]){0x00}
-#define NCT375_CMD_GET_TEMPERATURE_ONE_SHOT			(uint8_t[]){0x04}
 
-/* Temperature change notification thresholds, min value = xx */
+/* Default deadband of the temperature notifications, in 0.01 degC */
 #define NOTIF_THRES_TEMPERATURE  1
 
+/* Alert limits stored as one setting: THYST in the low, TOS in the high half */
+#define ALERT_LIMITS_PACK(thyst, tos)   (((uint32_t)(uint16_t)(tos) << 16) | (uint16_t)(thyst))
+#define ALERT_LIMITS_THYST(value)       ((int16_t)((value) & 0xFFFF))
+#define ALERT_LIMITS_TOS(value)         ((int16_t)((value) >> 16))
+
+/* Adaptive rate stored as one setting: maximum period in the low, rate
+ * threshold in the high half */
+#define ADAPTIVE_RATE_PACK(period, threshold) (((uint32_t)(threshold) << 16) | (uint16_t)(period))
+#define ADAPTIVE_RATE_PERIOD(value)     ((uint16_t)((value) & 0xFFFF))
+#define ADAPTIVE_RATE_THRESHOLD(value)  ((uint16_t)((value) >> 16))
+
 /* Set timer to 1000 ms (100 times the 10 ms kernel timer resolution) */
 #define TIMER_1S_SETTING                100
 
@@ -108,14 +137,15 @@ struct app_env_tag
 	/* Indication to update the exposed BLE data */
 	bool update_ble_data;
 
-	/* SI7042 firmware revision code */
-	//uint8_t si7042_firmware_rev_code;
-
 	/* Temperature value and CCCD */
 	int16_t temperature;
     uint16_t temperature_cccd_value;
     //float temperature2;
 
+    /* Temperatures of all sensors (NCT375_TEMP_INVALID if not present) and CCCD */
+    int16_t temperature_all[NCT375_MAX_DEVICES];
+    uint16_t temperature_all_cccd;
+
     /* Timeout value (in seconds) and CCCD*/
     int16_t timeout;
     uint16_t timeout_cccd;
@@ -128,11 +158,46 @@ struct app_env_tag
     int8_t pa_power;
     uint16_t pa_power_cccd;
 
-    /* I2C reception buffer */
-    uint8_t i2c_rx_buffer[8];
+    /* Sensor power mode (sampler_mode_t) */
+    uint8_t power_mode;
+
+    /* Alert limits THYST and TOS (0.01 degC) */
+    int16_t alert_limits[2];
+
+    /* Filter parameters: burst length, filter type, coefficient, decimation */
+    struct filter_param_tag filter_param;
+
+    /* Adaptive rate: maximum sample period (s) and rate threshold
+     * (0.01 degC/min) */
+    uint16_t adaptive_rate[2];
+
+    /* Current sample period (ms) and CCCD */
+    uint32_t sample_period;
+    uint16_t sample_period_cccd;
+
+    /* Sample history control point (command written, status read) and CCCD,
+     * download packet and CCCD */
+    uint8_t history_ctrl[HISTORY_CTRL_SIZE];
+    uint16_t history_ctrl_cccd;
+    uint8_t history_data[HISTORY_PACKET_SIZE];
+    uint16_t history_data_cccd;
+
+    /* Record access control point (command written, response notified) and
+     * CCCD */
+    uint8_t racp[RACP_SIZE];
+    uint16_t racp_cccd;
+
+    /* Time base status (read), current time (read, written to sync) */
+    uint8_t time_base[TIMEBASE_STATUS_SIZE];
+    uint8_t current_time[TIMEBASE_CTS_SIZE];
+
+    /* Running statistics of the sensors (read, sensor mask written to
+     * reset) */
+    uint8_t stats[STATS_SIZE];
 
-    /* I2C reception buffer */
-    uint8_t i2c_tx_buffer[8];
+    /* Notification policy of the measured values (read, channel entry
+     * written) */
+    uint8_t notify_policy[NOTIFY_POLICY_SIZE];
 };
 
 extern struct app_env_tag app_env;
@@ -144,9 +209,8 @@ extern void System_Initialize(void);
 extern int APP_Timer(ke_msg_id_t const msg_id, void const *param,
                      ke_task_id_t const dest_id, ke_task_id_t const src_id);
 void App_Env_Initialize(void);
-//void SI7042_Received_FwRevCode(void);
-//void SI7042_Received_Humidity(void);
-void UART_WriteEnvData(void);
+void UART_WriteEnvData(const int16_t *value);
+void UART_WriteI2CStats(void);
 //void LCD_ShowAll(void);
 
 /* ----------------------------------------------------------------------------
@@ -86,6 +86,48 @@ extern "C"
 #define CHAR_PA_PWR_UUID                {0x24,0xdc,0x0e,0x6e,0x04,0x40,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
 #define CHAR_PA_PWR_NAME                "PA POWER"
 
+#define SVC_SENSOR_UUID                 {0x24,0xdc,0x0e,0x6e,0x01,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+
+#define CHAR_TEMP_ALL_UUID              {0x24,0xdc,0x0e,0x6e,0x02,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_TEMP_ALL_NAME              "TEMP ALL"
+
+#define CHAR_POWER_MODE_UUID            {0x24,0xdc,0x0e,0x6e,0x03,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_POWER_MODE_NAME            "POWER MODE"
+
+#define CHAR_ALERT_LIMITS_UUID          {0x24,0xdc,0x0e,0x6e,0x04,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_ALERT_LIMITS_NAME          "ALERT LIMITS"
+
+#define CHAR_FILTER_UUID                {0x24,0xdc,0x0e,0x6e,0x05,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_FILTER_NAME                "FILTER"
+
+#define CHAR_ADAPTIVE_RATE_UUID         {0x24,0xdc,0x0e,0x6e,0x06,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_ADAPTIVE_RATE_NAME         "ADAPTIVE RATE"
+
+#define CHAR_SAMPLE_PERIOD_UUID         {0x24,0xdc,0x0e,0x6e,0x07,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_SAMPLE_PERIOD_NAME         "SAMPLE PERIOD"
+
+#define CHAR_HISTORY_CTRL_UUID          {0x24,0xdc,0x0e,0x6e,0x08,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_HISTORY_CTRL_NAME          "HISTORY CTRL"
+
+#define CHAR_HISTORY_DATA_UUID          {0x24,0xdc,0x0e,0x6e,0x09,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_HISTORY_DATA_NAME          "HISTORY DATA"
+
+#define CHAR_RACP_UUID                  {0x24,0xdc,0x0e,0x6e,0x0A,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_RACP_NAME                  "RACP"
+
+#define CHAR_TIME_BASE_UUID             {0x24,0xdc,0x0e,0x6e,0x0B,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_TIME_BASE_NAME             "TIME BASE"
+
+#define CHAR_STATS_UUID                 {0x24,0xdc,0x0e,0x6e,0x0C,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_STATS_NAME                 "STATISTICS"
+
+#define CHAR_NOTIFY_POLICY_UUID         {0x24,0xdc,0x0e,0x6e,0x0D,0x41,0xca,0x9e,0xe5,0xa9,0xa3,0x00,0xb5,0xf3,0x93,0xe0}
+#define CHAR_NOTIFY_POLICY_NAME         "NOTIFY POLICY"
+
+#define SVC_CTS_UUID                    {0x05,0x18}
+
+#define CHAR_CURRENT_TIME_UUID          {0x2B,0x2A}
+
 #define SVC_ENV_UUID                    {0x1A,0x18}
 
 #define CHAR_TEMP_UUID                  {0x6E,0x2A}
@@ -101,6 +143,18 @@ extern "C"
  * --------------------------------------------------------------------------*/
 uint8_t reak_att_desc_max_idx(void);
 void DataAccess_PaPower(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_PowerMode(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_AlertLimits(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_Filter(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_AdaptiveRate(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_HistoryCtrl(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_RACP(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_TimeBase(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_CurrentTime(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_Stats(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+void DataAccess_NotifyPolicy(void *gattm_data, void *app_data, uint16_t length, uint8_t access);
+int GATTC_CmpEvt(ke_msg_id_t const msg_id, struct gattc_cmp_evt const *param,
+                 ke_task_id_t const dest_id, ke_task_id_t const src_id);
 
 /* ----------------------------------------------------------------------------
  * Close the 'extern "C"' block
@@ -62,7 +62,8 @@ typedef bool (*appm_add_svc_func_t)(void);
 
 /* List of message handlers that are used by the different profiles/services */
 #define APP_MESSAGE_HANDLER_LIST \
-        DEFINE_MESSAGE_HANDLER(APP_TIMER, APP_Timer)
+        DEFINE_MESSAGE_HANDLER(APP_TIMER, APP_Timer),\
+        DEFINE_MESSAGE_HANDLER(GATTC_CMP_EVT, GATTC_CmpEvt)
 
 /* List of functions used to create the database */
 #define SERVICE_ADD_FUNCTION_LIST \
@@ -0,0 +1,146 @@
+/* ----------------------------------------------------------------------------
+ * archive.h
+ * - Sample archive in the external SPI NOR flash (spiflash.h). The encoded
+ *   blocks of the sample history (see history.h) are copied to it as one
+ *   byte stream, so months of samples are kept across resets.
+ * - The stream is cut in pages of ARCHIVE_PAYLOAD_SIZE bytes, one flash page
+ *   each. The page of stream offset x is in the flash page
+ *   (x / ARCHIVE_PAYLOAD_SIZE) % ARCHIVE_PAGES, so a page is found without a
+ *   scan. The pages are written round-robin over the flash; a sector is
+ *   erased when its first page is programmed, the oldest pages are lost then.
+ * - Page layout: header, then the payload.
+ *     header: stream offset of the first payload byte (uint32), offset in the
+ *             payload of the first block starting in the page (uint8,
+ *             ARCHIVE_NO_BLOCK if a block spans the whole page),
+ *             ARCHIVE_PAGE_MAGIC (uint8), CRC-16 of the first 6 bytes
+ *             (uint16)
+ *   The payload is programmed first, the header last: a page with a valid
+ *   header is complete.
+ * - Double-buffered: a full page is programmed from one buffer while the
+ *   next page fills the other one. The history blocks are only copied when
+ *   they fit, so a slow flash delays the copy instead of losing data.
+ * - After a reset the stream continues one page after the newest complete
+ *   page, or after the last page written to if a later page was torn; the
+ *   skipped page is a gap in the stream offsets. The page being filled is
+ *   lost on a reset.
+ * - A client downloads the archive through the HISTORY CTRL control point
+ *   (HISTORY_OP_ARCHIVE), in HISTORY DATA notifications with archive stream
+ *   offsets. The payload is read by DMA straight into the notification
+ *   messages.
+ * - The SPI flash interrupts don't call the kernel: Archive_Resume has to be
+ *   called from the main loop, it sends the notifications read and starts
+ *   the next flash operation.
+ * ------------------------------------------------------------------------- */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "spiflash.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* The whole flash: 4096 pages of 248 bytes, about 1 MB of encoded blocks.
+ * One sensor sampled every 30 s produces about 4 KB a day. */
+#define ARCHIVE_PAGES                   (SPIFLASH_SIZE / SPIFLASH_PAGE_SIZE)
+#define ARCHIVE_SECTOR_PAGES            (SPIFLASH_SECTOR_SIZE / SPIFLASH_PAGE_SIZE)
+#define ARCHIVE_HEADER_SIZE             8
+#define ARCHIVE_PAYLOAD_SIZE            (SPIFLASH_PAGE_SIZE - ARCHIVE_HEADER_SIZE)
+
+#define ARCHIVE_PAGE_MAGIC              0xA5
+#define ARCHIVE_NO_BLOCK                0xFF
+#define ARCHIVE_NO_SECTOR               0xFFFFFFFF
+#define ARCHIVE_NO_PAGE                 0xFFFFFFFF
+
+/* Steps of the programming of a full page */
+typedef enum
+{
+	ARCHIVE_STEP_ERASE,
+	ARCHIVE_STEP_PAYLOAD,
+	ARCHIVE_STEP_HEADER
+} archive_step_t;
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct archive_env_tag
+{
+	/* Page buffers (header and payload): buffer fill is being filled (used
+	 * payload bytes), the other one is programmed while programming is set */
+	uint8_t buffer[2][SPIFLASH_PAGE_SIZE];
+	uint8_t fill;
+	uint16_t used;
+	bool programming;
+
+	/* Stream offsets of the page being filled and of the first page not
+	 * programmed yet (end of the archive), step of the page being
+	 * programmed, last sector erased */
+	uint32_t offset;
+	uint32_t head;
+	uint8_t step;
+	uint32_t erased;
+
+	/* Stream offset of the next history block to copy */
+	uint32_t history_pos;
+
+	/* Download in progress: stream offset of the next byte to send, true if
+	 * the next byte has to be the start of a block, notifications that can
+	 * still be handed to the stack, read in progress and page whose header
+	 * has been checked */
+	bool download;
+	uint32_t next;
+	bool jump;
+	uint8_t credits;
+	bool reading;
+	uint32_t checked;
+	uint8_t header[ARCHIVE_HEADER_SIZE];
+
+	/* Set by the SPI flash interrupts for Archive_Resume: the flash is free
+	 * or a read has completed, the notification message read and the read
+	 * result */
+	volatile bool resume;
+	bool read_done;
+	void *message;
+	bool read_result;
+
+	/* Pages dropped because programming failed */
+	uint16_t errors;
+};
+
+extern struct archive_env_tag archive_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Archive_Init(void);
+void Archive_Process(void);
+void Archive_Resume(void);
+uint32_t Archive_Tail(void);
+void Archive_Download(uint32_t first);
+void Archive_Abort(void);
+void Archive_Sent(uint8_t status);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARCHIVE_H */
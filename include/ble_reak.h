@@ -39,6 +39,7 @@ extern "C"
 
 /* Simple helper functions */
 #define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
 
 /* Standard declaration/description UUIDs in 16-byte format */
 #define REAK_ATT_SERVICE_128            {0x00,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}
@@ -168,6 +169,8 @@ extern int GATTC_WriteReqInd(ke_msg_id_t const msg_id,
                       struct gattc_write_req_ind const *param,
                       ke_task_id_t const dest_id, ke_task_id_t const src_id);
 extern void REAK_SendNotification(void *data);
+extern void REAK_SendNotificationLength(void *data, uint16_t length, uint16_t seq_num);
+extern struct gattc_send_evt_cmd *REAK_NotificationAlloc(void *data, uint16_t length, uint16_t seq_num);
 
 /* ----------------------------------------------------------------------------
  * Close the 'extern "C"' block
@@ -71,7 +71,8 @@ enum appm_state
         DEFINE_MESSAGE_HANDLER(GAPC_DISCONNECT_IND, GAPC_DisconnectInd),\
         DEFINE_MESSAGE_HANDLER(GAPC_GET_DEV_INFO_REQ_IND, GAPC_GetDevInfoReqInd),\
         DEFINE_MESSAGE_HANDLER(GAPC_PARAM_UPDATED_IND, GAPC_ParamUpdatedInd),\
-        DEFINE_MESSAGE_HANDLER(GAPC_PARAM_UPDATE_REQ_IND, GAPC_ParamUpdateReqInd)\
+        DEFINE_MESSAGE_HANDLER(GAPC_PARAM_UPDATE_REQ_IND, GAPC_ParamUpdateReqInd),\
+        DEFINE_MESSAGE_HANDLER(GATTC_MTU_CHANGED_IND, GATTC_MtuChangedInd)\
 
 /* ----------------------------------------------------------------------------
  * Global variables and types
@@ -103,6 +104,9 @@ struct ble_env_tag {
     uint16_t updated_con_interval;
     uint16_t updated_latency;
     uint16_t updated_suo_to;
+
+    /* ATT MTU of the connection */
+    uint16_t mtu;
 };
 
 /* Support for the application manager and the application environment */
@@ -162,6 +166,10 @@ extern  int GAPC_ConnectionReqInd(ke_msg_id_t const msgid,
                                   struct gapc_connection_req_ind const *param,
                                   ke_task_id_t const dest_id,
                                   ke_task_id_t const src_id);
+extern int GATTC_MtuChangedInd(ke_msg_id_t const msgid,
+                               struct gattc_mtu_changed_ind const *param,
+                               ke_task_id_t const dest_id,
+                               ke_task_id_t const src_id);
 
 /* ----------------------------------------------------------------------------
  * Close the 'extern "C"' block
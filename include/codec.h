@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * codec.h
+ * - Block encoder of sample series, used by the sample history, and of
+ *   their rollups, used by the rollup tiers.
+ * - A block holds up to CODEC_BLOCK_SAMPLES consecutive samples of one sensor.
+ *   The first sample is kept as is (base), the following ones as the time
+ *   difference and the zigzag encoded value difference to the previous
+ *   sample, bit-packed with the smallest width that fits all the differences
+ *   of the block.
+ * - Encoded block (little endian):
+ *     seq (uint32), time (uint32, s), value (int16), sensor (uint8),
+ *     count (uint8), value width (uint8), time width (uint8),
+ *     then count - 1 fields of time width + value width bits, LSB first,
+ *     padded to the next byte.
+ *   The block size follows from the header (Codec_Size). ShowHistory.tcl
+ *   holds the host side decoder.
+ * - Rollup block: up to CODEC_ROLLUP_RECORDS rollups (mean, min and max over
+ *   a bucket of period seconds, see rollup.h) of one sensor. The mean is
+ *   kept as the zigzag encoded difference to the previous rollup, min and max
+ *   as their distance to the mean; buckets without samples are skipped.
+ *     seq (uint32), start of the first bucket (uint32, s), mean of the first
+ *     rollup (int16), period (uint16, s), sensor (uint8), count (uint8),
+ *     step width, mean width, spread width (uint8 each),
+ *     then for each rollup: buckets since the previous rollup minus one
+ *     (step width bits) and mean difference (mean width bits), except for
+ *     the first rollup, mean - min and max - mean (spread width bits each),
+ *     LSB first, padded to the next byte.
+ * ------------------------------------------------------------------------- */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Samples per block. The time of a sample is kept as a 16-bit offset to the
+ * first one, a block is closed earlier if the offset doesn't fit. */
+#define CODEC_BLOCK_SAMPLES             32
+#define CODEC_OFFSET_MAX                0xFFFF
+
+/* Encoded header size and maximum block size: time differences up to 16 bits,
+ * zigzag value differences up to 17 bits */
+#define CODEC_HEADER_SIZE               14
+#define CODEC_TIME_WIDTH_MAX            16
+#define CODEC_VALUE_WIDTH_MAX           17
+#define CODEC_BLOCK_SIZE_MAX            (CODEC_HEADER_SIZE + \
+                                         ((CODEC_BLOCK_SAMPLES - 1) * \
+                                          (CODEC_TIME_WIDTH_MAX + CODEC_VALUE_WIDTH_MAX) + 7) / 8)
+
+/* Rollups per rollup block, a block is closed earlier if the bucket offset
+ * doesn't fit. Widths: steps up to 16 bits, zigzag mean differences up to 17
+ * bits, spreads up to 16 bits. */
+#define CODEC_ROLLUP_RECORDS            16
+#define CODEC_ROLLUP_HEADER_SIZE        17
+#define CODEC_STEP_WIDTH_MAX            16
+#define CODEC_SPREAD_WIDTH_MAX          16
+#define CODEC_ROLLUP_SIZE_MAX           (CODEC_ROLLUP_HEADER_SIZE + \
+                                         ((CODEC_ROLLUP_RECORDS - 1) * \
+                                          (CODEC_STEP_WIDTH_MAX + CODEC_VALUE_WIDTH_MAX) + \
+                                          CODEC_ROLLUP_RECORDS * 2 * CODEC_SPREAD_WIDTH_MAX + 7) / 8)
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Decoded block */
+struct codec_block_tag
+{
+	uint32_t seq;                           /* Block sequence number */
+	uint32_t time;                          /* Time of the first sample (s) */
+	uint8_t sensor;
+	uint8_t count;                          /* Samples, 1 to CODEC_BLOCK_SAMPLES */
+	uint16_t offset[CODEC_BLOCK_SAMPLES];   /* Sample time - time */
+	int16_t value[CODEC_BLOCK_SAMPLES];
+};
+
+/* Decoded rollup block */
+struct codec_rollup_tag
+{
+	uint32_t seq;                           /* Block sequence number */
+	uint32_t time;                          /* Start of the first bucket (s) */
+	uint16_t period;                        /* Bucket period (s) */
+	uint8_t sensor;
+	uint8_t count;                          /* Rollups, 1 to CODEC_ROLLUP_RECORDS */
+	uint16_t offset[CODEC_ROLLUP_RECORDS];  /* Bucket index - index of the first one */
+	int16_t mean[CODEC_ROLLUP_RECORDS];
+	int16_t min[CODEC_ROLLUP_RECORDS];
+	int16_t max[CODEC_ROLLUP_RECORDS];
+};
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+uint16_t Codec_Encode(const struct codec_block_tag *block, uint8_t *data);
+uint16_t Codec_Size(const uint8_t *header);
+bool Codec_Decode(const uint8_t *data, uint16_t length, struct codec_block_tag *block);
+uint16_t Codec_Rollup_Encode(const struct codec_rollup_tag *block, uint8_t *data);
+uint16_t Codec_Rollup_Size(const uint8_t *header);
+bool Codec_Rollup_Decode(const uint8_t *data, uint16_t length, struct codec_rollup_tag *block);
+uint32_t Codec_Time(const uint8_t *data, uint16_t length);
+uint32_t Codec_Rollup_Time(const uint8_t *data, uint16_t length);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODEC_H */
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * filter.h
+ * - Fixed-point filter stage between the temperature acquisition and its
+ *   publication.
+ * - A sample is the median of a burst of conversions (outliers removed). The
+ *   burst medians are smoothed by a first order IIR (exponential average) or a
+ *   boxcar (moving average) filter. Decimation to the reporting rate is done by
+ *   the caller: only every n-th filter output is published.
+ * - Values are int16 in 0.01 degC, FILTER_SAMPLE_INVALID marks a missing
+ *   sample (same value as NCT375_TEMP_INVALID).
+ * ------------------------------------------------------------------------- */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+#define FILTER_SAMPLE_INVALID           ((int16_t)0x8000)
+
+/* Maximum burst length (conversions per sample) and boxcar length */
+#define FILTER_BURST_MAX                8
+#define FILTER_BOXCAR_MAX               16
+
+/* IIR filter: y += (x - y) / 2^shift, state with FILTER_IIR_FRAC fractional
+ * bits so small steps aren't lost */
+#define FILTER_IIR_SHIFT_MAX            8
+#define FILTER_IIR_FRAC                 8
+
+/* Filter types */
+typedef enum
+{
+	FILTER_TYPE_NONE,
+	FILTER_TYPE_IIR,
+	FILTER_TYPE_BOXCAR,
+	FILTER_TYPE_MAX
+} filter_type_t;
+
+/* Filter parameters, as written over BLE (4 bytes) and stored in the settings
+ * flash (packed in one word, burst in the low byte) */
+struct filter_param_tag
+{
+	uint8_t burst;          /* Conversions per sample, 1 to FILTER_BURST_MAX */
+	uint8_t type;           /* filter_type_t */
+	uint8_t coef;           /* IIR shift (1 to FILTER_IIR_SHIFT_MAX) or boxcar
+	                         * length (1 to FILTER_BOXCAR_MAX), unused without
+	                         * filter */
+	uint8_t decimation;     /* Filter outputs per published sample, >= 1 */
+};
+
+/* Default: single conversion, no filter, every sample published */
+#define FILTER_PARAM_DEFAULT            { 1, FILTER_TYPE_NONE, 0, 1 }
+
+#define FILTER_PARAM_PACK(p)            ((uint32_t)(p).burst | ((uint32_t)(p).type << 8) | \
+                                         ((uint32_t)(p).coef << 16) | ((uint32_t)(p).decimation << 24))
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Filter state of one channel */
+struct filter_tag
+{
+	/* Samples of the current burst */
+	int16_t burst[FILTER_BURST_MAX];
+	uint8_t burst_count;
+
+	/* Filter history, primed by the first valid sample */
+	bool primed;
+	int32_t iir;
+	int16_t boxcar[FILTER_BOXCAR_MAX];
+	int32_t boxcar_sum;
+	uint8_t boxcar_count;
+	uint8_t boxcar_pos;
+};
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+bool Filter_Param_Check(const struct filter_param_tag *param);
+void Filter_Param_Unpack(uint32_t value, struct filter_param_tag *param);
+void Filter_Reset(struct filter_tag *filter);
+void Filter_Add(struct filter_tag *filter, int16_t sample);
+int16_t Filter_Run(struct filter_tag *filter, const struct filter_param_tag *param);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILTER_H */
@@ -0,0 +1,108 @@
+/* ----------------------------------------------------------------------------
+ * flashlog.h
+ * - Persistent sample log, kept in FLASHLOG_SECTORS sectors of the main flash
+ *   below the settings sectors. The encoded blocks of the sample history (see
+ *   history.h) are copied to it, so they survive a reset or a battery swap.
+ * - Log-structured: records are appended to a page buffer in RAM, a page (one
+ *   flash sector) is programmed once it is full. Pages are written round-robin
+ *   over the log sectors, each sector is erased once per FLASHLOG_SECTORS
+ *   pages (wear levelling); the oldest page is overwritten when the log is
+ *   full.
+ * - Page layout: records from the start of the sector, the page header in
+ *   the last 16 bytes. The header is programmed last, so a page with a valid
+ *   header is complete. At start-up only the headers are scanned.
+ *     header: page sequence number (uint32), sequence number of the first
+ *             record (uint32), number of records (uint16), bytes used
+ *             (uint16), FLASHLOG_PAGE_MAGIC (uint16), CRC-16 of the header
+ *             (uint16)
+ *     record: sequence number (uint32), payload length (uint16), CRC-16 of
+ *             the sequence number, length and payload (uint16), payload
+ *             padded to a word pair
+ * - The records of the page not programmed yet are lost on a reset.
+ * - The log is downloaded record by record through the HISTORY CTRL control
+ *   point (HISTORY_OP_LOG, see history.h).
+ * - The application image must not use the log sectors (keep the image below
+ *   FLASHLOG_FLASH_ADDR).
+ * ------------------------------------------------------------------------- */
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "settings.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Log sectors: the FLASHLOG_SECTORS sectors below the settings sectors */
+#define FLASHLOG_SECTORS                16
+#define FLASHLOG_PAGE_SIZE              FLASH_SECTOR_SIZE
+#define FLASHLOG_FLASH_ADDR             (SETTINGS_FLASH_ADDR - FLASHLOG_SECTORS * FLASHLOG_PAGE_SIZE)
+
+#define FLASHLOG_PAGE_MAGIC             0x4C47
+#define FLASHLOG_HEADER_SIZE            16
+#define FLASHLOG_RECORD_HEADER_SIZE     8
+#define FLASHLOG_PAYLOAD_MAX            (FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE - FLASHLOG_RECORD_HEADER_SIZE)
+
+/* Word pair, the flash programming unit */
+#define FLASHLOG_ALIGN(length)          (((length) + 7) & ~7U)
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct flashlog_env_tag
+{
+	/* Page being filled: sector index, page and first record sequence
+	 * numbers, number of records and bytes used */
+	uint8_t page;
+	uint32_t page_seq;
+	uint32_t first;
+	uint16_t count;
+	uint16_t used;
+	uint32_t buffer[FLASHLOG_PAGE_SIZE / 4];
+
+	/* Sequence number of the next record */
+	uint32_t seq;
+
+	/* Stream offset of the next history block to copy */
+	uint32_t history_pos;
+
+	/* Page programming failures */
+	uint16_t errors;
+};
+
+extern struct flashlog_env_tag flashlog_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+uint16_t FlashLog_CRC(uint16_t crc, const uint8_t *data, uint16_t length);
+void FlashLog_Init(void);
+bool FlashLog_Append(const uint8_t *data, uint16_t length);
+bool FlashLog_Commit(void);
+bool FlashLog_Read(uint32_t *seq, uint8_t *data, uint16_t size, uint16_t *length);
+void FlashLog_Process(void);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASHLOG_H */
@@ -0,0 +1,228 @@
+/* ----------------------------------------------------------------------------
+ * history.h
+ * - Sample history: RAM ring buffer of timestamped samples. Every sample
+ *   published by the sampler is recorded, whether a central is connected or
+ *   not. Once the buffer is full the oldest samples are overwritten.
+ * - The samples of each sensor are collected in blocks of up to
+ *   CODEC_BLOCK_SAMPLES and kept encoded (base value, bit-packed zigzag
+ *   differences, see codec.h), about 10 bits per sample instead of 64.
+ * - Blocks are numbered by a sequence number that keeps counting when the
+ *   buffer wraps. A client starts the download of the backlog from a block
+ *   sequence number by writing the HISTORY CTRL control point; the open
+ *   blocks are closed and the encoded blocks are streamed in HISTORY DATA
+ *   notifications as long as the ATT MTU allows. A gateway resumes from the
+ *   block following the last one it received, so the history survives
+ *   between two connections (not a reset).
+ * - Timestamps are seconds since the last reset, counted by the time base
+ *   (timebase.h), which maps them to the wall clock of the central.
+ * - The closed blocks are also read in order by the flash log (flashlog.h)
+ *   and the archive in the external flash (archive.h), which are downloaded
+ *   through the same characteristics.
+ * - The rollup tiers (rollup.h) keep their blocks in rings of the same kind,
+ *   downloaded through the same characteristics.
+ * - Blocks are found through a sparse index (every HISTORY_INDEX_STRIDE-th
+ *   block), by sequence number or by record time: the time of the newest
+ *   sample written to the ring up to the block included, which never
+ *   decreases. All the samples of a block are at or before its record time,
+ *   so the blocks holding the samples at or after a time T are among those
+ *   with a record time at or after T. The record access control point
+ *   (racp.h) queries the history this way.
+ * ------------------------------------------------------------------------- */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "sensor.h"
+#include "codec.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Size of the encoded block buffer (power of 2). A block of 32 samples of a
+ * stable temperature takes about 40 bytes, so the buffer holds about 1500
+ * samples: the last 25 minutes at the fast sample period of one sensor, the
+ * adaptive period stretches it to hours. The flash log (flashlog.h) keeps
+ * 16 times more blocks, older samples are kept as rollups (rollup.h). */
+#define HISTORY_BUFFER_SIZE             2048
+
+/* RAM budget of the sample storage: history_env, rollup_env, flashlog_env
+ * and archive_env, checked at build time. The RSL10 has 24 KB of data RAM,
+ * the rest is left to the BLE stack heaps, the main stack and the other
+ * modules. */
+#define HISTORY_RAM_BUDGET              (16 * 1024)
+
+/* Control point opcodes, first byte written to HISTORY CTRL:
+ * - DOWNLOAD, followed by the first block sequence number (uint32, 0 or
+ *   omitted for the oldest block kept): close the open blocks and stream the
+ *   blocks up to the newest one
+ * - ABORT: stop the download in progress
+ * - ARCHIVE, followed by the archive stream offset (uint32) of the first
+ *   block, the end of the last complete block received (0 or omitted for the
+ *   oldest block kept): stream the programmed pages of the archive
+ * - ROLLUP, followed by the rollup tier (uint8, rollup_tier_t) and the first
+ *   rollup block sequence number of the tier (uint32, 0 or omitted for the
+ *   oldest block kept): close the rollup blocks of the finished buckets and
+ *   stream the rollup blocks of the tier up to the newest one
+ * - LOG, followed by the first record sequence number (uint32, 0 or omitted
+ *   for the oldest record kept): stream the records of the flash log, the
+ *   blocks kept from before the last reset, up to the newest one
+ * The control point value (read, notified after a command and at the end of
+ * the download) is the status: HISTORY_OP_STATUS, download in progress (0 or
+ * 1), sequence number of the oldest block kept (uint32), sequence number of
+ * the next block (uint32), current time (uint32, s), archive stream offsets
+ * of the oldest page kept and of the end of the archive (uint32 each). */
+typedef enum
+{
+	HISTORY_OP_DOWNLOAD = 0x01,
+	HISTORY_OP_ABORT = 0x02,
+	HISTORY_OP_ARCHIVE = 0x03,
+	HISTORY_OP_ROLLUP = 0x04,
+	HISTORY_OP_LOG = 0x05,
+	HISTORY_OP_STATUS = 0x80
+} history_op_t;
+
+#define HISTORY_CTRL_SIZE               22
+
+/* Sparse index of a ring: the stream offset and record time of the blocks
+ * whose sequence number is a multiple of the stride. A lookup is a binary
+ * search over the index followed by at most HISTORY_INDEX_STRIDE blocks. The
+ * index covers HISTORY_INDEX_SIZE * HISTORY_INDEX_STRIDE blocks, more than a
+ * ring of 4 KB of the smallest blocks. */
+#define HISTORY_INDEX_STRIDE            16
+#define HISTORY_INDEX_SIZE              32
+
+/* HISTORY DATA notification: stream offset (uint32) of the first byte, then
+ * the next bytes of the encoded blocks. The first notification of a download
+ * starts with a block. If the blocks not sent yet are overwritten, the stream
+ * continues with the oldest block kept: a gap in the offsets marks the start
+ * of a block, the partial block before it is dropped. The notifications are
+ * sized to the ATT MTU, up to HISTORY_PACKET_SIZE. A download of the flash
+ * log carries the record sequence number (uint32) instead of the stream
+ * offset, then the next bytes of the record: a record longer than a
+ * notification continues in the next ones with the same sequence number, a
+ * gap in the sequence numbers marks records overwritten before they were
+ * sent. */
+#define HISTORY_PACKET_HEADER_SIZE      4
+#define HISTORY_PACKET_SIZE             244
+
+/* Notifications handed to the stack at the same time, the next one is sent
+ * when one of them is completed (GATTC_CMP_EVT with HISTORY_NTF_SEQ_NUM) */
+#define HISTORY_NTF_CREDITS             4
+#define HISTORY_NTF_SEQ_NUM             0x4854
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Ring buffer of encoded blocks, of the sample history and of the rollup
+ * tiers. Positions are offsets in the stream of all the blocks since reset
+ * (buffer index modulo size, a power of 2): the oldest block kept starts at
+ * tail, the next one is written at head. The size of a block follows from its
+ * first header_size bytes. */
+struct history_index_tag
+{
+	uint32_t pos;
+	uint32_t time;
+};
+
+struct history_ring_tag
+{
+	uint8_t *buffer;
+	uint32_t size;
+	uint8_t header_size;
+	uint16_t (*block_size)(const uint8_t *header);
+	uint32_t (*block_time)(const uint8_t *data, uint16_t length);
+	uint32_t head;
+	uint32_t tail;
+
+	/* Sequence numbers of the block at tail and of the next block */
+	uint32_t first;
+	uint32_t seq;
+
+	/* Record time of the newest block and sparse index (entry of block seq
+	 * in index[(seq / HISTORY_INDEX_STRIDE) % HISTORY_INDEX_SIZE]) */
+	uint32_t time;
+	struct history_index_tag index[HISTORY_INDEX_SIZE];
+};
+
+struct history_env_tag
+{
+	/* Encoded blocks */
+	struct history_ring_tag ring;
+	uint8_t buffer[HISTORY_BUFFER_SIZE];
+
+	/* Open block of each sensor and encoding buffer */
+	struct codec_block_tag block[SENSOR_MAX];
+	uint8_t encoded[CODEC_BLOCK_SIZE_MAX];
+
+	/* Seconds since reset */
+	volatile uint32_t time;
+
+	/* Download in progress: ring downloaded, stream offset of the next byte
+	 * to send and of the end of the download (bounded set, otherwise up to
+	 * the newest block), notifications that can still be handed to the
+	 * stack, and report requested through the record access control point */
+	bool download;
+	struct history_ring_tag *source;
+	uint32_t next;
+	uint32_t end;
+	bool bounded;
+	uint8_t credits;
+	bool report;
+
+	/* Download of the flash log: sequence number of the record being sent
+	 * or looked for next, the record and the bytes of it sent */
+	bool log;
+	uint32_t log_seq;
+	uint8_t log_record[CODEC_BLOCK_SIZE_MAX];
+	uint16_t log_length;
+	uint16_t log_pos;
+};
+
+extern struct history_env_tag history_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void History_Init(void);
+void History_Tick(void);
+void History_Add(uint8_t sensor, int16_t value);
+void History_Command(const uint8_t *command, uint16_t length);
+void History_Status(uint8_t *status);
+void History_Notify_Status(void);
+void History_Abort(void);
+void History_Sent(uint8_t status);
+bool History_Block_Read(uint32_t *pos, uint8_t *data, uint16_t *length);
+void History_Ring_Init(struct history_ring_tag *ring, uint8_t *buffer, uint32_t size,
+                       uint8_t header_size, uint16_t (*block_size)(const uint8_t *header),
+                       uint32_t (*block_time)(const uint8_t *data, uint16_t length));
+void History_Ring_Write(struct history_ring_tag *ring, const uint8_t *data, uint16_t length,
+                        uint32_t time);
+void History_Flush(void);
+uint32_t History_Find(uint32_t time);
+void History_Report(uint32_t first, uint32_t last);
+bool History_Delete(uint32_t last);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HISTORY_H */
@@ -13,11 +13,20 @@
  * i2c.h
  * - RSL10 I2C communication library. Only master mode/auto acknowlege mode is
  *   currently supported.
+ * - Transactions are queued: each call posts a descriptor into a ring and the
+ *   interrupt handler starts the next one as soon as the current one is
+ *   completed. No wait is required between two transactions.
  * - The DIOs used by the I2C interface are not configured by this library; they
  *   have to be configured on the application level.
- * - Known limitations:
- *   > DMA transfers are not supported.
- *   > I2C bus errors are not treated.
+ * - Transaction payloads of at least I2C_DMA_MIN_LENGTH bytes are moved by a
+ *   DMA channel if I2C_DMA_CHANNEL is defined; shorter payloads use the
+ *   per-byte interrupt path.
+ * - Every transaction has a deadline. NACKs, bus errors and timeouts abort the
+ *   transaction, a stuck bus is recovered by clocking out SCL, and the
+ *   transaction is retried with a bounded backoff before its callback is
+ *   called with the error code.
+ * - Transaction statistics (counters and duration histogram) are always kept
+ *   and can be read with I2C_Stats_Get.
  * ----------------------------------------------------------------------------
  * $Revision: $
  * $Date: $
@@ -48,21 +57,143 @@ extern "C"
  * I2C_DBG_DIO_NUM (un-comment the following line). */
 /* #define I2C_DBG_DIO_NUM 9 */
 
+/* Number of transactions that can be queued (has to be a power of two), large
+ * enough for three commands to each of the eight sensors a bus can address */
+#define I2C_QUEUE_SIZE                  32
+
+/* TX data up to this length is copied into the transaction descriptor, so the
+ * caller can reuse its buffer as soon as the transaction has been queued.
+ * Longer TX data is referenced and has to stay valid until completion. */
+#define I2C_TX_INLINE_SIZE              4
+
+/* DMA support: The payload of a write or read phase of at least
+ * I2C_DMA_MIN_LENGTH bytes is moved by the DMA channel I2C_DMA_CHANNEL, so the
+ * CPU is interrupted a fixed number of times per phase instead of once per
+ * byte. To use the per-byte interrupt path only, comment out I2C_DMA_CHANNEL.
+ * The last byte of a read is still handled by the CPU to send the NACK. */
+#define I2C_DMA_CHANNEL                 0
+#define I2C_DMA_IRQn                    DMA0_IRQn
+#define I2C_DMA_IRQHandler              DMA0_IRQHandler
+#define I2C_DMA_MIN_LENGTH              4
+
+/* Transaction deadline and retries: The timer I2C_TIMEOUT_TIMER is started with
+ * each transaction and aborts it on expiry. A failed transaction is retried up
+ * to I2C_RETRY_MAX times after a backoff of I2C_RETRY_BACKOFF_TICKS, doubled
+ * with each retry. Ticks are SLOWCLK/64 (64 us with a 1 MHz SLOWCLK), so the
+ * worst-case latency of a transaction is bounded by
+ * (I2C_RETRY_MAX + 1) * I2C_TIMEOUT_TICKS +
+ * (2^I2C_RETRY_MAX - 1) * I2C_RETRY_BACKOFF_TICKS ticks
+ * plus the bus recoveries (about 0.1 ms each). The timer interrupt has to use
+ * the same priority as the I2C interrupt. */
+#define I2C_TIMEOUT_TIMER               2
+#define I2C_TIMEOUT_SELECT              SELECT_TIMER2
+#define I2C_TIMEOUT_IRQn                TIMER2_IRQn
+#define I2C_TIMEOUT_IRQHandler          TIMER2_IRQHandler
+#define I2C_TIMEOUT_TICKS               79
+#define I2C_RETRY_MAX                   2
+#define I2C_RETRY_BACKOFF_TICKS         16
+
+/* Half SCL period (in SYSCLK cycles) used to clock out a stuck bus */
+#define I2C_RECOVERY_HALF_CLK_CYCLES    40
+
+/* Transaction duration histogram: bucket n counts the transactions that took
+ * 2^(n + I2C_STATS_HIST_MIN_LOG2) to 2^(n + I2C_STATS_HIST_MIN_LOG2 + 1) - 1
+ * SYSCLK cycles. The first and last buckets also count shorter respectively
+ * longer transactions. */
+#define I2C_STATS_HIST_BUCKETS          16
+#define I2C_STATS_HIST_MIN_LOG2         8
+
+/* Define error codes */
+
+typedef enum
+{
+	I2C_ERRNO_NONE,
+	I2C_ERRNO_NACK,
+	I2C_ERRNO_BUS_ERROR,
+	I2C_ERRNO_TIMEOUT
+} i2c_error_code_t;
+
+/* State of the deadline/backoff timer */
+enum i2c_timer_state
+{
+	I2C_TIMER_IDLE,
+	I2C_TIMER_DEADLINE,
+	I2C_TIMER_BACKOFF
+};
 
 /* ----------------------------------------------------------------------------
  * Global variables and types
  * --------------------------------------------------------------------------*/
 
+/* Transaction completion callback, called from the I2C or timer interrupt
+ * with the transaction result */
+typedef void (*i2c_callback_t)(void *context, i2c_error_code_t status);
+
+/* I2C transaction statistics. Durations are in SYSCLK cycles, measured from
+ * the first start of a transaction (including retries) to its completion. */
+struct i2c_stats_tag
+{
+	uint32_t transactions;
+	uint32_t failures;
+	uint32_t bytes_tx;
+	uint32_t bytes_rx;
+	uint32_t nacks;
+	uint32_t bus_errors;
+	uint32_t timeouts;
+	uint32_t retries;
+	uint32_t queue_full;
+	uint32_t duration_max;
+	uint32_t duration_hist[I2C_STATS_HIST_BUCKETS];
+	uint32_t isr_max;
+};
+
+/* I2C transaction descriptor */
+struct i2c_xfer_tag
+{
+	uint8_t address;
+	uint8_t tx_inline[I2C_TX_INLINE_SIZE];
+	uint8_t *tx_buffer;
+	int16_t tx_buffer_length;
+	uint8_t *rx_buffer;
+	int16_t rx_buffer_length;
+	i2c_callback_t callbackfunction;
+	void *context;
+	uint8_t retries;
+};
+
 /* I2C environment */
 struct i2c_env_tag
 {
-	uint8_t last_status;
+	uint32_t last_status;
+
+	/* Active transaction (copied from the head of the queue) */
 	uint8_t address;
 	uint8_t *tx_buffer;
 	int16_t tx_buffer_length;
 	uint8_t *rx_buffer;
 	int16_t rx_buffer_length;
-	void *callbackfunction;
+	i2c_callback_t callbackfunction;
+	void *context;
+	volatile bool busy;
+
+	/* I2C_CTRL0 configuration without the controller and ACK selection */
+	uint32_t config;
+	bool dma_active;
+
+	/* Deadline/backoff timer and bus recovery DIOs */
+	volatile uint8_t timer_state;
+	uint32_t dio_config;
+	uint32_t scl_dio;
+	uint32_t sda_dio;
+
+	/* Statistics and start time (DWT cycle counter) of the active transaction */
+	struct i2c_stats_tag stats;
+	uint32_t start_time;
+
+	/* Transaction queue. The head entry stays reserved while it is active */
+	struct i2c_xfer_tag queue[I2C_QUEUE_SIZE];
+	volatile uint8_t queue_head;
+	volatile uint8_t queue_tail;
 };
 extern struct i2c_env_tag    i2c_env;
 
@@ -75,20 +206,37 @@ extern struct i2c_env_tag    i2c_env;
 /* I2C_Master_Init: Initialize the I2C interface in master mode */
 void I2C_Master_Init(uint8_t speed);
 
+/* I2C_Recovery_Config: Provides the DIO configuration used by the application
+                        so the library can clock out a stuck bus */
+void I2C_Recovery_Config(uint32_t config, uint32_t scl, uint32_t sda);
+
 /**** Write/read functions ****/
 
-/* I2C_WriteRead: Initiates a write, read or combined write-read transaction, 
-                  of one or multiple bytes */
-void I2C_WriteRead(uint8_t address, uint8_t *txdata, uint16_t txlength,
-		             uint8_t *rxdata, uint16_t rxlength, void *callback);
+/* I2C_Transfer: Queues a write, read or combined write-read transaction with
+                 a completion callback and context. Returns false if the queue
+                 is full. */
+bool I2C_Transfer(uint8_t address, uint8_t *txdata, uint16_t txlength,
+                  uint8_t *rxdata, uint16_t rxlength,
+                  i2c_callback_t callback, void *context);
 
 /* I2C_Write: Initiates a write transaction of one or multiple bytes */
-void I2C_Write(uint8_t address, uint8_t *txdata, uint16_t txlength,
-		         void *callback);
+bool I2C_Write(uint8_t address, uint8_t *txdata, uint16_t txlength,
+		         i2c_callback_t callback, void *context);
 
 /* I2C_Read: Initiates a read transaction of one or multiple bytes */
-void I2C_Read(uint8_t address, uint8_t *rxdata, uint16_t rxlength,
-		        void *callback);
+bool I2C_Read(uint8_t address, uint8_t *rxdata, uint16_t rxlength,
+		        i2c_callback_t callback, void *context);
+
+/* I2C_Idle: Returns true if no transaction is active or queued */
+bool I2C_Idle(void);
+
+/**** Statistics ****/
+
+/* I2C_Stats_Get: Returns the transaction statistics */
+const struct i2c_stats_tag *I2C_Stats_Get(void);
+
+/* I2C_Stats_Reset: Clears the transaction statistics */
+void I2C_Stats_Reset(void);
 
 /**** Support functions (internally used by the library) ****/
 
@@ -96,6 +244,16 @@ void I2C_Read(uint8_t address, uint8_t *rxdata, uint16_t rxlength,
                    operations */
 void I2C_IRQHandler(void);
 
+/* I2C_TIMEOUT_IRQHandler: Timer interrupt service function handling the
+                           transaction deadline and the retry backoff */
+void I2C_TIMEOUT_IRQHandler(void);
+
+#ifdef I2C_DMA_CHANNEL
+/* I2C_DMA_IRQHandler: DMA interrupt service function called once the payload
+                       of a write or read phase has been moved */
+void I2C_DMA_IRQHandler(void);
+#endif
+
 /* ----------------------------------------------------------------------------
  * Close the 'extern "C"' block
  * ------------------------------------------------------------------------- */
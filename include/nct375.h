@@ -8,40 +8,128 @@
 #ifndef NCT375_H_
 #define NCT375_H_
 
-/* Selection between power save ONE-SHOT-MODE (temperature register values are updated only in the user specified time)
- * and NORMAL-MODE during the BLE connection time (every 80ms temperature register value is updated automatically by the new value).
- * In the case normal mode selection ONE_SHOT_MODE definition has to be comment. Out of BLE connection, chip is in Shutdown Mode.
- * All circuitry except interface are powered down. */
-#define ONE_SHOT_MODE
+#include "nct375_regs.h"
 
-/* When the FULL_POWER_MODE definition is uncommented then the nct375 chip is in the normal mode out of BLE connection time too.
- * It is the chip maximal power consumption mode */
-#define FULL_POWER_MODE
+/* I2C slave addresses of the sensors sharing the bus (0x48 to 0x4F, selected
+ * by the A0-A2 pins). Up to NCT375_MAX_DEVICES sensors are supported. */
+#define NCT375_MAX_DEVICES		8
+#define NCT375_I2C_ADDR_LIST	{ 0x48 }
 
+/* Conversion time in sampler timer ticks (64 us), covers one conversion of the
+ * sensor (temperature register updated every 80 ms in normal mode) */
+#define NCT375_CONVERSION_TICKS		1250
+
+/* ALERT output (active low, open drain, wired together for all sensors) routed
+ * to NCT375_ALERT_DIO_NUM. In comparator mode the output is active while the
+ * temperature is above TOS until it falls below THYST, both edges are handled.
+ * In interrupt mode (uncomment NCT375_ALERT_INTERRUPT_MODE) the output is
+ * activated by each crossing and released by the following register read. */
+/* #define NCT375_ALERT_INTERRUPT_MODE */
+#ifdef NCT375_ALERT_INTERRUPT_MODE
+#define NCT375_CONFIG_ALERT			NCT375_CONFIG_INT
+#define NCT375_ALERT_EVENT			DIO_EVENT_FALLING_EDGE
+#else
+#define NCT375_CONFIG_ALERT			0x00
+#define NCT375_ALERT_EVENT			DIO_EVENT_TRANSITION
+#endif
+#define NCT375_ALERT_DIO_INT		0
+#define NCT375_ALERT_IRQn			DIO0_IRQn
+#define NCT375_ALERT_IRQHandler		DIO0_IRQHandler
+
+/* Alert limits in 0.01 degC (power-on defaults of the chip), sensor range */
+#define NCT375_THYST_DEFAULT		7500
+#define NCT375_TOS_DEFAULT			8000
+#define NCT375_LIMIT_MIN			(-5500)
+#define NCT375_LIMIT_MAX			12500
+
+/* 0.01 degC to the limit register unit (1/16 degC) */
+#define NCT375_TEMP_TO_LIMIT(t)		NCT375_TEMP_TO_TEMP12(t)
+
+/* Reported temperature of a missing or not yet sampled sensor */
+#define NCT375_TEMP_INVALID		((int16_t)0x8000)
+
+/* Address pointer value unknown (power-up, bus error) */
+#define NCT375_REG_UNKNOWN		0xFF
+
+/* Register mask bit for the batch read (NCT375_Read_Async) and the shadow
+ * valid flags */
+#define NCT375_REG_BIT(reg)		(1 << (reg))
+
+/* Sensor instance: I2C address and write-through shadow of the device
+ * registers. Valid has NCT375_REG_BIT(register) set while the Config, THYST,
+ * TOS and OneShot shadows match the device. */
 struct NCT375_Reg_tag
 {
+	uint8_t I2CAddr;
 	uint8_t Config;
-	uint8_t Addr;
+	uint8_t Addr;		/* Address pointer register value once the queued transactions are completed */
+	uint8_t InFlight;	/* Transactions queued and not completed yet */
 	uint8_t OneShot;
 	short int Thyst;
 	short int TOs;
-	uint16_t Temp;
+	uint8_t Valid;
+	int16_t Temp;		/* Last temperature in 0.01 degC, NCT375_TEMP_INVALID while read or if the read failed */
+	uint8_t Rx[NCT375_REG_SIZE_MAX];		/* Read buffer, one per instance for batched reads */
 };
 
-extern struct NCT375_Reg_tag nct375;
-
-void NCT375_Received_Temperature(void);
-void NCT375_ONEShot_ModeOn(void);
-void NCT375_ONEShot_StartSample(void);
-void NCT375_ONEShot_ModeOff(void);
-void NCT375_ONEShotReg_Read(void);
-void NCT375_ConfReg_Read(void);
-void NCT375_PowerDown(void);
-void NCT375_PowerUp(void);
-void NCT375_I2C_Delay(void);
-void NCT375_THYST_Write(short int);
-short int NCT375_THYST_Read(void);
-void NCT375_TOS_Write(short int);
-short int NCT375_TOS_Read(void);
+/* Completion callback of an asynchronous register operation. Read values are
+ * available in the shadow registers of dev (and dev->Temp). */
+typedef void (*nct375_callback_t)(void *context, struct NCT375_Reg_tag *dev, i2c_error_code_t status);
+
+/* Asynchronous register operation: its I2C transactions not completed yet
+ * (plus one while it is being posted) and the first error. The Config
+ * read-modify-write keeps its clear and set masks here. Operations of the
+ * sensor driver interface have a sensor_callback instead of a callback. */
+struct NCT375_Op_tag
+{
+	struct NCT375_Reg_tag *dev;		/* NULL while free */
+	nct375_callback_t callback;
+	sensor_callback_t sensor_callback;
+	void *context;
+	uint8_t pending;
+	i2c_error_code_t status;
+	uint8_t clear;
+	uint8_t set;
+	bool trigger;		/* One-shot trigger after the Config update */
+};
+
+/* Operations in progress at the same time: the sampler uses one per sensor,
+ * the remaining ones are left to the application */
+#define NCT375_OP_POOL_SIZE		(2 * NCT375_MAX_DEVICES + 4)
+
+/* Sensors on the bus */
+struct NCT375_Env_tag
+{
+	uint8_t nb_dev;
+	struct NCT375_Reg_tag dev[NCT375_MAX_DEVICES];
+
+	/* Alert limits (0.01 degC) */
+	int16_t thyst;
+	int16_t tos;
+
+	struct NCT375_Op_tag op[NCT375_OP_POOL_SIZE];
+};
+
+extern struct NCT375_Env_tag nct375_env;
+extern const struct sensor_driver_tag nct375_driver;
+
+/* Single sensor functions. The register accesses are asynchronous: they
+ * return false if the operation couldn't be started, otherwise the callback
+ * is called once it is completed. */
+void NCT375_Init(struct NCT375_Reg_tag *dev, uint8_t i2c_addr);
+void NCT375_Shadow_Invalidate(struct NCT375_Reg_tag *dev);
+bool NCT375_Read_Async(struct NCT375_Reg_tag *dev, uint8_t regs, nct375_callback_t callback, void *context);
+bool NCT375_Config_Async(struct NCT375_Reg_tag *dev, uint8_t clear, uint8_t set, nct375_callback_t callback, void *context);
+bool NCT375_Limits_Async(struct NCT375_Reg_tag *dev, short int thyst, short int tos, nct375_callback_t callback, void *context);
+bool NCT375_ONEShot_StartSample(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context);
+bool NCT375_ONEShot_ModeOn(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context);
+bool NCT375_ONEShot_ModeOff(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context);
+bool NCT375_PowerDown(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context);
+bool NCT375_PowerUp(struct NCT375_Reg_tag *dev, nct375_callback_t callback, void *context);
+
+/* Sensor driver registration and alert mode */
+void NCT375_Sensors_Add(void);
+bool NCT375_Limits_Set(int16_t thyst, int16_t tos);
+void NCT375_ALERT_IRQHandler(void);
 
 #endif /* NCT375_H_ */
@@ -0,0 +1,99 @@
+/*
+ * nct375_regs.h
+ *
+ * Register map of the NCT375 (and the LM75-like sensors of the same class).
+ * The registers and the Config fields are declared once in the lists below;
+ * addresses, sizes, masks, the field accessors and the 12-bit temperature
+ * encoding are generated from them at compile time. The static asserts at the
+ * end fail the build on a mistake in the map.
+ */
+
+#ifndef NCT375_REGS_H_
+#define NCT375_REGS_H_
+
+#include <stdint.h>
+
+/* Largest register, size of the read and write buffers */
+#define NCT375_REG_SIZE_MAX		2
+
+/* Registers: name, address pointer value, size in bytes (data is MSB first) */
+#define NCT375_REG_LIST(X)		\
+	X(TEMP,		0x00,	2)		\
+	X(CONFIG,	0x01,	1)		\
+	X(THYST,	0x02,	2)		\
+	X(TOS,		0x03,	2)		\
+	X(ONESHOT,	0x04,	1)
+
+/* Configuration register fields: name, bit position, width */
+#define NCT375_CONFIG_FIELD_LIST(X)	\
+	X(SHUTDOWN,		0,	1)			/* D0, shutdown mode */					\
+	X(INT,			1,	1)			/* D1, comparator (0) or interrupt (1) mode */	\
+	X(ALERT_POL,	2,	1)			/* D2, ALERT active high (1) */			\
+	X(FAULT_QUEUE,	3,	2)			/* D4-D3, faults before ALERT: 1, 2, 4, 6 */	\
+	X(ONESHOT,		5,	1)			/* D5, one-shot mode */
+
+/* Register addresses NCT375_REG_<name> and sizes NCT375_REG_<name>_SIZE */
+#define NCT375_REG_ENUM(name, addr, size)	NCT375_REG_##name = (addr), NCT375_REG_##name##_SIZE = (size),
+enum { NCT375_REG_LIST(NCT375_REG_ENUM) };
+
+/* Field positions NCT375_CONFIG_<name>_POS, widths NCT375_CONFIG_<name>_WIDTH */
+#define NCT375_FIELD_ENUM(name, pos, width)	NCT375_CONFIG_##name##_POS = (pos), NCT375_CONFIG_##name##_WIDTH = (width),
+enum { NCT375_CONFIG_FIELD_LIST(NCT375_FIELD_ENUM) };
+
+#define NCT375_FIELD_MASK(name)		((uint8_t)(((1U << NCT375_CONFIG_##name##_WIDTH) - 1) << NCT375_CONFIG_##name##_POS))
+
+/* Typed accessors NCT375_Config_Get_<name>() and NCT375_Config_Set_<name>() */
+#define NCT375_FIELD_ACCESSORS(name, pos, width)										\
+static inline uint8_t NCT375_Config_Get_##name(uint8_t config)							\
+{																						\
+	return (config & NCT375_FIELD_MASK(name)) >> NCT375_CONFIG_##name##_POS;			\
+}																						\
+static inline uint8_t NCT375_Config_Set_##name(uint8_t config, uint8_t value)			\
+{																						\
+	return (config & ~NCT375_FIELD_MASK(name)) |										\
+	       ((value << NCT375_CONFIG_##name##_POS) & NCT375_FIELD_MASK(name));			\
+}
+NCT375_CONFIG_FIELD_LIST(NCT375_FIELD_ACCESSORS)
+
+/* Configuration register bits */
+#define NCT375_CONFIG_SHUTDOWN	NCT375_FIELD_MASK(SHUTDOWN)
+#define NCT375_CONFIG_INT		NCT375_FIELD_MASK(INT)
+#define NCT375_CONFIG_ONESHOT	NCT375_FIELD_MASK(ONESHOT)
+#define NCT375_CONFIG_MODE_MASK	(NCT375_CONFIG_SHUTDOWN | NCT375_CONFIG_INT | NCT375_CONFIG_ONESHOT)
+
+/* Temperature, THYST and TOS: 12-bit two's complement in 1/16 degC, left
+ * aligned in the 16-bit register */
+#define NCT375_TEMP12_POS		4
+#define NCT375_TEMP12_WIDTH		12
+#define NCT375_TEMP12_SIGN		(1 << (NCT375_TEMP12_WIDTH - 1))
+
+#define NCT375_REG16(buf)			((uint16_t)(((buf)[0] << 8) | (buf)[1]))
+#define NCT375_TEMP12_ENCODE(t)		((uint16_t)(((uint32_t)(t) << NCT375_TEMP12_POS) & 0xFFFF))
+#define NCT375_TEMP12_DECODE(reg)	((int16_t)((int32_t)(((reg) >> NCT375_TEMP12_POS) ^ NCT375_TEMP12_SIGN) - NCT375_TEMP12_SIGN))
+
+/* 1/16 degC to 0.01 degC and back */
+#define NCT375_TEMP12_TO_TEMP(t)	((int16_t)(((int32_t)(t) * 100) / 16))
+#define NCT375_TEMP_TO_TEMP12(t)	((int16_t)(((int32_t)(t) * 16) / 100))
+
+/* Map checks */
+#define NCT375_REG_CHECK(name, addr, size)												\
+	_Static_assert((addr) < 8, "NCT375_REG_" #name ": address outside of the valid mask");	\
+	_Static_assert((size) >= 1 && (size) <= NCT375_REG_SIZE_MAX, "NCT375_REG_" #name ": size");
+NCT375_REG_LIST(NCT375_REG_CHECK)
+
+#define NCT375_FIELD_CHECK(name, pos, width)											\
+	_Static_assert((width) >= 1 && (pos) + (width) <= 8, "NCT375_CONFIG_" #name ": outside of the register");
+NCT375_CONFIG_FIELD_LIST(NCT375_FIELD_CHECK)
+
+/* Fields don't overlap: the sum of the masks equals their union */
+#define NCT375_FIELD_SUM(name, pos, width)	+ NCT375_FIELD_MASK(name)
+#define NCT375_FIELD_OR(name, pos, width)	| NCT375_FIELD_MASK(name)
+_Static_assert((0 NCT375_CONFIG_FIELD_LIST(NCT375_FIELD_SUM)) == (0 NCT375_CONFIG_FIELD_LIST(NCT375_FIELD_OR)),
+               "NCT375 Config fields overlap");
+
+_Static_assert(NCT375_TEMP12_POS + NCT375_TEMP12_WIDTH == 16, "NCT375 temperature field");
+_Static_assert(NCT375_TEMP12_DECODE(NCT375_TEMP12_ENCODE(-55 * 16)) == -55 * 16, "NCT375 temperature encoding");
+_Static_assert(NCT375_TEMP12_DECODE(NCT375_TEMP12_ENCODE(125 * 16)) == 125 * 16, "NCT375 temperature encoding");
+_Static_assert(NCT375_TEMP12_DECODE(0xFFF0) == -1, "NCT375 temperature encoding");
+
+#endif /* NCT375_REGS_H_ */
@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------------
+ * notify.h
+ * - Notification policy of the characteristics that notify measured values
+ *   (temperature, temperatures of all sensors, timeout and RSSI average).
+ *   Each one has its own policy:
+ *   > deadband: a new value is notified only if it differs by at least the
+ *     deadband from the last notified value (any entry of an array), in the
+ *     unit of the characteristic; 0 notifies every value
+ *   > minimum interval (s): notifications are at least this far apart; a
+ *     change held back is notified once the interval has elapsed
+ *   > maximum interval (s): the value is notified again after this time even
+ *     if it didn't change (heartbeat), 0 for none
+ *   The first value after the notifications are enabled (CCCD written or new
+ *   connection) is always notified.
+ * - Intervals are measured with the time base tick. The temperatures are
+ *   checked by the sampler for each published sample and polled once a
+ *   second by the application timer for the held back changes and the
+ *   heartbeat; the timeout and the RSSI are checked once a second.
+ * - NOTIFY POLICY characteristic: reading returns the policy of every
+ *   channel (deadband, minimum and maximum interval, uint16 each, in
+ *   notify_channel_t order). Writing a channel (uint8), deadband, minimum
+ *   and maximum interval (uint16 each) changes the policy of that channel,
+ *   stored in the settings flash. Policies with a minimum interval above the
+ *   maximum interval are discarded.
+ * ------------------------------------------------------------------------- */
+
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+typedef enum
+{
+	NOTIFY_TEMPERATURE,
+	NOTIFY_TEMPERATURE_ALL,
+	NOTIFY_TIMEOUT,
+	NOTIFY_RSSI_AVG,
+	NOTIFY_CHANNEL_MAX
+} notify_channel_t;
+
+/* Largest array notified by a channel (TEMPERATURE ALL, NCT375_MAX_DEVICES) */
+#define NOTIFY_VALUES_MAX               8
+
+/* Default policy: any change, no rate limit, heartbeat every minute */
+#define NOTIFY_MIN_INTERVAL_DEFAULT     0
+#define NOTIFY_MAX_INTERVAL_DEFAULT     60
+
+/* NOTIFY POLICY characteristic: one entry per channel when read, channel and
+ * entry when written */
+#define NOTIFY_ENTRY_SIZE               6
+#define NOTIFY_POLICY_SIZE              (NOTIFY_CHANNEL_MAX * NOTIFY_ENTRY_SIZE)
+#define NOTIFY_WRITE_SIZE               (1 + NOTIFY_ENTRY_SIZE)
+
+/* Intervals stored as one setting: minimum in the low, maximum in the high
+ * half */
+#define NOTIFY_INTERVAL_PACK(min, max)  (((uint32_t)(max) << 16) | (uint16_t)(min))
+#define NOTIFY_INTERVAL_MIN(value)      ((uint16_t)((value) & 0xFFFF))
+#define NOTIFY_INTERVAL_MAX(value)      ((uint16_t)((value) >> 16))
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct notify_policy_tag
+{
+	uint16_t deadband;
+	uint16_t min_interval;
+	uint16_t max_interval;
+};
+
+struct notify_channel_tag
+{
+	struct notify_policy_tag policy;
+
+	/* Last notified value and its time (time base tick); a change held back
+	 * by the minimum interval is pending */
+	bool sent;
+	bool pending;
+	uint32_t time;
+	int16_t value[NOTIFY_VALUES_MAX];
+};
+
+struct notify_env_tag
+{
+	struct notify_channel_tag channel[NOTIFY_CHANNEL_MAX];
+};
+
+extern struct notify_env_tag notify_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Notify_Init(void);
+bool Notify_Policy_Set(uint8_t channel, uint16_t deadband,
+                       uint16_t min_interval, uint16_t max_interval);
+void Notify_Policy_Value(uint8_t *value);
+bool Notify_Check(uint8_t channel, const int16_t *value, uint8_t count, bool enabled);
+bool Notify_Poll(uint8_t channel, const int16_t *value, uint8_t count, bool enabled);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOTIFY_H */
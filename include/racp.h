@@ -0,0 +1,104 @@
+/* ----------------------------------------------------------------------------
+ * racp.h
+ * - Record access control point, modelled on the Record Access Control Point
+ *   of the Bluetooth SIG profiles: a gateway counts, reports or deletes the
+ *   records of the sample history (history.h) selected by sequence number or
+ *   by time, so it fetches only the records it is missing.
+ * - A record is a history block. Its time is the record time of the block
+ *   (see history.h): the blocks reported for "at or after T" hold every
+ *   sample kept from T on. Times are seconds since reset, like the history
+ *   timestamps.
+ * - Written value: opcode (uint8), operator (uint8), then for the operators
+ *   with an operand the filter type (uint8) and the operand: one value
+ *   (uint32) for LESS_OR_EQUAL and GREATER_OR_EQUAL, minimum and maximum
+ *   (uint32 each) for RANGE.
+ * - The records are reported in HISTORY DATA notifications, like a download;
+ *   the response is notified once the last one has been handed to the stack.
+ *   Count responses and the other responses are notified right after the
+ *   command: RACP_OP_COUNT_RESPONSE, RACP_OPERATOR_NULL, count (uint16,
+ *   saturated) or RACP_OP_RESPONSE, RACP_OPERATOR_NULL, request opcode,
+ *   response code.
+ * - The characteristic notifies instead of indicating the responses; the
+ *   records are only deleted from the oldest one on.
+ * ------------------------------------------------------------------------- */
+
+#ifndef RACP_H
+#define RACP_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+typedef enum
+{
+	RACP_OP_REPORT = 0x01,
+	RACP_OP_DELETE = 0x02,
+	RACP_OP_ABORT = 0x03,
+	RACP_OP_REPORT_COUNT = 0x04,
+	RACP_OP_COUNT_RESPONSE = 0x05,
+	RACP_OP_RESPONSE = 0x06
+} racp_op_t;
+
+typedef enum
+{
+	RACP_OPERATOR_NULL = 0x00,
+	RACP_OPERATOR_ALL = 0x01,
+	RACP_OPERATOR_LESS_OR_EQUAL = 0x02,
+	RACP_OPERATOR_GREATER_OR_EQUAL = 0x03,
+	RACP_OPERATOR_RANGE = 0x04,
+	RACP_OPERATOR_FIRST = 0x05,
+	RACP_OPERATOR_LAST = 0x06
+} racp_operator_t;
+
+/* Filter types: block sequence number or record time (s since reset) */
+typedef enum
+{
+	RACP_FILTER_SEQ = 0x01,
+	RACP_FILTER_TIME = 0x02
+} racp_filter_t;
+
+typedef enum
+{
+	RACP_SUCCESS = 0x01,
+	RACP_OPCODE_NOT_SUPPORTED = 0x02,
+	RACP_INVALID_OPERATOR = 0x03,
+	RACP_OPERATOR_NOT_SUPPORTED = 0x04,
+	RACP_INVALID_OPERAND = 0x05,
+	RACP_NO_RECORDS_FOUND = 0x06,
+	RACP_ABORT_UNSUCCESSFUL = 0x07,
+	RACP_PROCEDURE_NOT_COMPLETED = 0x08,
+	RACP_OPERAND_NOT_SUPPORTED = 0x09
+} racp_response_t;
+
+/* Longest command: opcode, operator, filter type, minimum, maximum */
+#define RACP_SIZE                       11
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void RACP_Command(const uint8_t *command, uint16_t length);
+void RACP_Report_Done(void);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RACP_H */
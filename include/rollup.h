@@ -0,0 +1,113 @@
+/* ----------------------------------------------------------------------------
+ * rollup.h
+ * - Rollup tiers of the sample history: the raw samples of the last minutes
+ *   to hours are kept by the history (history.h) and the flash log, older
+ *   ones as mean, min and max over buckets of 1 minute (last hours) and of
+ *   15 minutes (last weeks).
+ * - The rollups are computed incrementally from each published sample: the
+ *   bucket in progress of each sensor and tier is a running sum, count, min
+ *   and max. A bucket is closed by the first sample of a later bucket, or by
+ *   Rollup_Flush once its period is over.
+ * - Closed rollups are collected in rollup blocks of up to
+ *   CODEC_ROLLUP_RECORDS (see codec.h, 2 to 3 bytes a rollup for a room
+ *   temperature), kept in a ring per tier; when a ring is full the oldest
+ *   blocks are overwritten.
+ * - Buckets are aligned on the history time (seconds since reset). A tier is
+ *   downloaded through the HISTORY CTRL control point (HISTORY_OP_ROLLUP),
+ *   like the history, with its own block sequence numbers. The rollups are
+ *   lost on a reset.
+ * ------------------------------------------------------------------------- */
+
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "sensor.h"
+#include "codec.h"
+#include "history.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Tiers: bucket period (s) and ring size (power of 2, within
+ * HISTORY_RAM_BUDGET). The rings are shared by all the sensors: about 910
+ * minute and 1280 quarter rollups, 15 hours and 13 days of one sensor (see
+ * the retention per sensor count in README.md). */
+typedef enum
+{
+	ROLLUP_TIER_MINUTE,
+	ROLLUP_TIER_QUARTER,
+	ROLLUP_TIERS
+} rollup_tier_t;
+
+#define ROLLUP_MINUTE_PERIOD            60
+#define ROLLUP_MINUTE_BUFFER_SIZE       2048
+#define ROLLUP_QUARTER_PERIOD           900
+#define ROLLUP_QUARTER_BUFFER_SIZE      4096
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Bucket in progress of a sensor */
+struct rollup_bucket_tag
+{
+	uint32_t index;                         /* Bucket start / period */
+	int32_t sum;
+	uint16_t count;                         /* Samples, 0 if none yet */
+	int16_t min;
+	int16_t max;
+};
+
+struct rollup_tier_tag
+{
+	/* Bucket period (s) and closed rollup blocks */
+	uint16_t period;
+	struct history_ring_tag ring;
+
+	/* Bucket in progress and open rollup block of each sensor */
+	struct rollup_bucket_tag bucket[SENSOR_MAX];
+	struct codec_rollup_tag block[SENSOR_MAX];
+};
+
+struct rollup_env_tag
+{
+	struct rollup_tier_tag tier[ROLLUP_TIERS];
+	uint8_t minute_buffer[ROLLUP_MINUTE_BUFFER_SIZE];
+	uint8_t quarter_buffer[ROLLUP_QUARTER_BUFFER_SIZE];
+
+	/* Encoding buffer */
+	uint8_t encoded[CODEC_ROLLUP_SIZE_MAX];
+};
+
+extern struct rollup_env_tag rollup_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Rollup_Init(void);
+void Rollup_Add(uint8_t sensor, int16_t value);
+void Rollup_Flush(void);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROLLUP_H */
@@ -0,0 +1,172 @@
+/* ----------------------------------------------------------------------------
+ * sampler.h
+ * - Sampling engine: schedules the conversions of all registered sensors
+ *   (see sensor.h) in batches, filters the results and publishes them.
+ * - The engine runs from the sampler timer and the I2C completion interrupts,
+ *   the CPU doesn't wait for the sensors. The values are recorded there and
+ *   sent over BLE and UART by Sampler_Resume from the main loop.
+ * ------------------------------------------------------------------------- */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include "sensor.h"
+#include "filter.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Power modes, selected at runtime (POWER MODE characteristic) and kept in the settings flash:
+ * - FULL_POWER: the sensors are in continuous conversion out of BLE connection time too. It is the maximal power
+ *   consumption mode.
+ * - NORMAL: continuous conversion during the BLE connection time (the nct375 temperature register is updated every
+ *   80 ms). Out of BLE connection, the sensors are in shutdown mode. All circuitry except interface are powered down.
+ * - ONE_SHOT: power save mode, a single conversion is started for each sample, then the sensors are shutting down
+ *   again.
+ * - ALERT: no polling. The sensors keep converting with their thresholds programmed (nct375 THYST and TOS), the values
+ *   are only read and notified when the ALERT line signals a crossing of the band.
+ * - GATED: the sensor supply (I2C_PWR_DIO_NUM) and the bus pull-ups are cut between two samples, in and out of BLE
+ *   connection. For each sample the supply is restored, the sensors are configured after SAMPLER_SUPPLY_SETTLE_TICKS
+ *   and powered off again once read. Neither the shutdown current nor the pull-up leakage is left.
+ * SAMPLER_MODE_DEFAULT is used until a mode is stored. */
+typedef enum
+{
+	SAMPLER_MODE_FULL_POWER,
+	SAMPLER_MODE_NORMAL,
+	SAMPLER_MODE_ONE_SHOT,
+	SAMPLER_MODE_ALERT,
+	SAMPLER_MODE_GATED,
+	SAMPLER_MODE_MAX
+} sampler_mode_t;
+
+#define SAMPLER_MODE_DEFAULT            SAMPLER_MODE_FULL_POWER
+
+/* Sampler timer: the single timer paces the samples and waits for the end of
+ * the conversions. Ticks are SLOWCLK/64 (64 us with a 1 MHz SLOWCLK). The
+ * timer interrupt has to use the same priority as the I2C interrupt. */
+#define SAMPLER_TIMER                   0
+#define SAMPLER_TIMER_SELECT            SELECT_TIMER0
+#define SAMPLER_TIMER_IRQn              TIMER0_IRQn
+#define SAMPLER_TIMER_IRQHandler        TIMER0_IRQHandler
+#define SAMPLER_PERIOD_TICKS            14000
+#define SAMPLER_TICKS_PER_S             15625
+#define SAMPLER_TIMER_MAX_TICKS         0xFFFFFF    /* longer waits are split */
+
+/* Adaptive sample period, in the periodic modes: doubled after each sample up
+ * to the maximum period (s) while the fastest change of all sensors stays below
+ * half the rate threshold (0.01 unit/min), back to SAMPLER_PERIOD_TICKS as
+ * soon as it exceeds the threshold. A maximum period of 0 keeps the period
+ * fixed. */
+#define SAMPLER_RATE_MAX_PERIOD_DEFAULT 0
+#define SAMPLER_RATE_THRESHOLD_DEFAULT  50
+
+/* Gated mode: time from the supply switched on until the sensors answer on the
+ * bus (power-on reset, supply and pull-up rise time) */
+#define SAMPLER_SUPPLY_SETTLE_TICKS     160
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Sampler states */
+typedef enum
+{
+	SAMPLER_IDLE,
+	SAMPLER_SETTLING,
+	SAMPLER_POWERUP,
+	SAMPLER_CONVERTING,
+	SAMPLER_READING,
+	SAMPLER_POWERDOWN
+} sampler_state_t;
+
+struct sampler_env_tag
+{
+	/* Registered sensors */
+	uint8_t nb_sensor;
+	struct sensor_tag sensor[SENSOR_MAX];
+
+	volatile sampler_state_t state;
+
+	/* Power mode (sampler_mode_t), reconfigure set when it or the sensor
+	 * thresholds have been changed */
+	uint8_t mode;
+	volatile bool reconfigure;
+
+	/* Set by an ALERT line event not handled yet */
+	volatile bool alert;
+
+	/* Sensors in continuous conversion */
+	bool powered;
+
+	/* Filter stage: parameters, state of each sensor, conversions done in the
+	 * current burst and filter outputs since the last publication. refilter
+	 * clears the filter history at the start of the next burst. */
+	struct filter_param_tag filter_param;
+	struct filter_tag filter[SENSOR_MAX];
+	uint8_t burst;
+	uint8_t decimation;
+	volatile bool refilter;
+
+	/* Filtered values of the last publication, publish set until they are
+	 * sent by Sampler_Resume */
+	int16_t value[SENSOR_MAX];
+	volatile bool publish;
+
+	/* Adaptive sample period: maximum (s) and rate threshold (0.01 unit/min),
+	 * current period and ticks left of a wait longer than the timer range */
+	uint16_t max_period;
+	uint16_t rate_threshold;
+	uint32_t period;
+	volatile uint32_t delay;
+
+	/* Set when the period changed, until it is notified by Sampler_Resume */
+	volatile bool period_changed;
+
+	/* Fastest change of all sensors at the last sample (0.01 unit/min) */
+	uint16_t rate;
+
+	/* Sensor supply and bus pull-ups on (off between samples in gated mode) */
+	bool supplied;
+
+	/* Number of operations of the current batch not completed yet */
+	volatile uint8_t pending;
+};
+
+extern struct sampler_env_tag sampler_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Sampler_Init(void);
+bool Sampler_Sensor_Add(const struct sensor_driver_tag *driver, void *dev, uint8_t i2c_addr);
+void Sampler_Start(void);
+bool Sampler_Mode_Set(uint8_t mode);
+void Sampler_Reconfigure(void);
+void Sampler_Alert(void);
+bool Sampler_Filter_Set(const struct filter_param_tag *param);
+bool Sampler_Rate_Set(uint16_t max_period, uint16_t threshold);
+uint32_t Sampler_Period_Ms(void);
+void Sampler_Resume(void);
+void SAMPLER_TIMER_IRQHandler(void);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLER_H */
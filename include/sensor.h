@@ -0,0 +1,102 @@
+/* ----------------------------------------------------------------------------
+ * sensor.h
+ * - Sensor driver interface scheduled by the sampler (see sampler.h).
+ * - A driver provides the operations below for one device instance (dev); the
+ *   sampler starts the conversions of all sensors together, waits for the
+ *   longest conversion time and reads them in one burst, so all sensors share
+ *   one wake window and no driver needs its own timer or interrupt.
+ * - The operations with a callback are asynchronous: they return false if the
+ *   operation couldn't be started, otherwise the callback is called once with
+ *   the context, the device and the first error.
+ * ------------------------------------------------------------------------- */
+
+#ifndef SENSOR_H
+#define SENSOR_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Sensors scheduled by the sampler */
+#define SENSOR_MAX                      8
+
+/* Value of a missing or not yet sampled sensor */
+#define SENSOR_VALUE_INVALID            ((int16_t)0x8000)
+
+/* Measured quantity and unit of the decoded value */
+typedef enum
+{
+	SENSOR_QUANTITY_TEMPERATURE,    /* 0.01 degC */
+	SENSOR_QUANTITY_HUMIDITY,       /* 0.01 %RH */
+	SENSOR_QUANTITY_PRESSURE        /* 0.1 hPa */
+} sensor_quantity_t;
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+typedef void (*sensor_callback_t)(void *context, void *dev, i2c_error_code_t status);
+
+struct sensor_driver_tag
+{
+	/* sensor_quantity_t */
+	uint8_t quantity;
+
+	/* Initialize the instance, no bus access */
+	void (*init)(void *dev, uint8_t i2c_addr);
+
+	/* Start a conversion. With continuous set the device keeps converting
+	 * until power_down and its latest conversion can be read at any time. */
+	bool (*start_conversion)(void *dev, bool continuous, sensor_callback_t callback, void *context);
+
+	/* Time from the start of a conversion until it can be read, in sampler
+	 * timer ticks */
+	uint32_t (*conversion_time)(void *dev);
+
+	/* Read the last conversion result from the device */
+	bool (*read)(void *dev, sensor_callback_t callback, void *context);
+
+	/* Value of the last read, SENSOR_VALUE_INVALID if none */
+	int16_t (*decode)(void *dev);
+
+	/* Put the device in its lowest power state until the next conversion.
+	 * With alert set a device with threshold monitoring keeps monitoring and
+	 * signals a crossing on the shared ALERT line. */
+	bool (*power_down)(void *dev, bool alert, sensor_callback_t callback, void *context);
+};
+
+/* Sensor instance scheduled by the sampler */
+struct sensor_tag
+{
+	const struct sensor_driver_tag *driver;
+	void *dev;
+	uint8_t i2c_addr;
+
+	/* Result of the last operation (i2c_error_code_t) */
+	uint8_t status;
+};
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_H */
@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+ * settings.h
+ * - Persistent application settings, kept in one of two sectors of the main
+ *   flash.
+ * - Each setting is a 32-bit value identified by a key. A change is appended
+ *   to the sector in use as one word pair record (key and check word, value).
+ *   When it is full, the other sector is erased and the current value of each
+ *   key is programmed to it, then its header with the next generation number:
+ *   the copy is used from then on. The header is programmed last, so a reset
+ *   during the copy leaves the previous sector in use.
+ * - At start-up the sector with the newest valid header is used and the last
+ *   valid record of each key is loaded.
+ * - The settings sectors must not be used by the application image (keep the
+ *   image below SETTINGS_FLASH_ADDR).
+ * ------------------------------------------------------------------------- */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "notify.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Settings sectors: last two sectors of the main flash */
+#define SETTINGS_SECTORS                2
+#define SETTINGS_SECTOR_SIZE            FLASH_SECTOR_SIZE
+#define SETTINGS_FLASH_SIZE             (SETTINGS_SECTORS * SETTINGS_SECTOR_SIZE)
+#define SETTINGS_FLASH_ADDR             (FLASH_MAIN_TOP + 1 - SETTINGS_FLASH_SIZE)
+
+/* Record layout: word 0 = tag (8 bits) | key (8 bits) | check (16 bits),
+ * word 1 = value. The sector header is the first word pair of the sector, a
+ * record of key SETTINGS_HEADER_KEY whose value is the generation number. */
+#define SETTINGS_RECORD_SIZE            8
+#define SETTINGS_RECORD_TAG             0x5E
+#define SETTINGS_HEADER_KEY             0xFF
+
+/* Setting keys */
+typedef enum
+{
+	SETTINGS_KEY_SENSOR_MODE,
+	SETTINGS_KEY_ALERT_LIMITS,
+	SETTINGS_KEY_FILTER_PARAM,
+	SETTINGS_KEY_ADAPTIVE_RATE,
+
+	/* Notification policy of each channel: deadband, then intervals */
+	SETTINGS_KEY_NOTIFY_DEADBAND,
+	SETTINGS_KEY_NOTIFY_INTERVAL = SETTINGS_KEY_NOTIFY_DEADBAND + NOTIFY_CHANNEL_MAX,
+	SETTINGS_KEY_MAX = SETTINGS_KEY_NOTIFY_INTERVAL + NOTIFY_CHANNEL_MAX
+} settings_key_t;
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct settings_env_tag
+{
+	/* Last stored value of each key */
+	uint32_t value[SETTINGS_KEY_MAX];
+	bool valid[SETTINGS_KEY_MAX];
+
+	/* Sector in use (0 if none yet) and its generation number, address of
+	 * the next free record */
+	uint32_t sector;
+	uint32_t generation;
+	uint32_t next;
+};
+
+extern struct settings_env_tag settings_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Settings_Init(void);
+uint32_t Settings_Read(settings_key_t key, uint32_t default_value);
+bool Settings_Write(settings_key_t key, uint32_t value);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETTINGS_H */
@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+ * spiflash.h
+ * - Driver of an external SPI NOR flash (JEDEC commands, 3-byte addresses,
+ *   256-byte pages, 4 KB sectors) on SPI0, used by the sample archive (see
+ *   archive.h).
+ * - One operation at a time. Read, program and erase are asynchronous: they
+ *   return false if the flash is busy, otherwise the callback is called once
+ *   from the DMA or timer interrupt with the result. The command bytes are
+ *   sent by the CPU, the data is moved by the DMA channel SPIFLASH_DMA_CHANNEL
+ *   straight between the SPI interface and the caller's buffer.
+ * - After a program or erase command the status register is polled from the
+ *   timer SPIFLASH_TIMER until the write is completed or its deadline has
+ *   passed; the CPU is free in between.
+ * - Chip select is driven as a GPIO, so it stays low over the command and the
+ *   DMA payload.
+ * ------------------------------------------------------------------------- */
+
+#ifndef SPIFLASH_H
+#define SPIFLASH_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* Flash geometry (8 Mbit, e.g. MX25R8035F) */
+#define SPIFLASH_SIZE                   0x100000
+#define SPIFLASH_PAGE_SIZE              256
+#define SPIFLASH_SECTOR_SIZE            4096
+
+/* Commands */
+#define SPIFLASH_CMD_READ               0x03
+#define SPIFLASH_CMD_PROGRAM            0x02
+#define SPIFLASH_CMD_ERASE_SECTOR       0x20
+#define SPIFLASH_CMD_WRITE_ENABLE       0x06
+#define SPIFLASH_CMD_READ_STATUS        0x05
+#define SPIFLASH_CMD_READ_ID            0x9F
+#define SPIFLASH_CMD_RELEASE_PD         0xAB
+#define SPIFLASH_STATUS_WIP             0x01
+
+/* SPI0 clock: SYSCLK / 2 */
+#define SPIFLASH_SPI_PRESCALE           SPI0_PRESCALE_2
+
+/* DMA channel moving the data (I2C uses channel 0) */
+#define SPIFLASH_DMA_CHANNEL            1
+#define SPIFLASH_DMA_IRQn               DMA1_IRQn
+#define SPIFLASH_DMA_IRQHandler         DMA1_IRQHandler
+
+/* Status polling timer. Ticks are SLOWCLK/64 (64 us with a 1 MHz SLOWCLK).
+ * A page program takes 0.85 ms typ., 10 ms max., a sector erase 40 ms typ.,
+ * 240 ms max. (MX25R8035F in low power mode); the deadlines leave a margin. */
+#define SPIFLASH_TIMER                  1
+#define SPIFLASH_TIMER_SELECT           SELECT_TIMER1
+#define SPIFLASH_TIMER_IRQn             TIMER1_IRQn
+#define SPIFLASH_TIMER_IRQHandler       TIMER1_IRQHandler
+#define SPIFLASH_PROGRAM_POLL_TICKS     16
+#define SPIFLASH_PROGRAM_TIMEOUT_TICKS  313
+#define SPIFLASH_ERASE_POLL_TICKS       156
+#define SPIFLASH_ERASE_TIMEOUT_TICKS    6250
+
+/* Operation in progress */
+typedef enum
+{
+	SPIFLASH_OP_IDLE,
+	SPIFLASH_OP_READ,
+	SPIFLASH_OP_PROGRAM,
+	SPIFLASH_OP_ERASE
+} spiflash_op_t;
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+/* Operation completion callback, called from the DMA or timer interrupt */
+typedef void (*spiflash_callback_t)(void *context, bool result);
+
+struct spiflash_env_tag
+{
+	/* JEDEC ID (manufacturer, type, capacity), false if no flash answered */
+	uint32_t id;
+	bool present;
+
+	/* Operation in progress, its callback and the time left until the
+	 * deadline of a program or erase (timer ticks) */
+	volatile uint8_t op;
+	spiflash_callback_t callback;
+	void *context;
+	uint16_t poll_ticks;
+	uint16_t ticks_left;
+
+	/* Failed operations (deadline passed) */
+	uint16_t errors;
+};
+
+extern struct spiflash_env_tag spiflash_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void SPIFlash_Init(void);
+bool SPIFlash_Idle(void);
+void SPIFlash_Read_Wait(uint32_t addr, uint8_t *data, uint16_t length);
+bool SPIFlash_Read(uint32_t addr, uint8_t *data, uint16_t length,
+                   spiflash_callback_t callback, void *context);
+bool SPIFlash_Program(uint32_t addr, const uint8_t *data, uint16_t length,
+                      spiflash_callback_t callback, void *context);
+bool SPIFlash_Erase(uint32_t addr, spiflash_callback_t callback, void *context);
+void SPIFLASH_DMA_IRQHandler(void);
+void SPIFLASH_TIMER_IRQHandler(void);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPIFLASH_H */
@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+ * stats.h
+ * - Running statistics of each sensor since reset (or since their reset by
+ *   the client): number of samples, min, max, mean and variance, updated
+ *   for every published sample, so a client reads the aggregates instead of
+ *   following every notification.
+ * - Mean and variance follow Welford's algorithm in fixed point:
+ *     n += 1, d = x - mean, mean += d / n, m2 += d * (x - mean)
+ *   with the mean in 1/2^32 of the sensor unit and m2 (sum of the squared
+ *   deviations) in 1/2^16 of the unit squared. m2 saturates after
+ *   2^47 / variance samples (years of samples of a temperature), the
+ *   variance is then too low.
+ * - STATISTICS characteristic: per sensor (SENSOR_MAX entries of
+ *   STATS_ENTRY_SIZE bytes) the number of samples (uint32, 0 if none), min
+ *   and max (int16), mean (int32, 1/256 of the sensor unit) and sample
+ *   variance (uint32, unit squared, saturated). Writing a sensor mask
+ *   (uint8, bit i for sensor i) resets the statistics of these sensors.
+ * ------------------------------------------------------------------------- */
+
+#ifndef STATS_H
+#define STATS_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+#include "sensor.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+#define STATS_ENTRY_SIZE                16
+#define STATS_SIZE                      (SENSOR_MAX * STATS_ENTRY_SIZE)
+
+/* Fractional bits of the mean and of m2 */
+#define STATS_MEAN_SHIFT                32
+#define STATS_M2_SHIFT                  16
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct stats_sensor_tag
+{
+	uint32_t count;
+	int16_t min;
+	int16_t max;
+	int64_t mean;
+	int64_t m2;
+};
+
+struct stats_env_tag
+{
+	struct stats_sensor_tag sensor[SENSOR_MAX];
+};
+
+extern struct stats_env_tag stats_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void Stats_Init(void);
+void Stats_Add(uint8_t sensor, int16_t value);
+void Stats_Reset(uint8_t mask);
+void Stats_Value(uint8_t *value);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H */
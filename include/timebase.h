@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * timebase.h
+ * - Device time base: a monotonic tick counted by the RTC of the analog
+ *   control system, which keeps running through sleep. The RTC counts down
+ *   from TIMEBASE_RTC_START and reloads at 0; its complement is the 32-bit
+ *   tick (TIMEBASE_TICK_HZ, wraps every 36 h, compare modulo 2^32). The tick
+ *   is extended to 64 bits by every reader, at least once a second from the
+ *   application timer, so the seconds since reset (the history timestamps)
+ *   never wrap.
+ * - Wall clock: a central writes the Current Time characteristic of the
+ *   Current Time Service (date, time, fractions of 1/256 s, adjust reason),
+ *   which anchors the tick to its time. The wall time follows from the last
+ *   anchor, corrected by the rate error of the RTC clock.
+ * - Drift: at a sync at least TIMEBASE_DRIFT_INTERVAL after the drift
+ *   reference (the previous sync used for the estimate), the difference
+ *   between the written time and the time projected from the reference
+ *   corrects the rate error, in units of 2^-32. Manual updates, time zone
+ *   and DST changes, and time jumps larger than the RTC clock tolerance only
+ *   move the anchor (and restart the drift reference).
+ * - The anchor and the drift are lost on a reset; the wall time is unknown
+ *   until the next sync.
+ * ------------------------------------------------------------------------- */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+/* ----------------------------------------------------------------------------
+ * If building with a C++ compiler, make all of the definitions in this header
+ * have a C binding.
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Include files
+ * --------------------------------------------------------------------------*/
+#include <rsl10.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * --------------------------------------------------------------------------*/
+
+/* RTC clocked by the 32 kHz RC oscillator, which runs in every power mode.
+ * Its frequency error (up to a few %) is what the drift estimate corrects. */
+#define TIMEBASE_RTC_START              0xFFFFFFFF
+#define TIMEBASE_RTC_CFG                (RTC_ALARM_ZERO | RTC_CNT_START | RTC_CLK_SRC_RC_OSC)
+#define TIMEBASE_TICK_HZ                32768
+#define TIMEBASE_TICK_SHIFT             15
+
+/* Minimum time between the syncs of a drift estimate, largest rate error
+ * accepted (2^-32 units, about 6 %), and error allowed on top of it before a
+ * sync is taken as a time jump (latency of the write) */
+#define TIMEBASE_DRIFT_INTERVAL         (3600ULL * TIMEBASE_TICK_HZ)
+#define TIMEBASE_DRIFT_MAX              0x10000000
+#define TIMEBASE_JUMP_MIN               (2 * TIMEBASE_TICK_HZ)
+
+/* Current Time characteristic: year (uint16), month, day, hours, minutes,
+ * seconds, day of week (1 Monday to 7 Sunday), fractions (1/256 s), adjust
+ * reason; all zero while the wall time is unknown */
+#define TIMEBASE_CTS_SIZE               10
+#define TIMEBASE_CTS_DATE_SIZE          7
+#define TIMEBASE_YEAR_MIN               1970
+#define TIMEBASE_YEAR_MAX               2105
+
+/* Adjust reasons that move the wall clock rather than correct its rate */
+#define TIMEBASE_ADJUST_MANUAL          0x01
+#define TIMEBASE_ADJUST_TIME_ZONE       0x04
+#define TIMEBASE_ADJUST_DST             0x08
+
+/* TIME BASE characteristic: seconds since reset (uint32, the history time),
+ * tick (uint32), wall time (uint32, s since 1970-01-01 in the time zone of
+ * the central, 0 if unknown), rate error (int32, ppb), number of syncs
+ * (uint16), all read at the same instant */
+#define TIMEBASE_STATUS_SIZE            18
+
+/* ----------------------------------------------------------------------------
+ * Global variables and types
+ * --------------------------------------------------------------------------*/
+
+struct timebase_env_tag
+{
+	/* Ticks since reset, RTC tick at their last update */
+	uint64_t ticks;
+	uint32_t last;
+
+	/* Wall time (ticks since 1970) at the anchor and at the drift
+	 * reference, with their device ticks, rate error (2^-32) and syncs */
+	bool synced;
+	uint64_t anchor;
+	uint64_t anchor_wall;
+	uint64_t reference;
+	uint64_t reference_wall;
+	int32_t drift;
+	uint16_t syncs;
+};
+
+extern struct timebase_env_tag timebase_env;
+
+/* ----------------------------------------------------------------------------
+ * Function prototype definitions
+ * --------------------------------------------------------------------------*/
+void TimeBase_Init(void);
+uint32_t TimeBase_Ticks(void);
+uint32_t TimeBase_Seconds(void);
+bool TimeBase_Sync(const uint8_t *time, uint16_t length);
+void TimeBase_Current_Time(uint8_t *time);
+void TimeBase_Status(uint8_t *status);
+
+/* ----------------------------------------------------------------------------
+ * Close the 'extern "C"' block
+ * ------------------------------------------------------------------------- */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H */
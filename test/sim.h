@@ -0,0 +1,218 @@
+/* ----------------------------------------------------------------------------
+ * sim.h
+ * - Host models of the RSL10 peripherals used by the application modules,
+ *   for the tests in this directory.
+ * - Time is counted in microseconds. Peripheral models schedule their events
+ *   (end of a transfer, timer expiry), Sim_Run runs them in time order and
+ *   calls the interrupt handlers they make pending. Interrupts don't nest
+ *   and wait while PRIMASK is set, as all the application interrupts have
+ *   the same priority. sim_thread stands for the main loop, it runs after
+ *   the handlers as the kernel does after SYS_WAIT_FOR_EVENT.
+ * - DMA and main flash addresses are passed as 32-bit values by the
+ *   application: the tests are linked without PIE so that the static buffers
+ *   are below 4 GB (Sim_Ptr).
+ * ------------------------------------------------------------------------- */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "app.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <setjmp.h>
+
+/* Checks that stay on with NDEBUG */
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #cond);                                                  \
+            exit(1);                                                         \
+        }                                                                    \
+    } while (0)
+
+/* ----------------------------------------------------------------------------
+ * Time, interrupts, main loop
+ * --------------------------------------------------------------------------*/
+#define SIM_TIMER_TICK_US               64
+#define SIM_TIMER_NUM                   4
+#define SIM_TIMER_LOG_SIZE              64
+#define SIM_DMA_NUM                     4
+#define SIM_DIO_NUM                     16
+
+extern uint64_t sim_now;
+extern bool sim_isr;
+extern uint32_t sim_irq_count[SIM_IRQ_MAX];
+extern void (*sim_thread)(void);
+
+void Sim_Reset(void);
+void Sim_Irq_Pend(IRQn_Type irq);
+void Sim_Schedule(uint64_t at, void (*fn)(uintptr_t), uintptr_t arg);
+void Sim_Cancel(void (*fn)(uintptr_t), uintptr_t arg);
+void Sim_Run(uint64_t until);
+void *Sim_Ptr(uint32_t addr);
+
+/* ----------------------------------------------------------------------------
+ * Timers: the timeout field of the control word in SIM_TIMER_TICK_US ticks,
+ * the timeouts of the starts are logged
+ * --------------------------------------------------------------------------*/
+struct sim_timer_tag
+{
+	uint32_t control;
+	bool armed;
+	uint32_t starts;
+	uint32_t log[SIM_TIMER_LOG_SIZE];
+};
+
+extern struct sim_timer_tag sim_timer[SIM_TIMER_NUM];
+
+/* ----------------------------------------------------------------------------
+ * DMA channels: configured by the application, moved by the peripheral
+ * model that owns the source or destination
+ * --------------------------------------------------------------------------*/
+struct sim_dma_tag
+{
+	uint32_t config;
+	uint32_t length;
+	uint32_t src;
+	uint32_t dest;
+	bool enabled;
+};
+
+extern struct sim_dma_tag sim_dma[SIM_DMA_NUM];
+
+int Sim_Dma_Find(uint32_t select);
+void Sim_Dma_Done(uint32_t num, uint64_t at);
+
+/* ----------------------------------------------------------------------------
+ * DIO: pad configuration and output level, peripheral models attach to the
+ * pads with a hook
+ * --------------------------------------------------------------------------*/
+extern uint32_t sim_dio_cfg[SIM_DIO_NUM];
+extern void (*sim_gpio_hook[2])(uint32_t dio, bool high);
+
+/* ----------------------------------------------------------------------------
+ * SPI0: bytes are exchanged with the attached device, MISO is pulled up
+ * --------------------------------------------------------------------------*/
+#define SIM_SPI_BYTE_US                 2
+
+extern uint8_t (*sim_spi_device)(uint8_t tx);
+
+/* ----------------------------------------------------------------------------
+ * SPI NOR flash (sim_nor.c) on SPI0, chip select SPI_CS_DIO_NUM (GPIO hook
+ * 1), JEDEC ID SIM_NOR_ID. A program or erase needs the write enable latch,
+ * starts when the flash is deselected and sets WIP for program_us or
+ * erase_us (typical times by default); the driver must not send another
+ * command meanwhile. Sim_Nor_Cut cuts the power: the program or erase in
+ * progress is left half done, a random part of the bytes changed. Sim_Reset
+ * detaches the model, Sim_Nor_Attach attaches it with the memory kept.
+ * --------------------------------------------------------------------------*/
+#define SIM_NOR_ID                      0xC22814
+#define SIM_NOR_PROGRAM_US              850
+#define SIM_NOR_ERASE_US                40000
+
+struct sim_nor_tag
+{
+	uint8_t mem[SPIFLASH_SIZE];
+	uint32_t program_us;
+	uint32_t erase_us;
+	uint64_t busy_until;
+	bool wel;
+	uint32_t programs;
+	uint32_t erases;
+	uint32_t status_reads;
+	uint32_t sector_erases[SPIFLASH_SIZE / SPIFLASH_SECTOR_SIZE];
+};
+
+extern struct sim_nor_tag sim_nor;
+
+void Sim_Nor_Reset(void);
+void Sim_Nor_Attach(void);
+void Sim_Nor_Cut(void);
+
+/* ----------------------------------------------------------------------------
+ * I2C (sim_i2c.c): the master and one slave that has an address pointer set
+ * by the first byte written, its registers in mem. Each write or read
+ * phase starts at the pointer. With a non-zero stride register r takes
+ * the stride bytes at mem[r * stride] and a phase wraps within it (0: one
+ * byte per register, a phase runs on through mem). The transfers of the
+ * interface are counted. The faults of the script are taken one per START
+ * (arg: index of the data byte not acknowledged, or SCL clocks until the
+ * slave releases SDA), stuck is the number of clocks SDA is still held low.
+ * --------------------------------------------------------------------------*/
+#define SIM_I2C_BYTE_US                 24
+#define SIM_I2C_DATA_EMPTY              0x100
+#define SIM_I2C_SCRIPT_SIZE             16
+
+enum sim_i2c_fault
+{
+	SIM_I2C_ACK,
+	SIM_I2C_NACK_ADDRESS,
+	SIM_I2C_NACK_DATA,
+	SIM_I2C_BUS_ERROR,
+	SIM_I2C_HANG
+};
+
+struct sim_i2c_fault_tag
+{
+	uint8_t fault;
+	uint16_t arg;
+};
+
+struct sim_i2c_tag
+{
+	uint8_t mem[256];
+	uint8_t pointer;
+	uint8_t stride;
+	uint32_t starts;
+	uint32_t stops;
+	uint32_t bytes_tx;
+	uint32_t bytes_rx;
+	struct sim_i2c_fault_tag script[SIM_I2C_SCRIPT_SIZE];
+	uint8_t script_length;
+	uint8_t script_pos;
+	uint32_t stuck;
+	uint32_t recovery_clocks;
+	uint32_t recovery_stops;
+};
+
+extern struct sim_i2c_tag sim_i2c_bus;
+
+void Sim_I2C_Reset(void);
+
+/* ----------------------------------------------------------------------------
+ * RTC: counts down at 32768 Hz times the rate of Sim_Rtc_Rate
+ * --------------------------------------------------------------------------*/
+void Sim_Rtc_Rate(double rate);
+
+/* ----------------------------------------------------------------------------
+ * Main flash (sim_flash.c): sim_flash_cut counts down the erases and word
+ * pair writes, the one started at 0 is cut by a power loss (-1: none). It
+ * is left half done, a random part of the sector erased or of the bits
+ * cleared, and the application stops there: the model jumps to
+ * sim_flash_cut_jump.
+ * --------------------------------------------------------------------------*/
+extern uint32_t sim_flash_erases;
+extern uint32_t sim_flash_writes;
+extern int32_t sim_flash_cut;
+extern jmp_buf sim_flash_cut_jump;
+
+void Sim_Flash_Erase_All(void);
+
+/* ----------------------------------------------------------------------------
+ * Kernel and BLE stack: notifications are passed to sim_ntf_hook when
+ * sent. Messages must be allocated, sent and freed from the main loop,
+ * Sim_Reset frees them all.
+ * --------------------------------------------------------------------------*/
+#define SIM_MSG_POOL_SIZE               16
+#define SIM_MSG_SIZE                    512
+
+extern void (*sim_ntf_hook)(void *attr, const uint8_t *value, uint16_t length,
+                            uint16_t seq_num);
+extern int sim_msg_used;
+extern uint32_t sim_ntf_count;
+
+#endif /* SIM_H */
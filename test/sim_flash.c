@@ -0,0 +1,87 @@
+/* ----------------------------------------------------------------------------
+ * sim_flash.c
+ * - Host model of the top sectors of the main flash: an erase sets a sector
+ *   to 0xFF, a word pair is programmed once after an erase (bits can only be
+ *   cleared) and needs the write enable of FLASH->MAIN_CTRL
+ * - Power cuts: see sim.h
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Global variable definition */
+FLASH_Type sim_flash_regs;
+uint8_t sim_flash[SIM_FLASH_SIZE] __attribute__((aligned(FLASH_SECTOR_SIZE)));
+uint32_t sim_flash_erases;
+uint32_t sim_flash_writes;
+int32_t sim_flash_cut = -1;
+jmp_buf sim_flash_cut_jump;
+
+void Sim_Flash_Erase_All(void)
+{
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    memset(&sim_flash_regs, 0, sizeof(sim_flash_regs));
+    sim_flash_cut = -1;
+}
+
+/* Power cut before the end of the current operation */
+static bool Sim_Flash_Cut(void)
+{
+    if (sim_flash_cut < 0)
+    {
+        return false;
+    }
+    return sim_flash_cut-- == 0;
+}
+
+static bool Sim_Flash_Enabled(void)
+{
+    return (sim_flash_regs.MAIN_CTRL & MAIN_HIGH_W_ENABLE) &&
+           sim_flash_regs.MAIN_WRITE_UNLOCK == FLASH_MAIN_KEY;
+}
+
+FlashStatus Flash_EraseSector(uint32_t addr)
+{
+    uint8_t *p = Sim_Ptr(addr);
+    uint32_t start;
+
+    CHECK(p >= sim_flash && p < sim_flash + SIM_FLASH_SIZE);
+    if (!Sim_Flash_Enabled())
+    {
+        return FLASH_ERR_WRITE_NOT_ENABLED;
+    }
+    p = sim_flash + ((p - sim_flash) & ~(FLASH_SECTOR_SIZE - 1));
+    if (Sim_Flash_Cut())
+    {
+        start = (uint32_t)rand() % FLASH_SECTOR_SIZE;
+        memset(p + start, 0xFF, (uint32_t)rand() % (FLASH_SECTOR_SIZE - start));
+        longjmp(sim_flash_cut_jump, 1);
+    }
+    memset(p, 0xFF, FLASH_SECTOR_SIZE);
+    sim_flash_erases++;
+    return FLASH_ERR_NONE;
+}
+
+FlashStatus Flash_WriteWordPair(uint32_t addr, uint32_t word0, uint32_t word1)
+{
+    uint32_t *p = Sim_Ptr(addr);
+
+    CHECK((addr & 7) == 0);
+    CHECK((uint8_t *)p >= sim_flash && (uint8_t *)p < sim_flash + SIM_FLASH_SIZE);
+    if (!Sim_Flash_Enabled())
+    {
+        return FLASH_ERR_WRITE_NOT_ENABLED;
+    }
+
+    /* A word pair can't be programmed twice without an erase */
+    CHECK(p[0] == 0xFFFFFFFF && p[1] == 0xFFFFFFFF);
+    if (Sim_Flash_Cut())
+    {
+        p[0] = word0 | (uint32_t)rand();
+        p[1] = word1 | (uint32_t)rand();
+        longjmp(sim_flash_cut_jump, 1);
+    }
+    p[0] = word0;
+    p[1] = word1;
+    sim_flash_writes++;
+    return FLASH_ERR_NONE;
+}
@@ -0,0 +1,407 @@
+/* ----------------------------------------------------------------------------
+ * sim_i2c.c
+ * - Register-level model of the I2C master and of one slave with an address
+ *   pointer (see sim.h): every write or read phase starts at the pointer,
+ *   which stays where it is. With a register stride the phase stays within
+ *   the register at the pointer. Every byte takes SIM_I2C_BYTE_US on the bus.
+ * - CPU controller: the interface interrupts after the address and after
+ *   each byte. A write byte is taken from DATA once the interrupt handler has
+ *   returned (DATA holds SIM_I2C_DATA_EMPTY until it is written), a read byte
+ *   is received once the previous one has been acknowledged by Sys_I2C_ACK.
+ *   With LAST_DATA set, the next byte is followed by a STOP (NACK for a read)
+ *   and one more interrupt.
+ * - DMA controller: the bytes are moved by the enabled DMA channel that has
+ *   the I2C as source or destination, without interrupt; the channel
+ *   completes once its last byte has been moved. A read acknowledges the
+ *   bytes automatically.
+ * - Faults are scripted per START (sim_i2c_bus.script, then ACK): address or
+ *   data byte not acknowledged, bus error with SDA held low by the slave for
+ *   a number of SCL clocks, or no answer at all (SCL held low). A START while
+ *   SDA is held low is a bus error too. SCL clocked as GPIO releases SDA one
+ *   clock at a time.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Global variable definition */
+I2C_Type sim_i2c;
+I2C_CTRL1_Type sim_i2c_ctrl1;
+struct sim_i2c_tag sim_i2c_bus;
+
+enum sim_i2c_state
+{
+    SIM_I2C_IDLE,
+    SIM_I2C_ADDRESS,
+    SIM_I2C_WRITE,
+    SIM_I2C_READ
+};
+
+/* Events of the bus, scheduled one at a time */
+enum sim_i2c_event
+{
+    SIM_I2C_EVENT_ADDRESS,
+    SIM_I2C_EVENT_POLL,
+    SIM_I2C_EVENT_SENT,
+    SIM_I2C_EVENT_RECEIVED,
+    SIM_I2C_EVENT_STOP,
+    SIM_I2C_EVENT_BUS_ERROR
+};
+
+static uint32_t sim_i2c_config;
+static uint32_t sim_i2c_status;
+static uint8_t sim_i2c_state;
+static bool sim_i2c_read;
+static bool sim_i2c_first;
+static uint32_t sim_i2c_dma_count;
+static struct sim_i2c_fault_tag sim_i2c_fault;
+static uint32_t sim_i2c_index;
+static uint8_t sim_i2c_cursor;
+static bool sim_i2c_scl;
+
+static void Sim_I2C_Event(uintptr_t event);
+
+static bool Sim_I2C_Gpio_Out(uint32_t dio)
+{
+    return (sim_dio_cfg[dio] & DIO_MODE_MASK) == DIO_MODE_GPIO_OUT_0 ||
+           (sim_dio_cfg[dio] & DIO_MODE_MASK) == DIO_MODE_GPIO_OUT_1;
+}
+
+/* SCL and SDA driven as GPIO: a slave holding SDA low is clocked by SCL, the
+ * clocks of the recovery loop (SDA released as input) and the STOP
+ * conditions are counted */
+static void Sim_I2C_Gpio(uint32_t dio, bool high)
+{
+    bool rising = (dio == I2C_SCL_DIO_NUM && high && !sim_i2c_scl);
+
+    if (dio == I2C_SCL_DIO_NUM)
+    {
+        sim_i2c_scl = high;
+    }
+    if (rising && Sim_I2C_Gpio_Out(dio) && sim_i2c_bus.stuck > 0)
+    {
+        if ((sim_dio_cfg[I2C_SDA_DIO_NUM] & DIO_MODE_MASK) == DIO_MODE_INPUT)
+        {
+            sim_i2c_bus.recovery_clocks++;
+        }
+        if (--sim_i2c_bus.stuck == 0)
+        {
+            sim_dio.DATA |= 1U << I2C_SDA_DIO_NUM;
+        }
+    }
+    else if (dio == I2C_SDA_DIO_NUM && high)
+    {
+        if (sim_i2c_bus.stuck > 0)
+        {
+            sim_dio.DATA &= ~(1U << I2C_SDA_DIO_NUM);
+        }
+        else if (sim_i2c_scl && Sim_I2C_Gpio_Out(I2C_SCL_DIO_NUM))
+        {
+            sim_i2c_bus.recovery_stops++;
+        }
+    }
+}
+
+void Sim_I2C_Reset(void)
+{
+    memset(&sim_i2c_bus, 0, sizeof(sim_i2c_bus));
+    memset(&sim_i2c, 0, sizeof(sim_i2c));
+    memset(&sim_i2c_ctrl1, 0, sizeof(sim_i2c_ctrl1));
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_ADDRESS);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_POLL);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_SENT);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_RECEIVED);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_STOP);
+    sim_i2c_config = 0;
+    sim_i2c_status = 0;
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_BUS_ERROR);
+    sim_i2c_state = SIM_I2C_IDLE;
+    sim_dio.DATA |= (1U << I2C_SCL_DIO_NUM) | (1U << I2C_SDA_DIO_NUM);
+    sim_i2c_scl = true;
+    sim_gpio_hook[0] = Sim_I2C_Gpio;
+}
+
+static bool Sim_I2C_Dma(void)
+{
+    return (sim_i2c_config & I2C_CONTROLLER_DMA) != 0;
+}
+
+static void Sim_I2C_Schedule(enum sim_i2c_event event, uint64_t delay)
+{
+    Sim_Schedule(sim_now + delay, Sim_I2C_Event, event);
+}
+
+static void Sim_I2C_Interrupt(uint32_t status)
+{
+    sim_i2c_status = status;
+    Sim_Irq_Pend(I2C_IRQn);
+}
+
+/* Slave memory at the cursor, which then moves to the next byte: one byte
+ * per pointer value, or the bytes of the register at the pointer in turn */
+static uint8_t *Sim_I2C_Slave_Byte(void)
+{
+    uint8_t index = (uint8_t)(sim_i2c_cursor++ - sim_i2c_bus.pointer);
+
+    if (sim_i2c_bus.stride == 0)
+    {
+        return &sim_i2c_bus.mem[(uint8_t)(sim_i2c_bus.pointer + index)];
+    }
+    return &sim_i2c_bus.mem[(uint8_t)(sim_i2c_bus.pointer * sim_i2c_bus.stride + index % sim_i2c_bus.stride)];
+}
+
+/* The slave takes a written byte: the first one of a transaction sets the
+ * address pointer */
+static void Sim_I2C_Slave_Write(uint8_t data)
+{
+    if (sim_i2c_first)
+    {
+        sim_i2c_bus.pointer = data;
+        sim_i2c_cursor = data;
+        sim_i2c_first = false;
+    }
+    else
+    {
+        *Sim_I2C_Slave_Byte() = data;
+    }
+    sim_i2c_bus.bytes_tx++;
+}
+
+static uint8_t Sim_I2C_Slave_Read(void)
+{
+    sim_i2c_bus.bytes_rx++;
+    return *Sim_I2C_Slave_Byte();
+}
+
+/* Put the next byte of the DMA channel on the bus */
+static void Sim_I2C_Dma_Send(void)
+{
+    int ch = Sim_Dma_Find(DMA_DEST_I2C);
+    uint8_t *src;
+
+    if (ch < 0 || sim_i2c_dma_count >= sim_dma[ch].length)
+    {
+        return;
+    }
+    CHECK((sim_dma[ch].config & DMA_TRANSFER_MASK) == DMA_TRANSFER_M_TO_P);
+    CHECK(Sim_Ptr(sim_dma[ch].dest) == &sim_i2c.DATA);
+    src = Sim_Ptr(sim_dma[ch].src);
+    Sim_I2C_Slave_Write(src[sim_i2c_dma_count++]);
+    if (sim_i2c_dma_count == sim_dma[ch].length)
+    {
+        Sim_Dma_Done(ch, sim_now);
+    }
+    Sim_I2C_Schedule(SIM_I2C_EVENT_SENT, SIM_I2C_BYTE_US);
+}
+
+static void Sim_I2C_Dma_Receive(uint8_t data)
+{
+    int ch = Sim_Dma_Find(DMA_SRC_I2C);
+    uint8_t *dest;
+
+    CHECK(ch >= 0 && sim_i2c_dma_count < sim_dma[ch].length);
+    CHECK((sim_dma[ch].config & DMA_TRANSFER_MASK) == DMA_TRANSFER_P_TO_M);
+    CHECK(Sim_Ptr(sim_dma[ch].src) == &sim_i2c.DATA);
+    dest = Sim_Ptr(sim_dma[ch].dest);
+    dest[sim_i2c_dma_count++] = data;
+    if (sim_i2c_dma_count == sim_dma[ch].length)
+    {
+        Sim_Dma_Done(ch, sim_now);
+    }
+}
+
+/* The slave has acknowledged the address or a written byte: ask the CPU for
+ * the next byte, or the DMA channel, or end with a STOP */
+static void Sim_I2C_Write_Next(void)
+{
+    if (Sim_I2C_Dma())
+    {
+        /* A DMA channel that has nothing left waits for the CPU */
+        Sim_I2C_Dma_Send();
+    }
+    else if (sim_i2c_ctrl1.LAST_DATA_ALIAS)
+    {
+        sim_i2c_ctrl1.LAST_DATA_ALIAS = 0;
+        sim_i2c_state = SIM_I2C_IDLE;
+        sim_i2c_bus.stops++;
+        Sim_I2C_Interrupt(I2C_IS_WRITE | I2C_HAS_ACK | I2C_STOP_DETECTED);
+    }
+    else
+    {
+        sim_i2c.DATA = SIM_I2C_DATA_EMPTY;
+        Sim_I2C_Interrupt(I2C_IS_WRITE | I2C_HAS_ACK);
+        Sim_I2C_Schedule(SIM_I2C_EVENT_POLL, 0);
+    }
+}
+
+static void Sim_I2C_Event(uintptr_t event)
+{
+    switch (event)
+    {
+        case SIM_I2C_EVENT_ADDRESS:
+            if (sim_i2c_fault.fault == SIM_I2C_NACK_ADDRESS)
+            {
+                sim_i2c_state = SIM_I2C_IDLE;
+                Sim_I2C_Interrupt((sim_i2c_read ? I2C_IS_READ : I2C_IS_WRITE) | I2C_HAS_NACK);
+            }
+            else if (!sim_i2c_read)
+            {
+                sim_i2c_state = SIM_I2C_WRITE;
+                Sim_I2C_Write_Next();
+            }
+            else
+            {
+                sim_i2c_state = SIM_I2C_READ;
+                if (Sim_I2C_Dma() && (sim_i2c_config & I2C_AUTO_ACK_ENABLE))
+                {
+                    Sim_I2C_Schedule(SIM_I2C_EVENT_RECEIVED, SIM_I2C_BYTE_US);
+                }
+                else
+                {
+                    Sim_I2C_Interrupt(I2C_IS_READ | I2C_HAS_ACK);
+                }
+            }
+            break;
+
+        /* The interrupt handler has returned: DATA written or not */
+        case SIM_I2C_EVENT_POLL:
+            if (sim_i2c_state == SIM_I2C_WRITE && sim_i2c.DATA != SIM_I2C_DATA_EMPTY)
+            {
+                Sim_I2C_Slave_Write((uint8_t)sim_i2c.DATA);
+                sim_i2c.DATA = SIM_I2C_DATA_EMPTY;
+                Sim_I2C_Schedule(SIM_I2C_EVENT_SENT, SIM_I2C_BYTE_US);
+            }
+            break;
+
+        case SIM_I2C_EVENT_SENT:
+            if (sim_i2c_fault.fault == SIM_I2C_NACK_DATA && sim_i2c_fault.arg == sim_i2c_index)
+            {
+                sim_i2c_state = SIM_I2C_IDLE;
+                Sim_I2C_Interrupt(I2C_IS_WRITE | I2C_HAS_NACK);
+                break;
+            }
+            sim_i2c_index++;
+            Sim_I2C_Write_Next();
+            break;
+
+        case SIM_I2C_EVENT_RECEIVED:
+            if (Sim_I2C_Dma())
+            {
+                Sim_I2C_Dma_Receive(Sim_I2C_Slave_Read());
+                if (sim_i2c_config & I2C_AUTO_ACK_ENABLE)
+                {
+                    Sim_I2C_Schedule(SIM_I2C_EVENT_RECEIVED, SIM_I2C_BYTE_US);
+                }
+                break;
+            }
+            sim_i2c.DATA = Sim_I2C_Slave_Read();
+            Sim_I2C_Interrupt(I2C_IS_READ | I2C_HAS_ACK | I2C_BUFFER_FULL);
+            if (sim_i2c_ctrl1.LAST_DATA_ALIAS)
+            {
+                sim_i2c_ctrl1.LAST_DATA_ALIAS = 0;
+                Sim_I2C_Schedule(SIM_I2C_EVENT_STOP, SIM_I2C_BYTE_US / 4);
+            }
+            break;
+
+        case SIM_I2C_EVENT_STOP:
+            sim_i2c_state = SIM_I2C_IDLE;
+            sim_i2c_bus.stops++;
+            Sim_I2C_Interrupt(I2C_IS_READ | I2C_HAS_ACK | I2C_STOP_DETECTED);
+            break;
+
+        case SIM_I2C_EVENT_BUS_ERROR:
+            sim_i2c_state = SIM_I2C_IDLE;
+            Sim_I2C_Interrupt((sim_i2c_read ? I2C_IS_READ : I2C_IS_WRITE) | I2C_BUS_ERROR);
+            break;
+    }
+}
+
+void Sys_I2C_Config(uint32_t config)
+{
+    sim_i2c_config = config;
+}
+
+void Sys_I2C_DIOConfig(uint32_t config, uint32_t scl, uint32_t sda)
+{
+    CHECK(scl == I2C_SCL_DIO_NUM && sda == I2C_SDA_DIO_NUM);
+    sim_dio_cfg[scl] = config;
+    sim_dio_cfg[sda] = config;
+}
+
+/* START (repeated START if the bus is still held) and address */
+static void Sim_I2C_Start(uint32_t address, bool read)
+{
+    (void)address;
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_POLL);
+    sim_i2c_bus.starts++;
+    sim_i2c_read = read;
+    sim_i2c_first = !read;
+    sim_i2c_dma_count = 0;
+    sim_i2c_index = 0;
+    sim_i2c_cursor = sim_i2c_bus.pointer;
+    sim_i2c_state = SIM_I2C_ADDRESS;
+
+    /* SDA still held low: the START is lost */
+    if (sim_i2c_bus.stuck > 0)
+    {
+        Sim_I2C_Schedule(SIM_I2C_EVENT_BUS_ERROR, SIM_I2C_BYTE_US / 9);
+        return;
+    }
+
+    memset(&sim_i2c_fault, 0, sizeof(sim_i2c_fault));
+    if (sim_i2c_bus.script_pos < sim_i2c_bus.script_length)
+    {
+        sim_i2c_fault = sim_i2c_bus.script[sim_i2c_bus.script_pos++];
+    }
+    switch (sim_i2c_fault.fault)
+    {
+        case SIM_I2C_BUS_ERROR:
+            sim_i2c_bus.stuck = sim_i2c_fault.arg;
+            sim_dio.DATA &= ~(1U << I2C_SDA_DIO_NUM);
+            Sim_I2C_Schedule(SIM_I2C_EVENT_BUS_ERROR, SIM_I2C_BYTE_US / 9);
+            break;
+        case SIM_I2C_HANG:
+            break;
+        default:
+            Sim_I2C_Schedule(SIM_I2C_EVENT_ADDRESS, SIM_I2C_BYTE_US);
+    }
+}
+
+void Sys_I2C_StartWrite(uint32_t address)
+{
+    Sim_I2C_Start(address, false);
+}
+
+void Sys_I2C_StartRead(uint32_t address)
+{
+    Sim_I2C_Start(address, true);
+}
+
+void Sys_I2C_ACK(void)
+{
+    CHECK(sim_i2c_state == SIM_I2C_READ && !Sim_I2C_Dma());
+    Sim_I2C_Schedule(SIM_I2C_EVENT_RECEIVED, SIM_I2C_BYTE_US);
+}
+
+void Sys_I2C_NackAndStop(void)
+{
+    Sys_I2C_Reset();
+    sim_i2c_bus.stops++;
+}
+
+/* Back to idle, the pending interrupt stays pending */
+void Sys_I2C_Reset(void)
+{
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_ADDRESS);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_POLL);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_SENT);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_RECEIVED);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_STOP);
+    Sim_Cancel(Sim_I2C_Event, SIM_I2C_EVENT_BUS_ERROR);
+    sim_i2c_ctrl1.LAST_DATA_ALIAS = 0;
+    sim_i2c_state = SIM_I2C_IDLE;
+}
+
+uint32_t Sys_I2C_Get_Status(void)
+{
+    return sim_i2c_status;
+}
@@ -0,0 +1,222 @@
+/* ----------------------------------------------------------------------------
+ * sim_nor.c
+ * - Model of the external SPI NOR flash (see sim.h) behind SPI0, selected by
+ *   the chip select GPIO: the commands of spiflash.h, 3-byte addresses.
+ * - A program is latched while the flash is selected and written when it is
+ *   deselected, wrapping within the page; it only clears bits. A program or
+ *   erase needs the write enable latch, which it clears, and keeps the flash
+ *   busy (WIP in the status register) for program_us or erase_us.
+ * - Errors of the driver are checks: a byte without chip select, a command
+ *   other than a status read while busy, a program or erase without write
+ *   enable, a program over a page or of a byte not erased.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Global variable definition */
+struct sim_nor_tag sim_nor;
+
+enum sim_nor_op
+{
+    SIM_NOR_IDLE,
+    SIM_NOR_PROGRAM,
+    SIM_NOR_ERASE
+};
+
+/* Command in progress: bytes exchanged since the chip select */
+static bool sim_nor_selected;
+static uint32_t sim_nor_count;
+static uint8_t sim_nor_command;
+static uint32_t sim_nor_addr;
+
+/* Program latch */
+static uint8_t sim_nor_latch[SPIFLASH_PAGE_SIZE];
+static bool sim_nor_latched[SPIFLASH_PAGE_SIZE];
+
+/* Write in progress and the page it is programming, as before */
+static uint8_t sim_nor_op;
+static uint32_t sim_nor_op_addr;
+static uint8_t sim_nor_old[SPIFLASH_PAGE_SIZE];
+
+static bool Sim_Nor_Busy(void)
+{
+    return sim_now < sim_nor.busy_until;
+}
+
+static uint8_t Sim_Nor_Byte(uint8_t tx)
+{
+    static const uint8_t id[3] = { SIM_NOR_ID >> 16, (uint8_t)(SIM_NOR_ID >> 8), (uint8_t)SIM_NOR_ID };
+    uint32_t n = sim_nor_count++;
+    uint8_t rx = 0xFF;
+    uint32_t i;
+
+    CHECK(sim_nor_selected);
+    if (n == 0)
+    {
+        CHECK(!Sim_Nor_Busy() || tx == SPIFLASH_CMD_READ_STATUS);
+        sim_nor_command = tx;
+        sim_nor_addr = 0;
+        if (tx == SPIFLASH_CMD_READ_STATUS)
+        {
+            sim_nor.status_reads++;
+        }
+        return rx;
+    }
+
+    switch (sim_nor_command)
+    {
+        case SPIFLASH_CMD_READ:
+        case SPIFLASH_CMD_PROGRAM:
+        case SPIFLASH_CMD_ERASE_SECTOR:
+            if (n <= 3)
+            {
+                sim_nor_addr = ((sim_nor_addr << 8) | tx) % SPIFLASH_SIZE;
+                if (n == 3 && sim_nor_command == SPIFLASH_CMD_PROGRAM)
+                {
+                    memset(sim_nor_latched, 0, sizeof(sim_nor_latched));
+                }
+            }
+            else if (sim_nor_command == SPIFLASH_CMD_READ)
+            {
+                rx = sim_nor.mem[(sim_nor_addr + n - 4) % SPIFLASH_SIZE];
+            }
+            else if (sim_nor_command == SPIFLASH_CMD_PROGRAM)
+            {
+                CHECK(n - 4 < SPIFLASH_PAGE_SIZE);
+                i = (sim_nor_addr + n - 4) % SPIFLASH_PAGE_SIZE;
+                sim_nor_latch[i] = tx;
+                sim_nor_latched[i] = true;
+            }
+            break;
+
+        case SPIFLASH_CMD_READ_STATUS:
+            rx = Sim_Nor_Busy() ? SPIFLASH_STATUS_WIP | 0x02 : (sim_nor.wel ? 0x02 : 0);
+            break;
+
+        case SPIFLASH_CMD_READ_ID:
+            rx = (n <= 3) ? id[n - 1] : 0xFF;
+            break;
+
+        default:
+            break;
+    }
+    return rx;
+}
+
+/* End of a command: a write enable, program or erase takes effect */
+static void Sim_Nor_Deselect(void)
+{
+    uint32_t page;
+    uint32_t i;
+
+    if (sim_nor_count == 0)
+    {
+        return;
+    }
+    switch (sim_nor_command)
+    {
+        case SPIFLASH_CMD_WRITE_ENABLE:
+            sim_nor.wel = true;
+            break;
+
+        case SPIFLASH_CMD_PROGRAM:
+            CHECK(sim_nor.wel && sim_nor_count > 4);
+            page = sim_nor_addr & ~(SPIFLASH_PAGE_SIZE - 1);
+            memcpy(sim_nor_old, &sim_nor.mem[page], SPIFLASH_PAGE_SIZE);
+            for (i = 0; i < SPIFLASH_PAGE_SIZE; i++)
+            {
+                if (sim_nor_latched[i])
+                {
+                    CHECK((sim_nor.mem[page + i] & sim_nor_latch[i]) == sim_nor_latch[i]);
+                    sim_nor.mem[page + i] &= sim_nor_latch[i];
+                }
+            }
+            sim_nor_op = SIM_NOR_PROGRAM;
+            sim_nor_op_addr = page;
+            sim_nor.busy_until = sim_now + sim_nor.program_us;
+            sim_nor.wel = false;
+            sim_nor.programs++;
+            break;
+
+        case SPIFLASH_CMD_ERASE_SECTOR:
+            CHECK(sim_nor.wel && sim_nor_count == 4);
+            sim_nor_op_addr = sim_nor_addr & ~(SPIFLASH_SECTOR_SIZE - 1);
+            memset(&sim_nor.mem[sim_nor_op_addr], 0xFF, SPIFLASH_SECTOR_SIZE);
+            sim_nor_op = SIM_NOR_ERASE;
+            sim_nor.busy_until = sim_now + sim_nor.erase_us;
+            sim_nor.wel = false;
+            sim_nor.erases++;
+            sim_nor.sector_erases[sim_nor_op_addr / SPIFLASH_SECTOR_SIZE]++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void Sim_Nor_Gpio(uint32_t dio, bool high)
+{
+    if (dio != SPI_CS_DIO_NUM || high != sim_nor_selected)
+    {
+        return;
+    }
+    if (high)
+    {
+        sim_nor_selected = false;
+        Sim_Nor_Deselect();
+    }
+    else
+    {
+        sim_nor_selected = true;
+        sim_nor_count = 0;
+    }
+}
+
+void Sim_Nor_Attach(void)
+{
+    sim_nor_selected = false;
+    sim_nor_count = 0;
+    sim_gpio_hook[1] = Sim_Nor_Gpio;
+    sim_spi_device = Sim_Nor_Byte;
+}
+
+void Sim_Nor_Reset(void)
+{
+    memset(&sim_nor, 0, sizeof(sim_nor));
+    memset(sim_nor.mem, 0xFF, sizeof(sim_nor.mem));
+    sim_nor.program_us = SIM_NOR_PROGRAM_US;
+    sim_nor.erase_us = SIM_NOR_ERASE_US;
+    sim_nor_op = SIM_NOR_IDLE;
+    Sim_Nor_Attach();
+}
+
+void Sim_Nor_Cut(void)
+{
+    uint32_t i;
+
+    if (Sim_Nor_Busy() && sim_nor_op == SIM_NOR_PROGRAM)
+    {
+        for (i = 0; i < SPIFLASH_PAGE_SIZE; i++)
+        {
+            if (rand() % 2)
+            {
+                sim_nor.mem[sim_nor_op_addr + i] = sim_nor_old[i] & (sim_nor.mem[sim_nor_op_addr + i] | (uint8_t)rand());
+            }
+        }
+    }
+    else if (Sim_Nor_Busy() && sim_nor_op == SIM_NOR_ERASE)
+    {
+        for (i = 0; i < SPIFLASH_SECTOR_SIZE; i++)
+        {
+            if (rand() % 2)
+            {
+                sim_nor.mem[sim_nor_op_addr + i] = (uint8_t)rand();
+            }
+        }
+    }
+    sim_nor_op = SIM_NOR_IDLE;
+    sim_nor.busy_until = 0;
+    sim_nor.wel = false;
+    sim_nor_selected = false;
+    sim_nor_count = 0;
+}
@@ -0,0 +1,564 @@
+/* ----------------------------------------------------------------------------
+ * sim_sys.c
+ * - Host models of the core, the timers, the DMA channels, the DIO, SPI0,
+ *   the RTC, the kernel messages and the BLE notifications (see sim.h)
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Global variable definition */
+uint32_t sim_primask;
+DWT_Type sim_dwt;
+CoreDebug_Type sim_coredebug;
+uint32_t SystemCoreClock = 8000000;
+DIO_Type sim_dio;
+SPI0_Type sim_spi0;
+SPI0_CTRL1_Type sim_spi0_ctrl1;
+
+uint64_t sim_now;
+bool sim_isr;
+uint32_t sim_irq_count[SIM_IRQ_MAX];
+void (*sim_thread)(void);
+struct sim_timer_tag sim_timer[SIM_TIMER_NUM];
+struct sim_dma_tag sim_dma[SIM_DMA_NUM];
+uint32_t sim_dio_cfg[SIM_DIO_NUM];
+void (*sim_gpio_hook[2])(uint32_t dio, bool high);
+uint8_t (*sim_spi_device)(uint8_t tx);
+
+struct app_env_tag app_env;
+struct ble_env_tag ble_env = { APPM_CONNECTED, 247 };
+void (*sim_ntf_hook)(void *attr, const uint8_t *value, uint16_t length,
+                     uint16_t seq_num);
+int sim_msg_used;
+uint32_t sim_ntf_count;
+
+/* ----------------------------------------------------------------------------
+ * Interrupts: the handlers of the application are weak references, a
+ * missing handler is an error once its interrupt is pending
+ * --------------------------------------------------------------------------*/
+#define SIM_WEAK_HANDLER(name)          void name(void) __attribute__((weak))
+SIM_WEAK_HANDLER(TIMER0_IRQHandler);
+SIM_WEAK_HANDLER(TIMER1_IRQHandler);
+SIM_WEAK_HANDLER(TIMER2_IRQHandler);
+SIM_WEAK_HANDLER(TIMER3_IRQHandler);
+SIM_WEAK_HANDLER(DMA0_IRQHandler);
+SIM_WEAK_HANDLER(DMA1_IRQHandler);
+SIM_WEAK_HANDLER(DMA2_IRQHandler);
+SIM_WEAK_HANDLER(DMA3_IRQHandler);
+SIM_WEAK_HANDLER(DIO0_IRQHandler);
+SIM_WEAK_HANDLER(I2C_IRQHandler);
+
+static void (*const sim_handler[SIM_IRQ_MAX])(void) =
+{
+    [TIMER0_IRQn] = TIMER0_IRQHandler,
+    [TIMER1_IRQn] = TIMER1_IRQHandler,
+    [TIMER2_IRQn] = TIMER2_IRQHandler,
+    [TIMER3_IRQn] = TIMER3_IRQHandler,
+    [DMA0_IRQn]   = DMA0_IRQHandler,
+    [DMA1_IRQn]   = DMA1_IRQHandler,
+    [DMA2_IRQn]   = DMA2_IRQHandler,
+    [DMA3_IRQn]   = DMA3_IRQHandler,
+    [DIO0_IRQn]   = DIO0_IRQHandler,
+    [I2C_IRQn]    = I2C_IRQHandler,
+};
+
+static bool sim_irq_enabled[SIM_IRQ_MAX];
+static bool sim_irq_pending[SIM_IRQ_MAX];
+
+/* Scheduled events of the peripheral models */
+#define SIM_EVENT_MAX                   32
+
+struct sim_event_tag
+{
+    uint64_t at;
+    void (*fn)(uintptr_t);
+    uintptr_t arg;
+};
+
+static struct sim_event_tag sim_event[SIM_EVENT_MAX];
+
+/* RTC */
+static uint32_t sim_rtc_count;
+static uint64_t sim_rtc_time;
+static double sim_rtc_fraction;
+static double sim_rtc_rate = 1.0;
+
+/* Message pool */
+struct sim_msg_tag
+{
+    void *attr;
+    bool used;
+    struct gattc_send_evt_cmd cmd __attribute__((aligned(8)));
+};
+
+static uint8_t sim_msg_pool[SIM_MSG_POOL_SIZE][SIM_MSG_SIZE] __attribute__((aligned(8)));
+
+void Sim_Reset(void)
+{
+    sim_primask = 0;
+    sim_now = 0;
+    sim_isr = false;
+    sim_thread = NULL;
+    memset(sim_irq_count, 0, sizeof(sim_irq_count));
+    memset(sim_irq_enabled, 0, sizeof(sim_irq_enabled));
+    memset(sim_irq_pending, 0, sizeof(sim_irq_pending));
+    memset(sim_event, 0, sizeof(sim_event));
+    memset(sim_timer, 0, sizeof(sim_timer));
+    memset(sim_dma, 0, sizeof(sim_dma));
+    memset(sim_dio_cfg, 0, sizeof(sim_dio_cfg));
+    memset(sim_gpio_hook, 0, sizeof(sim_gpio_hook));
+    sim_spi_device = NULL;
+    sim_rtc_count = 0;
+    sim_rtc_time = 0;
+    sim_rtc_fraction = 0;
+    sim_rtc_rate = 1.0;
+    sim_ntf_hook = NULL;
+    sim_ntf_count = 0;
+    memset(sim_msg_pool, 0, sizeof(sim_msg_pool));
+    sim_msg_used = 0;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    sim_irq_enabled[irq] = true;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    (void)irq;
+    (void)priority;
+}
+
+void Sim_Irq_Pend(IRQn_Type irq)
+{
+    sim_irq_pending[irq] = true;
+}
+
+/* Run the pending interrupts, then the main loop, until nothing is pending */
+static void Sim_Dispatch(void)
+{
+    bool ran;
+    int irq;
+
+    if (sim_isr)
+    {
+        return;
+    }
+    do
+    {
+        ran = false;
+        for (irq = 0; irq < SIM_IRQ_MAX && !sim_primask; irq++)
+        {
+            if (sim_irq_pending[irq] && sim_irq_enabled[irq])
+            {
+                CHECK(sim_handler[irq] != NULL);
+                sim_irq_pending[irq] = false;
+                sim_irq_count[irq]++;
+                sim_isr = true;
+                sim_handler[irq]();
+                sim_isr = false;
+                ran = true;
+                irq = -1;
+            }
+        }
+        if (ran && sim_thread != NULL)
+        {
+            sim_thread();
+        }
+    } while (ran);
+}
+
+void Sim_Schedule(uint64_t at, void (*fn)(uintptr_t), uintptr_t arg)
+{
+    int i;
+
+    for (i = 0; i < SIM_EVENT_MAX; i++)
+    {
+        if (sim_event[i].fn == NULL)
+        {
+            sim_event[i].at = at;
+            sim_event[i].fn = fn;
+            sim_event[i].arg = arg;
+            return;
+        }
+    }
+    CHECK(!"event table full");
+}
+
+void Sim_Cancel(void (*fn)(uintptr_t), uintptr_t arg)
+{
+    int i;
+
+    for (i = 0; i < SIM_EVENT_MAX; i++)
+    {
+        if (sim_event[i].fn == fn && sim_event[i].arg == arg)
+        {
+            sim_event[i].fn = NULL;
+        }
+    }
+}
+
+void Sim_Run(uint64_t until)
+{
+    struct sim_event_tag event;
+    int i, next;
+
+    for (;;)
+    {
+        Sim_Dispatch();
+        next = -1;
+        for (i = 0; i < SIM_EVENT_MAX; i++)
+        {
+            if (sim_event[i].fn != NULL && sim_event[i].at <= until &&
+                (next < 0 || sim_event[i].at < sim_event[next].at))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        event = sim_event[next];
+        sim_event[next].fn = NULL;
+        if (event.at > sim_now)
+        {
+            sim_now = event.at;
+        }
+        event.fn(event.arg);
+    }
+    if (until > sim_now)
+    {
+        sim_now = until;
+    }
+}
+
+void *Sim_Ptr(uint32_t addr)
+{
+    return (void *)(uintptr_t)addr;
+}
+
+/* ----------------------------------------------------------------------------
+ * Timers
+ * --------------------------------------------------------------------------*/
+static void Sim_Timer_Expired(uintptr_t num)
+{
+    sim_timer[num].armed = false;
+    Sim_Irq_Pend((IRQn_Type)(TIMER0_IRQn + num));
+}
+
+void Sys_Timer_Set_Control(uint32_t num, uint32_t config)
+{
+    sim_timer[num].control = config;
+}
+
+void Sys_Timers_Start(uint32_t select)
+{
+    uint32_t num, ticks;
+
+    for (num = 0; num < SIM_TIMER_NUM; num++)
+    {
+        if (select & (1U << num))
+        {
+            ticks = sim_timer[num].control & TIMER_TIMEOUT_MASK;
+            Sim_Cancel(Sim_Timer_Expired, num);
+            Sim_Schedule(sim_now + (uint64_t)ticks * SIM_TIMER_TICK_US,
+                         Sim_Timer_Expired, num);
+            sim_timer[num].armed = true;
+            if (sim_timer[num].starts < SIM_TIMER_LOG_SIZE)
+            {
+                sim_timer[num].log[sim_timer[num].starts] = ticks;
+            }
+            sim_timer[num].starts++;
+        }
+    }
+}
+
+void Sys_Timers_Stop(uint32_t select)
+{
+    uint32_t num;
+
+    for (num = 0; num < SIM_TIMER_NUM; num++)
+    {
+        if (select & (1U << num))
+        {
+            Sim_Cancel(Sim_Timer_Expired, num);
+            sim_timer[num].armed = false;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * DMA
+ * --------------------------------------------------------------------------*/
+void Sys_DMA_ChannelConfig(uint32_t num, uint32_t config, uint32_t transfer_length,
+                           uint32_t counter_int, uint32_t src_addr, uint32_t dest_addr)
+{
+    (void)counter_int;
+    sim_dma[num].config = config;
+    sim_dma[num].length = transfer_length;
+    sim_dma[num].src = src_addr;
+    sim_dma[num].dest = dest_addr;
+    sim_dma[num].enabled = (config & DMA_ENABLE) != 0;
+}
+
+void Sys_DMA_ClearChannelStatus(uint32_t num)
+{
+    (void)num;
+}
+
+static void Sim_Dma_Complete(uintptr_t num)
+{
+    if (sim_dma[num].config & DMA_COMPLETE_INT_ENABLE)
+    {
+        Sim_Irq_Pend((IRQn_Type)(DMA0_IRQn + num));
+    }
+}
+
+void Sys_DMA_ChannelDisable(uint32_t num)
+{
+    sim_dma[num].enabled = false;
+    Sim_Cancel(Sim_Dma_Complete, num);
+}
+
+/* Enabled channel with the peripheral select as source or destination */
+int Sim_Dma_Find(uint32_t select)
+{
+    int num;
+
+    for (num = 0; num < SIM_DMA_NUM; num++)
+    {
+        if (sim_dma[num].enabled && (sim_dma[num].config & select) == select)
+        {
+            return num;
+        }
+    }
+    return -1;
+}
+
+void Sim_Dma_Done(uint32_t num, uint64_t at)
+{
+    Sim_Schedule(at, Sim_Dma_Complete, num);
+}
+
+/* ----------------------------------------------------------------------------
+ * DIO
+ * --------------------------------------------------------------------------*/
+void Sys_DIO_Config(uint32_t dio, uint32_t config)
+{
+    sim_dio_cfg[dio] = config;
+    if ((config & DIO_MODE_MASK) == DIO_MODE_GPIO_OUT_0)
+    {
+        Sys_GPIO_Set_Low(dio);
+    }
+    else if ((config & DIO_MODE_MASK) == DIO_MODE_GPIO_OUT_1)
+    {
+        Sys_GPIO_Set_High(dio);
+    }
+}
+
+static void Sim_Gpio_Set(uint32_t dio, bool high)
+{
+    int i;
+
+    if (high)
+    {
+        sim_dio.DATA |= 1U << dio;
+    }
+    else
+    {
+        sim_dio.DATA &= ~(1U << dio);
+    }
+    for (i = 0; i < 2; i++)
+    {
+        if (sim_gpio_hook[i] != NULL)
+        {
+            sim_gpio_hook[i](dio, high);
+        }
+    }
+}
+
+void Sys_GPIO_Set_High(uint32_t dio)
+{
+    Sim_Gpio_Set(dio, true);
+}
+
+void Sys_GPIO_Set_Low(uint32_t dio)
+{
+    Sim_Gpio_Set(dio, false);
+}
+
+void Sys_GPIO_Toggle(uint32_t dio)
+{
+    Sim_Gpio_Set(dio, !(sim_dio.DATA & (1U << dio)));
+}
+
+/* ----------------------------------------------------------------------------
+ * SPI0: a CPU byte completes at once, a DMA transfer moves all its bytes and
+ * completes SIM_SPI_BYTE_US per byte later
+ * --------------------------------------------------------------------------*/
+static uint32_t sim_spi_config;
+
+static uint8_t Sim_Spi_Byte(uint8_t tx)
+{
+    return sim_spi_device != NULL ? sim_spi_device(tx) : 0xFF;
+}
+
+void Sys_SPI_Config(uint32_t num, uint32_t config)
+{
+    (void)num;
+    sim_spi_config = config;
+}
+
+void Sys_SPI_TransferConfig(uint32_t num, uint32_t config)
+{
+    uint32_t i;
+    uint8_t *data;
+    int ch;
+
+    (void)num;
+    if ((config & SPI0_RW_CMD_MASK) == SPI0_READ_WRITE_DATA && (config & SPI0_START))
+    {
+        CHECK(!(sim_spi_config & SPI0_CONTROLLER_DMA));
+        sim_spi0.RX_DATA = Sim_Spi_Byte((uint8_t)sim_spi0.TX_DATA);
+    }
+    else if ((config & SPI0_RW_CMD_MASK) == SPI0_READ_DATA && (config & SPI0_START))
+    {
+        ch = Sim_Dma_Find(DMA_SRC_SPI0);
+        CHECK(ch >= 0 && (sim_spi_config & SPI0_CONTROLLER_DMA));
+        data = Sim_Ptr(sim_dma[ch].dest);
+        for (i = 0; i < sim_dma[ch].length; i++)
+        {
+            data[i] = Sim_Spi_Byte(0xFF);
+        }
+        Sim_Dma_Done(ch, sim_now + 1 + sim_dma[ch].length * SIM_SPI_BYTE_US);
+    }
+    else if ((config & SPI0_RW_CMD_MASK) == SPI0_WRITE_DATA)
+    {
+        ch = Sim_Dma_Find(DMA_DEST_SPI0);
+        CHECK(ch >= 0 && (sim_spi_config & SPI0_CONTROLLER_DMA));
+        data = Sim_Ptr(sim_dma[ch].src);
+        for (i = 0; i < sim_dma[ch].length; i++)
+        {
+            Sim_Spi_Byte(data[i]);
+        }
+        Sim_Dma_Done(ch, sim_now + 1 + sim_dma[ch].length * SIM_SPI_BYTE_US);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * RTC
+ * --------------------------------------------------------------------------*/
+static void Sim_Rtc_Update(void)
+{
+    double ticks;
+
+    sim_rtc_fraction += (double)(sim_now - sim_rtc_time) * 32768e-6 * sim_rtc_rate;
+    sim_rtc_time = sim_now;
+    ticks = (double)(uint64_t)sim_rtc_fraction;
+    sim_rtc_count -= (uint32_t)(uint64_t)ticks;
+    sim_rtc_fraction -= ticks;
+}
+
+/* Clock error of the RTC from now on (1.0 + error) */
+void Sim_Rtc_Rate(double rate)
+{
+    Sim_Rtc_Update();
+    sim_rtc_rate = rate;
+}
+
+void Sys_RTC_Config(uint32_t start_value, uint32_t config)
+{
+    (void)config;
+    sim_rtc_count = start_value;
+    sim_rtc_time = sim_now;
+    sim_rtc_fraction = 0;
+}
+
+uint32_t Sys_RTC_Value(void)
+{
+    Sim_Rtc_Update();
+    return sim_rtc_count;
+}
+
+/* ----------------------------------------------------------------------------
+ * Kernel messages and BLE notifications
+ * --------------------------------------------------------------------------*/
+struct gattc_send_evt_cmd *REAK_NotificationAlloc(void *data, uint16_t length,
+                                                  uint16_t seq_num)
+{
+    struct sim_msg_tag *msg;
+    int i;
+
+    CHECK(!sim_isr);
+    if (ble_env.state != APPM_CONNECTED)
+    {
+        return NULL;
+    }
+    for (i = 0; i < SIM_MSG_POOL_SIZE; i++)
+    {
+        msg = (struct sim_msg_tag *)sim_msg_pool[i];
+        if (!msg->used)
+        {
+            memset(msg, 0, SIM_MSG_SIZE);
+            msg->used = true;
+            msg->attr = data;
+            msg->cmd.seq_num = seq_num;
+            msg->cmd.length = MIN(length, SIM_MSG_SIZE - sizeof(*msg));
+            sim_msg_used++;
+            return &msg->cmd;
+        }
+    }
+    return NULL;
+}
+
+void *ke_param2msg(void const *param)
+{
+    return (uint8_t *)param - offsetof(struct sim_msg_tag, cmd);
+}
+
+void ke_msg_free(void *msg)
+{
+    struct sim_msg_tag *m = msg;
+
+    CHECK(!sim_isr && m->used);
+    m->used = false;
+    sim_msg_used--;
+}
+
+void ke_msg_send(void const *param)
+{
+    struct sim_msg_tag *msg = ke_param2msg(param);
+
+    CHECK(!sim_isr && msg->used);
+    sim_ntf_count++;
+    if (sim_ntf_hook != NULL)
+    {
+        sim_ntf_hook(msg->attr, msg->cmd.value, msg->cmd.length, msg->cmd.seq_num);
+    }
+    ke_msg_free(msg);
+}
+
+void REAK_SendNotificationLength(void *data, uint16_t length, uint16_t seq_num)
+{
+    struct gattc_send_evt_cmd *cmd;
+
+    cmd = REAK_NotificationAlloc(data, length, seq_num);
+    if (cmd == NULL)
+    {
+        return;
+    }
+    memcpy(cmd->value, data, cmd->length);
+    ke_msg_send(cmd);
+}
+
+/* The characteristic length isn't known here: nothing is copied */
+void REAK_SendNotification(void *data)
+{
+    REAK_SendNotificationLength(data, 0, 0);
+}
+
+void UART_WriteEnvData(const int16_t *value)
+{
+    (void)value;
+}
@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * app.h (host stand-in)
+ * - Replaces the main application header for the host tests: the module
+ *   headers are the ones of the application, the kernel, the BLE stack and
+ *   the application environment are reduced to what the modules under test
+ *   use and are implemented by sim.c.
+ * ------------------------------------------------------------------------- */
+
+#ifndef APP_H
+#define APP_H
+
+#include <rsl10.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "i2c.h"
+#include "sensor.h"
+#include "filter.h"
+#include "nct375.h"
+#include "sampler.h"
+#include "notify.h"
+#include "settings.h"
+#include "timebase.h"
+#include "history.h"
+#include "rollup.h"
+#include "racp.h"
+#include "stats.h"
+#include "flashlog.h"
+#include "spiflash.h"
+#include "archive.h"
+
+#ifndef MIN
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                       (((a) > (b)) ? (a) : (b))
+#endif
+
+/* DIO of the I2C bus, of the sensors and of the SPI flash */
+#define I2C_SDA_DIO_NUM                 12
+#define I2C_SCL_DIO_NUM                 11
+#define I2C_GND_DIO_NUM                 10
+#define I2C_PWR_DIO_NUM                 8
+#define NCT375_ALERT_DIO_NUM            5
+#define I2C_DIO_CFG                     (DIO_6X_DRIVE | DIO_LPF_ENABLE | DIO_STRONG_PULL_UP)
+#define NCT375_ALERT_DIO_CFG            (DIO_MODE_INPUT | DIO_WEAK_PULL_UP | DIO_LPF_DISABLE)
+#define SPI_SCLK_DIO_NUM                2
+#define SPI_MOSI_DIO_NUM                3
+#define SPI_CS_DIO_NUM                  4
+#define SPI_MISO_DIO_NUM                7
+
+/* Default deadband of the temperature notifications, in 0.01 degC */
+#define NOTIF_THRES_TEMPERATURE         1
+
+/* Kernel and BLE stack */
+#define APPM_CONNECTED                  5
+#define GAP_ERR_NO_ERROR                0
+#define ATT_CCC_START_NTF               1
+
+struct ble_env_tag
+{
+	uint8_t state;
+	uint16_t mtu;
+};
+
+extern struct ble_env_tag ble_env;
+
+struct gattc_send_evt_cmd
+{
+	uint8_t operation;
+	uint16_t handle;
+	uint16_t seq_num;
+	uint16_t length;
+	uint8_t value[];
+};
+
+struct gattc_send_evt_cmd *REAK_NotificationAlloc(void *data, uint16_t length,
+                                                  uint16_t seq_num);
+void REAK_SendNotification(void *data);
+void REAK_SendNotificationLength(void *data, uint16_t length, uint16_t seq_num);
+void *ke_param2msg(void const *param);
+void ke_msg_send(void const *param);
+void ke_msg_free(void *msg);
+
+/* Application environment (the attributes used by the modules) */
+struct app_env_tag
+{
+	int16_t temperature;
+	uint16_t temperature_cccd_value;
+	int16_t temperature_all[NCT375_MAX_DEVICES];
+	uint16_t temperature_all_cccd;
+	uint32_t sample_period;
+	uint16_t sample_period_cccd;
+	uint8_t history_ctrl[HISTORY_CTRL_SIZE];
+	uint16_t history_ctrl_cccd;
+	uint8_t history_data[HISTORY_PACKET_SIZE];
+	uint16_t history_data_cccd;
+	uint8_t racp[RACP_SIZE];
+	uint16_t racp_cccd;
+};
+
+extern struct app_env_tag app_env;
+
+void UART_WriteEnvData(const int16_t *value);
+
+#endif /* APP_H */
@@ -0,0 +1,296 @@
+/* ----------------------------------------------------------------------------
+ * rsl10.h (host stand-in)
+ * - Replaces the RSL10 device header, the CMSIS core and the system library
+ *   for the host tests: the registers used by the application are plain
+ *   structures and the system library calls used by the application are
+ *   implemented by the peripheral models (sim.h).
+ * - Only what the application modules use is declared. The bit fields keep
+ *   the names of the device header, their values only have to be distinct.
+ * ------------------------------------------------------------------------- */
+
+#ifndef RSL10_H
+#define RSL10_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* ----------------------------------------------------------------------------
+ * Interrupts
+ * --------------------------------------------------------------------------*/
+typedef enum
+{
+	TIMER0_IRQn,
+	TIMER1_IRQn,
+	TIMER2_IRQn,
+	TIMER3_IRQn,
+	DMA0_IRQn,
+	DMA1_IRQn,
+	DMA2_IRQn,
+	DMA3_IRQn,
+	DIO0_IRQn,
+	I2C_IRQn,
+	SIM_IRQ_MAX
+} IRQn_Type;
+
+#define PRIMASK_DISABLE_INTERRUPTS      1
+#define PRIMASK_ENABLE_INTERRUPTS       0
+
+extern uint32_t sim_primask;
+
+static inline uint32_t __get_PRIMASK(void)
+{
+	return sim_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+	sim_primask = primask;
+}
+
+static inline uint32_t __CLZ(uint32_t value)
+{
+	return value ? (uint32_t)__builtin_clz(value) : 32;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+
+/* Cycle counter */
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_coredebug;
+#define DWT                             (&sim_dwt)
+#define CoreDebug                       (&sim_coredebug)
+#define DWT_CTRL_CYCCNTENA_Msk          (1U << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1U << 24)
+
+extern uint32_t SystemCoreClock;
+
+static inline void Sys_Delay_ProgramROM(uint32_t cycles)
+{
+	sim_dwt.CYCCNT += cycles;
+}
+
+/* ----------------------------------------------------------------------------
+ * DIO
+ * --------------------------------------------------------------------------*/
+typedef struct
+{
+	volatile uint32_t DATA;
+} DIO_Type;
+
+extern DIO_Type sim_dio;
+#define DIO                             (&sim_dio)
+
+#define DIO_MODE_GPIO_OUT_0             (0x1U << 0)
+#define DIO_MODE_GPIO_OUT_1             (0x2U << 0)
+#define DIO_MODE_INPUT                  (0x3U << 0)
+#define DIO_MODE_DISABLE                (0x4U << 0)
+#define DIO_MODE_MASK                   (0xFU << 0)
+#define DIO_NO_PULL                     (0x0U << 8)
+#define DIO_WEAK_PULL_UP                (0x1U << 8)
+#define DIO_STRONG_PULL_UP              (0x2U << 8)
+#define DIO_LPF_ENABLE                  (0x1U << 10)
+#define DIO_LPF_DISABLE                 (0x0U << 10)
+#define DIO_6X_DRIVE                    (0x3U << 12)
+
+void Sys_DIO_Config(uint32_t dio, uint32_t config);
+void Sys_GPIO_Set_High(uint32_t dio);
+void Sys_GPIO_Set_Low(uint32_t dio);
+void Sys_GPIO_Toggle(uint32_t dio);
+
+/* ----------------------------------------------------------------------------
+ * Timers (ticks of SLOWCLK / 64, 64 us)
+ * --------------------------------------------------------------------------*/
+#define SELECT_TIMER0                   (1U << 0)
+#define SELECT_TIMER1                   (1U << 1)
+#define SELECT_TIMER2                   (1U << 2)
+#define SELECT_TIMER3                   (1U << 3)
+#define TIMER_TIMEOUT_MASK              0xFFFFFFU
+#define TIMER_MULTI_COUNT_1             (0x1U << 24)
+#define TIMER_SHOT_MODE                 (0x0U << 28)
+#define TIMER_SLOWCLK_DIV2              (0x1U << 29)
+#define TIMER_PRESCALE_32               (0x1U << 30)
+
+void Sys_Timer_Set_Control(uint32_t num, uint32_t config);
+void Sys_Timers_Start(uint32_t select);
+void Sys_Timers_Stop(uint32_t select);
+
+/* ----------------------------------------------------------------------------
+ * RTC (counts down at 32768 Hz)
+ * --------------------------------------------------------------------------*/
+#define RTC_ALARM_ZERO                  (0x1U << 0)
+#define RTC_CNT_START                   (0x1U << 1)
+#define RTC_CLK_SRC_RC_OSC              (0x1U << 2)
+
+void Sys_RTC_Config(uint32_t start_value, uint32_t config);
+uint32_t Sys_RTC_Value(void);
+
+/* ----------------------------------------------------------------------------
+ * DMA
+ * --------------------------------------------------------------------------*/
+#define DMA_ENABLE                      (0x1U << 0)
+#define DMA_ADDR_LIN                    (0x0U << 1)
+#define DMA_TRANSFER_M_TO_P             (0x1U << 2)
+#define DMA_TRANSFER_P_TO_M             (0x2U << 2)
+#define DMA_TRANSFER_MASK               (0x3U << 2)
+#define DMA_PRIORITY_0                  (0x0U << 4)
+#define DMA_DISABLE_INT_DISABLE         (0x0U << 6)
+#define DMA_ERROR_INT_DISABLE           (0x0U << 7)
+#define DMA_COMPLETE_INT_ENABLE         (0x1U << 8)
+#define DMA_COUNTER_INT_DISABLE         (0x0U << 9)
+#define DMA_START_INT_DISABLE           (0x0U << 10)
+#define DMA_LITTLE_ENDIAN               (0x0U << 11)
+#define DMA_SRC_ADDR_INC                (0x1U << 12)
+#define DMA_SRC_ADDR_STATIC             (0x0U << 12)
+#define DMA_DEST_ADDR_INC               (0x1U << 13)
+#define DMA_DEST_ADDR_STATIC            (0x0U << 13)
+#define DMA_SRC_I2C                     (0x1U << 16)
+#define DMA_DEST_I2C                    (0x1U << 20)
+#define DMA_SRC_SPI0                    (0x2U << 16)
+#define DMA_DEST_SPI0                   (0x2U << 20)
+#define WORD_SIZE_8BITS_TO_8BITS        (0x0U << 24)
+
+void Sys_DMA_ChannelConfig(uint32_t num, uint32_t config, uint32_t transfer_length,
+                           uint32_t counter_int, uint32_t src_addr, uint32_t dest_addr);
+void Sys_DMA_ClearChannelStatus(uint32_t num);
+void Sys_DMA_ChannelDisable(uint32_t num);
+
+/* ----------------------------------------------------------------------------
+ * I2C
+ * --------------------------------------------------------------------------*/
+typedef struct
+{
+	volatile uint32_t DATA;
+} I2C_Type;
+
+typedef struct
+{
+	volatile uint32_t LAST_DATA_ALIAS;
+} I2C_CTRL1_Type;
+
+extern I2C_Type sim_i2c;
+extern I2C_CTRL1_Type sim_i2c_ctrl1;
+#define I2C                             (&sim_i2c)
+#define I2C_CTRL1                       (&sim_i2c_ctrl1)
+
+#define I2C_CTRL0_SPEED_Pos             8
+#define I2C_STOP_INT_ENABLE             (0x1U << 0)
+#define I2C_SAMPLE_CLK_ENABLE           (0x1U << 1)
+#define I2C_SLAVE_DISABLE               (0x0U << 2)
+#define I2C_CONTROLLER_CM3              (0x0U << 3)
+#define I2C_CONTROLLER_DMA              (0x1U << 3)
+#define I2C_AUTO_ACK_DISABLE            (0x0U << 4)
+#define I2C_AUTO_ACK_ENABLE             (0x1U << 4)
+#define I2C_LAST_DATA_BITBAND           0x1U
+
+#define I2C_STATUS_ACK_STATUS_Pos       0
+#define I2C_STATUS_READ_WRITE_Pos       2
+#define I2C_STATUS_BUFFER_FULL_Pos      6
+#define I2C_STATUS_BUS_ERROR_Pos        7
+#define I2C_STATUS_STOP_DETECT_Pos      10
+#define I2C_HAS_ACK                     (0x0U << I2C_STATUS_ACK_STATUS_Pos)
+#define I2C_HAS_NACK                    (0x1U << I2C_STATUS_ACK_STATUS_Pos)
+#define I2C_IS_WRITE                    (0x0U << I2C_STATUS_READ_WRITE_Pos)
+#define I2C_IS_READ                     (0x1U << I2C_STATUS_READ_WRITE_Pos)
+#define I2C_BUFFER_FULL                 (0x1U << I2C_STATUS_BUFFER_FULL_Pos)
+#define I2C_BUS_ERROR                   (0x1U << I2C_STATUS_BUS_ERROR_Pos)
+#define I2C_STOP_DETECTED               (0x1U << I2C_STATUS_STOP_DETECT_Pos)
+
+void Sys_I2C_Config(uint32_t config);
+void Sys_I2C_DIOConfig(uint32_t config, uint32_t scl, uint32_t sda);
+void Sys_I2C_StartWrite(uint32_t address);
+void Sys_I2C_StartRead(uint32_t address);
+void Sys_I2C_ACK(void);
+void Sys_I2C_NackAndStop(void);
+void Sys_I2C_Reset(void);
+uint32_t Sys_I2C_Get_Status(void);
+
+/* ----------------------------------------------------------------------------
+ * SPI0
+ * --------------------------------------------------------------------------*/
+typedef struct
+{
+	volatile uint32_t TX_DATA;
+	volatile uint32_t RX_DATA;
+} SPI0_Type;
+
+typedef struct
+{
+	volatile uint32_t START_BUSY_ALIAS;
+} SPI0_CTRL1_Type;
+
+extern SPI0_Type sim_spi0;
+extern SPI0_CTRL1_Type sim_spi0_ctrl1;
+#define SPI0                            (&sim_spi0)
+#define SPI0_CTRL1                      (&sim_spi0_ctrl1)
+
+#define SPI0_BUSY_BITBAND               0x1U
+#define SPI0_SELECT_MASTER              (0x0U << 0)
+#define SPI0_ENABLE                     (0x1U << 1)
+#define SPI0_CLK_POLARITY_NORMAL        (0x0U << 2)
+#define SPI0_CONTROLLER_CM3             (0x0U << 3)
+#define SPI0_CONTROLLER_DMA             (0x1U << 3)
+#define SPI0_MODE_SELECT_MANUAL         (0x0U << 4)
+#define SPI0_MODE_SELECT_AUTO           (0x1U << 4)
+#define SPI0_PRESCALE_2                 (0x0U << 8)
+#define SPI0_IDLE                       (0x0U << 0)
+#define SPI0_START                      (0x1U << 0)
+#define SPI0_CS_1                       (0x1U << 1)
+#define SPI0_READ_WRITE_DATA            (0x1U << 4)
+#define SPI0_READ_DATA                  (0x2U << 4)
+#define SPI0_WRITE_DATA                 (0x3U << 4)
+#define SPI0_RW_CMD_MASK                (0x3U << 4)
+#define SPI0_WORD_SIZE_8                (0x7U << 8)
+
+void Sys_SPI_Config(uint32_t num, uint32_t config);
+void Sys_SPI_TransferConfig(uint32_t num, uint32_t config);
+
+/* ----------------------------------------------------------------------------
+ * Main flash (sim_flash.c): FLASH_MAIN_TOP is the top of the host array
+ * standing for the end of the main flash
+ * --------------------------------------------------------------------------*/
+typedef struct
+{
+	volatile uint32_t MAIN_CTRL;
+	volatile uint32_t MAIN_WRITE_UNLOCK;
+} FLASH_Type;
+
+extern FLASH_Type sim_flash_regs;
+#define FLASH                           (&sim_flash_regs)
+
+#define MAIN_LOW_W_ENABLE               (0x1U << 0)
+#define MAIN_MIDDLE_W_ENABLE            (0x1U << 1)
+#define MAIN_HIGH_W_ENABLE              (0x1U << 2)
+#define FLASH_MAIN_KEY                  0xDBC8264EU
+
+#define FLASH_SECTOR_SIZE               2048
+#define SIM_FLASH_SIZE                  (20 * FLASH_SECTOR_SIZE)
+
+extern uint8_t sim_flash[SIM_FLASH_SIZE];
+#define FLASH_MAIN_TOP                  ((uint32_t)(uintptr_t)sim_flash + SIM_FLASH_SIZE - 1)
+
+typedef enum
+{
+	FLASH_ERR_NONE,
+	FLASH_ERR_GENERAL_FAILURE,
+	FLASH_ERR_WRITE_NOT_ENABLED,
+	FLASH_ERR_BAD_ADDRESS
+} FlashStatus;
+
+FlashStatus Flash_EraseSector(uint32_t addr);
+FlashStatus Flash_WriteWordPair(uint32_t addr, uint32_t word0, uint32_t word1);
+
+#endif /* RSL10_H */
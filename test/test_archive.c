@@ -0,0 +1,260 @@
+/* ----------------------------------------------------------------------------
+ * test_archive.c
+ * - Archive against the SPI NOR flash model: a page programmed after a write
+ *   enable and its sector erase, the status polled until the end of each
+ *   write (also at the maximum program and erase times), the flash wrapped
+ *   with even sector wear, and power cuts in the middle of programs and
+ *   erases: the archive goes on after the reset, one page skipped.
+ * - Downloads through HISTORY CTRL while the archive is written: every byte
+ *   received is the one archived, the gaps are the pages lost by the resets.
+ *   The notifications are allocated, sent and freed from the main loop only
+ *   (the kernel model checks it), none is leaked.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define SAMPLES_PER_S                   96
+#define STREAM_SIZE                     (1 << 21)
+#define GAP_MAX                         (4 * ARCHIVE_PAYLOAD_SIZE)
+
+/* Archived stream, by archive stream offset: the history stream follows
+ * the archive offset it started at after the last reset */
+static uint8_t expected[STREAM_SIZE];
+static uint32_t base, track_pos;
+
+/* Download: first and next offset received, bytes received, gaps, end
+ * of the archive in the last status notified */
+static uint32_t received_first, received_next, received, gaps, status_head;
+static int in_flight;
+
+/* Power cuts, those during a program or erase */
+static uint32_t cuts, torn;
+
+static void Notification(void *attr, const uint8_t *value, uint16_t length, uint16_t seq_num)
+{
+    uint32_t offset;
+
+    if (attr == app_env.history_ctrl)
+    {
+        memcpy(&status_head, &app_env.history_ctrl[18], sizeof(status_head));
+        return;
+    }
+    CHECK(attr == app_env.history_data);
+    CHECK(seq_num == HISTORY_NTF_SEQ_NUM && length > HISTORY_PACKET_HEADER_SIZE);
+    memcpy(&offset, value, 4);
+    length -= HISTORY_PACKET_HEADER_SIZE;
+    CHECK(offset + length <= STREAM_SIZE);
+    CHECK(memcmp(&expected[offset], value + HISTORY_PACKET_HEADER_SIZE, length) == 0);
+    if (received == 0)
+    {
+        received_first = offset;
+    }
+    else if (offset != received_next)
+    {
+        CHECK(offset > received_next && offset - received_next < GAP_MAX);
+        gaps++;
+    }
+    received_next = offset + length;
+    received += length;
+    in_flight++;
+}
+
+/* Main loop: the archive goes on after the flash interrupts, the stack
+ * completes the notifications */
+static void Main_Loop(void)
+{
+    int n;
+
+    Archive_Resume();
+    n = in_flight;
+    in_flight = 0;
+    while (n--)
+    {
+        History_Sent(GAP_ERR_NO_ERROR);
+    }
+}
+
+/* Follow the blocks written to the history */
+static void Track(void)
+{
+    uint8_t data[CODEC_BLOCK_SIZE_MAX];
+    uint16_t length;
+
+    while (History_Block_Read(&track_pos, data, &length))
+    {
+        CHECK(base + track_pos <= STREAM_SIZE);
+        memcpy(&expected[base + track_pos - length], data, length);
+    }
+}
+
+/* One second of samples, then the application timer */
+static void Samples(void)
+{
+    int i;
+
+    history_env.time++;
+    for (i = 0; i < SAMPLES_PER_S; i++)
+    {
+        History_Add(0, (int16_t)rand());
+    }
+    Track();
+    Archive_Process();
+}
+
+static void Second(void)
+{
+    Samples();
+    Sim_Run(sim_now + 1000000);
+    Main_Loop();
+}
+
+/* Power up: the history starts again, the archive after its newest page */
+static void Start(void)
+{
+    Sim_Reset();
+    Sim_Nor_Attach();
+    sim_thread = Main_Loop;
+    sim_ntf_hook = Notification;
+    app_env.history_ctrl_cccd = ATT_CCC_START_NTF;
+    in_flight = 0;
+    History_Init();
+    Archive_Init();
+    CHECK(spiflash_env.present && spiflash_env.id == SIM_NOR_ID);
+    base = archive_env.head;
+    track_pos = 0;
+}
+
+/* Power cut a little after the copy of the blocks, when a write is likely
+ * in progress */
+static void Cut(void)
+{
+    Samples();
+    Sim_Run(sim_now + (uint32_t)rand() % 4000);
+    if (sim_now < sim_nor.busy_until)
+    {
+        torn++;
+    }
+    cuts++;
+    Sim_Nor_Cut();
+    Start();
+}
+
+/* Download of the archive from a stream offset, while the samples go on;
+ * it ends at the end of the archive when it is notified */
+static void Download(uint32_t first)
+{
+    uint8_t command[5] = { HISTORY_OP_ARCHIVE };
+
+    memcpy(&command[1], &first, sizeof(first));
+    received = gaps = 0;
+    History_Command(command, sizeof(command));
+    while (archive_env.download)
+    {
+        Second();
+    }
+    CHECK(received > 0 && received_next == status_head);
+    CHECK(!archive_env.reading && !archive_env.read_done);
+}
+
+static uint32_t Pages_Programmed(void)
+{
+    return sim_nor.programs / 2;
+}
+
+int main(void)
+{
+    uint32_t i, min, max, head;
+
+    Sim_Reset();
+    Sim_Nor_Reset();
+    srand(11);
+    Start();
+    CHECK(archive_env.head == 0);
+
+    /* First page: the sector erased, the payload then the header programmed,
+     * each after a write enable and polled until done */
+    while (archive_env.head == 0)
+    {
+        CHECK(sim_nor.erases == 0 || Pages_Programmed() == 0);
+        Second();
+    }
+    CHECK(sim_nor.erases == 1 && sim_nor.sector_erases[0] == 1 && sim_nor.programs == 2);
+    CHECK(sim_nor.status_reads >= 3 && !sim_nor.wel);
+    CHECK(archive_env.head == ARCHIVE_PAYLOAD_SIZE);
+    CHECK(memcmp(&sim_nor.mem[ARCHIVE_HEADER_SIZE], expected, ARCHIVE_PAYLOAD_SIZE) == 0);
+    CHECK(sim_nor.mem[5] == ARCHIVE_PAGE_MAGIC);
+
+    /* Slowest flash: the writes still end before their deadline */
+    sim_nor.program_us = 10000;
+    sim_nor.erase_us = 240000;
+    for (i = 0; i < 600; i++)
+    {
+        Second();
+    }
+    CHECK(sim_nor.erases > 1 && spiflash_env.errors == 0 && archive_env.errors == 0);
+    sim_nor.program_us = SIM_NOR_PROGRAM_US;
+    sim_nor.erase_us = SIM_NOR_ERASE_US;
+
+    /* Download from the start, then resumed from the end of the last block
+     * received */
+    Download(0);
+    CHECK(received_first == 0 && gaps == 0);
+    head = received_next;
+    for (i = 0; i < 100; i++)
+    {
+        Second();
+    }
+    Download(head);
+    CHECK(received_first == head && gaps == 0);
+
+    /* Power cuts now and then until the flash has wrapped */
+    while (Archive_Tail() < 2 * ARCHIVE_SECTOR_PAGES * ARCHIVE_PAYLOAD_SIZE)
+    {
+        if (rand() % 200 == 0)
+        {
+            Cut();
+        }
+        Second();
+    }
+    CHECK(spiflash_env.errors == 0 && archive_env.errors == 0);
+    CHECK(cuts > 10 && torn > 5);
+
+    /* The oldest pages are overwritten, the sectors wear evenly */
+    min = max = sim_nor.sector_erases[0];
+    for (i = 0; i < SPIFLASH_SIZE / SPIFLASH_SECTOR_SIZE; i++)
+    {
+        min = MIN(min, sim_nor.sector_erases[i]);
+        max = MAX(max, sim_nor.sector_erases[i]);
+    }
+    CHECK(min >= 1 && max - min <= 1);
+
+    /* Download of the whole flash: from the first block of the oldest page
+     * kept, a gap per reset at most */
+    Download(0);
+    CHECK(received_first >= Archive_Tail() && received_first < Archive_Tail() + GAP_MAX);
+    CHECK(gaps <= cuts && received + gaps * GAP_MAX >= status_head - received_first);
+
+    /* Power cut during a download */
+    received = 0;
+    History_Command((const uint8_t[]){ HISTORY_OP_ARCHIVE, 0, 0, 0, 0 }, 5);
+    while (received < 10 * ARCHIVE_PAYLOAD_SIZE)
+    {
+        Sim_Run(sim_now + 1000);
+    }
+    CHECK(sim_msg_used > 0);
+    Cut();
+    CHECK(!archive_env.download && sim_msg_used == 0);
+    head = received_next;
+    for (i = 0; i < 10; i++)
+    {
+        Second();
+    }
+    Download(head);
+    CHECK(received_first == head && gaps >= 1 && gaps <= cuts);
+    CHECK(sim_msg_used == 0);
+
+    printf("%u pages, %u erases, %u power cuts (%u in a write)\n", Pages_Programmed(),
+           sim_nor.erases, cuts, torn);
+    puts("archive: ok");
+    return 0;
+}
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * test_filter.c
+ * - Filter stage against outputs computed by hand: parameter check and
+ *   packing, burst median (odd and even counts, outliers, invalid samples,
+ *   samples beyond the burst), IIR with its rounding and the convergence of
+ *   small steps, boxcar with its rounding and a reduced length.
+ * - A burst without a valid sample gives an invalid output and keeps the
+ *   filter history.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+static struct filter_tag filter;
+
+/* Adds a burst and ends it */
+static int16_t Run(const struct filter_param_tag *param, const int16_t *burst, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        Filter_Add(&filter, burst[i]);
+    }
+    return Filter_Run(&filter, param);
+}
+
+static int16_t Run1(const struct filter_param_tag *param, int16_t x)
+{
+    return Run(param, &x, 1);
+}
+
+int main(void)
+{
+    static const int16_t odd[] = { 30, 10, 20 };
+    static const int16_t outliers[] = { 2500, 2501, 9000, 2499, -4000 };
+    static const int16_t even[] = { 10, 21 };
+    static const int16_t even_negative[] = { -10, -21 };
+    static const int16_t missing[] = { 100, FILTER_SAMPLE_INVALID, 300 };
+    static const int16_t none_valid[] = { FILTER_SAMPLE_INVALID, FILTER_SAMPLE_INVALID };
+    const struct filter_param_tag none = FILTER_PARAM_DEFAULT;
+    struct filter_param_tag param = { 3, FILTER_TYPE_BOXCAR, 5, 2 };
+    struct filter_param_tag iir = { 1, FILTER_TYPE_IIR, 2, 1 };
+    struct filter_param_tag boxcar = { 1, FILTER_TYPE_BOXCAR, 3, 1 };
+    struct filter_param_tag unpacked;
+    int16_t y, last;
+    int i;
+
+    /* Parameters */
+    CHECK(Filter_Param_Check(&none) && Filter_Param_Check(&param));
+    CHECK(FILTER_PARAM_PACK(param) == 0x02050203);
+    Filter_Param_Unpack(FILTER_PARAM_PACK(param), &unpacked);
+    CHECK(memcmp(&unpacked, &param, sizeof(param)) == 0);
+    param.burst = 0;
+    CHECK(!Filter_Param_Check(&param));
+    param.burst = FILTER_BURST_MAX + 1;
+    CHECK(!Filter_Param_Check(&param));
+    param.burst = FILTER_BURST_MAX;
+    param.decimation = 0;
+    CHECK(!Filter_Param_Check(&param));
+    param.decimation = 255;
+    param.coef = FILTER_BOXCAR_MAX;
+    CHECK(Filter_Param_Check(&param));
+    param.coef = FILTER_BOXCAR_MAX + 1;
+    CHECK(!Filter_Param_Check(&param));
+    param.type = FILTER_TYPE_IIR;
+    CHECK(!Filter_Param_Check(&param));
+    param.coef = FILTER_IIR_SHIFT_MAX;
+    CHECK(Filter_Param_Check(&param));
+    param.coef = 0;
+    CHECK(!Filter_Param_Check(&param));
+    param.type = FILTER_TYPE_NONE;
+    CHECK(Filter_Param_Check(&param));
+    param.type = FILTER_TYPE_MAX;
+    param.coef = 1;
+    CHECK(!Filter_Param_Check(&param));
+
+    /* Median: the middle sample, the truncated mean of the two middle ones
+     * for an even count; invalid samples and samples beyond the burst are
+     * left out */
+    Filter_Reset(&filter);
+    CHECK(Run(&none, odd, 3) == 20);
+    CHECK(Run(&none, outliers, 5) == 2500);
+    CHECK(Run(&none, even, 2) == 15);
+    CHECK(Run(&none, even_negative, 2) == -15);
+    CHECK(Run(&none, missing, 3) == 200);
+    for (i = 0; i < FILTER_BURST_MAX; i++)
+    {
+        Filter_Add(&filter, 100);
+    }
+    Filter_Add(&filter, 9999);
+    Filter_Add(&filter, 9999);
+    CHECK(filter.burst_count == FILTER_BURST_MAX);
+    CHECK(Filter_Run(&filter, &none) == 100);
+    CHECK(Filter_Run(&filter, &none) == FILTER_SAMPLE_INVALID);
+    CHECK(Run(&none, none_valid, 2) == FILTER_SAMPLE_INVALID);
+
+    /* IIR, y += (x - y) / 4: primed by the first sample, rounded to the
+     * nearest 0.01 */
+    Filter_Reset(&filter);
+    CHECK(Run1(&iir, 1000) == 1000);
+    CHECK(Run1(&iir, 2000) == 1250);
+    CHECK(Run1(&iir, 2000) == 1438);
+    CHECK(Run(&iir, none_valid, 2) == FILTER_SAMPLE_INVALID);
+    CHECK(filter.iir == 368000);
+    CHECK(Run1(&iir, 2000) == 1578);
+
+    /* Negative values and a step of one unit, y += (x - y) / 2 */
+    iir.coef = 1;
+    Filter_Reset(&filter);
+    CHECK(Run1(&iir, -100) == -100);
+    CHECK(Run1(&iir, -101) == -100);
+    CHECK(Run1(&iir, -101) == -101);
+
+    /* y += (x - y) / 16: a small step is reached and not overshot */
+    iir.coef = 4;
+    Filter_Reset(&filter);
+    CHECK(Run1(&iir, 0) == 0);
+    last = 0;
+    for (i = 0; i < 2000; i++)
+    {
+        y = Run1(&iir, 10);
+        CHECK(y >= last && y <= 10);
+        last = y;
+    }
+    CHECK(last == 10);
+
+    /* Boxcar of 3: mean of the samples so far until the window is full,
+     * rounded half away from zero */
+    Filter_Reset(&filter);
+    CHECK(Run1(&boxcar, 1) == 1);
+    CHECK(Run1(&boxcar, 2) == 2);
+    CHECK(Run1(&boxcar, 4) == 2);
+    CHECK(Run1(&boxcar, 8) == 5);
+    CHECK(Run(&boxcar, none_valid, 2) == FILTER_SAMPLE_INVALID);
+    CHECK(filter.boxcar_count == 3 && filter.boxcar_sum == 14);
+
+    /* Length reduced to 2: the oldest samples are dropped */
+    boxcar.coef = 2;
+    CHECK(Run1(&boxcar, 10) == 9);
+    CHECK(filter.boxcar_count == 2 && filter.boxcar_sum == 18);
+
+    Filter_Reset(&filter);
+    CHECK(Run1(&boxcar, -1) == -1);
+    CHECK(Run1(&boxcar, -2) == -2);
+    CHECK(Run1(&boxcar, -4) == -3);
+
+    /* Full window wrapping around the buffer: mean of 320 to 470 */
+    boxcar.coef = FILTER_BOXCAR_MAX;
+    Filter_Reset(&filter);
+    for (i = 0; i < 3 * FILTER_BOXCAR_MAX; i++)
+    {
+        y = Run1(&boxcar, (int16_t)(i * 10));
+    }
+    CHECK(y == 395);
+
+    puts("filter: ok");
+    return 0;
+}
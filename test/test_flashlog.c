@@ -0,0 +1,302 @@
+/* ----------------------------------------------------------------------------
+ * test_flashlog.c
+ * - Flash log against the main flash model: a sector programmed only after
+ *   an erase and once per full page, wrap over the sectors with even wear,
+ *   recovery from the page headers, a power cut at every erase and word pair
+ *   write of three pages (the complete pages survive, every record read back
+ *   is intact, the log goes on after the reset) and the download of the log
+ *   through HISTORY CTRL in notifications shorter than a record
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define PAGES                           40
+#define SNAPSHOT_PAGES                  3
+
+/* Pages completed, by page sequence number modulo the table size */
+struct page_tag
+{
+    uint32_t first;
+    uint16_t count;
+};
+
+static struct page_tag pages[64];
+static uint32_t newest;
+static uint32_t sector_erases[FLASHLOG_SECTORS];
+
+/* Next record to append */
+static uint32_t appended;
+
+/* Downloaded records: next one expected and bytes of it received */
+static uint32_t record_seq, record_pos, records, skipped;
+static uint8_t record[CODEC_BLOCK_SIZE_MAX];
+static int in_flight;
+
+/* Payload buffer */
+static uint8_t data[FLASHLOG_PAYLOAD_MAX];
+
+/* Record of a sequence number: history block sizes, now and then one too
+ * long for the download */
+static uint16_t Record(uint32_t seq, uint8_t *data)
+{
+    uint16_t length = (seq % 61 == 60) ? 400 : (uint16_t)(CODEC_HEADER_SIZE + seq * 37 % 129);
+    uint16_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        data[i] = (uint8_t)(seq * 131 + i * 7);
+    }
+    return length;
+}
+
+static bool Record_Valid(uint32_t seq, const uint8_t *data, uint16_t length)
+{
+    static uint8_t expected[FLASHLOG_PAYLOAD_MAX];
+
+    return length == Record(seq, expected) && memcmp(data, expected, length) == 0;
+}
+
+/* Note the page completed by a commit */
+static void Completed(uint32_t page_seq, uint8_t sector, uint32_t first, uint16_t count)
+{
+    pages[page_seq % 64].first = first;
+    pages[page_seq % 64].count = count;
+    newest = page_seq;
+    sector_erases[sector]++;
+}
+
+static void Append(void)
+{
+    uint32_t page_seq = flashlog_env.page_seq, first = flashlog_env.first;
+    uint16_t count = flashlog_env.count;
+    uint8_t sector = flashlog_env.page;
+
+    CHECK(FlashLog_Append(data, Record(appended, data)));
+    if (flashlog_env.page_seq != page_seq)
+    {
+        Completed(page_seq, sector, first, count);
+    }
+    appended++;
+}
+
+/* Append records until a number of pages have been programmed */
+static void Append_Pages(uint32_t n)
+{
+    uint32_t end = flashlog_env.page_seq + n;
+
+    while (flashlog_env.page_seq != end)
+    {
+        Append();
+    }
+}
+
+/* Every record read back is intact and in order, none is missing from the
+ * newest FLASHLOG_SECTORS - 1 complete pages (the sector after them may be
+ * in the middle of its erase) to the page buffer */
+static void Check_Log(void)
+{
+    uint32_t seq = 0, s;
+    uint16_t length;
+
+    while (FlashLog_Read(&seq, data, sizeof(data), &length))
+    {
+        CHECK(Record_Valid(seq, data, length));
+        seq++;
+    }
+    CHECK(seq == flashlog_env.seq);
+
+    for (s = pages[(newest - (FLASHLOG_SECTORS - 2)) % 64].first; s != flashlog_env.seq; s++)
+    {
+        seq = s;
+        CHECK(FlashLog_Read(&seq, data, sizeof(data), &length) && seq == s);
+    }
+}
+
+/* Reset: the page buffer is lost, the log goes on after the newest complete
+ * page */
+static void Reset(void)
+{
+    Settings_Init();
+    FlashLog_Init();
+    CHECK(flashlog_env.count == 0);
+    CHECK((int32_t)(flashlog_env.seq - (pages[newest % 64].first + pages[newest % 64].count)) >= 0);
+    CHECK((int32_t)(flashlog_env.seq - appended) <= 0);
+    appended = flashlog_env.seq;
+}
+
+static void Notification(void *attr, const uint8_t *value, uint16_t length, uint16_t seq_num)
+{
+    uint32_t seq;
+
+    if (attr != app_env.history_data)
+    {
+        return;
+    }
+    in_flight++;
+    CHECK(length > HISTORY_PACKET_HEADER_SIZE && length <= ble_env.mtu - 3);
+    memcpy(&seq, value, 4);
+    length -= HISTORY_PACKET_HEADER_SIZE;
+    if (seq != record_seq)
+    {
+        /* Next record: the previous one is complete, the records skipped are
+         * too long for the download */
+        CHECK(record_pos == 0 && (int32_t)(seq - record_seq) > 0);
+        for (; record_seq != seq; record_seq++)
+        {
+            CHECK(Record(record_seq, data) > CODEC_BLOCK_SIZE_MAX);
+            skipped++;
+        }
+    }
+    CHECK(record_pos + length <= sizeof(record));
+    memcpy(&record[record_pos], value + HISTORY_PACKET_HEADER_SIZE, length);
+    record_pos += length;
+    if (record_pos == Record(seq, data))
+    {
+        CHECK(Record_Valid(seq, record, record_pos));
+        record_pos = 0;
+        record_seq++;
+        records++;
+    }
+}
+
+/* Download of the log from a record, the records from the oldest one kept
+ * at or after it up to the newest one are received or skipped */
+static void Download(uint32_t first)
+{
+    uint8_t command[5] = { HISTORY_OP_LOG };
+    uint16_t length;
+    int n;
+
+    memcpy(&command[1], &first, sizeof(first));
+    records = skipped = 0;
+    record_seq = first;
+    if (!FlashLog_Read(&record_seq, data, sizeof(data), &length))
+    {
+        record_seq = flashlog_env.seq;
+    }
+    first = record_seq;
+    record_pos = 0;
+    in_flight = 0;
+    History_Command(command, sizeof(command));
+    while (history_env.download)
+    {
+        n = in_flight;
+        in_flight = 0;
+        while (n--)
+        {
+            History_Sent(GAP_ERR_NO_ERROR);
+        }
+    }
+    CHECK(record_pos == 0 && record_seq == flashlog_env.seq);
+    CHECK(records + skipped == flashlog_env.seq - first);
+}
+
+int main(void)
+{
+    static uint8_t snapshot[SIM_FLASH_SIZE];
+    static struct page_tag snapshot_pages[64];
+    static uint32_t snapshot_newest, cut, cuts;
+    uint32_t i, oldest, used;
+    uint16_t length;
+
+    Sim_Reset();
+    Sim_Flash_Erase_All();
+    srand(3);
+
+    /* Log sectors not erased: nothing found, a sector is erased before it is
+     * programmed */
+    for (i = 0; i < FLASHLOG_SECTORS * FLASHLOG_PAGE_SIZE; i++)
+    {
+        ((uint8_t *)FLASHLOG_FLASH_ADDR)[i] = (uint8_t)rand();
+    }
+    Settings_Init();
+    FlashLog_Init();
+    CHECK(flashlog_env.seq == 0 && flashlog_env.page == 0);
+
+    /* Batching: the flash is only written once the page is full */
+    while (flashlog_env.page_seq == 0)
+    {
+        CHECK(sim_flash_erases == 0 && sim_flash_writes == 0);
+        Append();
+    }
+    used = ((uint32_t *)FLASHLOG_FLASH_ADDR)[FLASHLOG_PAGE_SIZE / 4 - 2] >> 16;
+    CHECK(sim_flash_erases == 1 && sim_flash_writes == (used + FLASHLOG_HEADER_SIZE) / 8);
+    for (i = used; i < FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE; i++)
+    {
+        CHECK(((uint8_t *)FLASHLOG_FLASH_ADDR)[i] == 0xFF);
+    }
+
+    /* Wrap: the oldest page is overwritten, the sectors wear evenly */
+    Append_Pages(PAGES - 1);
+    CHECK(sim_flash_erases == PAGES);
+    for (i = 0; i < FLASHLOG_SECTORS; i++)
+    {
+        CHECK(sector_erases[i] == PAGES / FLASHLOG_SECTORS ||
+              sector_erases[i] == PAGES / FLASHLOG_SECTORS + 1);
+    }
+    oldest = 0;
+    CHECK(FlashLog_Read(&oldest, data, sizeof(data), &length));
+    CHECK(oldest == pages[(newest - (FLASHLOG_SECTORS - 1)) % 64].first);
+    Check_Log();
+
+    /* Recovery from the headers */
+    i = flashlog_env.page;
+    Reset();
+    CHECK(flashlog_env.page == i && flashlog_env.page_seq == newest + 1);
+    Check_Log();
+
+    /* Power cut at every flash operation while three pages are programmed,
+     * the log is checked after the reset and goes on */
+    memcpy(snapshot, sim_flash, sizeof(snapshot));
+    memcpy(snapshot_pages, pages, sizeof(pages));
+    snapshot_newest = newest;
+    for (cut = 0;; cut++)
+    {
+        memcpy(sim_flash, snapshot, sizeof(snapshot));
+        memcpy(pages, snapshot_pages, sizeof(pages));
+        newest = snapshot_newest;
+        Reset();
+
+        sim_flash_cut = (int32_t)cut;
+        if (setjmp(sim_flash_cut_jump) == 0)
+        {
+            Append_Pages(SNAPSHOT_PAGES);
+            if (sim_flash_cut >= 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            cuts++;
+        }
+        sim_flash_cut = -1;
+        Reset();
+        Check_Log();
+        Append_Pages(2);
+        Check_Log();
+    }
+    sim_flash_cut = -1;
+    CHECK(cuts == cut && cuts > SNAPSHOT_PAGES * FLASHLOG_PAGE_SIZE / 16);
+
+    /* Download in notifications of 16 bytes of record, from the oldest
+     * record and resumed in the middle */
+    History_Init();
+    sim_ntf_hook = Notification;
+    ble_env.mtu = 23;
+    for (i = 0; i < 100; i++)
+    {
+        Append();
+    }
+    Download(0);
+    CHECK(records > FLASHLOG_SECTORS * 10 && skipped > 0);
+    Download(flashlog_env.seq - 50);
+    CHECK(records + skipped == 50);
+    Download(flashlog_env.seq);
+    CHECK(records == 0);
+    CHECK(sim_msg_used == 0);
+
+    printf("%u pages, %u power cuts\n", newest + 1, cuts);
+    puts("flashlog: ok");
+    return 0;
+}
@@ -0,0 +1,275 @@
+/* ----------------------------------------------------------------------------
+ * test_i2c.c
+ * - I2C transactions against the register-level model: write, read and
+ *   write-read phases of 1 to 40 bytes, alone and queued back to back. The
+ *   CPU is interrupted once per byte below I2C_DMA_MIN_LENGTH and a fixed
+ *   number of times per phase from I2C_DMA_MIN_LENGTH on.
+ * - Failures scripted on the bus: NACK of the address or of a data byte, SDA
+ *   held low by the slave, slave not answering. The bus recovery clocks, the
+ *   deadline and backoff timer starts, the retries and the final status.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define LENGTH_MAX                      40
+
+static uint8_t tx[LENGTH_MAX + 1];
+static uint8_t rx[LENGTH_MAX];
+static int completed;
+static i2c_error_code_t last_status;
+static uint32_t phases;
+static uint64_t done_time;
+
+static void Done(void *context, i2c_error_code_t status)
+{
+    CHECK(context == &completed);
+    completed++;
+    last_status = status;
+    done_time = sim_now;
+}
+
+/* Interrupts of the CPU for a phase of length bytes */
+static uint32_t Irq_Write(int length)
+{
+    return length == 0 ? 0 : (length < I2C_DMA_MIN_LENGTH ? length + 1 : 1);
+}
+
+static uint32_t Irq_Read(int length)
+{
+    return length == 0 ? 0 : (length < I2C_DMA_MIN_LENGTH ? length + 2 : 2);
+}
+
+static uint32_t Irq_Dma(int length)
+{
+    return length >= I2C_DMA_MIN_LENGTH;
+}
+
+/* Register pointer then txlength - 1 data bytes, then rxlength bytes read
+ * from the pointer again. The data is checked if the transaction succeeded. */
+static void Transaction(int txlength, int rxlength)
+{
+    uint8_t pointer = (uint8_t)(rand() % 128);
+    int i;
+
+    for (i = 0; i < 256; i++)
+    {
+        sim_i2c_bus.mem[i] = (uint8_t)rand();
+    }
+    tx[0] = pointer;
+    for (i = 1; i < txlength; i++)
+    {
+        tx[i] = (uint8_t)rand();
+    }
+    memset(rx, 0, sizeof(rx));
+    memset(sim_irq_count, 0, sizeof(sim_irq_count));
+    completed = 0;
+
+    phases += (txlength > 0) + (rxlength > 0);
+    CHECK(I2C_Transfer(0x48, tx, txlength, rx, rxlength, Done, &completed));
+    Sim_Run(sim_now + 40000);
+    if (completed != 1 || last_status != I2C_ERRNO_NONE)
+    {
+        return;
+    }
+
+    /* Data written after the pointer, then read from the pointer */
+    for (i = 1; i < txlength; i++)
+    {
+        CHECK(sim_i2c_bus.mem[(uint8_t)(pointer + i - 1)] == tx[i]);
+    }
+    if (txlength > 0)
+    {
+        for (i = 0; i < rxlength; i++)
+        {
+            CHECK(rx[i] == sim_i2c_bus.mem[(uint8_t)(pointer + i)]);
+        }
+    }
+}
+
+/* Fixed interrupt count per phase, no deadline expiry */
+static void Transaction_Irq(int txlength, int rxlength)
+{
+    Transaction(txlength, rxlength);
+    CHECK(completed == 1 && last_status == I2C_ERRNO_NONE && I2C_Idle());
+    CHECK(sim_irq_count[I2C_IRQn] == Irq_Write(txlength) + Irq_Read(rxlength));
+    CHECK(sim_irq_count[DMA0_IRQn] == Irq_Dma(txlength) + Irq_Dma(rxlength));
+    CHECK(sim_irq_count[TIMER2_IRQn] == 0 && !sim_timer[2].armed);
+    CHECK(!sim_dma[0].enabled);
+}
+
+/* Faults of the next transactions, then ACK */
+#define SCRIPT(...)                                                         \
+    Script((const struct sim_i2c_fault_tag[]){ __VA_ARGS__ },                \
+           sizeof((const struct sim_i2c_fault_tag[]){ __VA_ARGS__ }) /      \
+           sizeof(struct sim_i2c_fault_tag))
+
+static void Script(const struct sim_i2c_fault_tag *script, int length)
+{
+    memcpy(sim_i2c_bus.script, script, length * sizeof(*script));
+    sim_i2c_bus.script_length = (uint8_t)length;
+    sim_i2c_bus.script_pos = 0;
+    sim_i2c_bus.recovery_clocks = 0;
+    sim_i2c_bus.recovery_stops = 0;
+    sim_timer[2].starts = 0;
+    I2C_Stats_Reset();
+}
+
+/* Final status of the transaction and timer starts: deadline, then backoff
+ * and deadline for each retry (then the deadlines of the transactions queued
+ * behind) */
+static void Check_Retries(i2c_error_code_t status, uint8_t retries, uint32_t transactions)
+{
+    const struct i2c_stats_tag *stats = I2C_Stats_Get();
+    uint32_t i;
+
+    CHECK(completed == 1 && last_status == status && I2C_Idle());
+    CHECK(stats->retries == retries && stats->transactions == transactions);
+    CHECK(stats->failures == (status != I2C_ERRNO_NONE));
+    CHECK(sim_timer[2].starts == 2 * (uint32_t)retries + transactions && !sim_timer[2].armed);
+    for (i = 0; i < 2 * (uint32_t)retries + 1; i++)
+    {
+        CHECK(sim_timer[2].log[i] == (i % 2 ? (uint32_t)I2C_RETRY_BACKOFF_TICKS << (i / 2) : I2C_TIMEOUT_TICKS));
+    }
+    CHECK(!sim_dma[0].enabled);
+}
+
+static void Failures(void)
+{
+    const struct i2c_stats_tag *stats = I2C_Stats_Get();
+    uint64_t start;
+    int i;
+
+    /* Address not acknowledged once, CPU write: STOP, no bus recovery */
+    SCRIPT({ SIM_I2C_NACK_ADDRESS, 0 });
+    Transaction(2, 0);
+    Check_Retries(I2C_ERRNO_NONE, 1, 1);
+    CHECK(stats->nacks == 1 && sim_i2c_bus.recovery_clocks == 0);
+
+    /* Address never acknowledged, DMA write */
+    SCRIPT({ SIM_I2C_NACK_ADDRESS, 0 }, { SIM_I2C_NACK_ADDRESS, 0 }, { SIM_I2C_NACK_ADDRESS, 0 });
+    Transaction(12, 0);
+    Check_Retries(I2C_ERRNO_NACK, I2C_RETRY_MAX, 1);
+    CHECK(stats->nacks == I2C_RETRY_MAX + 1 && stats->timeouts == 0);
+    CHECK(sim_irq_count[DMA0_IRQn] == 0 && sim_irq_count[TIMER2_IRQn] == I2C_RETRY_MAX);
+
+    /* Data byte not acknowledged during the DMA write, then during the CPU
+     * write of the next attempt */
+    SCRIPT({ SIM_I2C_NACK_DATA, 5 }, { SIM_I2C_NACK_DATA, 1 });
+    Transaction(16, 4);
+    Check_Retries(I2C_ERRNO_NONE, 2, 1);
+    CHECK(stats->nacks == 2);
+    SCRIPT({ SIM_I2C_NACK_ADDRESS, 0 }, { SIM_I2C_NACK_DATA, 2 });
+    Transaction(3, 2);
+    Check_Retries(I2C_ERRNO_NONE, 2, 1);
+
+    /* Address of a DMA read not acknowledged */
+    SCRIPT({ SIM_I2C_ACK, 0 }, { SIM_I2C_NACK_ADDRESS, 0 });
+    Transaction(1, 20);
+    Check_Retries(I2C_ERRNO_NONE, 1, 1);
+
+    /* SDA held for 3 clocks: released by the first recovery */
+    SCRIPT({ SIM_I2C_BUS_ERROR, 3 });
+    Transaction(1, 2);
+    Check_Retries(I2C_ERRNO_NONE, 1, 1);
+    CHECK(stats->bus_errors == 1 && stats->nacks == 0);
+    CHECK(sim_i2c_bus.recovery_clocks == 3 && sim_i2c_bus.recovery_stops == 1);
+
+    /* SDA held for 25 clocks during a DMA read: each recovery clocks 9 times
+     * (and once more for its STOP), the third one releases the bus but no
+     * retry is left */
+    SCRIPT({ SIM_I2C_BUS_ERROR, 25 });
+    Transaction(0, 8);
+    Check_Retries(I2C_ERRNO_BUS_ERROR, I2C_RETRY_MAX, 1);
+    CHECK(stats->bus_errors == I2C_RETRY_MAX + 1 && stats->timeouts == 0);
+    CHECK(sim_i2c_bus.recovery_clocks == 9 + 9 + 5 && sim_i2c_bus.recovery_stops == 1);
+    CHECK(sim_i2c_bus.stuck == 0);
+
+    /* SDA held during a DMA write, the bus error aborts the DMA phase */
+    SCRIPT({ SIM_I2C_BUS_ERROR, 1 });
+    Transaction(30, 0);
+    Check_Retries(I2C_ERRNO_NONE, 1, 1);
+    CHECK(sim_i2c_bus.recovery_clocks == 1 && stats->timeouts == 0);
+
+    /* Slave not answering: the deadline expires, the bus is checked (nothing
+     * to clock out) and the transaction retried */
+    SCRIPT({ SIM_I2C_HANG, 0 });
+    Transaction(5, 5);
+    Check_Retries(I2C_ERRNO_NONE, 1, 1);
+    CHECK(stats->timeouts == 1 && sim_i2c_bus.recovery_clocks == 0);
+    CHECK(sim_i2c_bus.recovery_stops == 1);
+
+    /* Never answering: the latency is bounded by the deadlines and backoffs,
+     * the transaction queued behind runs afterwards */
+    SCRIPT({ SIM_I2C_HANG, 0 }, { SIM_I2C_HANG, 0 }, { SIM_I2C_HANG, 0 });
+    start = sim_now;
+    completed = 0;
+    CHECK(I2C_Transfer(0x48, tx, 2, NULL, 0, Done, &completed));
+    CHECK(I2C_Transfer(0x49, tx, 1, rx, 2, NULL, NULL));
+    Sim_Run(sim_now + 40000);
+    Check_Retries(I2C_ERRNO_TIMEOUT, I2C_RETRY_MAX, 2);
+    CHECK(stats->timeouts == I2C_RETRY_MAX + 1 && stats->failures == 1);
+    CHECK(done_time - start <= ((I2C_RETRY_MAX + 1) * I2C_TIMEOUT_TICKS +
+                                ((1 << I2C_RETRY_MAX) - 1) * I2C_RETRY_BACKOFF_TICKS) * SIM_TIMER_TICK_US);
+    CHECK(done_time - start >= (3 * I2C_TIMEOUT_TICKS) * SIM_TIMER_TICK_US);
+    for (i = 0; i < SIM_DIO_NUM; i++)
+    {
+        CHECK(i == I2C_SCL_DIO_NUM || i == I2C_SDA_DIO_NUM || sim_dio_cfg[i] == 0);
+    }
+    CHECK(sim_dio_cfg[I2C_SCL_DIO_NUM] == I2C_DIO_CFG && sim_dio_cfg[I2C_SDA_DIO_NUM] == I2C_DIO_CFG);
+}
+
+int main(void)
+{
+    static uint8_t buffer[8][LENGTH_MAX];
+    const struct i2c_stats_tag *stats;
+    uint32_t irq_i2c = 0, irq_dma = 0, starts;
+    int n, m;
+
+    Sim_Reset();
+    Sim_I2C_Reset();
+    srand(3);
+    I2C_Master_Init(0);
+    I2C_Recovery_Config(I2C_DIO_CFG, I2C_SCL_DIO_NUM, I2C_SDA_DIO_NUM);
+
+    /* Write, read and write-read phases around I2C_DMA_MIN_LENGTH */
+    for (n = 1; n <= LENGTH_MAX; n++)
+    {
+        Transaction_Irq(n, 0);
+        Transaction_Irq(0, n);
+        Transaction_Irq(1, n);
+        for (m = 1; m <= 6; m++)
+        {
+            Transaction_Irq(n, m);
+        }
+    }
+    stats = I2C_Stats_Get();
+    CHECK(stats->failures == 0 && stats->retries == 0 && stats->timeouts == 0);
+    CHECK(stats->bytes_tx == sim_i2c_bus.bytes_tx);
+    CHECK(stats->bytes_rx == sim_i2c_bus.bytes_rx);
+    CHECK(sim_i2c_bus.stops == stats->transactions && sim_i2c_bus.starts == phases);
+
+    /* Queued back to back, each started from the completion of the previous
+     * one: the interrupts add up */
+    memset(sim_irq_count, 0, sizeof(sim_irq_count));
+    completed = 0;
+    starts = sim_i2c_bus.starts;
+    for (n = 0; n < 8; n++)
+    {
+        m = 1 + rand() % LENGTH_MAX;
+        CHECK(I2C_Transfer(0x48, buffer[n], 1, buffer[n], m, Done, &completed));
+        irq_i2c += Irq_Write(1) + Irq_Read(m);
+        irq_dma += Irq_Dma(m);
+    }
+    CHECK(!I2C_Idle());
+    Sim_Run(sim_now + 50000);
+    CHECK(completed == 8 && I2C_Idle());
+    CHECK(sim_irq_count[I2C_IRQn] == irq_i2c && sim_irq_count[DMA0_IRQn] == irq_dma);
+    CHECK(sim_i2c_bus.starts - starts == 16);
+    printf("%u transactions, %u bytes written, %u bytes read\n", stats->transactions,
+           stats->bytes_tx, stats->bytes_rx);
+
+    Failures();
+
+    puts("i2c: ok");
+    return 0;
+}
@@ -0,0 +1,209 @@
+/* ----------------------------------------------------------------------------
+ * test_nct375.c
+ * - NCT375 sensor driver against the I2C model: temperature reads through the
+ *   driver interface, the address pointer write skipped only when no
+ *   transaction of the sensor is in flight, and no stale temperature after a
+ *   failed read
+ * - Asynchronous register operations: a batch read skips the registers with a
+ *   valid shadow, the callback is called once with the first error of the
+ *   batch, the Config read-modify-write and the limits only write what the
+ *   shadow doesn't hold already
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+static struct NCT375_Reg_tag nct;
+static int completed;
+static i2c_error_code_t last_status;
+
+static void Done(void *context, void *dev, i2c_error_code_t status)
+{
+    CHECK(context == &completed && dev == &nct);
+    completed++;
+    last_status = status;
+}
+
+static void Reg_Done(void *context, struct NCT375_Reg_tag *dev, i2c_error_code_t status)
+{
+    Done(context, dev, status);
+}
+
+/* Registers of the slave, two bytes each, MSB first */
+#define REG(reg)                        (&sim_i2c_bus.mem[(reg) * 2])
+
+static void Reg16_Set(uint8_t reg, uint16_t value)
+{
+    REG(reg)[0] = (uint8_t)(value >> 8);
+    REG(reg)[1] = (uint8_t)value;
+}
+
+static uint16_t Reg16(uint8_t reg)
+{
+    return (uint16_t)((REG(reg)[0] << 8) | REG(reg)[1]);
+}
+
+/* Temperature register of the slave, 0.0625 degC */
+static void Temp_Set(int16_t temp12)
+{
+    Reg16_Set(NCT375_REG_TEMP, NCT375_TEMP12_ENCODE(temp12));
+}
+
+static uint32_t Transactions(void)
+{
+    return I2C_Stats_Get()->transactions;
+}
+
+/* Waits for an asynchronous operation posted since start, returns its
+ * transactions. Nothing is queued if the shadows hold everything, the
+ * callback has been called by the request then. */
+static uint32_t Async(uint32_t start, i2c_error_code_t status)
+{
+    Sim_Run(sim_now + 1000000);
+    CHECK(completed == 1 && last_status == status && nct.InFlight == 0);
+    return Transactions() - start;
+}
+
+/* Faults of the next n transactions (all their attempts) */
+static void Fail(int n, uint8_t fault)
+{
+    int i;
+
+    for (i = 0; i < n * (I2C_RETRY_MAX + 1); i++)
+    {
+        sim_i2c_bus.script[sim_i2c_bus.script_length++].fault = fault;
+    }
+}
+
+/* Driver read, returns the pointer bytes written */
+static uint32_t Read(i2c_error_code_t status)
+{
+    uint32_t tx = sim_i2c_bus.bytes_tx;
+
+    completed = 0;
+    CHECK(nct375_driver.read(&nct, Done, &completed));
+    CHECK(nct375_driver.decode(&nct) == NCT375_TEMP_INVALID);
+    Sim_Run(sim_now + 40000);
+    CHECK(completed == 1 && last_status == status && nct.InFlight == 0);
+    return sim_i2c_bus.bytes_tx - tx;
+}
+
+int main(void)
+{
+    uint32_t start;
+    int i;
+
+    Sim_Reset();
+    Sim_I2C_Reset();
+    sim_i2c_bus.stride = 2;
+    I2C_Master_Init(0);
+    I2C_Recovery_Config(I2C_DIO_CFG, I2C_SCL_DIO_NUM, I2C_SDA_DIO_NUM);
+    nct375_driver.init(&nct, 0x48);
+    CHECK(nct375_driver.decode(&nct) == NCT375_TEMP_INVALID);
+
+    /* The pointer is written by the first read only */
+    Temp_Set(25 * 16);
+    CHECK(Read(I2C_ERRNO_NONE) == 1);
+    CHECK(nct375_driver.decode(&nct) == 2500);
+    Temp_Set(-10 * 16 - 8);
+    CHECK(Read(I2C_ERRNO_NONE) == 0);
+    CHECK(nct375_driver.decode(&nct) == -1050);
+
+    /* Sensor not answering: no stale temperature, the pointer is written
+     * again by the next read */
+    sim_i2c_bus.script_length = I2C_RETRY_MAX + 1;
+    sim_i2c_bus.script_pos = 0;
+    for (i = 0; i <= I2C_RETRY_MAX; i++)
+    {
+        sim_i2c_bus.script[i].fault = SIM_I2C_NACK_ADDRESS;
+    }
+    Read(I2C_ERRNO_NACK);
+    CHECK(nct375_driver.decode(&nct) == NCT375_TEMP_INVALID);
+    CHECK(Read(I2C_ERRNO_NONE) == 1);
+    CHECK(nct375_driver.decode(&nct) == -1050);
+
+    /* Second read queued while the first one is in flight: the pointer is
+     * written again, the first one may fail and leave it anywhere */
+    completed = 0;
+    CHECK(nct375_driver.read(&nct, Done, &completed));
+    CHECK(nct375_driver.read(&nct, Done, &completed));
+    CHECK(nct.InFlight == 2);
+    i = (int)sim_i2c_bus.bytes_tx;
+    Sim_Run(sim_now + 40000);
+    CHECK(completed == 2 && nct.InFlight == 0 && sim_i2c_bus.bytes_tx - i == 1);
+    CHECK(nct375_driver.decode(&nct) == -1050);
+
+    /* Batch read: the shadows loaded once, the temperature read each time */
+    REG(NCT375_REG_CONFIG)[0] = 0x18;
+    Reg16_Set(NCT375_REG_THYST, NCT375_TEMP12_ENCODE(75 * 16));
+    Reg16_Set(NCT375_REG_TOS, NCT375_TEMP12_ENCODE(80 * 16));
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Read_Async(&nct, NCT375_REG_BIT(NCT375_REG_TEMP) | NCT375_REG_BIT(NCT375_REG_CONFIG) |
+                                  NCT375_REG_BIT(NCT375_REG_THYST) | NCT375_REG_BIT(NCT375_REG_TOS),
+                            Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 4);
+    CHECK(nct.Temp == -1050 && nct.Config == 0x18 && nct.Thyst == 75 * 16 && nct.TOs == 80 * 16);
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Read_Async(&nct, NCT375_REG_BIT(NCT375_REG_TEMP) | NCT375_REG_BIT(NCT375_REG_CONFIG) |
+                                  NCT375_REG_BIT(NCT375_REG_THYST) | NCT375_REG_BIT(NCT375_REG_TOS),
+                            Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 1 && nct.Temp == -1050);
+    completed = 0;
+    CHECK(NCT375_Read_Async(&nct, NCT375_REG_BIT(NCT375_REG_CONFIG), Reg_Done, &completed));
+    CHECK(completed == 1 && Async(start, I2C_ERRNO_NONE) == 1);
+
+    /* Failing batch: one callback with the first error, the later error and
+     * the successful reads don't replace it, the shadows are invalid */
+    NCT375_Shadow_Invalidate(&nct);
+    sim_i2c_bus.script_length = 0;
+    sim_i2c_bus.script_pos = 0;
+    Fail(1, SIM_I2C_NACK_ADDRESS);
+    Fail(1, SIM_I2C_HANG);
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Read_Async(&nct, NCT375_REG_BIT(NCT375_REG_TEMP) | NCT375_REG_BIT(NCT375_REG_CONFIG) |
+                                  NCT375_REG_BIT(NCT375_REG_TOS),
+                            Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NACK) == 3);
+    CHECK(I2C_Stats_Get()->failures >= 2 && nct.Temp == NCT375_TEMP_INVALID);
+    CHECK(nct.Valid == NCT375_REG_BIT(NCT375_REG_TOS) && nct.TOs == 80 * 16);
+
+    /* Config read-modify-write: an invalid shadow read first, nothing written
+     * if the register already has the value */
+    NCT375_Shadow_Invalidate(&nct);
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Config_Async(&nct, NCT375_CONFIG_SHUTDOWN, NCT375_CONFIG_ONESHOT, Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 2);
+    CHECK(REG(NCT375_REG_CONFIG)[0] == (0x18 | NCT375_CONFIG_ONESHOT) && nct.Config == REG(NCT375_REG_CONFIG)[0]);
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_ONEShot_ModeOn(&nct, Reg_Done, &completed));
+    CHECK(completed == 1 && Async(start, I2C_ERRNO_NONE) == 0);
+    completed = 0;
+    CHECK(NCT375_ONEShot_ModeOff(&nct, Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 1 && REG(NCT375_REG_CONFIG)[0] == 0x18);
+
+    /* Limits: both written while the shadows are invalid, then only the
+     * changed one; read back from the shadows */
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Limits_Async(&nct, 70 * 16, 90 * 16, Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 2);
+    CHECK(Reg16(NCT375_REG_THYST) == NCT375_TEMP12_ENCODE(70 * 16));
+    CHECK(Reg16(NCT375_REG_TOS) == NCT375_TEMP12_ENCODE(90 * 16));
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Limits_Async(&nct, 70 * 16, 95 * 16, Reg_Done, &completed));
+    CHECK(Async(start, I2C_ERRNO_NONE) == 1 && Reg16(NCT375_REG_TOS) == NCT375_TEMP12_ENCODE(95 * 16));
+    start = Transactions();
+    completed = 0;
+    CHECK(NCT375_Read_Async(&nct, NCT375_REG_BIT(NCT375_REG_THYST) | NCT375_REG_BIT(NCT375_REG_TOS),
+                            Reg_Done, &completed));
+    CHECK(completed == 1 && Async(start, I2C_ERRNO_NONE) == 0);
+    CHECK(nct.Thyst == 70 * 16 && nct.TOs == 95 * 16);
+
+    puts("nct375: ok");
+    return 0;
+}
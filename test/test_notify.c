@@ -0,0 +1,113 @@
+/* ----------------------------------------------------------------------------
+ * test_notify.c
+ * - Notification policy: deadband, minimum interval with the held back
+ *   change, heartbeat, arrays, and the time base tick wrapping around
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Let time pass (s, or 1/32768 s ticks) */
+static void Wait(uint32_t seconds)
+{
+    Sim_Run(sim_now + (uint64_t)seconds * 1000000);
+}
+
+static void Wait_Tick(void)
+{
+    Sim_Run(sim_now + 31);
+}
+
+int main(void)
+{
+    uint8_t policy[NOTIFY_POLICY_SIZE];
+    int16_t array[NOTIFY_VALUES_MAX] = { 0 };
+    int16_t v;
+    int i;
+
+    Sim_Reset();
+    TimeBase_Init();
+    Notify_Init();
+
+    /* Minimum interval above the maximum interval, unknown channel */
+    CHECK(!Notify_Policy_Set(0, 1, 10, 5));
+    CHECK(!Notify_Policy_Set(9, 1, 0, 0));
+    CHECK(Notify_Policy_Set(0, 50, 5, 30));
+
+    /* Start one minute before the tick wraps around */
+    Sys_RTC_Config(60 * 32768, 0);
+
+    /* Nothing while disabled, the first value once enabled */
+    v = 2000;
+    CHECK(!Notify_Check(0, &v, 1, false));
+    CHECK(Notify_Check(0, &v, 1, true));
+
+    /* Below the deadband, then at least the deadband */
+    v = 2040;
+    Wait(10);
+    CHECK(!Notify_Check(0, &v, 1, true));
+    v = 2060;
+    Wait(1);
+    CHECK(Notify_Check(0, &v, 1, true));
+
+    /* Held back by the minimum interval, notified by the poll once it has
+     * elapsed */
+    v = 2200;
+    Wait(2);
+    CHECK(!Notify_Check(0, &v, 1, true));
+    Wait(1);
+    CHECK(!Notify_Poll(0, &v, 1, true));
+    Wait(2);
+    CHECK(Notify_Poll(0, &v, 1, true));
+    Wait(1);
+    CHECK(!Notify_Poll(0, &v, 1, true));
+
+    /* Heartbeat */
+    Wait(29);
+    CHECK(Notify_Poll(0, &v, 1, true));
+
+    /* A change held back that returns to the notified value is dropped */
+    Wait(1);
+    v = 2300;
+    CHECK(!Notify_Check(0, &v, 1, true));
+    v = 2200;
+    Wait(1);
+    CHECK(!Notify_Check(0, &v, 1, true));
+    Wait(5);
+    CHECK(!Notify_Poll(0, &v, 1, true));
+
+    /* Deadband 0: every value, without interval */
+    CHECK(Notify_Policy_Set(2, 0, 0, 0));
+    v = 7;
+    CHECK(Notify_Check(2, &v, 1, true));
+    Wait_Tick();
+    CHECK(Notify_Check(2, &v, 1, true));
+    CHECK(!Notify_Poll(2, &v, 1, true));
+
+    /* Long idle without heartbeat, checked every second: the elapsed time
+     * doesn't wrap */
+    CHECK(Notify_Policy_Set(3, 1, 10, 0));
+    v = -60;
+    CHECK(Notify_Check(3, &v, 1, true));
+    for (i = 0; i < 200000; i++)
+    {
+        Wait(1);
+        CHECK(!Notify_Check(3, &v, 1, true));
+    }
+    v = -50;
+    Wait(1);
+    CHECK(Notify_Check(3, &v, 1, true));
+
+    /* Arrays: any entry, up to the full int16 range */
+    CHECK(Notify_Policy_Set(1, 5, 0, 0));
+    CHECK(Notify_Check(1, array, NOTIFY_VALUES_MAX, true));
+    array[7] = 4;
+    CHECK(!Notify_Check(1, array, NOTIFY_VALUES_MAX, true));
+    array[7] = -32768;
+    CHECK(Notify_Check(1, array, NOTIFY_VALUES_MAX, true));
+
+    Notify_Policy_Value(policy);
+    CHECK(policy[0] == 50 && policy[2] == 5 && policy[4] == 30);
+
+    puts("notify: ok");
+    return 0;
+}
@@ -0,0 +1,298 @@
+/* ----------------------------------------------------------------------------
+ * test_racp.c
+ * - Record access control point over 20 days of samples with changing
+ *   periods and a sensor that comes and goes: History_Find against a brute
+ *   force search, reports by time and sequence number checked block by
+ *   block, count, delete, abort and the error responses
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define DAYS                            20
+#define BLOCKS_MAX                      200000
+
+/* Downloaded stream, RACP responses */
+static uint8_t stream[1 << 20];
+static uint32_t stream_length, stream_next;
+static int in_flight, gaps;
+static uint8_t response[RACP_SIZE];
+static int responses;
+
+/* Time of every block and running maximum of the times, by sequence
+ * number */
+static uint32_t block_time[BLOCKS_MAX], max_time[BLOCKS_MAX];
+static uint32_t track_pos, blocks;
+static long finds, exact;
+
+static void Notification(void *attr, const uint8_t *value, uint16_t length, uint16_t seq_num)
+{
+    uint32_t offset;
+
+    if (attr == app_env.racp)
+    {
+        memcpy(response, value, length);
+        responses++;
+        return;
+    }
+    CHECK(attr == app_env.history_data);
+    memcpy(&offset, value, 4);
+    if (stream_length && offset != stream_next)
+    {
+        gaps++;
+    }
+    memcpy(&stream[stream_length], value + HISTORY_PACKET_HEADER_SIZE,
+           length - HISTORY_PACKET_HEADER_SIZE);
+    stream_length += length - HISTORY_PACKET_HEADER_SIZE;
+    stream_next = offset + length - HISTORY_PACKET_HEADER_SIZE;
+    in_flight++;
+}
+
+/* Follow the blocks written to the history */
+static void Track(void)
+{
+    uint8_t data[CODEC_BLOCK_SIZE_MAX];
+    uint16_t length;
+
+    while (History_Block_Read(&track_pos, data, &length))
+    {
+        block_time[blocks] = Codec_Time(data, length);
+        max_time[blocks] = blocks ? MAX(max_time[blocks - 1], block_time[blocks]) : block_time[blocks];
+        blocks++;
+    }
+    CHECK(blocks == history_env.ring.seq);
+}
+
+/* Run a command to its end, the notifications completed as they come */
+static void Command(const uint8_t *command, int length)
+{
+    int n;
+
+    responses = 0;
+    stream_length = 0;
+    gaps = 0;
+    RACP_Command(command, length);
+    while (history_env.download)
+    {
+        n = in_flight;
+        in_flight = 0;
+        while (n--)
+        {
+            History_Sent(GAP_ERR_NO_ERROR);
+        }
+    }
+    CHECK(gaps == 0);
+}
+
+#define COMMAND(...)                                                        \
+    Command((const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ }))
+#define U32(x)                          (uint8_t)(x), (uint8_t)((x) >> 8), (uint8_t)((x) >> 16), (uint8_t)((x) >> 24)
+
+/* Sequence numbers of the first and last block of the stream, consecutive */
+static int Stream_Blocks(uint32_t *first, uint32_t *last)
+{
+    struct codec_block_tag block;
+    uint32_t pos = 0;
+    int n = 0;
+
+    while (pos < stream_length)
+    {
+        CHECK(Codec_Decode(&stream[pos], stream_length - pos, &block));
+        if (n == 0)
+        {
+            *first = block.seq;
+        }
+        else
+        {
+            CHECK(block.seq == *last + 1);
+        }
+        *last = block.seq;
+        n++;
+        pos += Codec_Size(&stream[pos]);
+    }
+    CHECK(pos == stream_length);
+    return n;
+}
+
+/* First block that can hold a sample at or after time: no earlier block,
+ * and at most the first one found by a full search */
+static void Check_Find(uint32_t time)
+{
+    struct history_ring_tag *ring = &history_env.ring;
+    uint32_t found = History_Find(time), brute = ring->seq, seq;
+
+    for (seq = ring->first; seq < ring->seq; seq++)
+    {
+        if (max_time[seq] >= time)
+        {
+            brute = seq;
+            break;
+        }
+    }
+    for (seq = ring->first; seq < found; seq++)
+    {
+        CHECK(block_time[seq] < time);
+    }
+    CHECK(found == ring->seq || max_time[found] >= time);
+    CHECK(brute <= found);
+    finds++;
+    exact += (found == brute);
+}
+
+static void Check_Reports(int round)
+{
+    struct history_ring_tag *ring = &history_env.ring;
+    uint32_t now = history_env.time, t, t2, count, s, seq, first, last;
+    int i;
+
+    for (i = 0; i < 20; i++)
+    {
+        Check_Find(now - rand() % (now + 10));
+    }
+    Check_Find(0);
+    Check_Find(now + 5);
+    Check_Find(max_time[ring->seq ? ring->seq - 1 : 0]);
+    History_Flush();
+    Track();
+
+    /* Count of all records */
+    COMMAND(RACP_OP_REPORT_COUNT, RACP_OPERATOR_ALL);
+    CHECK(responses == 1 && response[0] == RACP_OP_COUNT_RESPONSE);
+    count = response[2] | response[3] << 8;
+    CHECK(count == ring->seq - ring->first);
+
+    /* Records at or after a time */
+    t = now - rand() % 7200;
+    if (t > now)
+    {
+        t = rand() % (now + 1);
+    }
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_GREATER_OR_EQUAL, RACP_FILTER_TIME, U32(t));
+    Track();
+    if (stream_length)
+    {
+        CHECK(Stream_Blocks(&first, &last) > 0 && last == ring->seq - 1 && first == History_Find(t));
+        CHECK(responses == 1 && response[0] == RACP_OP_RESPONSE && response[2] == RACP_OP_REPORT &&
+              response[3] == RACP_SUCCESS);
+    }
+    else
+    {
+        CHECK(responses == 1 && response[3] == RACP_NO_RECORDS_FOUND);
+    }
+
+    /* Records within a time range */
+    t2 = t + rand() % 3600;
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_RANGE, RACP_FILTER_TIME, U32(t), U32(t2));
+    if (stream_length)
+    {
+        Stream_Blocks(&first, &last);
+        CHECK(first == History_Find(t) && last + 1 == History_Find(t2 + 1));
+        for (seq = first; seq <= last; seq++)
+        {
+            CHECK(max_time[seq] >= t && max_time[seq] <= t2);
+        }
+    }
+    else
+    {
+        CHECK(History_Find(t) == History_Find(t2 + 1) && response[3] == RACP_NO_RECORDS_FOUND);
+    }
+
+    /* Records up to a sequence number, last record */
+    s = ring->first + rand() % (ring->seq - ring->first + 1);
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_LESS_OR_EQUAL, RACP_FILTER_SEQ, U32(s));
+    if (stream_length)
+    {
+        Stream_Blocks(&first, &last);
+        CHECK(first == ring->first && last == MIN(s, ring->seq - 1));
+    }
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_LAST);
+    Stream_Blocks(&first, &last);
+    CHECK(first == ring->seq - 1 && last == first);
+
+    /* Errors */
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_NULL);
+    CHECK(response[3] == RACP_INVALID_OPERATOR);
+    COMMAND(RACP_OP_REPORT, 9);
+    CHECK(response[3] == RACP_OPERATOR_NOT_SUPPORTED);
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_RANGE, RACP_FILTER_SEQ, U32(5), U32(4));
+    CHECK(response[3] == RACP_INVALID_OPERAND);
+    COMMAND(RACP_OP_REPORT, RACP_OPERATOR_RANGE, 7, U32(5), U32(4));
+    CHECK(response[3] == RACP_OPERAND_NOT_SUPPORTED);
+    COMMAND(0x33, 0);
+    CHECK(response[3] == RACP_OPCODE_NOT_SUPPORTED);
+
+    /* Now and then delete up to a time */
+    if (round % 50 == 49)
+    {
+        t = now - 1800;
+        seq = History_Find(t + 1);
+        COMMAND(RACP_OP_DELETE, RACP_OPERATOR_LESS_OR_EQUAL, RACP_FILTER_TIME, U32(t));
+        if (seq != ring->first || response[3] == RACP_SUCCESS)
+        {
+            CHECK(response[3] == RACP_SUCCESS && ring->first == seq);
+        }
+        COMMAND(RACP_OP_DELETE, RACP_OPERATOR_LAST);
+        CHECK(response[3] == RACP_OPERATOR_NOT_SUPPORTED || response[3] == RACP_NO_RECORDS_FOUND ||
+              ring->first == ring->seq);
+    }
+
+    /* Commands during a report, abort */
+    RACP_Command((const uint8_t[]){ RACP_OP_REPORT, RACP_OPERATOR_ALL }, 2);
+    if (history_env.report)
+    {
+        responses = 0;
+        RACP_Command((const uint8_t[]){ RACP_OP_REPORT_COUNT, RACP_OPERATOR_ALL }, 2);
+        CHECK(response[3] == RACP_PROCEDURE_NOT_COMPLETED);
+        RACP_Command((const uint8_t[]){ RACP_OP_ABORT, RACP_OPERATOR_NULL }, 2);
+        CHECK(response[3] == RACP_SUCCESS && !history_env.download);
+    }
+    in_flight = 0;
+}
+
+int main(void)
+{
+    int16_t value[3] = { 0, 100, 200 };
+    uint32_t t;
+    int s, period = 5, round = 0;
+
+    Sim_Reset();
+    sim_ntf_hook = Notification;
+    srand(7);
+    TimeBase_Init();
+    History_Init();
+    Rollup_Init();
+    app_env.racp_cccd = ATT_CCC_START_NTF;
+
+    for (t = 0; t < DAYS * 86400; t++)
+    {
+        Sim_Run(sim_now + 1000000);
+        History_Tick();
+        if (t % 3600 == 0)
+        {
+            period = 1 + rand() % 120;
+        }
+        if (t % period == 0)
+        {
+            for (s = 0; s < 3; s++)
+            {
+                if (s == 2 && (t / 1800) % 3)
+                {
+                    continue;
+                }
+                value[s] += rand() % 5 - 2;
+                History_Add(s, value[s]);
+            }
+        }
+        Track();
+        flashlog_env.history_pos = track_pos;
+        if (t % 997 == 0)
+        {
+            Check_Reports(round++);
+        }
+    }
+    CHECK(sim_msg_used == 0);
+    printf("%u blocks, %u kept, %ld finds, %ld exact\n", blocks,
+           history_env.ring.seq - history_env.ring.first, finds, exact);
+
+    puts("racp: ok");
+    return 0;
+}
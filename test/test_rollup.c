@@ -0,0 +1,187 @@
+/* ----------------------------------------------------------------------------
+ * test_rollup.c
+ * - Rollup tiers over 40 days of samples with a period changing every day, a
+ *   sensor missing one hour out of five and values close to the int16
+ *   limits: every downloaded rollup against a reference mean, min and max;
+ *   incremental downloads from the last sequence number, one per day
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define DAYS                            40
+#define SENSORS                         3
+#define BUCKETS_MAX                     (DAYS * 86400 / ROLLUP_MINUTE_PERIOD + 1)
+
+/* Downloaded stream */
+static uint8_t stream[1 << 20];
+static uint32_t stream_length, stream_next;
+static int in_flight, gaps;
+
+/* Reference rollups: per tier, sensor and bucket */
+static int64_t ref_sum[ROLLUP_TIERS][SENSORS][BUCKETS_MAX];
+static int ref_count[ROLLUP_TIERS][SENSORS][BUCKETS_MAX];
+static int16_t ref_min[ROLLUP_TIERS][SENSORS][BUCKETS_MAX];
+static int16_t ref_max[ROLLUP_TIERS][SENSORS][BUCKETS_MAX];
+static const uint32_t period[ROLLUP_TIERS] = { ROLLUP_MINUTE_PERIOD, ROLLUP_QUARTER_PERIOD };
+
+static void Notification(void *attr, const uint8_t *value, uint16_t length, uint16_t seq_num)
+{
+    uint32_t offset;
+
+    if (attr != app_env.history_data)
+    {
+        return;
+    }
+    memcpy(&offset, value, 4);
+    if (stream_length && offset != stream_next)
+    {
+        gaps++;
+    }
+    memcpy(&stream[stream_length], value + HISTORY_PACKET_HEADER_SIZE,
+           length - HISTORY_PACKET_HEADER_SIZE);
+    stream_length += length - HISTORY_PACKET_HEADER_SIZE;
+    stream_next = offset + length - HISTORY_PACKET_HEADER_SIZE;
+    in_flight++;
+}
+
+static void Reference_Add(uint8_t sensor, int16_t value)
+{
+    uint32_t bucket;
+    int tier;
+
+    for (tier = 0; tier < ROLLUP_TIERS; tier++)
+    {
+        bucket = history_env.time / period[tier];
+        if (ref_count[tier][sensor][bucket] == 0)
+        {
+            ref_min[tier][sensor][bucket] = value;
+            ref_max[tier][sensor][bucket] = value;
+        }
+        ref_sum[tier][sensor][bucket] += value;
+        ref_count[tier][sensor][bucket]++;
+        ref_min[tier][sensor][bucket] = MIN(ref_min[tier][sensor][bucket], value);
+        ref_max[tier][sensor][bucket] = MAX(ref_max[tier][sensor][bucket], value);
+    }
+}
+
+/* Download a tier from a sequence number and check every rollup: only
+ * finished buckets, mean rounded to nearest */
+static int Download(uint8_t tier, uint32_t first, long *checked, uint32_t *last_seq)
+{
+    struct codec_rollup_tag block;
+    uint32_t pos = 0, bucket;
+    int64_t sum, mean;
+    int count, n, blocks = 0;
+
+    stream_length = 0;
+    gaps = 0;
+    History_Command((const uint8_t[]){ HISTORY_OP_ROLLUP, tier, (uint8_t)first, (uint8_t)(first >> 8),
+                                       (uint8_t)(first >> 16), (uint8_t)(first >> 24) }, 6);
+    while (history_env.download)
+    {
+        n = in_flight;
+        in_flight = 0;
+        while (n--)
+        {
+            History_Sent(GAP_ERR_NO_ERROR);
+        }
+    }
+    CHECK(gaps == 0);
+
+    while (pos < stream_length)
+    {
+        CHECK(Codec_Rollup_Decode(&stream[pos], stream_length - pos, &block));
+        CHECK(block.period == period[tier] && block.sensor < SENSORS);
+        for (n = 0; n < block.count; n++)
+        {
+            bucket = block.time / block.period + block.offset[n];
+            CHECK(bucket < history_env.time / period[tier]);
+            count = ref_count[tier][block.sensor][bucket];
+            CHECK(count > 0);
+            sum = ref_sum[tier][block.sensor][bucket];
+            mean = sum >= 0 ? (sum + count / 2) / count : (sum - count / 2) / count;
+            CHECK(block.mean[n] == mean);
+            CHECK(block.min[n] == ref_min[tier][block.sensor][bucket]);
+            CHECK(block.max[n] == ref_max[tier][block.sensor][bucket]);
+            (*checked)++;
+        }
+        *last_seq = block.seq;
+        blocks++;
+        pos += Codec_Rollup_Size(&stream[pos]);
+    }
+    CHECK(pos == stream_length);
+    return blocks;
+}
+
+int main(void)
+{
+    struct history_ring_tag *ring;
+    uint32_t t, last_seq[ROLLUP_TIERS] = { 0 }, seq;
+    long checked[ROLLUP_TIERS] = { 0 }, all;
+    int16_t value[SENSORS] = { 2000, -500, 32000 };
+    int tier, s, sample_period = 7, blocks;
+
+    Sim_Reset();
+    sim_ntf_hook = Notification;
+    srand(3);
+    TimeBase_Init();
+    History_Init();
+    Rollup_Init();
+
+    for (t = 0; t < DAYS * 86400; t++)
+    {
+        Sim_Run(sim_now + 1000000);
+        History_Tick();
+        if (t % 86400 == 0)
+        {
+            sample_period = 1 + rand() % 200;
+        }
+        if (t % 86400 == 43210)
+        {
+            for (tier = 0; tier < ROLLUP_TIERS; tier++)
+            {
+                Download(tier, last_seq[tier] + (checked[tier] ? 1 : 0), &checked[tier], &last_seq[tier]);
+            }
+        }
+        if (t % sample_period)
+        {
+            continue;
+        }
+        for (s = 0; s < SENSORS; s++)
+        {
+            if (s == 1 && (t / 3600) % 5 == 0)
+            {
+                continue;
+            }
+            value[s] += rand() % 9 - 4;
+            if (rand() % 1000 == 0)
+            {
+                value[s] += rand() % 20001 - 10000;
+            }
+            if (s == 2 && value[s] < 30000)
+            {
+                value[s] = 32700;
+            }
+            value[s] = MIN(value[s], 32767 - 10);
+            Reference_Add(s, value[s]);
+            History_Add(s, value[s]);
+            Rollup_Add(s, value[s]);
+        }
+    }
+
+    for (tier = 0; tier < ROLLUP_TIERS; tier++)
+    {
+        ring = &rollup_env.tier[tier].ring;
+        all = 0;
+        blocks = Download(tier, 0, &all, &seq);
+        printf("tier %d: %u bytes, %d blocks, %ld rollups kept (%.2f bytes each), "
+               "%.1f days of %d sensors, %ld checked incrementally\n",
+               tier, ring->size, blocks, all, (double)(ring->head - ring->tail) / all,
+               all / (double)SENSORS * period[tier] / 86400, SENSORS, checked[tier]);
+        CHECK(all > 0 && checked[tier] > 0);
+    }
+    CHECK(sim_msg_used == 0);
+
+    puts("rollup: ok");
+    return 0;
+}
@@ -0,0 +1,305 @@
+/* ----------------------------------------------------------------------------
+ * test_sampler.c
+ * - Sampler state machine with the NCT375 driver against the I2C model, in
+ *   each power mode: the I2C transactions per sample, the conversion, settle
+ *   and period waits of the sampler timer, the value published and notified
+ *   from the main loop (the kernel model checks that no message is sent from
+ *   an interrupt).
+ * - Full power and normal mode read the converting sensor once per sample,
+ *   normal mode shuts it down out of connection; one-shot mode triggers each
+ *   conversion; alert mode only reads on the ALERT line; gated mode cuts the
+ *   supply, no transaction is made while it is off.
+ * - A failed read publishes an invalid value that isn't recorded, the filter
+ *   stage runs a burst per sample and decimates, the adaptive period doubles
+ *   up to its maximum and is notified.
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+/* Publications seen by the main loop, notifications sent */
+static uint32_t published, temperature_ntf, period_ntf;
+
+/* I2C transactions when the supply was cut */
+static uint32_t supply_off_transactions;
+
+static uint32_t Transactions(void)
+{
+    return I2C_Stats_Get()->transactions;
+}
+
+static void Main_Loop(void)
+{
+    if (sampler_env.publish)
+    {
+        published++;
+    }
+    Sampler_Resume();
+}
+
+static void Notification(void *attr, const uint8_t *value, uint16_t length, uint16_t seq_num)
+{
+    if (attr == &app_env.temperature)
+    {
+        temperature_ntf++;
+    }
+    else if (attr == &app_env.sample_period)
+    {
+        period_ntf++;
+    }
+}
+
+/* Registers of the slave, two bytes each, MSB first */
+#define REG(reg)                        (&sim_i2c_bus.mem[(reg) * 2])
+
+static void Reg16_Set(uint8_t reg, uint16_t value)
+{
+    REG(reg)[0] = (uint8_t)(value >> 8);
+    REG(reg)[1] = (uint8_t)value;
+}
+
+static uint16_t Reg16(uint8_t reg)
+{
+    return (uint16_t)((REG(reg)[0] << 8) | REG(reg)[1]);
+}
+
+/* Temperature register of the slave, 0.0625 degC */
+static void Temp_Set(int16_t temp12)
+{
+    Reg16_Set(NCT375_REG_TEMP, NCT375_TEMP12_ENCODE(temp12));
+}
+
+static uint8_t Config_Mode(void)
+{
+    return REG(NCT375_REG_CONFIG)[0] & NCT375_CONFIG_MODE_MASK;
+}
+
+/* Sensor supply: cut with the bus and ALERT pads released, the registers
+ * back to their power-on values; nothing on the bus while it is off */
+static void Supply(uint32_t dio, bool high)
+{
+    if (dio != I2C_PWR_DIO_NUM)
+    {
+        return;
+    }
+    if (!high)
+    {
+        CHECK(sim_dio_cfg[I2C_SCL_DIO_NUM] == (DIO_MODE_DISABLE | DIO_NO_PULL));
+        CHECK(sim_dio_cfg[I2C_SDA_DIO_NUM] == (DIO_MODE_DISABLE | DIO_NO_PULL));
+        CHECK(sim_dio_cfg[NCT375_ALERT_DIO_NUM] == (DIO_MODE_DISABLE | DIO_NO_PULL));
+        supply_off_transactions = Transactions();
+        REG(NCT375_REG_CONFIG)[0] = 0;
+        Reg16_Set(NCT375_REG_THYST, NCT375_TEMP12_ENCODE(75 * 16));
+        Reg16_Set(NCT375_REG_TOS, NCT375_TEMP12_ENCODE(80 * 16));
+        sim_i2c_bus.pointer = NCT375_REG_TEMP;
+    }
+    else if (sampler_env.mode == SAMPLER_MODE_GATED)
+    {
+        CHECK(Transactions() == supply_off_transactions);
+    }
+}
+
+/* Runs until n more samples have been published (70 s at most each) */
+static void Publish(uint32_t n)
+{
+    uint32_t target = published + n;
+    uint64_t deadline = sim_now + (uint64_t)n * 70000000;
+
+    while (published < target)
+    {
+        CHECK(sim_now < deadline);
+        Sim_Run(sim_now + 1000);
+    }
+}
+
+/* n samples from a publication: transactions per sample and sampler timer
+ * waits per sample (the period started by the last publication is the last
+ * wait of each sample) */
+static void Samples(uint32_t n, uint32_t transactions, const uint32_t *waits, uint32_t nb_waits)
+{
+    uint32_t start = Transactions();
+    uint32_t i;
+
+    sim_timer[SAMPLER_TIMER].starts = 0;
+    Publish(n);
+    CHECK(Transactions() - start == n * transactions);
+    CHECK(sim_timer[SAMPLER_TIMER].starts == n * nb_waits);
+    for (i = 0; i < n * nb_waits; i++)
+    {
+        CHECK(sim_timer[SAMPLER_TIMER].log[i] == waits[i % nb_waits]);
+    }
+}
+
+static void Mode_Set(uint8_t mode)
+{
+    CHECK(Sampler_Mode_Set(mode));
+    Publish(1);
+}
+
+int main(void)
+{
+    static const uint32_t period[] = { SAMPLER_PERIOD_TICKS };
+    static const uint32_t one_shot[] = { NCT375_CONVERSION_TICKS, SAMPLER_PERIOD_TICKS };
+    static const uint32_t gated[] = { SAMPLER_SUPPLY_SETTLE_TICKS, NCT375_CONVERSION_TICKS, SAMPLER_PERIOD_TICKS };
+    static const uint32_t burst[] = { NCT375_CONVERSION_TICKS, NCT375_CONVERSION_TICKS, SAMPLER_PERIOD_TICKS };
+    const struct filter_param_tag filter_default = FILTER_PARAM_DEFAULT;
+    const struct filter_param_tag filter_burst = { 3, FILTER_TYPE_NONE, 0, 1 };
+    const struct filter_param_tag filter_iir = { 1, FILTER_TYPE_IIR, 1, 2 };
+    uint32_t transactions, count, ticks;
+    int i;
+
+    Sim_Reset();
+    Sim_I2C_Reset();
+    sim_i2c_bus.stride = 2;
+    sim_gpio_hook[1] = Supply;
+    sim_thread = Main_Loop;
+    sim_ntf_hook = Notification;
+    app_env.temperature_cccd_value = ATT_CCC_START_NTF;
+    app_env.sample_period_cccd = ATT_CCC_START_NTF;
+    I2C_Master_Init(0);
+    I2C_Recovery_Config(I2C_DIO_CFG, I2C_SCL_DIO_NUM, I2C_SDA_DIO_NUM);
+    Sys_I2C_DIOConfig(I2C_DIO_CFG, I2C_SCL_DIO_NUM, I2C_SDA_DIO_NUM);
+    Sys_DIO_Config(I2C_PWR_DIO_NUM, DIO_MODE_GPIO_OUT_1);
+    Sys_DIO_Config(NCT375_ALERT_DIO_NUM, NCT375_ALERT_DIO_CFG);
+    TimeBase_Init();
+    History_Init();
+    Rollup_Init();
+    Stats_Init();
+    Notify_Init();
+    Sampler_Init();
+    NCT375_Sensors_Add();
+    CHECK(sampler_env.nb_sensor == 1 && sampler_env.sensor[0].driver == &nct375_driver);
+    Temp_Set(25 * 16);
+
+    /* Full power: shut down by the start, then put in continuous conversion;
+     * afterwards one read frame per sample at the sample period */
+    Sampler_Start();
+    Publish(1);
+    CHECK(Transactions() == 4 && Config_Mode() == 0);
+    CHECK(app_env.temperature == 2500 && app_env.temperature_all[0] == 2500 &&
+          app_env.temperature_all[1] == SENSOR_VALUE_INVALID);
+    CHECK(temperature_ntf == 1 && stats_env.sensor[0].count == 1);
+    transactions = sim_i2c_bus.bytes_tx;
+    Samples(3, 1, period, 1);
+    CHECK(sim_i2c_bus.bytes_tx == transactions && temperature_ntf == 1);
+    Temp_Set(-10 * 16 - 8);
+    Publish(1);
+    CHECK(app_env.temperature == -1050 && temperature_ntf == 2);
+
+    /* Sensor not answering: an invalid value is published and not recorded,
+     * the next read writes the pointer again */
+    count = stats_env.sensor[0].count;
+    sim_i2c_bus.script_length = I2C_RETRY_MAX + 1;
+    sim_i2c_bus.script_pos = 0;
+    for (i = 0; i <= I2C_RETRY_MAX; i++)
+    {
+        sim_i2c_bus.script[i].fault = SIM_I2C_NACK_ADDRESS;
+    }
+    Publish(1);
+    CHECK(app_env.temperature == SENSOR_VALUE_INVALID && stats_env.sensor[0].count == count);
+    CHECK(sampler_env.value[0] == SENSOR_VALUE_INVALID);
+    transactions = sim_i2c_bus.bytes_tx;
+    Publish(1);
+    CHECK(app_env.temperature == -1050 && stats_env.sensor[0].count == count + 1);
+    CHECK(sim_i2c_bus.bytes_tx == transactions + 1);
+
+    /* One-shot: a trigger and a read per sample, with the conversion wait */
+    Mode_Set(SAMPLER_MODE_ONE_SHOT);
+    Samples(3, 2, one_shot, 2);
+    CHECK(Config_Mode() == NCT375_CONFIG_ONESHOT);
+
+    /* Normal: continuous conversion while connected, shut down and polled
+     * without sampling out of connection */
+    Mode_Set(SAMPLER_MODE_NORMAL);
+    Samples(3, 1, period, 1);
+    CHECK(Config_Mode() == 0);
+    ble_env.state = 0;
+    count = published;
+    transactions = Transactions();
+    Sim_Run(sim_now + 5000000);
+    CHECK(published == count && Transactions() == transactions + 1);
+    CHECK(Config_Mode() == NCT375_CONFIG_SHUTDOWN);
+    ble_env.state = APPM_CONNECTED;
+    Publish(1);
+    Samples(2, 1, period, 1);
+
+    /* Alert: the limits programmed and the sensor left converting, the
+     * current value published once, then nothing until the ALERT line */
+    Mode_Set(SAMPLER_MODE_ALERT);
+    CHECK(Config_Mode() == NCT375_CONFIG_ALERT);
+    CHECK(Reg16(NCT375_REG_THYST) == NCT375_TEMP12_ENCODE(NCT375_TEMP_TO_LIMIT(NCT375_THYST_DEFAULT)));
+    CHECK(Reg16(NCT375_REG_TOS) == NCT375_TEMP12_ENCODE(NCT375_TEMP_TO_LIMIT(NCT375_TOS_DEFAULT)));
+    CHECK(!sim_timer[SAMPLER_TIMER].armed);
+    count = published;
+    transactions = Transactions();
+    Sim_Run(sim_now + 10000000);
+    CHECK(published == count && Transactions() == transactions);
+    Temp_Set(85 * 16);
+    count = temperature_ntf;
+    Sim_Irq_Pend(NCT375_ALERT_IRQn);
+    Publish(1);
+    CHECK(Transactions() == transactions + 1 && app_env.temperature == 8500 && temperature_ntf == count + 1);
+    CHECK(!sim_timer[SAMPLER_TIMER].armed);
+    CHECK(NCT375_Limits_Set(7000, 9000));
+    Publish(1);
+    CHECK(Reg16(NCT375_REG_TOS) == NCT375_TEMP12_ENCODE(NCT375_TEMP_TO_LIMIT(9000)));
+
+    /* Gated: the supply restored and settled, the power-on configuration read
+     * and kept, the temperature read, the supply cut again */
+    Temp_Set(25 * 16);
+    Mode_Set(SAMPLER_MODE_GATED);
+    Samples(3, 2, gated, 3);
+    CHECK(!sampler_env.supplied && sim_dio_cfg[I2C_PWR_DIO_NUM] == DIO_MODE_GPIO_OUT_0);
+    CHECK(app_env.temperature == 2500);
+
+    /* Back to full power: the supply restored before the sensor is configured */
+    Mode_Set(SAMPLER_MODE_FULL_POWER);
+    CHECK(sampler_env.supplied && sim_dio_cfg[I2C_SCL_DIO_NUM] == I2C_DIO_CFG);
+    Samples(2, 1, period, 1);
+
+    /* Filter stage: a burst of three conversions per sample, then an IIR
+     * filter published every second output */
+    CHECK(Sampler_Filter_Set(&filter_burst));
+    Publish(1);
+    Samples(2, 3, burst, 3);
+    CHECK(Sampler_Filter_Set(&filter_iir));
+    Publish(1);
+    CHECK(app_env.temperature == 2500);
+    count = stats_env.sensor[0].count;
+    Temp_Set(35 * 16);
+    Publish(1);
+    CHECK(app_env.temperature == 3250 && stats_env.sensor[0].count == count + 1);
+    CHECK(sampler_env.value[0] == 3250);
+    CHECK(Sampler_Filter_Set(&filter_default));
+    Publish(1);
+
+    /* Adaptive period: doubled after each stable sample up to one minute,
+     * each change notified from the main loop, back to the fast period on a
+     * fast change */
+    period_ntf = 0;
+    sim_timer[SAMPLER_TIMER].starts = 0;
+    CHECK(Sampler_Rate_Set(60, 100));
+    ticks = SAMPLER_PERIOD_TICKS;
+    for (i = 0; ticks < 60 * SAMPLER_TICKS_PER_S; i++)
+    {
+        Publish(1);
+        ticks = MIN(2 * ticks, 60 * SAMPLER_TICKS_PER_S);
+        CHECK(sampler_env.period == ticks && period_ntf == (uint32_t)i + 1);
+        CHECK(app_env.sample_period == Sampler_Period_Ms());
+        CHECK(sim_timer[SAMPLER_TIMER].log[i + 1] == ticks);
+    }
+    CHECK(app_env.sample_period == 60000);
+    Publish(1);
+    CHECK(period_ntf == (uint32_t)i);
+    Temp_Set(30 * 16);
+    Publish(1);
+    CHECK(sampler_env.period == SAMPLER_PERIOD_TICKS && period_ntf == (uint32_t)i + 1);
+    CHECK(app_env.sample_period == Sampler_Period_Ms());
+    CHECK(Sampler_Rate_Set(SAMPLER_RATE_MAX_PERIOD_DEFAULT, SAMPLER_RATE_THRESHOLD_DEFAULT));
+    Publish(1);
+    Samples(2, 1, period, 1);
+
+    CHECK(sim_msg_used == 0);
+    printf("%u samples, %u I2C transactions\n", published, Transactions());
+    puts("sampler: ok");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* ----------------------------------------------------------------------------
+ * test_settings.c
+ * - Settings against the main flash model: values restored after a reset,
+ *   nothing programmed for an unchanged value, copies between the two
+ *   sectors, and a power cut at every erase and word pair write over three
+ *   copies: after the reset every key has its last stored value, the one
+ *   being written its old or new value, and the settings go on
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+
+#define WRITES                          (3 * SETTINGS_SECTOR_SIZE / SETTINGS_RECORD_SIZE)
+
+/* Values stored, the write in progress */
+static uint32_t value[SETTINGS_KEY_MAX];
+static bool valid[SETTINGS_KEY_MAX];
+static uint8_t pending_key;
+static uint32_t pending_value;
+
+static void Write(uint8_t key, uint32_t v)
+{
+    pending_key = key;
+    pending_value = v;
+    CHECK(Settings_Write(key, v));
+    value[key] = v;
+    valid[key] = true;
+}
+
+static void Write_Random(void)
+{
+    Write((uint8_t)(rand() % SETTINGS_KEY_MAX), (uint32_t)rand() * 2654435761U);
+}
+
+/* Reset: the stored values are loaded, the write cut by the reset may have
+ * been stored or not */
+static void Reset(void)
+{
+    uint8_t key;
+
+    Settings_Init();
+    for (key = 0; key < SETTINGS_KEY_MAX; key++)
+    {
+        if (key == pending_key && settings_env.valid[key] && settings_env.value[key] == pending_value)
+        {
+            value[key] = pending_value;
+            valid[key] = true;
+        }
+        CHECK(settings_env.valid[key] == valid[key]);
+        CHECK(!valid[key] || Settings_Read(key, 0) == value[key]);
+    }
+}
+
+int main(void)
+{
+    static uint8_t snapshot[SIM_FLASH_SIZE];
+    static uint32_t snapshot_value[SETTINGS_KEY_MAX];
+    static bool snapshot_valid[SETTINGS_KEY_MAX];
+    static uint32_t cut, cuts, copies, writes;
+    uint32_t i, generation;
+
+    Sim_Reset();
+    Sim_Flash_Erase_All();
+    srand(5);
+
+    /* Sectors not erased, nothing stored yet */
+    for (i = 0; i < SETTINGS_FLASH_SIZE; i++)
+    {
+        ((uint8_t *)SETTINGS_FLASH_ADDR)[i] = (uint8_t)rand();
+    }
+    Settings_Init();
+    CHECK(settings_env.sector == 0 && Settings_Read(SETTINGS_KEY_SENSOR_MODE, 7) == 7);
+
+    /* The first write sets up a sector, an unchanged value isn't programmed */
+    Write(SETTINGS_KEY_SENSOR_MODE, 2);
+    CHECK(sim_flash_erases == 1 && sim_flash_writes == 2);
+    Write(SETTINGS_KEY_SENSOR_MODE, 2);
+    CHECK(sim_flash_writes == 2);
+    Reset();
+    CHECK(Settings_Read(SETTINGS_KEY_SENSOR_MODE, 7) == 2);
+
+    /* Copies alternate between the sectors, an erase per sector full of
+     * records */
+    generation = settings_env.generation;
+    for (i = 0; i < WRITES; i++)
+    {
+        Write_Random();
+        if (i % 97 == 0)
+        {
+            Reset();
+        }
+    }
+    Reset();
+    copies = settings_env.generation - generation;
+    CHECK(copies >= 3 && sim_flash_erases == 1 + copies);
+    CHECK(settings_env.sector ==
+          SETTINGS_FLASH_ADDR + (1 - settings_env.generation % 2) * SETTINGS_SECTOR_SIZE);
+
+    /* Power cut at every flash operation of the writes that fill a sector
+     * twice and more */
+    memcpy(snapshot, sim_flash, sizeof(snapshot));
+    memcpy(snapshot_value, value, sizeof(value));
+    memcpy(snapshot_valid, valid, sizeof(valid));
+    for (cut = 0;; cut++)
+    {
+        memcpy(sim_flash, snapshot, sizeof(snapshot));
+        memcpy(value, snapshot_value, sizeof(value));
+        memcpy(valid, snapshot_valid, sizeof(valid));
+        pending_key = SETTINGS_KEY_MAX;
+        Reset();
+        generation = settings_env.generation;
+        srand(cut);
+
+        sim_flash_cut = (int32_t)cut;
+        if (setjmp(sim_flash_cut_jump) == 0)
+        {
+            for (writes = 0; writes < 2 * SETTINGS_SECTOR_SIZE / SETTINGS_RECORD_SIZE + 10; writes++)
+            {
+                Write_Random();
+            }
+            if (sim_flash_cut >= 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            cuts++;
+        }
+        sim_flash_cut = -1;
+        Reset();
+        for (writes = 0; writes < SETTINGS_SECTOR_SIZE / SETTINGS_RECORD_SIZE; writes++)
+        {
+            Write_Random();
+        }
+        pending_key = SETTINGS_KEY_MAX;
+        Reset();
+        CHECK(settings_env.generation != generation);
+    }
+    CHECK(cuts == cut && cuts > 2 * SETTINGS_SECTOR_SIZE / SETTINGS_RECORD_SIZE);
+
+    printf("%u copies, %u power cuts\n", copies, cuts);
+    puts("settings: ok");
+    return 0;
+}
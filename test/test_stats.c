@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+ * test_stats.c
+ * - Running statistics against a double precision reference: a slowly
+ *   varying temperature, a sensor alternating between the int16 limits (as
+ *   long as m2 doesn't saturate) and a sparse sensor; reset of one sensor
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+#include <math.h>
+
+#define SAMPLES                         2000000
+#define SENSORS                         3
+
+struct stats_entry_tag
+{
+    uint32_t count;
+    int16_t min;
+    int16_t max;
+    int32_t mean;
+    uint32_t variance;
+};
+
+static struct stats_entry_tag Entry(const uint8_t *value, int sensor)
+{
+    struct stats_entry_tag e;
+    const uint8_t *p = value + sensor * STATS_ENTRY_SIZE;
+
+    memcpy(&e.count, p, 4);
+    memcpy(&e.min, p + 4, 2);
+    memcpy(&e.max, p + 6, 2);
+    memcpy(&e.mean, p + 8, 4);
+    memcpy(&e.variance, p + 12, 4);
+    return e;
+}
+
+int main(void)
+{
+    static uint8_t value[STATS_SIZE];
+    double sum[SENSORS] = { 0 }, square[SENSORS] = { 0 };
+    long count[SENSORS] = { 0 };
+    int min[SENSORS], max[SENSORS];
+    int16_t x;
+    struct stats_entry_tag e;
+    double mean, variance;
+    long n;
+    int s;
+
+    Sim_Reset();
+    Stats_Init();
+    srand(1);
+    for (s = 0; s < SENSORS; s++)
+    {
+        min[s] = 32767;
+        max[s] = -32768;
+    }
+
+    for (n = 0; n < SAMPLES; n++)
+    {
+        for (s = 0; s < SENSORS; s++)
+        {
+            if (s == 0)
+            {
+                x = (int16_t)(2150 + (rand() % 41 - 20) + (int)(500 * sin(n / 2880.0)));
+            }
+            else if (s == 1 && n < 100000)
+            {
+                x = (n % 2) ? 32767 : -32768;
+            }
+            else if (s == 2 && n % 1000 == 0)
+            {
+                x = (int16_t)(100 + rand() % 7);
+            }
+            else
+            {
+                continue;
+            }
+            Stats_Add(s, x);
+            sum[s] += x;
+            square[s] += (double)x * x;
+            count[s]++;
+            min[s] = MIN(min[s], x);
+            max[s] = MAX(max[s], x);
+        }
+    }
+
+    Stats_Value(value);
+    for (s = 0; s < SENSORS; s++)
+    {
+        e = Entry(value, s);
+        mean = sum[s] / count[s];
+        variance = (square[s] - sum[s] * mean) / (count[s] - 1);
+        printf("sensor %d: %u samples, min %d max %d, mean %.4f (%.4f), variance %u (%.1f)\n",
+               s, e.count, e.min, e.max, e.mean / 256.0, mean, e.variance, variance);
+        CHECK(e.count == count[s] && e.min == min[s] && e.max == max[s]);
+        CHECK(fabs(e.mean / 256.0 - mean) <= 1.0 / 256);
+        CHECK(fabs(e.variance - variance) <= 1 + variance * 1e-4);
+    }
+
+    /* Reset of sensor 0 only */
+    Stats_Reset(1);
+    Stats_Value(value);
+    CHECK(Entry(value, 0).count == 0);
+    CHECK(Entry(value, 1).count == count[1]);
+
+    puts("stats: ok");
+    return 0;
+}
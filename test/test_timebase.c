@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * test_timebase.c
+ * - Time base: calendar conversions over the supported years, wall clock
+ *   error with a fast RC oscillator synchronized every 6 hours, rate change,
+ *   time zone change without drift update, invalid Current Time values
+ * ------------------------------------------------------------------------- */
+
+#include "sim.h"
+#include <time.h>
+
+/* Wall clock of the central at the start of the test (2026) */
+#define WALL_START                      1790000000.0
+
+/* Adjust reason of a sync from an external time reference */
+#define ADJUST_EXTERNAL                 0x02
+
+static double Wall(void)
+{
+    return WALL_START + sim_now / 1e6;
+}
+
+/* Current Time value of a UNIX time */
+static void Current_Time(double unix_time, uint8_t *value, uint8_t reason)
+{
+    time_t t = (time_t)unix_time;
+    struct tm tm;
+    uint16_t year;
+
+    gmtime_r(&t, &tm);
+    year = (uint16_t)(tm.tm_year + 1900);
+    memcpy(value, &year, 2);
+    value[2] = (uint8_t)(tm.tm_mon + 1);
+    value[3] = (uint8_t)tm.tm_mday;
+    value[4] = (uint8_t)tm.tm_hour;
+    value[5] = (uint8_t)tm.tm_min;
+    value[6] = (uint8_t)tm.tm_sec;
+    value[7] = (uint8_t)(tm.tm_wday ? tm.tm_wday : 7);
+    value[8] = (uint8_t)((unix_time - t) * 256);
+    value[9] = reason;
+}
+
+/* UNIX time of the device clock, with a check of the day of week */
+static double Device_Time(void)
+{
+    uint8_t value[TIMEBASE_CTS_SIZE];
+    struct tm tm = { 0 }, check;
+    uint16_t year;
+    time_t t;
+
+    TimeBase_Current_Time(value);
+    memcpy(&year, value, 2);
+    tm.tm_year = year - 1900;
+    tm.tm_mon = value[2] - 1;
+    tm.tm_mday = value[3];
+    tm.tm_hour = value[4];
+    tm.tm_min = value[5];
+    tm.tm_sec = value[6];
+    t = timegm(&tm);
+    gmtime_r(&t, &check);
+    CHECK(value[7] == (check.tm_wday ? check.tm_wday : 7));
+    return t + value[8] / 256.0;
+}
+
+/* Every day from 1970 to 2101 written and read back */
+static void Calendar(void)
+{
+    uint8_t value[TIMEBASE_CTS_SIZE];
+    double t;
+    uint32_t day;
+
+    TimeBase_Init();
+    for (day = 0; day < 48000; day++)
+    {
+        t = day * 86400.0 + (day % 86400) + 0.5;
+        Current_Time(t, value, TIMEBASE_ADJUST_MANUAL);
+        CHECK(TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+        CHECK(Device_Time() == t);
+    }
+}
+
+int main(void)
+{
+    uint8_t value[TIMEBASE_CTS_SIZE], status[TIMEBASE_STATUS_SIZE];
+    uint32_t seconds, last = 0;
+    int32_t drift, ppb;
+    double error;
+    int minute, i;
+
+    Sim_Reset();
+    Calendar();
+
+    /* RC oscillator 2.3 % fast, no time before the first sync */
+    TimeBase_Init();
+    Sim_Rtc_Rate(1.023);
+    TimeBase_Current_Time(value);
+    for (i = 0; i < TIMEBASE_CTS_SIZE; i++)
+    {
+        CHECK(value[i] == 0);
+    }
+
+    /* 8 days, synced after 10 minutes then every 6 hours with a latency of
+     * 40 ms; the oscillator changes by 10 ppm after 3.5 days */
+    for (minute = 0; minute < 8 * 24 * 60; minute++)
+    {
+        Sim_Run(sim_now + 60000000);
+        if (minute % 15 == 0)
+        {
+            seconds = TimeBase_Seconds();
+            CHECK(seconds >= last);
+            last = seconds;
+        }
+        if (minute == 10)
+        {
+            Current_Time(Wall(), value, 0);
+            CHECK(TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+        }
+        if (minute > 10 && minute % 360 == 0)
+        {
+            error = Device_Time() - Wall();
+            if (minute % 1440 == 0)
+            {
+                printf("day %.0f: error %.3f s before the sync, drift %d ppb\n", sim_now / 86400e6,
+                       error, (int)((int64_t)timebase_env.drift * 1000000000 >> 32));
+            }
+            CHECK(minute < 720 || (error < 0.5 && error > -0.5));
+            Current_Time(Wall() - 0.04, value, ADJUST_EXTERNAL);
+            CHECK(TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+        }
+        if (minute == 5000)
+        {
+            Sim_Rtc_Rate(1.02301);
+        }
+    }
+    error = Device_Time() - Wall();
+    printf("final error %.4f s\n", error);
+    CHECK(error < 0.3 && error > -0.3);
+
+    /* Time zone change: the wall clock moves, the drift doesn't */
+    drift = timebase_env.drift;
+    Current_Time(Wall() + 3600, value, TIMEBASE_ADJUST_TIME_ZONE);
+    CHECK(TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+    CHECK(timebase_env.drift == drift);
+    Sim_Run(sim_now + 7200000000ULL);
+    Current_Time(Wall() + 3600, value, 0);
+    CHECK(TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+
+    /* Invalid month, short value */
+    value[2] = 13;
+    CHECK(!TimeBase_Sync(value, TIMEBASE_CTS_SIZE));
+    CHECK(!TimeBase_Sync(value, 3));
+
+    TimeBase_Status(status);
+    memcpy(&ppb, &status[12], 4);
+    printf("status: drift %d ppb, %u syncs\n", ppb, status[16]);
+
+    puts("timebase: ok");
+    return 0;
+}